@@ -13,6 +13,8 @@ static HINSTANCE hInst;
 static Utf8Ini settings;
 static wchar_t szIniFile[MAX_PATH] = L"";
 static CRITICAL_SECTION csIni;
+static CBSETTINGCHANGED settingCallbacks[MAX_SETTING_CALLBACKS];
+static volatile LONG settingCallbackCount = 0;
 
 #ifdef _WIN64
 #define dbg_lib "x64dbg.dll"
@@ -119,6 +121,15 @@ BRIDGE_IMPEXP void BridgeFree(void* ptr)
         GlobalFree(ptr);
 }
 
+static void settingchanged(const char* section, const char* key)
+{
+    //called without holding csIni, so the callbacks can read the new value
+    LONG count = settingCallbackCount;
+    for(LONG i = 0; i < count && i < MAX_SETTING_CALLBACKS; i++)
+        if(settingCallbacks[i])
+            settingCallbacks[i](section, key);
+}
+
 BRIDGE_IMPEXP bool BridgeSettingGet(const char* section, const char* key, char* value)
 {
     if(!section || !key || !value)
@@ -162,6 +173,8 @@ BRIDGE_IMPEXP bool BridgeSettingSet(const char* section, const char* key, const
         else
             success = settings.SetValue(section, key, value);
         LeaveCriticalSection(&csIni);
+        if(success)
+            settingchanged(section, key);
     }
     return success;
 }
@@ -232,10 +245,22 @@ BRIDGE_IMPEXP bool BridgeSettingRead(int* errorLine)
         if(errorLine)
             *errorLine = errline;
         LeaveCriticalSection(&csIni);
+        settingchanged(nullptr, nullptr);
     }
     return success;
 }
 
+BRIDGE_IMPEXP bool BridgeSettingAddCallback(CBSETTINGCHANGED cbChanged)
+{
+    if(!cbChanged)
+        return false;
+    LONG index = InterlockedIncrement(&settingCallbackCount) - 1;
+    if(index >= MAX_SETTING_CALLBACKS)
+        return false;
+    settingCallbacks[index] = cbChanged;
+    return true;
+}
+
 BRIDGE_IMPEXP int BridgeGetDbgVersion()
 {
     return DBG_VERSION;
@@ -1021,6 +1046,13 @@ BRIDGE_IMPEXP const char* GuiReferenceGetCellContent(int row, int col)
 }
 
 
+//returns a copy of the cell text, free it with BridgeFree()
+BRIDGE_IMPEXP char* GuiReferenceGetCellContentCopy(int row, int col)
+{
+    return (char*)_gui_sendmessage(GUI_REF_GETCELLCONTENTCOPY, (void*)(duint)row, (void*)(duint)col);
+}
+
+
 BRIDGE_IMPEXP void GuiReferenceReloadData()
 {
     _gui_sendmessage(GUI_REF_RELOADDATA, 0, 0);
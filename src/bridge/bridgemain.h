@@ -40,8 +40,12 @@ extern "C"
 
 //Bridge defines
 #define MAX_SETTING_SIZE 65536
+#define MAX_SETTING_CALLBACKS 16
 #define DBG_VERSION 25
 
+//Bridge typedefs
+typedef void (*CBSETTINGCHANGED)(const char* section, const char* key); //section and key are nullptr when all settings changed
+
 //Bridge functions
 BRIDGE_IMPEXP const char* BridgeInit();
 BRIDGE_IMPEXP const char* BridgeStart();
@@ -53,6 +57,7 @@ BRIDGE_IMPEXP bool BridgeSettingSet(const char* section, const char* key, const
 BRIDGE_IMPEXP bool BridgeSettingSetUint(const char* section, const char* key, duint value);
 BRIDGE_IMPEXP bool BridgeSettingFlush();
 BRIDGE_IMPEXP bool BridgeSettingRead(int* errorLine);
+BRIDGE_IMPEXP bool BridgeSettingAddCallback(CBSETTINGCHANGED cbChanged);
 BRIDGE_IMPEXP int BridgeGetDbgVersion();
 
 //Debugger defines
@@ -789,7 +794,8 @@ typedef enum
     GUI_SET_DEBUGGEE_NOTES,         // param1=const char* text,     param2=unused
     GUI_GET_DEBUGGEE_NOTES,         // param1=char** text,          param2=unused
     GUI_DUMP_AT_N,                  // param1=int index,            param2=duint va
-    GUI_DISPLAY_WARNING             // param1=const char *text,     param2=unused
+    GUI_DISPLAY_WARNING,            // param1=const char *text,     param2=unused
+    GUI_REF_GETCELLCONTENTCOPY      // param1=int row,              param2=int col
 } GUIMSG;
 
 //GUI Typedefs
@@ -848,6 +854,7 @@ BRIDGE_IMPEXP void GuiReferenceDeleteAllColumns();
 BRIDGE_IMPEXP void GuiReferenceInitialize(const char* name);
 BRIDGE_IMPEXP void GuiReferenceSetCellContent(int row, int col, const char* str);
 BRIDGE_IMPEXP const char* GuiReferenceGetCellContent(int row, int col);
+BRIDGE_IMPEXP char* GuiReferenceGetCellContentCopy(int row, int col);
 BRIDGE_IMPEXP void GuiReferenceReloadData();
 BRIDGE_IMPEXP void GuiReferenceSetSingleSelection(int index, bool scroll);
 BRIDGE_IMPEXP void GuiReferenceSetProgress(int progress);
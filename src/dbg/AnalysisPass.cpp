@@ -18,7 +18,8 @@ AnalysisPass::AnalysisPass(duint VirtualStart, duint VirtualEnd, BBlockArray & M
 
     if(!MemRead(VirtualStart, m_Data, m_DataSize))
     {
-        BridgeFree(m_Data);
+        efree(m_Data, "AnalysisPass:m_Data");
+        m_Data = nullptr;
         assert(false);
     }
 }
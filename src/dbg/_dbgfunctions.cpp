@@ -86,8 +86,7 @@ static void _patchrestorerange(duint start, duint end)
     if(start > end)
         std::swap(start, end);
 
-    for(duint i = start; i <= end; i++)
-        PatchDelete(i, true);
+    PatchDelRange(start, end == ~duint(0) ? end : end + 1, true);
 
     GuiUpdatePatches();
 }
@@ -236,4 +235,7 @@ void dbgfunctionsinit()
     _dbgfunctions.GetSourceFromAddr = _getsourcefromaddr;
     _dbgfunctions.ValFromString = _valfromstring;
     _dbgfunctions.PatchGetEx = (PATCHGETEX)PatchGet;
+    _dbgfunctions.PatchEnumRange = (PATCHENUMRANGE)PatchEnumRange;
+    _dbgfunctions.PatchGetRange = PatchGetRange;
+    _dbgfunctions.PatchFileRange = (PATCHFILERANGE)PatchFileRange;
 }
@@ -13,6 +13,13 @@ typedef struct
     unsigned char newbyte;
 } DBGPATCHINFO;
 
+typedef struct
+{
+    char mod[MAX_MODULE_SIZE];
+    duint addr;
+    duint size;
+} DBGPATCHRANGE;
+
 typedef struct
 {
     duint addr;
@@ -69,6 +76,9 @@ typedef duint(*GETADDRFROMLINE)(const char* szSourceFile, int line);
 typedef bool (*GETSOURCEFROMADDR)(duint addr, char* szSourceFile, int* line);
 typedef bool (*VALFROMSTRING)(const char* string, duint* value);
 typedef bool(*PATCHGETEX)(duint addr, DBGPATCHINFO* info);
+typedef bool(*PATCHENUMRANGE)(DBGPATCHRANGE* rangelist, size_t* cbsize);
+typedef bool(*PATCHGETRANGE)(duint addr, duint size, unsigned char* oldbytes, unsigned char* newbytes);
+typedef int(*PATCHFILERANGE)(DBGPATCHRANGE* rangelist, int count, const char* szFileName, char* error);
 
 typedef struct DBGFUNCTIONS_
 {
@@ -108,6 +118,9 @@ typedef struct DBGFUNCTIONS_
     GETSOURCEFROMADDR GetSourceFromAddr;
     VALFROMSTRING ValFromString;
     PATCHGETEX PatchGetEx;
+    PATCHENUMRANGE PatchEnumRange;
+    PATCHGETRANGE PatchGetRange;
+    PATCHFILERANGE PatchFileRange;
 } DBGFUNCTIONS;
 
 #ifdef BUILD_DBG
@@ -119,18 +119,9 @@ static bool getLabel(duint addr, char* label)
         retval = true;
     else //no user labels
     {
-        DWORD64 displacement = 0;
-        char buffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME * sizeof(char)];
-        PSYMBOL_INFO pSymbol = (PSYMBOL_INFO)buffer;
-        pSymbol->SizeOfStruct = sizeof(SYMBOL_INFO);
-        pSymbol->MaxNameLen = MAX_LABEL_SIZE;
-        if(SafeSymFromAddr(fdProcessInfo->hProcess, (DWORD64)addr, &displacement, pSymbol) && !displacement)
-        {
-            pSymbol->Name[pSymbol->MaxNameLen - 1] = '\0';
-            if(!bUndecorateSymbolNames || !SafeUnDecorateSymbolName(pSymbol->Name, label, MAX_LABEL_SIZE, UNDNAME_COMPLETE))
-                strcpy_s(label, MAX_LABEL_SIZE, pSymbol->Name);
+        //symbol lookups are cached, the disassembly asks for the same addresses on every repaint
+        if(SymNameFromAddr(addr, label, MAX_LABEL_SIZE))
             retval = !shouldFilterSymbol(label);
-        }
         if(!retval)  //search for CALL <jmp.&user32.MessageBoxA>
         {
             BASIC_INSTRUCTION_INFO basicinfo;
@@ -140,11 +131,14 @@ static bool getLabel(duint addr, char* label)
                 duint val = 0;
                 if(MemRead(basicinfo.memory.value, &val, sizeof(val)))
                 {
-                    if(SafeSymFromAddr(fdProcessInfo->hProcess, (DWORD64)val, &displacement, pSymbol) && !displacement)
+                    char name[MAX_LABEL_SIZE] = "";
+                    bool undecorated = false;
+                    if(SymNameFromAddr(val, name, MAX_LABEL_SIZE, &undecorated))
                     {
-                        pSymbol->Name[pSymbol->MaxNameLen - 1] = '\0';
-                        if(!bUndecorateSymbolNames || !SafeUnDecorateSymbolName(pSymbol->Name, label, MAX_LABEL_SIZE, UNDNAME_COMPLETE))
-                            sprintf_s(label, MAX_LABEL_SIZE, "JMP.&%s", pSymbol->Name);
+                        if(undecorated)
+                            strcpy_s(label, MAX_LABEL_SIZE, name);
+                        else
+                            sprintf_s(label, MAX_LABEL_SIZE, "JMP.&%s", name);
                         retval = !shouldFilterSymbol(label);
                     }
                 }
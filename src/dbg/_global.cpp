@@ -4,6 +4,7 @@
 */
 
 #include "_global.h"
+#include "allocator.h"
 #include <objbase.h>
 #include <shlobj.h>
 
@@ -15,7 +16,7 @@ HINSTANCE hInst;
 /**
 \brief Number of allocated buffers by emalloc(). This should be 0 when x64dbg ends.
 */
-static int emalloc_count = 0;
+static volatile LONG emalloc_count = 0;
 
 /**
 \brief Path for debugging, used to create an allocation trace file on emalloc() or efree(). Not used.
@@ -32,14 +33,14 @@ void* emalloc(size_t size, const char* reason)
 {
     ASSERT_NONZERO(size);
 
-    unsigned char* a = (unsigned char*)GlobalAlloc(GMEM_FIXED, size);
+    unsigned char* a = (unsigned char*)PoolAlloc(size, reason);
     if(!a)
     {
         MessageBoxA(0, "Could not allocate memory", "Error", MB_ICONERROR);
         ExitProcess(1);
     }
     memset(a, 0, size);
-    emalloc_count++;
+    InterlockedIncrement(&emalloc_count);
     /*
     FILE* file = fopen(alloctrace, "a+");
     fprintf(file, "DBG%.5d:  alloc:" fhex ":%s:" fhex "\n", emalloc_count, a, reason, size);
@@ -73,13 +74,15 @@ void* erealloc(void* ptr, size_t size, const char* reason)
 */
 void efree(void* ptr, const char* reason)
 {
-    emalloc_count--;
+    if(!ptr)
+        return;
+    InterlockedDecrement(&emalloc_count);
     /*
     FILE* file = fopen(alloctrace, "a+");
     fprintf(file, "DBG%.5d:   free:" fhex ":%s\n", emalloc_count, ptr, reason);
     fclose(file);
     */
-    GlobalFree(ptr);
+    PoolFree(ptr);
 }
 
 void* json_malloc(size_t size)
@@ -341,8 +344,9 @@ bool ResolveShortcut(HWND hwnd, const wchar_t* szShortcutPath, char* szResolvedP
     return SUCCEEDED(hres);
 }
 
-void WaitForThreadTermination(HANDLE hThread)
+bool WaitForThreadTermination(HANDLE hThread, DWORD timeout)
 {
-    WaitForSingleObject(hThread, INFINITE);
+    bool terminated = WaitForSingleObject(hThread, timeout) == WAIT_OBJECT_0;
     CloseHandle(hThread);
+    return terminated;
 }
\ No newline at end of file
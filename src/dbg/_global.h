@@ -62,6 +62,8 @@ extern HINSTANCE hInst;
 void* emalloc(size_t size, const char* reason = "emalloc:???");
 void* erealloc(void* ptr, size_t size, const char* reason = "erealloc:???");
 void efree(void* ptr, const char* reason = "efree:???");
+void* ArenaAlloc(size_t size, const char* reason);
+void ArenaFree(void* ptr);
 void* json_malloc(size_t size);
 void json_free(void* ptr);
 int memleaks();
@@ -77,7 +79,7 @@ bool settingboolget(const char* section, const char* name);
 arch GetFileArchitecture(const char* szFileName);
 bool IsWow64();
 bool ResolveShortcut(HWND hwnd, const wchar_t* szShortcutPath, char* szResolvedPath, size_t nSize);
-void WaitForThreadTermination(HANDLE hThread);
+bool WaitForThreadTermination(HANDLE hThread, DWORD timeout = INFINITE);
 
 #include "dynamicmem.h"
 
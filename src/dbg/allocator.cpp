@@ -0,0 +1,310 @@
+/**
+\file allocator.cpp
+\brief Implements the size class pools behind emalloc(), the thread arena behind Memory<T> and the per tag allocation statistics.
+*/
+
+#include "allocator.h"
+#include "console.h"
+
+struct ALLOCTAGENTRY
+{
+    const char* volatile Tag;
+    volatile LONGLONG Allocations;
+    volatile LONGLONG Frees;
+    volatile LONGLONG TotalBytes;
+    volatile LONGLONG LiveBytes;
+};
+
+/**
+\brief Placed in front of every pool and arena allocation. It is 16 bytes on both architectures so the memory handed out keeps the alignment of the underlying block.
+*/
+struct ALLOCHEADER
+{
+    ALLOCTAGENTRY* Tag;
+    size_t Size;
+#ifndef _WIN64
+    size_t Reserved[2];
+#endif //_WIN64
+};
+
+struct ARENABLOCK
+{
+    ARENABLOCK* Next;
+    size_t Size; // Usable bytes after the block header
+    size_t Used;
+    size_t Live; // Arena allocations of the thread that were not freed, only maintained in the newest block
+};
+
+/**
+\brief Tag tables for pool (index 0) and arena (index 1) allocations. Entries are claimed with a compare exchange on the tag pointer and never released, so the hot path takes no lock.
+*/
+static ALLOCTAGENTRY tagTable[2][ALLOC_MAX_TAGS];
+static ALLOCTAGENTRY tagOverflow[2] = { { "<other>" }, { "<other>" } };
+
+/**
+\brief Free lists per size class. A zeroed SLIST_HEADER is an empty list, so no initialization is required before the first emalloc().
+*/
+static SLIST_HEADER poolFreeLists[ALLOC_POOL_CLASSES];
+
+/**
+\brief TLS slot holding the newest ARENABLOCK of every thread. This is a TlsAlloc() slot rather than __declspec(thread), because implicit TLS is not initialized in a DLL loaded with LoadLibrary before Windows Vista.
+*/
+static volatile DWORD arenaTlsIndex = TLS_OUT_OF_INDEXES;
+
+static DWORD arenatlsindex()
+{
+    if(arenaTlsIndex == TLS_OUT_OF_INDEXES)
+    {
+        DWORD index = TlsAlloc();
+        if(InterlockedCompareExchange((volatile LONG*)&arenaTlsIndex, LONG(index), LONG(TLS_OUT_OF_INDEXES)) != LONG(TLS_OUT_OF_INDEXES) && index != TLS_OUT_OF_INDEXES)
+            TlsFree(index); //another thread was first
+    }
+    return arenaTlsIndex;
+}
+
+static ALLOCTAGENTRY* tagentry(const char* Tag, bool Arena)
+{
+    if(!Tag)
+        Tag = "???";
+    auto table = tagTable[Arena ? 1 : 0];
+    auto hash = size_t((ULONG_PTR(Tag) >> 2) * 2654435761u);
+    for(size_t i = 0; i < ALLOC_MAX_TAGS; i++)
+    {
+        auto & entry = table[(hash + i) % ALLOC_MAX_TAGS];
+        const char* current = entry.Tag;
+        if(current == Tag)
+            return &entry;
+        if(!current)
+        {
+            current = (const char*)InterlockedCompareExchangePointer((PVOID volatile*)&entry.Tag, (PVOID)Tag, nullptr);
+            if(!current || current == Tag)
+                return &entry;
+        }
+    }
+    return &tagOverflow[Arena ? 1 : 0];
+}
+
+static void tagalloc(ALLOCTAGENTRY* Entry, size_t Size)
+{
+    InterlockedIncrement64(&Entry->Allocations);
+    InterlockedExchangeAdd64(&Entry->TotalBytes, LONGLONG(Size));
+    InterlockedExchangeAdd64(&Entry->LiveBytes, LONGLONG(Size));
+}
+
+static void tagfree(ALLOCTAGENTRY* Entry, size_t Size)
+{
+    InterlockedIncrement64(&Entry->Frees);
+    InterlockedExchangeAdd64(&Entry->LiveBytes, -LONGLONG(Size));
+}
+
+static int poolclass(size_t Size)
+{
+    if(Size <= 16)
+        return 0;
+    DWORD index;
+    _BitScanReverse(&index, DWORD(Size - 1));
+    return int(index) - 3;
+}
+
+static ALLOCHEADER* poolpop(int Class)
+{
+    auto entry = InterlockedPopEntrySList(&poolFreeLists[Class]);
+    if(entry)
+        return (ALLOCHEADER*)entry;
+
+    // Carve a new chunk into blocks of this class. Chunks are kept for the lifetime of the process.
+    auto stride = sizeof(ALLOCHEADER) + (size_t(16) << Class);
+    auto chunk = (unsigned char*)VirtualAlloc(nullptr, ALLOC_POOL_CHUNK, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if(!chunk)
+        return nullptr;
+    auto count = ALLOC_POOL_CHUNK / stride;
+    for(size_t i = 1; i < count; i++)
+        InterlockedPushEntrySList(&poolFreeLists[Class], (PSLIST_ENTRY)(chunk + i * stride));
+    return (ALLOCHEADER*)chunk;
+}
+
+/**
+\brief Allocates memory for emalloc(). Requests up to ALLOC_POOL_MAX bytes are served from lock-free size class free lists, larger ones from GlobalAlloc().
+\param Size The size of the buffer to allocate (in bytes).
+\param Tag The allocation reason, used as the statistics key.
+\return The (uninitialized) buffer, nullptr when out of memory.
+*/
+void* PoolAlloc(size_t Size, const char* Tag)
+{
+    ALLOCHEADER* header;
+    if(Size <= ALLOC_POOL_MAX)
+        header = poolpop(poolclass(Size));
+    else
+        header = (ALLOCHEADER*)GlobalAlloc(GMEM_FIXED, sizeof(ALLOCHEADER) + Size);
+    if(!header)
+        return nullptr;
+    header->Tag = tagentry(Tag, false);
+    header->Size = Size;
+    tagalloc(header->Tag, Size);
+    return header + 1;
+}
+
+/**
+\brief Frees memory allocated by PoolAlloc(). The statistics are charged to the tag the memory was allocated with.
+\param [in] Ptr The buffer to free, nullptr is ignored.
+*/
+void PoolFree(void* Ptr)
+{
+    if(!Ptr)
+        return;
+    auto header = (ALLOCHEADER*)Ptr - 1;
+    tagfree(header->Tag, header->Size);
+    if(header->Size <= ALLOC_POOL_MAX)
+        InterlockedPushEntrySList(&poolFreeLists[poolclass(header->Size)], (PSLIST_ENTRY)header);
+    else
+        GlobalFree(header);
+}
+
+/**
+\brief Allocates a scoped temporary from the bump arena of the calling thread. The memory must be freed with ArenaFree() on the same thread.
+\param size The size of the buffer to allocate (in bytes).
+\param reason The allocation reason, used as the statistics key.
+\return The (uninitialized) buffer, nullptr when \p size is zero or larger than ARENA_MAX_ALLOC. Use emalloc() in that case.
+*/
+void* ArenaAlloc(size_t size, const char* reason)
+{
+    if(!size || size > ARENA_MAX_ALLOC)
+        return nullptr;
+    auto tlsIndex = arenatlsindex();
+    if(tlsIndex == TLS_OUT_OF_INDEXES)
+        return nullptr;
+    auto total = sizeof(ALLOCHEADER) + ((size + 15) & ~size_t(15));
+    auto block = (ARENABLOCK*)TlsGetValue(tlsIndex);
+    if(!block || block->Used + total > block->Size)
+    {
+        auto newBlock = (ARENABLOCK*)VirtualAlloc(nullptr, ARENA_BLOCK_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        if(!newBlock)
+            return nullptr;
+        newBlock->Next = block;
+        newBlock->Size = ARENA_BLOCK_SIZE - sizeof(ARENABLOCK);
+        newBlock->Used = 0;
+        newBlock->Live = block ? block->Live : 0;
+        TlsSetValue(tlsIndex, newBlock);
+        block = newBlock;
+    }
+    auto header = (ALLOCHEADER*)((unsigned char*)(block + 1) + block->Used);
+    block->Used += total;
+    block->Live++;
+    header->Tag = tagentry(reason, true);
+    header->Size = size;
+    tagalloc(header->Tag, size);
+    return header + 1;
+}
+
+/**
+\brief Frees memory allocated by ArenaAlloc(). Frees in reverse allocation order (the order of stack objects) give the space back immediately, other space is reclaimed once every arena allocation of the thread is freed.
+\param [in] ptr The buffer to free.
+*/
+void ArenaFree(void* ptr)
+{
+    auto header = (ALLOCHEADER*)ptr - 1;
+    tagfree(header->Tag, header->Size);
+    auto block = (ARENABLOCK*)TlsGetValue(arenaTlsIndex);
+    auto total = sizeof(ALLOCHEADER) + ((header->Size + 15) & ~size_t(15));
+    if((unsigned char*)header + total == (unsigned char*)(block + 1) + block->Used)
+        block->Used -= total;
+    if(--block->Live == 0)
+    {
+        // Keep a single block around for the next temporaries
+        while(block->Next)
+        {
+            auto next = block->Next;
+            block->Next = next->Next;
+            VirtualFree(next, 0, MEM_RELEASE);
+        }
+        block->Used = 0;
+    }
+}
+
+/**
+\brief Releases the arena of the calling thread. Called from DllMain on DLL_THREAD_DETACH.
+*/
+void ArenaThreadExit()
+{
+    if(arenaTlsIndex == TLS_OUT_OF_INDEXES)
+        return;
+    auto block = (ARENABLOCK*)TlsGetValue(arenaTlsIndex);
+    while(block)
+    {
+        auto next = block->Next;
+        VirtualFree(block, 0, MEM_RELEASE);
+        block = next;
+    }
+    TlsSetValue(arenaTlsIndex, nullptr);
+}
+
+/**
+\brief Gets a snapshot of the allocation statistics. Tags with the same text (the same literal in different translation units) are merged.
+\param [out] Stats The statistics, one entry per tag and allocator.
+*/
+void AllocStatsGet(std::vector<ALLOCSTATS> & Stats)
+{
+    Stats.clear();
+    for(int arena = 0; arena < 2; arena++)
+    {
+        std::unordered_map<String, size_t> merged;
+        auto collect = [&](const ALLOCTAGENTRY & entry)
+        {
+            if(!entry.Tag || !entry.Allocations)
+                return;
+            auto found = merged.find(entry.Tag);
+            if(found == merged.end())
+            {
+                merged.insert({ entry.Tag, Stats.size() });
+                ALLOCSTATS stats;
+                stats.tag = entry.Tag;
+                stats.allocations = entry.Allocations;
+                stats.frees = entry.Frees;
+                stats.totalBytes = entry.TotalBytes;
+                stats.liveBytes = entry.LiveBytes;
+                stats.arena = arena != 0;
+                Stats.push_back(stats);
+            }
+            else
+            {
+                auto & stats = Stats[found->second];
+                stats.allocations += entry.Allocations;
+                stats.frees += entry.Frees;
+                stats.totalBytes += entry.TotalBytes;
+                stats.liveBytes += entry.LiveBytes;
+            }
+        };
+        for(const auto & entry : tagTable[arena])
+            collect(entry);
+        collect(tagOverflow[arena]);
+    }
+}
+
+/**
+\brief Prints the allocation statistics, sorted by the number of live bytes.
+\param LeaksOnly Only print the tags that still have allocations that were not freed.
+*/
+void AllocStatsPrint(bool LeaksOnly)
+{
+    std::vector<ALLOCSTATS> stats;
+    AllocStatsGet(stats);
+    std::sort(stats.begin(), stats.end(), [](const ALLOCSTATS & a, const ALLOCSTATS & b)
+    {
+        if(a.liveBytes != b.liveBytes)
+            return a.liveBytes > b.liveBytes;
+        return a.totalBytes > b.totalBytes;
+    });
+    for(const auto & entry : stats)
+    {
+        auto live = entry.allocations - entry.frees;
+        if(LeaksOnly && !live)
+            continue;
+        dprintf("%s%s: %lld allocation(s), %lld live (%lld bytes), %lld bytes total\n",
+                entry.tag,
+                entry.arena ? " (arena)" : "",
+                entry.allocations,
+                live,
+                entry.liveBytes,
+                entry.totalBytes);
+    }
+}
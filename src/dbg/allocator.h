@@ -0,0 +1,26 @@
+#pragma once
+
+#include "_global.h"
+
+#define ALLOC_POOL_CLASSES 9 // 16, 32, 64, ..., 4096 bytes
+#define ALLOC_POOL_MAX (16 << (ALLOC_POOL_CLASSES - 1))
+#define ALLOC_POOL_CHUNK (64 * 1024)
+#define ALLOC_MAX_TAGS 1024
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_MAX_ALLOC (32 * 1024)
+
+struct ALLOCSTATS
+{
+    const char* tag;
+    LONGLONG allocations; // Number of allocations made with this tag
+    LONGLONG frees;       // Number of those allocations that were freed
+    LONGLONG totalBytes;  // Bytes requested over the lifetime of the tag
+    LONGLONG liveBytes;   // Bytes currently allocated
+    bool arena;           // Allocations were served by the thread arena
+};
+
+void* PoolAlloc(size_t Size, const char* Tag);
+void PoolFree(void* Ptr);
+void ArenaThreadExit();
+void AllocStatsGet(std::vector<ALLOCSTATS> & Stats);
+void AllocStatsPrint(bool LeaksOnly);
@@ -5,6 +5,7 @@ Analysis::Analysis(duint base, duint size)
 {
     _base = base;
     _size = size;
+    _verbose = true;
     _data = new unsigned char[_size + MAX_DISASM_BUFFER];
     MemRead(_base, _data, _size);
 }
@@ -14,6 +15,11 @@ Analysis::~Analysis()
     delete[] _data;
 }
 
+void Analysis::SetVerbose(bool verbose)
+{
+    _verbose = verbose;
+}
+
 bool Analysis::IsValidAddress(duint addr)
 {
     return addr >= _base && addr < _base + _size;
@@ -12,11 +12,13 @@ public:
     virtual ~Analysis();
     virtual void Analyse() = 0;
     virtual void SetMarkers() = 0;
+    void SetVerbose(bool verbose);
 
 protected:
     duint _base;
     duint _size;
     unsigned char* _data;
+    bool _verbose;
     Capstone _cp;
 
     bool IsValidAddress(duint addr);
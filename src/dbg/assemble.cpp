@@ -10,6 +10,7 @@
 #include "value.h"
 #include "disasm_helper.h"
 #include "debugger.h"
+#include "assembleblock.h"
 
 static bool cbUnknown(const char* text, ULONGLONG* value)
 {
@@ -22,6 +23,146 @@ static bool cbUnknown(const char* text, ULONGLONG* value)
     return true;
 }
 
+struct ASSEMBLEBLOCK
+{
+    AssembleBlock<duint> block;
+    std::unordered_map<String, std::pair<bool, duint>> symbols; // expression -> cached valfromstring result
+};
+
+// TLS slot with the context of the block that is being assembled on the calling thread.
+// TlsAlloc() is used because implicit TLS (__declspec(thread)) does not work in a LoadLibrary'd DLL before Windows Vista.
+static volatile DWORD blockTlsIndex = TLS_OUT_OF_INDEXES;
+
+static DWORD blocktlsindex()
+{
+    if(blockTlsIndex == TLS_OUT_OF_INDEXES)
+    {
+        DWORD index = TlsAlloc();
+        if(InterlockedCompareExchange((volatile LONG*)&blockTlsIndex, LONG(index), LONG(TLS_OUT_OF_INDEXES)) != LONG(TLS_OUT_OF_INDEXES) && index != TLS_OUT_OF_INDEXES)
+            TlsFree(index); //another thread was first
+    }
+    return blockTlsIndex;
+}
+
+static bool cbUnknownBlock(const char* text, ULONGLONG* value)
+{
+    if(!text || !value)
+        return false;
+    auto block = (ASSEMBLEBLOCK*)TlsGetValue(blockTlsIndex);
+    if(!block)
+        return false;
+    duint label;
+    if(block->block.Resolve(text, label))
+    {
+        *value = label;
+        return true;
+    }
+
+    // Every expression is resolved only once per block
+    auto found = block->symbols.find(text);
+    if(found == block->symbols.end())
+    {
+        duint val = 0;
+        bool ok = valfromstring(text, &val);
+        found = block->symbols.insert(std::make_pair(String(text), std::make_pair(ok, val))).first;
+    }
+    if(!found->second.first)
+        return false;
+    *value = found->second.second;
+    return true;
+}
+
+static bool assembleline(duint addr, const String & instruction, unsigned char* dest, int* size, char* error)
+{
+    if(instruction.length() >= XEDPARSE_MAXBUFSIZE)
+    {
+        strcpy_s(error, MAX_ERROR_SIZE, "Instruction too long");
+        return false;
+    }
+    XEDPARSE parse;
+    memset(&parse, 0, sizeof(parse));
+#ifdef _WIN64
+    parse.x64 = true;
+#else //x86
+    parse.x64 = false;
+#endif
+    parse.cbUnknown = cbUnknownBlock;
+    parse.cip = addr;
+    strcpy_s(parse.instr, instruction.c_str());
+    if(XEDParseAssemble(&parse) == XEDPARSE_ERROR)
+    {
+        strcpy_s(error, MAX_ERROR_SIZE, parse.error);
+        return false;
+    }
+    memcpy(dest, parse.dest, parse.dest_size);
+    *size = parse.dest_size;
+    return true;
+}
+
+bool assembleblock(duint addr, const std::vector<String> & lines, std::vector<unsigned char> & dest, char* error)
+{
+    char localError[MAX_ERROR_SIZE] = "";
+    if(!error)
+        error = localError;
+    dest.clear();
+
+    ASSEMBLEBLOCK block;
+    String message;
+    if(!block.block.Parse(lines, message))
+    {
+        strncpy_s(error, MAX_ERROR_SIZE, message.c_str(), _TRUNCATE);
+        return false;
+    }
+
+    // XEDParse resolves the labels through cbUnknownBlock, which finds the block of the calling thread
+    auto tlsIndex = blocktlsindex();
+    if(tlsIndex == TLS_OUT_OF_INDEXES)
+    {
+        strcpy_s(error, MAX_ERROR_SIZE, "TlsAlloc failed");
+        return false;
+    }
+    auto previousBlock = (ASSEMBLEBLOCK*)TlsGetValue(tlsIndex);
+    TlsSetValue(tlsIndex, &block);
+    bool success = block.block.Relax(addr, [](duint Address, const String & Text, std::vector<unsigned char> & Bytes, String & Error)
+    {
+        unsigned char buffer[XEDPARSE_MAXASMSIZE];
+        int size = 0;
+        char lineError[MAX_ERROR_SIZE] = "";
+        if(!assembleline(Address, Text, buffer, &size, lineError))
+        {
+            Error = lineError;
+            return false;
+        }
+        Bytes.assign(buffer, buffer + size);
+        return true;
+    }, dest, message);
+    TlsSetValue(tlsIndex, previousBlock);
+    if(!success)
+        strncpy_s(error, MAX_ERROR_SIZE, message.c_str(), _TRUNCATE);
+    return success;
+}
+
+bool assembleblockat(duint addr, const std::vector<String> & lines, int* size, char* error)
+{
+    std::vector<unsigned char> dest;
+    if(!assembleblock(addr, lines, dest, error))
+        return false;
+    if(size)
+        *size = int(dest.size());
+    if(dest.empty())
+        return true;
+
+    // The whole block is written (and recorded as one patch extent) at once
+    if(!MemPatch(addr, dest.data(), dest.size()))
+    {
+        if(error)
+            strcpy_s(error, MAX_ERROR_SIZE, "Error while writing process memory");
+        return false;
+    }
+    GuiUpdatePatches();
+    return true;
+}
+
 bool assemble(duint addr, unsigned char* dest, int* size, const char* instruction, char* error)
 {
     if(strlen(instruction) >= XEDPARSE_MAXBUFSIZE)
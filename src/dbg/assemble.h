@@ -12,6 +12,8 @@ enum INSTR_POINTING_TO
 
 bool assemble(duint addr, unsigned char* dest, int* size, const char* instruction, char* error);
 bool assembleat(duint addr, const char* instruction, int* size, char* error, bool fillnop);
+bool assembleblock(duint addr, const std::vector<String> & lines, std::vector<unsigned char> & dest, char* error);
+bool assembleblockat(duint addr, const std::vector<String> & lines, int* size, char* error);
 INSTR_POINTING_TO isInstructionPointingToExMemory(duint addr, const unsigned char* dest);
 
 #endif // _ASSEMBLE_H
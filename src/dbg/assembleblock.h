@@ -0,0 +1,169 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#define MAX_RELAXATION_PASSES 16
+
+/**
+\brief Labels and branch relaxation of a block of instructions. The encoder is passed in, so this header does not depend on XEDParse or the Windows types and can be tested on its own.
+*/
+template<typename Address>
+class AssembleBlock
+{
+public:
+    AssembleBlock()
+        : m_Unresolved(0)
+    {
+    }
+
+    /**
+    \brief Splits the lines into labels ("name:") and instructions, comments start with ';'.
+    \return false on an empty or duplicate label.
+    */
+    bool Parse(const std::vector<std::string> & Lines, std::string & Error)
+    {
+        m_Items.clear();
+        m_Labels.clear();
+        for(size_t i = 0; i < Lines.size(); i++)
+        {
+            std::string text = Lines[i];
+            auto comment = text.find(';');
+            if(comment != std::string::npos)
+                text.resize(comment);
+            text = trim(text);
+            if(text.empty())
+                continue;
+            Item item;
+            item.line = int(i + 1);
+            item.size = 0;
+            item.label = text.back() == ':' && text.find_first_of(" \t,[") == std::string::npos;
+            if(item.label)
+            {
+                text.pop_back();
+                if(text.empty() || m_Labels.count(text))
+                {
+                    Error = linemessage(item.line, "invalid or duplicate label \"" + text + "\"");
+                    return false;
+                }
+                m_Labels[text] = 0;
+            }
+            item.text = text;
+            m_Items.push_back(item);
+        }
+        return true;
+    }
+
+    /**
+    \brief Gives the value of a label for the instruction that is being encoded. A label that is not placed yet is the address of that instruction.
+    \return false if Name is not a label of the block.
+    */
+    bool Resolve(const std::string & Name, Address & Value) const
+    {
+        auto label = m_Labels.find(Name);
+        if(label == m_Labels.end())
+            return false;
+        Value = label->second ? label->second : m_Unresolved;
+        return true;
+    }
+
+    /**
+    \brief Encodes every instruction at its current address until no size changes. Sizes only grow, so a branch that once needed a long encoding keeps it and the passes converge. The final encoding pads shorter encodings with NOPs.
+    \param Encode Called as Encode(Address, Text, Bytes, Error) for every instruction, it can call Resolve for the labels.
+    */
+    template<typename EncodeProc>
+    bool Relax(Address Addr, EncodeProc Encode, std::vector<unsigned char> & Dest, std::string & Error, int MaxPasses = MAX_RELAXATION_PASSES)
+    {
+        Dest.clear();
+        bool success = false;
+        for(int pass = 0; pass < MaxPasses && !success; pass++)
+        {
+            bool changed = false;
+            Address current = Addr;
+            std::unordered_map<std::string, Address> placed;
+            for(auto & item : m_Items)
+            {
+                if(item.label)
+                {
+                    placed[item.text] = current;
+                    continue;
+                }
+                std::vector<unsigned char> bytes;
+                m_Unresolved = current;
+                if(!Encode(current, item.text, bytes, Error))
+                {
+                    Error = linemessage(item.line, Error);
+                    return false;
+                }
+                if(int(bytes.size()) > item.size)
+                {
+                    item.size = int(bytes.size());
+                    changed = true;
+                }
+                current += item.size;
+            }
+            for(auto & label : placed)
+            {
+                if(m_Labels[label.first] != label.second)
+                {
+                    m_Labels[label.first] = label.second;
+                    changed = true;
+                }
+            }
+            success = !changed;
+        }
+        if(!success)
+        {
+            Error = "Branch sizes did not converge";
+            return false;
+        }
+
+        // Final encoding with the settled addresses
+        Address current = Addr;
+        for(auto & item : m_Items)
+        {
+            if(item.label)
+                continue;
+            std::vector<unsigned char> bytes;
+            m_Unresolved = current;
+            if(!Encode(current, item.text, bytes, Error) || int(bytes.size()) > item.size)
+            {
+                Error = linemessage(item.line, "failed to encode \"" + item.text + "\"");
+                Dest.clear();
+                return false;
+            }
+            Dest.insert(Dest.end(), bytes.begin(), bytes.end());
+            Dest.insert(Dest.end(), item.size - bytes.size(), 0x90);
+            current += item.size;
+        }
+        return true;
+    }
+
+private:
+    struct Item
+    {
+        std::string text;
+        bool label;
+        int line;
+        int size; // Bytes reserved for the instruction, they only grow
+    };
+
+    static std::string trim(const std::string & Text)
+    {
+        const char* whitespace = " \n\r\t";
+        size_t start = Text.find_first_not_of(whitespace);
+        if(start == std::string::npos)
+            return "";
+        return Text.substr(start, Text.find_last_not_of(whitespace) + 1 - start);
+    }
+
+    static std::string linemessage(int Line, const std::string & Text)
+    {
+        return "line " + std::to_string(Line) + ": " + Text;
+    }
+
+    std::vector<Item> m_Items;
+    std::unordered_map<std::string, Address> m_Labels; // label -> address in the current pass
+    Address m_Unresolved; // value of labels that are not placed yet (the instruction address)
+};
@@ -0,0 +1,166 @@
+/**
+ @file autoanalysis.cpp
+
+ @brief Runs the control flow analysis of the debuggee modules on a pool of background threads.
+ */
+
+#include "autoanalysis.h"
+#include "autoanalysisqueue.h"
+#include "threading.h"
+#include "debugger.h"
+#include "module.h"
+#include "memory.h"
+#include "settings.h"
+#include "controlflowanalysis.h"
+#include <thread>
+
+typedef AutoAnalysisQueue<duint>::Request AUTOANALYSISREQUEST;
+
+static AutoAnalysisQueue<duint> analysisQueue;
+static HANDLE hAutoAnalysisSemaphore = 0;
+static std::vector<HANDLE> hAutoAnalysisThreads;
+static bool bStopAutoAnalysisThreads = false;
+
+static bool autoanalysisnext(AUTOANALYSISREQUEST & Request)
+{
+    EXCLUSIVE_ACQUIRE(LockAutoAnalysis);
+    return analysisQueue.Next(Request);
+}
+
+/**
+\brief Gets the code sections of a module from the PE header in the debuggee memory.
+*/
+static bool autoanalysiscoderanges(duint Base, duint Size, std::vector<Range> & Ranges)
+{
+    unsigned char header[0x1000];
+    if(!MemRead(Base, header, sizeof(header)))
+        return false;
+    auto dosHeader = (const IMAGE_DOS_HEADER*)header;
+    if(dosHeader->e_magic != IMAGE_DOS_SIGNATURE || dosHeader->e_lfanew <= 0 || size_t(dosHeader->e_lfanew) + sizeof(IMAGE_NT_HEADERS) > sizeof(header))
+        return false;
+    auto ntHeaders = (const IMAGE_NT_HEADERS*)(header + dosHeader->e_lfanew);
+    if(ntHeaders->Signature != IMAGE_NT_SIGNATURE)
+        return false;
+    auto section = IMAGE_FIRST_SECTION(ntHeaders);
+    for(WORD i = 0; i < ntHeaders->FileHeader.NumberOfSections; i++, section++)
+    {
+        if((const unsigned char*)(section + 1) > header + sizeof(header))
+            break;
+        if(!(section->Characteristics & (IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE)))
+            continue;
+        duint start = section->VirtualAddress;
+        duint size = max(section->Misc.VirtualSize, section->SizeOfRawData);
+        if(!size || start >= Size)
+            continue;
+        Ranges.push_back(Range(Base + start, Base + min(start + size, Size) - 1));
+    }
+    return !Ranges.empty();
+}
+
+static DWORD WINAPI autoAnalysisThread(void* ptr)
+{
+    while(WaitForSingleObject(hAutoAnalysisSemaphore, INFINITE) == WAIT_OBJECT_0 && !bStopAutoAnalysisThreads)
+    {
+        AUTOANALYSISREQUEST request;
+        if(!autoanalysisnext(request)) //the request was removed before a thread picked it up
+            continue;
+
+        DWORD ticks = GetTickCount();
+        std::vector<Range> ranges;
+        autoanalysiscoderanges(request.Base, request.Size, ranges);
+        for(auto & range : ranges)
+        {
+            if(bStopAutoAnalysisThreads)
+                break;
+
+            ControlFlowAnalysis anal(range.first, range.second - range.first + 1, true);
+            anal.SetVerbose(false);
+            anal.SetCancel([&request]()
+            {
+                if(bStopAutoAnalysisThreads)
+                    return true;
+                SHARED_ACQUIRE(LockAutoAnalysis);
+                return analysisQueue.IsCancelled(request.Id);
+            });
+            anal.Analyse();
+
+            // The results of every section are published as soon as they are ready, unless the module was unloaded in the meantime
+            SHARED_ACQUIRE(LockAutoAnalysis);
+            if(analysisQueue.IsCancelled(request.Id))
+                break;
+            anal.SetMarkers();
+            SHARED_RELEASE();
+
+            GuiUpdateDisassemblyView();
+        }
+
+        int done = 0, total = 0;
+        EXCLUSIVE_ACQUIRE(LockAutoAnalysis);
+        bool finished = analysisQueue.Finish(request.Id, done, total);
+        EXCLUSIVE_RELEASE();
+
+        if(finished)
+            GuiAddStatusBarMessage(StringUtils::sprintf("Analysed %s in %ums (%d/%d)\n", request.Name.c_str(), GetTickCount() - ticks, done, total).c_str());
+    }
+    return 0;
+}
+
+void AutoAnalyseInit()
+{
+    int threadCount = min(max(int(std::thread::hardware_concurrency() / 2), 1), AUTOANALYSIS_MAX_THREADS);
+    hAutoAnalysisSemaphore = CreateSemaphoreW(nullptr, 0, MAXLONG, nullptr);
+    for(int i = 0; i < threadCount; i++)
+        hAutoAnalysisThreads.push_back(CreateThread(nullptr, 0, autoAnalysisThread, nullptr, 0, nullptr));
+}
+
+void AutoAnalyseStop()
+{
+    bStopAutoAnalysisThreads = true;
+    ReleaseSemaphore(hAutoAnalysisSemaphore, LONG(hAutoAnalysisThreads.size()), nullptr);
+    for(auto hThread : hAutoAnalysisThreads)
+        WaitForThreadTermination(hThread);
+    hAutoAnalysisThreads.clear();
+    CloseHandle(hAutoAnalysisSemaphore);
+}
+
+/**
+\brief Queues a module for analysis when Engine\\AutoAnalyse is enabled. Returns immediately, the analysis never runs on the debug loop.
+\param Base The module base.
+\param Name The module name, for the status bar.
+*/
+void AutoAnalyseAdd(duint Base, const char* Name)
+{
+    if(!SettingGetBool(SettingEngineAutoAnalyse))
+        return;
+
+    duint size = ModSizeFromAddr(Base);
+
+    EXCLUSIVE_ACQUIRE(LockAutoAnalysis);
+    analysisQueue.Add(Base, size, Name);
+    EXCLUSIVE_RELEASE();
+
+    ReleaseSemaphore(hAutoAnalysisSemaphore, 1, nullptr);
+}
+
+/**
+\brief Removes a module from the queue. If the module is being analysed, the results are discarded.
+*/
+void AutoAnalyseRemove(duint Base)
+{
+    EXCLUSIVE_ACQUIRE(LockAutoAnalysis);
+    analysisQueue.Remove(Base);
+}
+
+void AutoAnalyseClear()
+{
+    EXCLUSIVE_ACQUIRE(LockAutoAnalysis);
+    analysisQueue.Clear();
+}
+
+void AutoAnalysePrioritize(duint Address)
+{
+    EXCLUSIVE_ACQUIRE(LockAutoAnalysis);
+
+    // The module that contains the current instruction is analysed next
+    analysisQueue.Prioritize(Address);
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "_global.h"
+
+#define AUTOANALYSIS_MAX_THREADS 4
+
+void AutoAnalyseInit();
+void AutoAnalyseStop();
+void AutoAnalyseAdd(duint Base, const char* Name);
+void AutoAnalyseRemove(duint Base);
+void AutoAnalyseClear();
+void AutoAnalysePrioritize(duint Address);
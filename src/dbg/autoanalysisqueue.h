@@ -0,0 +1,182 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+/**
+\brief The modules waiting for the background analysis, ordered by priority, and the modules being analysed. This header does not depend on the Windows types, so it can be tested on its own. It is not synchronized, the auto analysis guards it with LockAutoAnalysis.
+*/
+template<typename Address>
+class AutoAnalysisQueue
+{
+public:
+    struct Request
+    {
+        Address Base;
+        Address Size;
+        std::string Name;
+        long long Priority; // the highest priority is analysed first
+        long long Id;
+        bool Cancelled;     // only used for running requests
+    };
+
+    AutoAnalysisQueue()
+        : m_Sequence(0),
+          m_Done(0),
+          m_Total(0)
+    {
+    }
+
+    /**
+    \brief Queues a module. Modules are analysed in the order they were added, unless they are prioritized.
+    \return The id of the request.
+    */
+    long long Add(Address Base, Address Size, const std::string & Name)
+    {
+        Request request;
+        request.Base = Base;
+        request.Size = Size;
+        request.Name = Name;
+        request.Id = ++m_Sequence;
+        request.Priority = -request.Id;
+        request.Cancelled = false;
+        m_Queue.push_back(request);
+        m_Total++;
+        return request.Id;
+    }
+
+    /**
+    \brief Drops a module from the queue (it was unloaded from the debuggee). If the module is being analysed, the request is cancelled. Either way it no longer counts towards the total.
+    \return true if the module was queued or running.
+    */
+    bool Remove(Address Base)
+    {
+        bool found = false;
+        for(auto i = m_Queue.begin(); i != m_Queue.end(); ++i)
+        {
+            if(i->Base == Base)
+            {
+                m_Queue.erase(i);
+                m_Total--;
+                found = true;
+                break;
+            }
+        }
+        for(auto & running : m_Running)
+        {
+            if(running.Base == Base && !running.Cancelled)
+            {
+                running.Cancelled = true;
+                m_Total--;
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    /**
+    \brief Drops every queued module and cancels the running requests (the debuggee stopped).
+    */
+    void Clear()
+    {
+        m_Queue.clear();
+        for(auto & running : m_Running)
+            running.Cancelled = true;
+        m_Done = 0;
+        m_Total = 0;
+    }
+
+    /**
+    \brief Takes the module with the highest priority, it is running until Finish is called.
+    \return false if the queue is empty.
+    */
+    bool Next(Request & Result)
+    {
+        if(m_Queue.empty())
+            return false;
+
+        auto next = m_Queue.begin();
+        for(auto i = m_Queue.begin(); i != m_Queue.end(); ++i)
+        {
+            if(i->Priority > next->Priority)
+                next = i;
+        }
+
+        Result = *next;
+        m_Queue.erase(next);
+        m_Running.push_back(Result);
+        return true;
+    }
+
+    /**
+    \brief Checks whether the results of a running request should be discarded. A request that is not running counts as cancelled.
+    */
+    bool IsCancelled(long long Id) const
+    {
+        for(auto & running : m_Running)
+        {
+            if(running.Id == Id)
+                return running.Cancelled;
+        }
+        return true;
+    }
+
+    /**
+    \brief Marks a running request as done.
+    \param [out] Done The number of modules analysed since the last Clear.
+    \param [out] Total The number of modules queued since the last Clear.
+    \return false if the request was cancelled, Done and Total are not set then.
+    */
+    bool Finish(long long Id, int & Done, int & Total)
+    {
+        bool cancelled = true;
+        for(auto i = m_Running.begin(); i != m_Running.end(); ++i)
+        {
+            if(i->Id == Id)
+            {
+                cancelled = i->Cancelled;
+                m_Running.erase(i);
+                break;
+            }
+        }
+        if(cancelled)
+            return false;
+        Done = ++m_Done;
+        Total = m_Total;
+        return true;
+    }
+
+    /**
+    \brief Analyses the module at Va next. The module that was asked for last wins.
+    \return true if the module was queued.
+    */
+    bool Prioritize(Address Va)
+    {
+        for(auto & request : m_Queue)
+        {
+            if(Va >= request.Base && Va < request.Base + request.Size)
+            {
+                request.Priority = ++m_Sequence;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t Size() const
+    {
+        return m_Queue.size();
+    }
+
+    size_t Running() const
+    {
+        return m_Running.size();
+    }
+
+private:
+    std::vector<Request> m_Queue;
+    std::vector<Request> m_Running;
+    long long m_Sequence;
+    int m_Done;
+    int m_Total;
+};
@@ -89,80 +89,55 @@ void BookmarkDelRange(duint Start, duint End)
     }
 }
 
-void BookmarkCacheSave(JSON Root)
+void BookmarkCacheSave(JsonWriter & Writer)
 {
     EXCLUSIVE_ACQUIRE(LockBookmarks);
 
-    const JSON jsonBookmarks = json_array();
-    const JSON jsonAutoBookmarks = json_array();
-
-    // Save to the JSON root
-    for(auto & itr : bookmarks)
+    // Write the user-set and the auto-set bookmarks as separate arrays
+    for(int manual = 1; manual >= 0; manual--)
     {
-        JSON currentBookmark = json_object();
-
-        json_object_set_new(currentBookmark, "module", json_string(itr.second.mod));
-        json_object_set_new(currentBookmark, "address", json_hex(itr.second.addr));
-
-        if(itr.second.manual)
-            json_array_append_new(jsonBookmarks, currentBookmark);
-        else
-            json_array_append_new(jsonAutoBookmarks, currentBookmark);
-    }
+        bool empty = true;
+        for(auto & itr : bookmarks)
+        {
+            if(itr.second.manual != (manual != 0))
+                continue;
 
-    if(json_array_size(jsonBookmarks))
-        json_object_set(Root, "bookmarks", jsonBookmarks);
+            if(empty)
+            {
+                Writer.ArrayBegin(manual ? "bookmarks" : "autobookmarks");
+                empty = false;
+            }
 
-    if(json_array_size(jsonAutoBookmarks))
-        json_object_set(Root, "autobookmarks", jsonAutoBookmarks);
+            Writer.ObjectBegin();
+            Writer.WriteString("module", itr.second.mod);
+            Writer.WriteHex("address", itr.second.addr);
+            Writer.ObjectEnd();
+        }
 
-    json_decref(jsonBookmarks);
-    json_decref(jsonAutoBookmarks);
+        if(!empty)
+            Writer.ArrayEnd();
+    }
 }
 
-void BookmarkCacheLoad(JSON Root)
+void BookmarkCacheLoad(const JsonEntry & Entry, bool Manual)
 {
-    EXCLUSIVE_ACQUIRE(LockBookmarks);
-
-    // Inline lambda to parse each JSON entry
-    auto AddBookmarks = [](const JSON Object, bool Manual)
-    {
-        size_t i;
-        JSON value;
+    BOOKMARKSINFO bookmarkInfo;
+    memset(&bookmarkInfo, 0, sizeof(BOOKMARKSINFO));
 
-        json_array_foreach(Object, i, value)
-        {
-            BOOKMARKSINFO bookmarkInfo;
-            memset(&bookmarkInfo, 0, sizeof(BOOKMARKSINFO));
-
-            // Load the module name
-            const char* mod = json_string_value(json_object_get(value, "module"));
+    // Load the module name
+    const char* mod = Entry.GetString("module");
 
-            if(mod && strlen(mod) < MAX_MODULE_SIZE)
-                strcpy_s(bookmarkInfo.mod, mod);
+    if(mod && strlen(mod) < MAX_MODULE_SIZE)
+        strcpy_s(bookmarkInfo.mod, mod);
 
-            // Load address and set auto-generated flag
-            bookmarkInfo.addr = (duint)json_hex_value(json_object_get(value, "address"));
-            bookmarkInfo.manual = Manual;
+    // Load address and set auto-generated flag
+    bookmarkInfo.addr = Entry.GetHex("address");
+    bookmarkInfo.manual = Manual;
 
-            const duint key = ModHashFromName(bookmarkInfo.mod) + bookmarkInfo.addr;
-            bookmarks.insert(std::make_pair(key, bookmarkInfo));
-        }
-    };
+    const duint key = ModHashFromName(bookmarkInfo.mod) + bookmarkInfo.addr;
 
-    // Remove existing entries
-    bookmarks.clear();
-
-    const JSON jsonBookmarks = json_object_get(Root, "bookmarks");
-    const JSON jsonAutoBookmarks = json_object_get(Root, "autobookmarks");
-
-    // Load user-set bookmarks
-    if(jsonBookmarks)
-        AddBookmarks(jsonBookmarks, true);
-
-    // Load auto-set bookmarks
-    if(jsonAutoBookmarks)
-        AddBookmarks(jsonAutoBookmarks, false);
+    EXCLUSIVE_ACQUIRE(LockBookmarks);
+    bookmarks.insert(std::make_pair(key, bookmarkInfo));
 }
 
 bool BookmarkEnum(BOOKMARKSINFO* List, size_t* Size)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "_global.h"
+#include "jsonstream.h"
 
 struct BOOKMARKSINFO
 {
@@ -13,7 +14,7 @@ bool BookmarkSet(duint Address, bool Manual);
 bool BookmarkGet(duint Address);
 bool BookmarkDelete(duint Address);
 void BookmarkDelRange(duint Start, duint End);
-void BookmarkCacheSave(JSON Root);
-void BookmarkCacheLoad(JSON Root);
+void BookmarkCacheSave(JsonWriter & Writer);
+void BookmarkCacheLoad(const JsonEntry & Entry, bool Manual);
 bool BookmarkEnum(BOOKMARKSINFO* List, size_t* Size);
 void BookmarkClear();
\ No newline at end of file
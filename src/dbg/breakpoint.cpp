@@ -5,13 +5,101 @@
  */
 
 #include "breakpoint.h"
+#include "breakpointpage.h"
 #include "memory.h"
 #include "threading.h"
 #include "module.h"
+#include "commandhash.h"
 
 typedef std::pair<BP_TYPE, duint> BreakpointKey;
 std::map<BreakpointKey, BREAKPOINT> breakpoints;
 
+struct BreakpointModule
+{
+    duint base; // 0 when the module is not loaded
+    std::set<BreakpointKey> keys;
+};
+
+// Breakpoints grouped by BREAKPOINT::mod ("" for addresses outside of modules), case-insensitive like ModBaseFromName
+static std::unordered_map<String, BreakpointModule, CommandHash, CommandEqual> breakpointModules;
+
+// BREAKPOINT::name -> key, names are unique
+static std::unordered_map<String, BreakpointKey> breakpointNames;
+
+static void BpIndexInsert(const BreakpointKey & Key, const BREAKPOINT & Bp)
+{
+    //
+    // NOTE: THIS DOES _NOT_ USE LOCKS
+    //
+    breakpointModules[Bp.mod].keys.insert(Key);
+
+    if(Bp.name[0] != '\0')
+        breakpointNames.insert(std::make_pair(String(Bp.name), Key));
+}
+
+static void BpIndexErase(const BreakpointKey & Key, const BREAKPOINT & Bp)
+{
+    //
+    // NOTE: THIS DOES _NOT_ USE LOCKS
+    //
+    auto group = breakpointModules.find(Bp.mod);
+
+    if(group != breakpointModules.end())
+    {
+        group->second.keys.erase(Key);
+
+        if(group->second.keys.empty())
+            breakpointModules.erase(group);
+    }
+
+    auto name = breakpointNames.find(Bp.name);
+
+    if(name != breakpointNames.end() && name->second == Key)
+        breakpointNames.erase(name);
+}
+
+static void BpRefreshGroup(const String & Module, BreakpointModule & Group)
+{
+    //
+    // NOTE: THIS DOES _NOT_ USE LOCKS
+    //
+    if(Module.empty())
+    {
+        // Addresses outside of modules need a remote read each
+        Group.base = 0;
+
+        for(auto & key : Group.keys)
+        {
+            BREAKPOINT & bp = breakpoints[key];
+            bp.active = MemIsValidReadPtr(bp.addr);
+        }
+        return;
+    }
+
+    // A module breakpoint is active when the module is loaded
+    Group.base = ModBaseFromName(Module.c_str());
+    duint size = Group.base ? ModSizeFromAddr(Group.base) : 0;
+
+    for(auto & key : Group.keys)
+    {
+        BREAKPOINT & bp = breakpoints[key];
+        bp.active = bp.addr < size;
+    }
+}
+
+static duint BpModuleBase(const char* Module)
+{
+    //
+    // NOTE: THIS DOES _NOT_ USE LOCKS
+    //
+    auto found = breakpointModules.find(Module);
+
+    if(found == breakpointModules.end())
+        return 0;
+
+    return found->second.base;
+}
+
 BREAKPOINT* BpInfoFromAddr(BP_TYPE Type, duint Address)
 {
     //
@@ -34,12 +122,14 @@ int BpGetList(std::vector<BREAKPOINT>* List)
     if(List)
     {
         // Enumerate all breakpoints in the global list, fixing the relative
-        // offset to a virtual address
+        // offset to a virtual address. The module bases and the active state
+        // are cached and only refreshed when modules are (un)loaded.
+        List->reserve(List->size() + breakpoints.size());
+
         for(auto & i : breakpoints)
         {
             BREAKPOINT currentBp = i.second;
-            currentBp.addr += ModBaseFromName(currentBp.mod);
-            currentBp.active = MemIsValidReadPtr(currentBp.addr);
+            currentBp.addr += BpModuleBase(currentBp.mod);
 
             List->push_back(currentBp);
         }
@@ -78,13 +168,94 @@ bool BpNew(duint Address, bool Enable, bool Singleshot, short OldBytes, BP_TYPE
     bp.titantype = TitanType;
     bp.type = Type;
 
+    const BreakpointKey key(Type, ModHashFromAddr(Address));
+    const duint base = ModBaseFromAddr(Address);
+
     // Insert new entry to the global list
     EXCLUSIVE_ACQUIRE(LockBreakpoints);
 
-    breakpoints.insert(std::make_pair(BreakpointKey(Type, ModHashFromAddr(Address)), bp));
+    if(!breakpoints.insert(std::make_pair(key, bp)).second)
+        return false;
+
+    BpIndexInsert(key, bp);
+    breakpointModules[bp.mod].base = base;
     return true;
 }
 
+static void BpReadOldBytes(const std::vector<duint> & Addresses, std::vector<unsigned short> & OldBytes, std::vector<bool> & Valid)
+{
+    // Addresses must be sorted, so every page is read only once
+    BpReadPageBytes(Addresses, duint(PAGE_SIZE), OldBytes, Valid, [](duint Address, unsigned char* Buffer, duint Size)
+    {
+        duint read = 0;
+        MemRead(Address, Buffer, Size, &read);
+        return read;
+    });
+}
+
+int BpNewBatch(std::vector<duint> & Addresses, bool Singleshot, DWORD TitanType)
+{
+    ASSERT_DEBUGGING("Command function call");
+
+    // Sort the addresses, so the original bytes can be read page by page
+    std::sort(Addresses.begin(), Addresses.end());
+    Addresses.erase(std::unique(Addresses.begin(), Addresses.end()), Addresses.end());
+
+    std::vector<unsigned short> oldBytes;
+    std::vector<bool> valid;
+    BpReadOldBytes(Addresses, oldBytes, valid);
+
+    // Prepare the entries without holding the lock
+    struct BatchEntry
+    {
+        BreakpointKey key;
+        BREAKPOINT bp;
+        duint base;
+    };
+    std::vector<BatchEntry> entries;
+    entries.reserve(Addresses.size());
+
+    for(size_t i = 0; i < Addresses.size(); i++)
+    {
+        if(!valid[i])
+            continue;
+
+        const duint address = Addresses[i];
+        BatchEntry entry;
+        memset(&entry.bp, 0, sizeof(BREAKPOINT));
+
+        ModNameFromAddr(address, entry.bp.mod, true);
+        entry.base = ModBaseFromAddr(address);
+        entry.key = BreakpointKey(BPNORMAL, ModHashFromAddr(address));
+
+        entry.bp.active = true;
+        entry.bp.addr = address - entry.base;
+        entry.bp.enabled = true;
+        entry.bp.oldbytes = oldBytes[i];
+        entry.bp.singleshoot = Singleshot;
+        entry.bp.titantype = TitanType;
+        entry.bp.type = BPNORMAL;
+
+        entries.push_back(entry);
+    }
+
+    // Insert all entries at once, Addresses receives the ones that were added
+    EXCLUSIVE_ACQUIRE(LockBreakpoints);
+    Addresses.clear();
+
+    for(auto & entry : entries)
+    {
+        if(!breakpoints.insert(std::make_pair(entry.key, entry.bp)).second)
+            continue;
+
+        BpIndexInsert(entry.key, entry.bp);
+        breakpointModules[entry.bp.mod].base = entry.base;
+        Addresses.push_back(entry.bp.addr + entry.base);
+    }
+
+    return (int)Addresses.size();
+}
+
 bool BpGet(duint Address, BP_TYPE Type, const char* Name, BREAKPOINT* Bp)
 {
     ASSERT_DEBUGGING("Export call");
@@ -105,30 +276,24 @@ bool BpGet(duint Address, BP_TYPE Type, const char* Name, BREAKPOINT* Bp)
 
         *Bp = *bpInfo;
         Bp->addr += ModBaseFromAddr(Address);
-        Bp->active = MemIsValidReadPtr(Bp->addr);
         return true;
     }
 
     // Do a lookup by breakpoint name
-    for(auto & i : breakpoints)
-    {
-        // Do the names match?
-        if(strcmp(Name, i.second.name) != 0)
-            continue;
+    auto found = breakpointNames.find(Name);
 
-        // Fill out the optional user buffer
-        if(Bp)
-        {
-            *Bp = i.second;
-            Bp->addr += ModBaseFromAddr(Address);
-            Bp->active = MemIsValidReadPtr(Bp->addr);
-        }
+    if(found == breakpointNames.end())
+        return false;
 
-        // Return true if the name was found at all
-        return true;
+    // Fill out the optional user buffer
+    if(Bp)
+    {
+        *Bp = breakpoints[found->second];
+        Bp->addr += BpModuleBase(Bp->mod);
     }
 
-    return false;
+    // Return true if the name was found at all
+    return true;
 }
 
 bool BpDelete(duint Address, BP_TYPE Type)
@@ -136,8 +301,16 @@ bool BpDelete(duint Address, BP_TYPE Type)
     ASSERT_DEBUGGING("Command function call");
     EXCLUSIVE_ACQUIRE(LockBreakpoints);
 
+    const BreakpointKey key(Type, ModHashFromAddr(Address));
+    auto found = breakpoints.find(key);
+
+    if(found == breakpoints.end())
+        return false;
+
     // Erase the index from the global list
-    return (breakpoints.erase(BreakpointKey(Type, ModHashFromAddr(Address))) > 0);
+    BpIndexErase(key, found->second);
+    breakpoints.erase(found);
+    return true;
 }
 
 bool BpEnable(duint Address, BP_TYPE Type, bool Enable)
@@ -162,6 +335,75 @@ bool BpEnable(duint Address, BP_TYPE Type, bool Enable)
     return true;
 }
 
+int BpEnableBatch(bool Enable, std::vector<BREAKPOINT> & Changed)
+{
+    ASSERT_DEBUGGING("Command function call");
+
+    // Collect the normal breakpoints that have to change
+    std::vector<BreakpointKey> keys;
+    Changed.clear();
+    SHARED_ACQUIRE(LockBreakpoints);
+
+    for(auto & i : breakpoints)
+    {
+        if(i.first.first != BPNORMAL || i.second.enabled == Enable)
+            continue;
+
+        BREAKPOINT currentBp = i.second;
+        currentBp.addr += BpModuleBase(currentBp.mod);
+        Changed.push_back(currentBp);
+    }
+
+    SHARED_RELEASE();
+
+    // Sort by address, so the original bytes can be read page by page
+    std::sort(Changed.begin(), Changed.end(), [](const BREAKPOINT & a, const BREAKPOINT & b)
+    {
+        return a.addr < b.addr;
+    });
+
+    std::vector<unsigned short> oldBytes;
+    std::vector<bool> valid;
+
+    if(Enable)
+    {
+        std::vector<duint> addresses;
+        addresses.reserve(Changed.size());
+
+        for(auto & bp : Changed)
+            addresses.push_back(bp.addr);
+
+        BpReadOldBytes(addresses, oldBytes, valid);
+    }
+
+    // Update the store in one go, Changed receives the ones that were updated
+    EXCLUSIVE_ACQUIRE(LockBreakpoints);
+    size_t count = 0;
+
+    for(size_t i = 0; i < Changed.size(); i++)
+    {
+        if(Enable && !valid[i])
+            continue;
+
+        BREAKPOINT* bpInfo = BpInfoFromAddr(BPNORMAL, Changed[i].addr);
+
+        if(!bpInfo || bpInfo->enabled == Enable)
+            continue;
+
+        bpInfo->enabled = Enable;
+        if(Enable)
+            bpInfo->oldbytes = oldBytes[i];
+
+        Changed[count] = Changed[i];
+        Changed[count].enabled = Enable;
+        Changed[count].oldbytes = bpInfo->oldbytes;
+        count++;
+    }
+
+    Changed.resize(count);
+    return (int)count;
+}
+
 bool BpSetName(duint Address, BP_TYPE Type, const char* Name)
 {
     ASSERT_DEBUGGING("Future(?): This is not used anywhere");
@@ -172,12 +414,23 @@ bool BpSetName(duint Address, BP_TYPE Type, const char* Name)
         Name = "";
 
     // Check if the breakpoint exists first
-    BREAKPOINT* bpInfo = BpInfoFromAddr(Type, Address);
+    const BreakpointKey key(Type, ModHashFromAddr(Address));
+    auto found = breakpoints.find(key);
 
-    if(!bpInfo)
+    if(found == breakpoints.end())
         return false;
 
-    strcpy_s(bpInfo->name, Name);
+    // Renaming to the current name changes nothing
+    if(!strcmp(found->second.name, Name))
+        return true;
+
+    // Names have to stay unique
+    if(Name[0] != '\0' && breakpointNames.count(Name))
+        return false;
+
+    BpIndexErase(key, found->second);
+    strcpy_s(found->second.name, Name);
+    BpIndexInsert(key, found->second);
     return true;
 }
 
@@ -196,6 +449,173 @@ bool BpSetTitanType(duint Address, BP_TYPE Type, int TitanType)
     return true;
 }
 
+bool BpSetCondition(duint Address, BP_TYPE Type, const char* Condition)
+{
+    ASSERT_DEBUGGING("Command function call");
+    EXCLUSIVE_ACQUIRE(LockBreakpoints);
+
+    // An empty condition makes the breakpoint unconditional
+    if(!Condition)
+        Condition = "";
+
+    BREAKPOINT* bpInfo = BpInfoFromAddr(Type, Address);
+
+    if(!bpInfo || strlen(Condition) >= MAX_CONDITIONAL_EXPR_SIZE)
+        return false;
+
+    strcpy_s(bpInfo->condition, Condition);
+    return true;
+}
+
+bool BpSetLogText(duint Address, BP_TYPE Type, const char* Text)
+{
+    ASSERT_DEBUGGING("Command function call");
+    EXCLUSIVE_ACQUIRE(LockBreakpoints);
+
+    // An empty text makes the breakpoint pause again
+    if(!Text)
+        Text = "";
+
+    BREAKPOINT* bpInfo = BpInfoFromAddr(Type, Address);
+
+    if(!bpInfo || strlen(Text) >= MAX_CONDITIONAL_TEXT_SIZE)
+        return false;
+
+    strcpy_s(bpInfo->logText, Text);
+    return true;
+}
+
+bool BpResetHitCount(duint Address, BP_TYPE Type)
+{
+    ASSERT_DEBUGGING("Command function call");
+    EXCLUSIVE_ACQUIRE(LockBreakpoints);
+
+    BREAKPOINT* bpInfo = BpInfoFromAddr(Type, Address);
+
+    if(!bpInfo)
+        return false;
+
+    bpInfo->hitCount = 0;
+    return true;
+}
+
+duint BpIncrementHitCount(duint Address, BP_TYPE Type)
+{
+    ASSERT_DEBUGGING("Breakpoint callback");
+    EXCLUSIVE_ACQUIRE(LockBreakpoints);
+
+    // Called from the exception handler for every hit, conditional or not
+    BREAKPOINT* bpInfo = BpInfoFromAddr(Type, Address);
+
+    if(!bpInfo)
+        return 0;
+
+    return ++bpInfo->hitCount;
+}
+
+bool BpAddMemoryWatch(duint Address, duint Start, duint Size)
+{
+    ASSERT_DEBUGGING("Command function call");
+    EXCLUSIVE_ACQUIRE(LockBreakpoints);
+
+    // Address is the base of the guarded region, the range has to be inside of it
+    BREAKPOINT* bpInfo = BpInfoFromAddr(BPMEMORY, Address);
+
+    if(!bpInfo || !Size || Start < Address)
+        return false;
+
+    BPWATCHRANGE range;
+    range.offset = Start - Address;
+    range.size = Size;
+
+    // Skip ranges that are already watched
+    for(unsigned char i = 0; i < bpInfo->watchCount; i++)
+    {
+        const BPWATCHRANGE & watch = bpInfo->watch[i];
+        if(range.offset >= watch.offset && range.offset + range.size <= watch.offset + watch.size)
+            return true;
+    }
+
+    if(bpInfo->watchCount >= MAX_MEMORY_WATCH_RANGES)
+        return false;
+
+    bpInfo->watch[bpInfo->watchCount++] = range;
+    return true;
+}
+
+bool BpClearMemoryWatch(duint Address)
+{
+    ASSERT_DEBUGGING("Command function call");
+    EXCLUSIVE_ACQUIRE(LockBreakpoints);
+
+    // Without ranges every access to the region triggers the breakpoint
+    BREAKPOINT* bpInfo = BpInfoFromAddr(BPMEMORY, Address);
+
+    if(!bpInfo)
+        return false;
+
+    bpInfo->watchCount = 0;
+    return true;
+}
+
+bool BpMemoryWatchHit(const BREAKPOINT & Bp, duint Address)
+{
+    // Bp has to be retrieved with BpGet, so Bp.addr is a virtual address
+    if(!Bp.watchCount)
+        return true;
+
+    if(Address < Bp.addr)
+        return false;
+
+    duint offset = Address - Bp.addr;
+    for(unsigned char i = 0; i < Bp.watchCount; i++)
+    {
+        if(offset >= Bp.watch[i].offset && offset < Bp.watch[i].offset + Bp.watch[i].size)
+            return true;
+    }
+    return false;
+}
+
+void BpMemoryWatchPages(const BREAKPOINT & Bp, std::vector<duint> & Pages)
+{
+    // Every page touched by a watched range gets its own guard, watches on the same page share it
+    Pages.clear();
+
+    // Ranges from a damaged database can reach past the region, only its pages are guarded
+    duint regionSize = 0;
+    duint regionBase = MemFindBaseAddr(Bp.addr, &regionSize);
+    if(!regionBase)
+        return;
+    duint regionEnd = regionBase + regionSize;
+
+    for(unsigned char i = 0; i < Bp.watchCount; i++)
+    {
+        if(Bp.watch[i].offset >= regionEnd - Bp.addr)
+            continue;
+        duint start = Bp.addr + Bp.watch[i].offset;
+        duint end = start + min(Bp.watch[i].size, regionEnd - start);
+        for(duint page = start & ~(PAGE_SIZE - 1); page < end && page >= (start & ~(PAGE_SIZE - 1)); page += PAGE_SIZE)
+            Pages.push_back(page);
+    }
+    std::sort(Pages.begin(), Pages.end());
+    Pages.erase(std::unique(Pages.begin(), Pages.end()), Pages.end());
+}
+
+bool BpSetMemoryWatchHardware(duint Address, bool Hardware, unsigned char Drx)
+{
+    ASSERT_DEBUGGING("Command function call");
+    EXCLUSIVE_ACQUIRE(LockBreakpoints);
+
+    BREAKPOINT* bpInfo = BpInfoFromAddr(BPMEMORY, Address);
+
+    if(!bpInfo)
+        return false;
+
+    bpInfo->watchHardware = Hardware;
+    bpInfo->watchDrx = Drx;
+    return true;
+}
+
 bool BpEnumAll(BPENUMCALLBACK EnumCallback, const char* Module)
 {
     ASSERT_DEBUGGING("Export call");
@@ -204,21 +624,36 @@ bool BpEnumAll(BPENUMCALLBACK EnumCallback, const char* Module)
     // Loop each entry, executing the user's callback
     bool callbackStatus = true;
 
-    for(auto i = breakpoints.begin(); i != breakpoints.end();)
+    // If a module name was sent, only visit the breakpoints of that module.
+    // The keys are copied, because the callback might remove entries.
+    std::vector<BreakpointKey> keys;
+
+    if(Module && Module[0] != '\0')
     {
-        auto j = i;
-        ++i; // Increment here, because the callback might remove the current entry
+        auto group = breakpointModules.find(Module);
 
-        // If a module name was sent, check it
-        if(Module && Module[0] != '\0')
-        {
-            if(strcmp(j->second.mod, Module) != 0)
-                continue;
-        }
+        if(group == breakpointModules.end())
+            return true;
+
+        keys.assign(group->second.keys.begin(), group->second.keys.end());
+    }
+    else
+    {
+        keys.reserve(breakpoints.size());
 
-        BREAKPOINT bpInfo = j->second;
-        bpInfo.addr += ModBaseFromName(bpInfo.mod);
-        bpInfo.active = MemIsValidReadPtr(bpInfo.addr);
+        for(auto & i : breakpoints)
+            keys.push_back(i.first);
+    }
+
+    for(auto & key : keys)
+    {
+        auto found = breakpoints.find(key);
+
+        if(found == breakpoints.end())
+            continue;
+
+        BREAKPOINT bpInfo = found->second;
+        bpInfo.addr += BpModuleBase(bpInfo.mod);
 
         // Lock must be released due to callback sub-locks
         SHARED_RELEASE();
@@ -297,12 +732,11 @@ void BpToBridge(const BREAKPOINT* Bp, BRIDGEBP* BridgeBp)
     }
 }
 
-void BpCacheSave(JSON Root)
+void BpCacheSave(JsonWriter & Writer)
 {
     EXCLUSIVE_ACQUIRE(LockBreakpoints);
 
-    // Create a JSON array to store each sub-object with a breakpoint
-    const JSON jsonBreakpoints = json_array();
+    bool empty = true;
 
     // Loop all breakpoints
     for(auto & i : breakpoints)
@@ -313,76 +747,152 @@ void BpCacheSave(JSON Root)
         if(breakpoint.singleshoot)
             continue;
 
-        JSON jsonObj = json_object();
-        json_object_set_new(jsonObj, "address", json_hex(breakpoint.addr));
-        json_object_set_new(jsonObj, "enabled", json_boolean(breakpoint.enabled));
+        if(empty)
+        {
+            Writer.ArrayBegin("breakpoints");
+            empty = false;
+        }
+
+        Writer.ObjectBegin();
+        Writer.WriteHex("address", breakpoint.addr);
+        Writer.WriteBoolean("enabled", breakpoint.enabled);
 
         // "Normal" breakpoints save the old data
         if(breakpoint.type == BPNORMAL)
-            json_object_set_new(jsonObj, "oldbytes", json_hex(breakpoint.oldbytes));
+            Writer.WriteHex("oldbytes", breakpoint.oldbytes);
 
-        json_object_set_new(jsonObj, "type", json_integer(breakpoint.type));
-        json_object_set_new(jsonObj, "titantype", json_hex(breakpoint.titantype));
-        json_object_set_new(jsonObj, "name", json_string(breakpoint.name));
-        json_object_set_new(jsonObj, "module", json_string(breakpoint.mod));
-        json_array_append_new(jsonBreakpoints, jsonObj);
-    }
+        Writer.WriteInteger("type", breakpoint.type);
+        Writer.WriteHex("titantype", breakpoint.titantype);
+        Writer.WriteString("name", breakpoint.name);
+        Writer.WriteString("module", breakpoint.mod);
 
-    if(json_array_size(jsonBreakpoints))
-        json_object_set(Root, "breakpoints", jsonBreakpoints);
+        // Conditions are optional, only store them when set
+        if(*breakpoint.condition)
+            Writer.WriteString("condition", breakpoint.condition);
+        if(*breakpoint.logText)
+            Writer.WriteString("logtext", breakpoint.logText);
 
-    // Notify garbage collector
-    json_decref(jsonBreakpoints);
+        // Watched ranges of memory breakpoints
+        if(breakpoint.watchCount)
+        {
+            Writer.ArrayBegin("watch");
+            for(unsigned char j = 0; j < breakpoint.watchCount; j++)
+            {
+                Writer.ObjectBegin();
+                Writer.WriteHex("offset", breakpoint.watch[j].offset);
+                Writer.WriteHex("size", breakpoint.watch[j].size);
+                Writer.ObjectEnd();
+            }
+            Writer.ArrayEnd();
+        }
+        if(breakpoint.watchHardware)
+            Writer.WriteBoolean("hardware", true);
+        Writer.ObjectEnd();
+    }
+
+    if(!empty)
+        Writer.ArrayEnd();
 }
 
-void BpCacheLoad(JSON Root)
+void BpCacheLoad(const JsonEntry & Entry)
 {
-    EXCLUSIVE_ACQUIRE(LockBreakpoints);
+    BREAKPOINT breakpoint;
+    memset(&breakpoint, 0, sizeof(BREAKPOINT));
 
-    // Remove all existing elements
-    breakpoints.clear();
+    if(breakpoint.type == BPNORMAL)
+        breakpoint.oldbytes = (unsigned short)(Entry.GetHex("oldbytes") & 0xFFFF);
+    breakpoint.type = (BP_TYPE)Entry.GetInteger("type");
+    breakpoint.addr = Entry.GetHex("address");
+    breakpoint.enabled = Entry.GetBoolean("enabled");
+    breakpoint.titantype = (DWORD)Entry.GetHex("titantype");
 
-    // Get a handle to the root object -> breakpoints subtree
-    const JSON jsonBreakpoints = json_object_get(Root, "breakpoints");
+    // Name
+    const char* name = Entry.GetString("name");
 
-    // Return if there was nothing to load
-    if(!jsonBreakpoints)
-        return;
+    if(name)
+        strcpy_s(breakpoint.name, name);
 
-    size_t i;
-    JSON value;
-    json_array_foreach(jsonBreakpoints, i, value)
-    {
-        BREAKPOINT breakpoint;
-        memset(&breakpoint, 0, sizeof(BREAKPOINT));
+    // Module
+    const char* mod = Entry.GetString("module");
 
-        if(breakpoint.type == BPNORMAL)
-            breakpoint.oldbytes = (unsigned short)(json_hex_value(json_object_get(value, "oldbytes")) & 0xFFFF);
-        breakpoint.type = (BP_TYPE)json_integer_value(json_object_get(value, "type"));
-        breakpoint.addr = (duint)json_hex_value(json_object_get(value, "address"));
-        breakpoint.enabled = json_boolean_value(json_object_get(value, "enabled"));
-        breakpoint.titantype = (DWORD)json_hex_value(json_object_get(value, "titantype"));
+    if(mod && *mod && strlen(mod) < MAX_MODULE_SIZE)
+        strcpy_s(breakpoint.mod, mod);
+
+    // Condition
+    const char* condition = Entry.GetString("condition");
 
-        // Name
-        const char* name = json_string_value(json_object_get(value, "name"));
+    if(condition && strlen(condition) < MAX_CONDITIONAL_EXPR_SIZE)
+        strcpy_s(breakpoint.condition, condition);
 
-        if(name)
-            strcpy_s(breakpoint.name, name);
+    // Log text
+    const char* logText = Entry.GetString("logtext");
 
-        // Module
-        const char* mod = json_string_value(json_object_get(value, "module"));
+    if(logText && strlen(logText) < MAX_CONDITIONAL_TEXT_SIZE)
+        strcpy_s(breakpoint.logText, logText);
 
-        if(mod && *mod && strlen(mod) < MAX_MODULE_SIZE)
-            strcpy_s(breakpoint.mod, mod);
+    // Watched ranges
+    const std::vector<JsonEntry>* watchRanges = Entry.GetArray("watch");
 
-        // Build the hash map key: MOD_HASH + ADDRESS
-        const duint key = ModHashFromName(breakpoint.mod) + breakpoint.addr;
-        breakpoints.insert(std::make_pair(BreakpointKey(breakpoint.type, key), breakpoint));
+    if(watchRanges)
+    {
+        for(const auto & range : *watchRanges)
+        {
+            if(breakpoint.watchCount >= MAX_MEMORY_WATCH_RANGES)
+                break;
+            BPWATCHRANGE watch;
+            watch.offset = range.GetHex("offset");
+            watch.size = range.GetHex("size");
+
+            // The region is not known yet, BpMemoryWatchPages clamps the ranges to it
+            if(!watch.size || watch.offset + watch.size < watch.offset)
+                continue;
+            breakpoint.watch[breakpoint.watchCount++] = watch;
+        }
     }
+
+    // The debug register is picked again when the breakpoint is set
+    breakpoint.watchHardware = breakpoint.type == BPMEMORY && breakpoint.watchCount == 1 && Entry.GetBoolean("hardware");
+
+    // Build the hash map key: MOD_HASH + ADDRESS
+    const BreakpointKey key(breakpoint.type, ModHashFromName(breakpoint.mod) + breakpoint.addr);
+
+    EXCLUSIVE_ACQUIRE(LockBreakpoints);
+    if(breakpoints.insert(std::make_pair(key, breakpoint)).second)
+        BpIndexInsert(key, breakpoint);
+}
+
+void BpCacheLoadFinish()
+{
+    EXCLUSIVE_ACQUIRE(LockBreakpoints);
+
+    // Modules might be loaded already
+    for(auto & group : breakpointModules)
+        BpRefreshGroup(group.first, group.second);
 }
 
 void BpClear()
 {
     EXCLUSIVE_ACQUIRE(LockBreakpoints);
     breakpoints.clear();
+    breakpointModules.clear();
+    breakpointNames.clear();
+}
+
+void BpRefreshModule(const char* Module)
+{
+    EXCLUSIVE_ACQUIRE(LockBreakpoints);
+
+    // Called when a module is loaded or unloaded
+    auto found = breakpointModules.find(Module);
+
+    if(found != breakpointModules.end())
+        BpRefreshGroup(found->first, found->second);
+}
+
+void BpRefreshAll()
+{
+    EXCLUSIVE_ACQUIRE(LockBreakpoints);
+
+    for(auto & group : breakpointModules)
+        BpRefreshGroup(group.first, group.second);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "_global.h"
+#include "jsonstream.h"
 
 #define TITANSETDRX(titantype, drx) titantype &= 0x0FF; titantype |= (drx<<8)
 #define TITANGETDRX(titantype) (titantype >> 8) & 0xF
@@ -9,6 +10,10 @@
 #define TITANSETSIZE(titantype, size) titantype &= 0xFF0; titantype |= size;
 #define TITANGETSIZE(titantype) titantype & 0xF
 
+#define MAX_CONDITIONAL_EXPR_SIZE 256
+#define MAX_CONDITIONAL_TEXT_SIZE 256
+#define MAX_MEMORY_WATCH_RANGES 8
+
 enum BP_TYPE
 {
     BPNORMAL = 0,
@@ -16,6 +21,12 @@ enum BP_TYPE
     BPMEMORY = 2
 };
 
+struct BPWATCHRANGE
+{
+    duint offset; // relative to the breakpoint address
+    duint size;
+};
+
 struct BREAKPOINT
 {
     duint addr;
@@ -27,6 +38,13 @@ struct BREAKPOINT
     DWORD titantype;
     char name[MAX_BREAKPOINT_SIZE];
     char mod[MAX_MODULE_SIZE];
+    char condition[MAX_CONDITIONAL_EXPR_SIZE]; // break only when this expression is nonzero (empty = always)
+    char logText[MAX_CONDITIONAL_TEXT_SIZE]; // log this text and continue instead of breaking (empty = break)
+    duint hitCount;
+    unsigned char watchCount; // memory breakpoints only: number of watched ranges (0 = the whole region)
+    BPWATCHRANGE watch[MAX_MEMORY_WATCH_RANGES];
+    bool watchHardware; // memory breakpoints only: the single watched range is in a debug register instead of behind page guards
+    unsigned char watchDrx; // memory breakpoints only: the debug register used when watchHardware is set
 };
 
 // Breakpoint enumeration callback
@@ -35,15 +53,29 @@ typedef bool (*BPENUMCALLBACK)(const BREAKPOINT* bp);
 BREAKPOINT* BpInfoFromAddr(BP_TYPE Type, duint Address);
 int BpGetList(std::vector<BREAKPOINT>* List);
 bool BpNew(duint Address, bool Enable, bool Singleshot, short OldBytes, BP_TYPE Type, DWORD TitanType, const char* Name);
+int BpNewBatch(std::vector<duint> & Addresses, bool Singleshot, DWORD TitanType);
 bool BpGet(duint Address, BP_TYPE Type, const char* Name, BREAKPOINT* Bp);
 bool BpDelete(duint Address, BP_TYPE Type);
 bool BpEnable(duint Address, BP_TYPE Type, bool Enable);
+int BpEnableBatch(bool Enable, std::vector<BREAKPOINT> & Changed);
 bool BpSetName(duint Address, BP_TYPE Type, const char* Name);
 bool BpSetTitanType(duint Address, BP_TYPE Type, int TitanType);
+bool BpSetCondition(duint Address, BP_TYPE Type, const char* Condition);
+bool BpSetLogText(duint Address, BP_TYPE Type, const char* Text);
+bool BpResetHitCount(duint Address, BP_TYPE Type);
+duint BpIncrementHitCount(duint Address, BP_TYPE Type);
+bool BpAddMemoryWatch(duint Address, duint Start, duint Size);
+bool BpClearMemoryWatch(duint Address);
+bool BpMemoryWatchHit(const BREAKPOINT & Bp, duint Address);
+void BpMemoryWatchPages(const BREAKPOINT & Bp, std::vector<duint> & Pages);
+bool BpSetMemoryWatchHardware(duint Address, bool Hardware, unsigned char Drx);
 bool BpEnumAll(BPENUMCALLBACK EnumCallback, const char* Module);
 bool BpEnumAll(BPENUMCALLBACK EnumCallback);
 int BpGetCount(BP_TYPE Type, bool EnabledOnly = false);
 void BpToBridge(const BREAKPOINT* Bp, BRIDGEBP* BridgeBp);
-void BpCacheSave(JSON Root);
-void BpCacheLoad(JSON Root);
-void BpClear();
\ No newline at end of file
+void BpCacheSave(JsonWriter & Writer);
+void BpCacheLoad(const JsonEntry & Entry);
+void BpCacheLoadFinish();
+void BpClear();
+void BpRefreshModule(const char* Module);
+void BpRefreshAll();
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <cstring>
+
+/**
+\brief Calls Proc(PageBase, First, Last) once for every page touched by the sorted Addresses, with [First, Last) the index range of the addresses on that page. This header does not depend on the Windows types, so it can be tested on its own.
+*/
+template<typename Address, typename PageProc>
+void BpForEachPage(const std::vector<Address> & Addresses, Address PageSize, PageProc Proc)
+{
+    size_t first = 0;
+    while(first < Addresses.size())
+    {
+        const Address pageBase = Addresses[first] & ~(PageSize - 1);
+        size_t last = first + 1;
+        while(last < Addresses.size() && (Addresses[last] & ~(PageSize - 1)) == pageBase)
+            last++;
+        Proc(pageBase, first, last);
+        first = last;
+    }
+}
+
+/**
+\brief Reads the two original bytes at every address with a single Read(Address, Buffer, Size) call per page. Only a completely read page is used, the bytes of a partially readable page and bytes crossing into the next page are read individually. Like MemRead, an address is valid when at least its first byte could be read, so a breakpoint on the last byte of a region works; the unread byte is zero.
+\param Addresses The sorted addresses.
+\param PageSize The page size (a power of two).
+\param [out] OldBytes The original bytes, one entry per address.
+\param [out] Valid Whether the original bytes of an address could be read.
+\param Read Returns the number of bytes it read.
+*/
+template<typename Address, typename ReadProc>
+void BpReadPageBytes(const std::vector<Address> & Addresses, Address PageSize, std::vector<unsigned short> & OldBytes, std::vector<bool> & Valid, ReadProc Read)
+{
+    OldBytes.assign(Addresses.size(), 0);
+    Valid.assign(Addresses.size(), false);
+    std::vector<unsigned char> page((size_t)PageSize);
+    BpForEachPage(Addresses, PageSize, [&](Address PageBase, size_t First, size_t Last)
+    {
+        const bool pageValid = Read(PageBase, page.data(), PageSize) == PageSize;
+        for(size_t i = First; i < Last; i++)
+        {
+            const Address offset = Addresses[i] - PageBase;
+            if(pageValid && offset + sizeof(unsigned short) <= PageSize)
+            {
+                memcpy(&OldBytes[i], page.data() + size_t(offset), sizeof(unsigned short));
+                Valid[i] = true;
+            }
+            else
+                Valid[i] = Read(Addresses[i], (unsigned char*)&OldBytes[i], Address(sizeof(unsigned short))) != 0;
+        }
+    });
+}
@@ -8,123 +8,119 @@
 #include "value.h"
 #include "console.h"
 #include "commandparser.h"
+#include "threading.h"
+#include "commandhash.h"
 
-COMMAND* cmd_list = 0;
+/**
+\brief Every alias of every command, mapped to the command it belongs to. The commands are reference counted, so a command that is deleted while it executes stays alive until its callback returns.
+*/
+static std::unordered_map<String, std::shared_ptr<COMMAND>, CommandHash, CommandEqual> commandMap;
 
 /**
-\brief Finds a ::COMMAND in a command list.
-\param [in] command list.
-\param name The name of the command to find.
-\param [out] Link to the command.
-\return null if it fails, else a ::COMMAND*.
+\brief Incremented every time the registry changes, used to invalidate cached command bindings.
+*/
+static volatile LONG commandGeneration = 1;
+
+/**
+\brief Splits a '\1' separated command name into its aliases.
+\param name The command name.
+\return The aliases.
 */
-COMMAND* cmdfind(const char* name, COMMAND** link)
+static std::vector<String> cmdaliases(const char* name)
 {
-    COMMAND* cur = cmd_list;
-    if(!cur->name)
-        return 0;
-    COMMAND* prev = 0;
-    while(cur)
+    std::vector<String> aliases;
+    const char* start = name;
+    for(const char* p = name;; p++)
     {
-        if(arraycontains(cur->name, name))
+        if(*p == '\1' || !*p)
         {
-            if(link)
-                *link = prev;
-            return cur;
+            if(p != start)
+                aliases.push_back(String(start, p - start));
+            if(!*p)
+                break;
+            start = p + 1;
         }
-        prev = cur;
-        cur = cur->next;
     }
-    return 0;
+    return aliases;
 }
 
 /**
-\brief Initialize a command list.
-\return a ::COMMAND*
+\brief Finds a ::COMMAND by one of its aliases.
+\param name The name of the command to find.
+\return null if it fails, else a reference to the ::COMMAND.
 */
-COMMAND* cmdinit()
+std::shared_ptr<COMMAND> cmdfind(const char* name)
 {
-    cmd_list = (COMMAND*)emalloc(sizeof(COMMAND), "cmdinit:cmd");
-    memset(cmd_list, 0, sizeof(COMMAND));
-    return cmd_list;
+    if(!name)
+        return nullptr;
+    SHARED_ACQUIRE(LockCommands);
+    auto found = commandMap.find(name);
+    if(found == commandMap.end())
+        return nullptr;
+    return found->second;
 }
 
 /**
-\brief Clear a command list.
-\param [in] cmd_list Command list to clear.
+\brief Initialize the command registry.
+*/
+void cmdinit()
+{
+    EXCLUSIVE_ACQUIRE(LockCommands);
+    commandMap.reserve(1024);
+}
+
+/**
+\brief Clear the command registry.
 */
 void cmdfree()
 {
-    COMMAND* cur = cmd_list;
-    while(cur)
-    {
-        efree(cur->name, "cmdfree:cur->name");
-        COMMAND* next = cur->next;
-        efree(cur, "cmdfree:cur");
-        cur = next;
-    }
+    EXCLUSIVE_ACQUIRE(LockCommands);
+    commandMap.clear();
 }
 
 /**
-\brief Creates a new command and adds it to the list.
-\param [in,out] command_list Command list. Cannot be null.
-\param name The command name.
+\brief Creates a new command and adds it to the registry.
+\param name The command name, aliases are separated by '\1'.
 \param cbCommand The command callback.
 \param debugonly true if the command can only be executed in a debugging context.
-\return true if the command was successfully added to the list.
+\return true if the command was successfully added to the registry.
 */
 bool cmdnew(const char* name, CBCOMMAND cbCommand, bool debugonly)
 {
-    if(!cmd_list || !cbCommand || !name || !*name || cmdfind(name, 0))
+    if(!cbCommand || !name || !*name)
         return false;
-    COMMAND* cmd;
-    bool nonext = false;
-    if(!cmd_list->name)
-    {
-        cmd = cmd_list;
-        nonext = true;
-    }
-    else
-        cmd = (COMMAND*)emalloc(sizeof(COMMAND), "cmdnew:cmd");
-    memset(cmd, 0, sizeof(COMMAND));
-    cmd->name = (char*)emalloc(strlen(name) + 1, "cmdnew:cmd->name");
-    strcpy(cmd->name, name);
+    auto aliases = cmdaliases(name);
+    if(aliases.empty())
+        return false;
+    EXCLUSIVE_ACQUIRE(LockCommands);
+    for(const auto & alias : aliases)
+        if(commandMap.count(alias))
+            return false;
+    auto cmd = std::make_shared<COMMAND>();
+    cmd->name = name;
     cmd->cbCommand = cbCommand;
     cmd->debugonly = debugonly;
-    COMMAND* cur = cmd_list;
-    if(!nonext)
-    {
-        while(cur->next)
-            cur = cur->next;
-        cur->next = cmd;
-    }
+    for(const auto & alias : aliases)
+        commandMap[alias] = cmd;
+    InterlockedIncrement(&commandGeneration);
     return true;
 }
 
 /**
-\brief Gets a ::COMMAND from the command list.
-\param [in] command_list Command list.
-\param cmd The command to get from the list.
-\return null if the command was not found. Otherwise a ::COMMAND*.
+\brief Gets a ::COMMAND from the registry by the first word of a command line.
+\param cmd The command line.
+\return null if the command was not found. Otherwise a reference to the ::COMMAND.
 */
-COMMAND* cmdget(const char* cmd)
+std::shared_ptr<COMMAND> cmdget(const char* cmd)
 {
-    char new_cmd[deflen] = "";
-    strcpy_s(new_cmd, deflen, cmd);
-    int len = (int)strlen(new_cmd);
-    int start = 0;
-    while(new_cmd[start] != ' ' && start < len)
-        start++;
-    new_cmd[start] = 0;
-    COMMAND* found = cmdfind(new_cmd, 0);
-    if(!found)
-        return 0;
-    return found;
+    const char* end = strchr(cmd, ' ');
+    if(!end)
+        return cmdfind(cmd);
+    return cmdfind(String(cmd, end - cmd).c_str());
 }
 
 /**
-\brief Sets a new command callback and debugonly property in a command list.
-\param [in] command_list Command list.
+\brief Sets a new command callback and debugonly property in the registry.
 \param name The name of the command to change.
 \param cbCommand The new command callback.
 \param debugonly The new debugonly value.
@@ -134,48 +130,46 @@ CBCOMMAND cmdset(const char* name, CBCOMMAND cbCommand, bool debugonly)
 {
     if(!cbCommand)
         return 0;
-    COMMAND* found = cmdfind(name, 0);
+    auto found = cmdfind(name);
     if(!found)
         return 0;
     CBCOMMAND old = found->cbCommand;
     found->cbCommand = cbCommand;
     found->debugonly = debugonly;
+    InterlockedIncrement(&commandGeneration);
     return old;
 }
 
 /**
-\brief Deletes a command from a command list.
-\param [in] command_list Command list.
+\brief Deletes a command (and all its aliases) from the registry.
 \param name The name of the command to delete.
 \return true if the command was deleted.
 */
 bool cmddel(const char* name)
 {
-    COMMAND* prev = 0;
-    COMMAND* found = cmdfind(name, &prev);
-    if(!found)
+    if(!name)
         return false;
-    efree(found->name, "cmddel:found->name");
-    if(found == cmd_list)
-    {
-        COMMAND* next = cmd_list->next;
-        if(next)
-        {
-            memcpy(cmd_list, cmd_list->next, sizeof(COMMAND));
-            cmd_list->next = next->next;
-            efree(next, "cmddel:next");
-        }
-        else
-            memset(cmd_list, 0, sizeof(COMMAND));
-    }
-    else
-    {
-        prev->next = found->next;
-        efree(found, "cmddel:found");
-    }
+    EXCLUSIVE_ACQUIRE(LockCommands);
+    auto found = commandMap.find(name);
+    if(found == commandMap.end())
+        return false;
+    // A running command keeps its own reference, it is freed when the last reference is gone
+    auto cmd = found->second;
+    for(const auto & alias : cmdaliases(cmd->name.c_str()))
+        commandMap.erase(alias);
+    InterlockedIncrement(&commandGeneration);
     return true;
 }
 
+/**
+\brief Gets the current generation of the command registry.
+\return The generation, it changes every time a command is added, changed or removed.
+*/
+duint cmdgeneration()
+{
+    return (duint)commandGeneration;
+}
+
 /*
 command_list:         command list
 cbUnknownCommand:     function to execute when an unknown command was found
@@ -186,7 +180,6 @@ error_is_fatal:       error return of a command callback stops the command proce
 
 /**
 \brief Initiates a command loop. This function will not return until a command returns ::STATUS_EXIT.
-\param [in] command_list Command list to use for the command lookups.
 \param cbUnknownCommand The unknown command callback.
 \param cbCommandProvider The command provider callback.
 \param cbCommandFinder The command finder callback.
@@ -206,7 +199,7 @@ CMDRESULT cmdloop(CBCOMMAND cbUnknownCommand, CBCOMMANDPROVIDER cbCommandProvide
         if(strlen(command))
         {
             strcpy_s(command, StringUtils::Trim(command).c_str());
-            COMMAND* cmd;
+            std::shared_ptr<COMMAND> cmd;
             if(!cbCommandFinder) //'clean' command processing
                 cmd = cmdget(command);
             else //'dirty' command processing
@@ -354,11 +347,11 @@ static void specialformat(char* string)
 \brief Default command finder. It uses specialformat() and mathformat() to make sure the command is optimally checked.
 \param [in] cmd_list Command list.
 \param [in] command Command name.
-\return null if it fails, else a COMMAND*.
+\return null if it fails, else a reference to the COMMAND.
 */
-COMMAND* cmdfindmain(char* command)
+std::shared_ptr<COMMAND> cmdfindmain(char* command)
 {
-    COMMAND* cmd = cmdfind(command, 0);
+    auto cmd = cmdfind(command);
     if(!cmd)
     {
         specialformat(command);
@@ -389,7 +382,7 @@ CMDRESULT cmddirectexec(const char* cmd, ...)
     va_end(ap);
 
     strcpy_s(command, StringUtils::Trim(command).c_str());
-    COMMAND* found = cmdfindmain(command);
+    auto found = cmdfindmain(command);
     if(!found || !found->cbCommand)
         return STATUS_ERROR;
     if(found->debugonly && !DbgIsDebugging())
@@ -2,6 +2,7 @@
 #define _COMMAND_H
 
 #include "_global.h"
+#include <memory>
 
 //typedefs
 
@@ -17,26 +18,26 @@ enum CMDRESULT
 
 typedef CMDRESULT(*CBCOMMAND)(int, char**);
 typedef bool (*CBCOMMANDPROVIDER)(char*, int);
-typedef COMMAND* (*CBCOMMANDFINDER)(char*);
+typedef std::shared_ptr<COMMAND> (*CBCOMMANDFINDER)(char*);
 
 struct COMMAND
 {
-    char* name;
+    String name;
     CBCOMMAND cbCommand;
     bool debugonly;
-    COMMAND* next;
 };
 
 //functions
-COMMAND* cmdinit();
+void cmdinit();
 void cmdfree();
-COMMAND* cmdfind(const char* name, COMMAND** link);
+std::shared_ptr<COMMAND> cmdfind(const char* name);
 bool cmdnew(const char* name, CBCOMMAND cbCommand, bool debugonly);
-COMMAND* cmdget(const char* cmd);
+std::shared_ptr<COMMAND> cmdget(const char* cmd);
 CBCOMMAND cmdset(const char* name, CBCOMMAND cbCommand, bool debugonly);
 bool cmddel(const char* name);
+duint cmdgeneration();
 CMDRESULT cmdloop(CBCOMMAND cbUnknownCommand, CBCOMMANDPROVIDER cbCommandProvider, CBCOMMANDFINDER cbCommandFinder, bool error_is_fatal);
-COMMAND* cmdfindmain(char* command);
+std::shared_ptr<COMMAND> cmdfindmain(char* command);
 CMDRESULT cmddirectexec(const char* cmd, ...);
 
 #endif // _COMMAND_H
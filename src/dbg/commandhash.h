@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <ctype.h>
+
+/**
+\brief Case-insensitive hash for command and module names.
+*/
+struct CommandHash
+{
+    size_t operator()(const std::string & name) const
+    {
+        // FNV-1a on the lowercase characters
+        size_t hash = 2166136261u;
+        for(auto ch : name)
+        {
+            hash ^= (unsigned char)tolower((unsigned char)ch);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+};
+
+/**
+\brief Case-insensitive equality for command and module names.
+*/
+struct CommandEqual
+{
+    bool operator()(const std::string & a, const std::string & b) const
+    {
+        if(a.size() != b.size())
+            return false;
+        for(size_t i = 0; i < a.size(); i++)
+        {
+            if(tolower((unsigned char)a[i]) != tolower((unsigned char)b[i]))
+                return false;
+        }
+        return true;
+    }
+};
@@ -28,7 +28,7 @@ char* getCommandLineArgs()
 
 }
 
-void CmdLineCacheSave(JSON Root)
+void CmdLineCacheSave(JsonWriter & Writer)
 {
     EXCLUSIVE_ACQUIRE(LockCmdLine);
 
@@ -36,34 +36,27 @@ void CmdLineCacheSave(JSON Root)
     if(!strlen(commandLine))
         return;
 
-    // Create a JSON array to store each sub-object with a breakpoint
-    const JSON jsonCmdLine = json_object();
-    json_object_set_new(jsonCmdLine, "cmdLine", json_string(commandLine));
-    json_object_set(Root, "commandLine", jsonCmdLine);
-
-    // Notify garbage collector
-    json_decref(jsonCmdLine);
+    Writer.ObjectBegin("commandLine");
+    Writer.WriteString("cmdLine", commandLine);
+    Writer.ObjectEnd();
 }
 
-void CmdLineCacheLoad(JSON Root)
+void CmdLineCacheLoad(const JsonEntry & Entry)
 {
-    EXCLUSIVE_ACQUIRE(LockCmdLine);
-
-    // Clear command line
-    memset(commandLine, 0, MAX_COMMAND_LINE_SIZE);
-
-    // Get a handle to the root object -> commandLine
-    const JSON jsonCmdLine = json_object_get(Root, "commandLine");
+    const char* cmdLine = Entry.GetString("cmdLine");
 
     // Return if there was nothing to load
-    if(!jsonCmdLine)
+    if(!cmdLine)
         return;
 
-    const char* cmdLine = json_string_value(json_object_get(jsonCmdLine, "cmdLine"));
-
+    EXCLUSIVE_ACQUIRE(LockCmdLine);
     strcpy_s(commandLine, cmdLine);
+}
 
-    json_decref(jsonCmdLine);
+void CmdLineClear()
+{
+    EXCLUSIVE_ACQUIRE(LockCmdLine);
+    memset(commandLine, 0, MAX_COMMAND_LINE_SIZE);
 }
 
 void copyCommandLine(const char* cmdLine)
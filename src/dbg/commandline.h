@@ -2,10 +2,12 @@
 
 #include "_global.h"
 #include "command.h"
+#include "jsonstream.h"
 
 bool isCmdLineEmpty();
 char* getCommandLineArgs();
-void CmdLineCacheSave(JSON Root);
-void CmdLineCacheLoad(JSON Root);
+void CmdLineCacheSave(JsonWriter & Writer);
+void CmdLineCacheLoad(const JsonEntry & Entry);
+void CmdLineClear();
 void copyCommandLine(const char* cmdLine);
 CMDRESULT setCommandLine();
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "threading.h"
 #include "module.h"
 #include "memory.h"
+#include "stackinfo.h"
 
 std::unordered_map<duint, COMMENTSINFO> comments;
 
@@ -38,6 +39,7 @@ bool CommentSet(duint Address, const char* Text, bool Manual)
     if(!comments.insert(std::make_pair(key, comment)).second)
         comments[key] = comment;
 
+    stackcommentinvalidate();
     return true;
 }
 
@@ -66,6 +68,7 @@ bool CommentDelete(duint Address)
     ASSERT_DEBUGGING("Export call");
     EXCLUSIVE_ACQUIRE(LockComments);
 
+    stackcommentinvalidate();
     return (comments.erase(ModHashFromAddr(Address)) > 0);
 }
 
@@ -92,6 +95,7 @@ void CommentDelRange(duint Start, duint End)
         End -= moduleBase;
 
         EXCLUSIVE_ACQUIRE(LockComments);
+        stackcommentinvalidate();
         for(auto itr = comments.begin(); itr != comments.end();)
         {
             const auto & currentComment = itr->second;
@@ -111,93 +115,68 @@ void CommentDelRange(duint Start, duint End)
     }
 }
 
-void CommentCacheSave(JSON Root)
+void CommentCacheSave(JsonWriter & Writer)
 {
     EXCLUSIVE_ACQUIRE(LockComments);
 
-    const JSON jsonComments = json_array();
-    const JSON jsonAutoComments = json_array();
-
-    // Build the JSON array
-    for(auto & itr : comments)
+    // Write the user-set and the auto-set comments as separate arrays
+    for(int manual = 1; manual >= 0; manual--)
     {
-        JSON currentComment = json_object();
-
-        json_object_set_new(currentComment, "module", json_string(itr.second.mod));
-        json_object_set_new(currentComment, "address", json_hex(itr.second.addr));
-        json_object_set_new(currentComment, "text", json_string(itr.second.text));
-
-        if(itr.second.manual)
-            json_array_append_new(jsonComments, currentComment);
-        else
-            json_array_append_new(jsonAutoComments, currentComment);
-    }
+        bool empty = true;
+        for(auto & itr : comments)
+        {
+            if(itr.second.manual != (manual != 0))
+                continue;
 
-    // Save to the JSON root
-    if(json_array_size(jsonComments))
-        json_object_set(Root, "comments", jsonComments);
+            if(empty)
+            {
+                Writer.ArrayBegin(manual ? "comments" : "autocomments");
+                empty = false;
+            }
 
-    if(json_array_size(jsonAutoComments))
-        json_object_set(Root, "autocomments", jsonAutoComments);
+            Writer.ObjectBegin();
+            Writer.WriteString("module", itr.second.mod);
+            Writer.WriteHex("address", itr.second.addr);
+            Writer.WriteString("text", itr.second.text);
+            Writer.ObjectEnd();
+        }
 
-    json_decref(jsonComments);
-    json_decref(jsonAutoComments);
+        if(!empty)
+            Writer.ArrayEnd();
+    }
 }
 
-void CommentCacheLoad(JSON Root)
+void CommentCacheLoad(const JsonEntry & Entry, bool Manual)
 {
-    EXCLUSIVE_ACQUIRE(LockComments);
+    COMMENTSINFO commentInfo;
+    memset(&commentInfo, 0, sizeof(COMMENTSINFO));
 
-    // Inline lambda to parse each JSON entry
-    auto AddComments = [](const JSON Object, bool Manual)
-    {
-        size_t i;
-        JSON value;
-
-        json_array_foreach(Object, i, value)
-        {
-            COMMENTSINFO commentInfo;
-            memset(&commentInfo, 0, sizeof(COMMENTSINFO));
+    // Module
+    const char* mod = Entry.GetString("module");
 
-            // Module
-            const char* mod = json_string_value(json_object_get(value, "module"));
+    if(mod && strlen(mod) < MAX_MODULE_SIZE)
+        strcpy_s(commentInfo.mod, mod);
 
-            if(mod && strlen(mod) < MAX_MODULE_SIZE)
-                strcpy_s(commentInfo.mod, mod);
+    // Address/Manual
+    commentInfo.addr = Entry.GetHex("address");
+    commentInfo.manual = Manual;
 
-            // Address/Manual
-            commentInfo.addr = (duint)json_hex_value(json_object_get(value, "address"));
-            commentInfo.manual = Manual;
+    // String value
+    const char* text = Entry.GetString("text");
 
-            // String value
-            const char* text = json_string_value(json_object_get(value, "text"));
-
-            if(text)
-                strcpy_s(commentInfo.text, text);
-            else
-            {
-                // Skip blank comments
-                continue;
-            }
-
-            const duint key = ModHashFromName(commentInfo.mod) + commentInfo.addr;
-            comments.insert(std::make_pair(key, commentInfo));
-        }
-    };
-
-    // Remove existing entries
-    comments.clear();
-
-    const JSON jsonComments = json_object_get(Root, "comments");
-    const JSON jsonAutoComments = json_object_get(Root, "autocomments");
+    if(text)
+        strcpy_s(commentInfo.text, text);
+    else
+    {
+        // Skip blank comments
+        return;
+    }
 
-    // Load user-set comments
-    if(jsonComments)
-        AddComments(jsonComments, true);
+    const duint key = ModHashFromName(commentInfo.mod) + commentInfo.addr;
 
-    // Load auto-set comments
-    if(jsonAutoComments)
-        AddComments(jsonAutoComments, false);
+    EXCLUSIVE_ACQUIRE(LockComments);
+    comments.insert(std::make_pair(key, commentInfo));
+    stackcommentinvalidate();
 }
 
 bool CommentEnum(COMMENTSINFO* List, size_t* Size)
@@ -233,4 +212,5 @@ void CommentClear()
 {
     EXCLUSIVE_ACQUIRE(LockComments);
     comments.clear();
+    stackcommentinvalidate();
 }
\ No newline at end of file
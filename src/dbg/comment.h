@@ -1,6 +1,7 @@
 #pragma once
 
 #include "_global.h"
+#include "jsonstream.h"
 
 struct COMMENTSINFO
 {
@@ -14,7 +15,7 @@ bool CommentSet(duint Address, const char* Text, bool Manual);
 bool CommentGet(duint Address, char* Text);
 bool CommentDelete(duint Address);
 void CommentDelRange(duint Start, duint End);
-void CommentCacheSave(JSON Root);
-void CommentCacheLoad(JSON Root);
+void CommentCacheSave(JsonWriter & Writer);
+void CommentCacheLoad(const JsonEntry & Entry, bool Manual);
 bool CommentEnum(COMMENTSINFO* List, size_t* Size);
 void CommentClear();
\ No newline at end of file
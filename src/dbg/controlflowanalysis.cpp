@@ -8,6 +8,7 @@
 ControlFlowAnalysis::ControlFlowAnalysis(duint base, duint size, bool exceptionDirectory) : Analysis(base, size)
 {
     _functionInfoData = nullptr;
+    _cancelled = false;
 #ifdef _WIN64
     // This will only be valid if the address range is within a loaded module
     _moduleBase = ModBaseFromAddr(base);
@@ -61,26 +62,50 @@ ControlFlowAnalysis::~ControlFlowAnalysis()
 
 void ControlFlowAnalysis::Analyse()
 {
-    dputs("Starting analysis...");
+    if(_verbose)
+        dputs("Starting analysis...");
     DWORD ticks = GetTickCount();
 
     BasicBlockStarts();
-    dprintf("Basic block starts in %ums!\n", GetTickCount() - ticks);
+    if(_verbose)
+        dprintf("Basic block starts in %ums!\n", GetTickCount() - ticks);
     ticks = GetTickCount();
+    if(cancelled())
+        return;
 
     BasicBlocks();
-    dprintf("Basic blocks in %ums!\n", GetTickCount() - ticks);
+    if(_verbose)
+        dprintf("Basic blocks in %ums!\n", GetTickCount() - ticks);
     ticks = GetTickCount();
+    if(cancelled())
+        return;
 
     Functions();
-    dprintf("Functions in %ums!\n", GetTickCount() - ticks);
+    if(_verbose)
+        dprintf("Functions in %ums!\n", GetTickCount() - ticks);
     ticks = GetTickCount();
+    if(cancelled())
+        return;
 
     FunctionRanges();
-    dprintf("Function ranges in %ums!\n", GetTickCount() - ticks);
+    if(_verbose)
+        dprintf("Function ranges in %ums!\n", GetTickCount() - ticks);
     ticks = GetTickCount();
 
-    dprintf("Analysis finished!\n");
+    if(_verbose)
+        dprintf("Analysis finished!\n");
+}
+
+void ControlFlowAnalysis::SetCancel(std::function<bool()> cancelled)
+{
+    _cancel = cancelled;
+}
+
+bool ControlFlowAnalysis::cancelled()
+{
+    if(!_cancelled && _cancel)
+        _cancelled = _cancel();
+    return _cancelled;
 }
 
 void ControlFlowAnalysis::SetMarkers()
@@ -136,8 +161,10 @@ void ControlFlowAnalysis::BasicBlockStarts()
 {
     _blockStarts.insert(_base);
     bool bSkipFilling = false;
-    for(duint i = 0; i < _size;)
+    for(duint i = 0, poll = 0; i < _size;)
     {
+        if(++poll % 0x10000 == 0 && cancelled())
+            return;
         duint addr = _base + i;
         if(_cp.Disassemble(addr, TranslateAddress(addr), MAX_DISASM_BUFFER))
         {
@@ -191,8 +218,11 @@ void ControlFlowAnalysis::BasicBlockStarts()
 
 void ControlFlowAnalysis::BasicBlocks()
 {
+    duint poll = 0;
     for(auto i = _blockStarts.begin(); i != _blockStarts.end(); ++i)
     {
+        if(++poll % 0x1000 == 0 && cancelled())
+            return;
         duint start = *i;
         if(!IsValidAddress(start))
             continue;
@@ -13,6 +13,7 @@ public:
     ~ControlFlowAnalysis();
     void Analyse() override;
     void SetMarkers() override;
+    void SetCancel(std::function<bool()> cancelled);
 
 private:
     struct BasicBlock
@@ -59,6 +60,8 @@ private:
     std::map<duint, UintSet> _parentMap; //start child -> parents
     std::map<duint, UintSet> _functions; //function start -> function block starts
     std::vector<Range> _functionRanges; //function start -> function range TODO: smarter stuff with overlapping ranges
+    std::function<bool()> _cancel; //polled between the phases and while disassembling, Analyse stops early when it returns true
+    bool _cancelled;
 
     void BasicBlockStarts();
     void BasicBlocks();
@@ -70,6 +73,7 @@ private:
     UintSet* findParents(duint child);
     duint findFunctionStart(BasicBlock* block, UintSet* parents);
     String blockToString(BasicBlock* block);
+    bool cancelled();
     duint GetReferenceOperand();
 #ifdef _WIN64
     void EnumerateFunctionRuntimeEntries64(std::function<bool(PRUNTIME_FUNCTION)> Callback);
@@ -16,7 +16,8 @@
 #include "commandline.h"
 #include "database.h"
 #include "threading.h"
-#include "filehelper.h"
+#include "jsonstream.h"
+#include "settings.h"
 
 /**
 \brief Directory where program databases are stored (usually in \db). UTF-8 encoding.
@@ -28,66 +29,84 @@ char dbbasepath[deflen];
 */
 char dbpath[deflen];
 
+/**
+\brief Set when the database of the current path failed to load, DbClose does not overwrite such a file.
+*/
+static bool dbLoadFailed = false;
+
 void DbSave(DbLoadSaveType saveType)
 {
     EXCLUSIVE_ACQUIRE(LockDatabase);
 
     dprintf("Saving database...");
     DWORD ticks = GetTickCount();
-    JSON root = json_object();
+
+    // Every cache writes its entries straight to the (buffered) file. The data
+    // goes to a temporary file first, so a failed save keeps the old database.
+    String tempPath = String(dbpath) + ".tmp";
+    WString wdbpath = StringUtils::Utf8ToUtf16(dbpath);
+    WString wtempPath = StringUtils::Utf8ToUtf16(tempPath);
+    JsonWriter writer;
+    bool useCompression = !SettingGetBool(SettingEngineDisableDatabaseCompression);
+    if(!writer.Open(tempPath.c_str(), useCompression, SettingGetBool(SettingEngineIndentDatabase)))
+    {
+        dputs("\nFailed to write database file!");
+        return;
+    }
+    writer.ObjectBegin();
 
     // Save only command line
     if(saveType == DbLoadSaveType::CommandLine || saveType == DbLoadSaveType::All)
     {
-        CmdLineCacheSave(root);
+        CmdLineCacheSave(writer);
     }
 
     if(saveType == DbLoadSaveType::DebugData || saveType == DbLoadSaveType::All)
     {
-        CommentCacheSave(root);
-        LabelCacheSave(root);
-        BookmarkCacheSave(root);
-        FunctionCacheSave(root);
-        LoopCacheSave(root);
-        BpCacheSave(root);
+        CommentCacheSave(writer);
+        LabelCacheSave(writer);
+        BookmarkCacheSave(writer);
+        FunctionCacheSave(writer);
+        LoopCacheSave(writer);
+        BpCacheSave(writer);
 
         //save notes
         char* text = nullptr;
         GuiGetDebuggeeNotes(&text);
         if(text)
         {
-            json_object_set_new(root, "notes", json_string(text));
+            writer.WriteString("notes", text);
             BridgeFree(text);
         }
         GuiSetDebuggeeNotes("");
     }
 
-    WString wdbpath = StringUtils::Utf8ToUtf16(dbpath);
-    if(json_object_size(root))
+    writer.ObjectEnd();
+    size_t rootSize = writer.RootSize();
+    if(!writer.Close())
     {
-        char* jsonText = json_dumps(root, JSON_INDENT(4));
+        dputs("\nFailed to write database file!");
+        DeleteFileW(wtempPath.c_str());
+        return;
+    }
 
-        if(jsonText)
+    if(rootSize)
+    {
+        // Replace the old database
+        if(!MoveFileExW(wtempPath.c_str(), wdbpath.c_str(), MOVEFILE_REPLACE_EXISTING))
         {
-            // Dump JSON to disk (overwrite any old files)
-            if(!FileHelper::WriteAllText(dbpath, jsonText))
-            {
-                dputs("\nFailed to write database file!");
-                json_free(jsonText);
-                json_decref(root);
-                return;
-            }
-
-            json_free(jsonText);
+            dputs("\nFailed to write database file!");
+            DeleteFileW(wtempPath.c_str());
+            return;
         }
-
-        if(!settingboolget("Engine", "DisableDatabaseCompression"))
-            LZ4_compress_fileW(wdbpath.c_str(), wdbpath.c_str());
     }
     else //remove database when nothing is in there
+    {
+        DeleteFileW(wtempPath.c_str());
         DeleteFileW(wdbpath.c_str());
+    }
+    dbLoadFailed = false;
     dprintf("%ums\n", GetTickCount() - ticks);
-    json_decref(root); //free root
 }
 
 void DbLoad(DbLoadSaveType loadType)
@@ -107,10 +126,19 @@ void DbLoad(DbLoadSaveType loadType)
     // Multi-byte (UTF8) file path converted to UTF16
     WString databasePathW = StringUtils::Utf8ToUtf16(dbpath);
 
-    // Decompress the file if compression was enabled
-    bool useCompression = !settingboolget("Engine", "DisableDatabaseCompression");
+    JsonReader reader;
+    if(!reader.Open(dbpath))
+    {
+        dputs("\nFailed to read database file!");
+        return;
+    }
+
+    // Databases written by older versions are compressed as a whole, decompress those in place first
+    bool useCompression = !SettingGetBool(SettingEngineDisableDatabaseCompression);
     LZ4_STATUS lzmaStatus = LZ4_INVALID_ARCHIVE;
+    if(!reader.Compressed())
     {
+        reader.Close();
         lzmaStatus = LZ4_decompress_fileW(databasePathW.c_str(), databasePathW.c_str());
 
         // Check return code
@@ -119,61 +147,119 @@ void DbLoad(DbLoadSaveType loadType)
             dputs("\nInvalid database file!");
             return;
         }
+
+        if(!reader.Open(dbpath))
+        {
+            dputs("\nFailed to read database file!");
+            return;
+        }
     }
 
-    // Read the database file
-    String databaseText;
+    bool loadCommandLine = loadType == DbLoadSaveType::CommandLine || loadType == DbLoadSaveType::All;
+    bool loadDebugData = loadType == DbLoadSaveType::DebugData || loadType == DbLoadSaveType::All;
 
-    if(!FileHelper::ReadAllText(dbpath, databaseText))
+    // Validate the whole file before touching the caches, a damaged file must not leave a partial database behind
+    bool valid = reader.Parse([](const String &, const JsonEntry &) {});
+    reader.Close();
+    if(valid && !reader.Open(dbpath))
     {
         dputs("\nFailed to read database file!");
+        valid = false;
+    }
+    if(!valid)
+    {
+        // Restore the old, compressed file
+        if(lzmaStatus != LZ4_INVALID_ARCHIVE && useCompression)
+            LZ4_compress_fileW(databasePathW.c_str(), databasePathW.c_str());
+        dputs("\nInvalid database file (JSON)!");
+        dbLoadFailed = true;
         return;
     }
 
-    // Restore the old, compressed file
-    if(lzmaStatus != LZ4_INVALID_ARCHIVE && useCompression)
-        LZ4_compress_fileW(databasePathW.c_str(), databasePathW.c_str());
-
-    // Deserialize JSON and validate
-    JSON root = json_loads(databaseText.c_str(), 0, 0);
+    // Remove existing entries, the caches only add the entries they are given
+    if(loadCommandLine)
+        CmdLineClear();
 
-    if(!root)
+    if(loadDebugData)
     {
-        dputs("\nInvalid database file (JSON)!");
-        return;
+        CommentClear();
+        LabelClear();
+        BookmarkClear();
+        FunctionClear();
+        LoopClear();
+        BpClear();
     }
 
-    // Load only command line
-    if(loadType == DbLoadSaveType::CommandLine || loadType == DbLoadSaveType::All)
+    // Hand every entry to its cache while parsing, the file is never loaded as a whole
+    const char* notes = nullptr;
+    String notesText;
+    valid = reader.Parse([&](const String & Section, const JsonEntry & Entry)
+    {
+        if(Section == "commandLine")
+        {
+            if(loadCommandLine)
+                CmdLineCacheLoad(Entry);
+            return;
+        }
+
+        if(!loadDebugData)
+            return;
+
+        if(Section == "comments" || Section == "autocomments")
+            CommentCacheLoad(Entry, Section == "comments");
+        else if(Section == "labels" || Section == "autolabels")
+            LabelCacheLoad(Entry, Section == "labels");
+        else if(Section == "bookmarks" || Section == "autobookmarks")
+            BookmarkCacheLoad(Entry, Section == "bookmarks");
+        else if(Section == "functions" || Section == "autofunctions")
+            FunctionCacheLoad(Entry, Section == "functions");
+        else if(Section == "loops" || Section == "autoloops")
+            LoopCacheLoad(Entry, Section == "loops");
+        else if(Section == "breakpoints")
+            BpCacheLoad(Entry);
+        else if(Section == "notes" && Entry.Type() == JsonTypeString)
+        {
+            notesText = Entry.Value();
+            notes = notesText.c_str();
+        }
+    });
+    reader.Close();
+
+    // Restore the old, compressed file
+    if(lzmaStatus != LZ4_INVALID_ARCHIVE && useCompression)
+        LZ4_compress_fileW(databasePathW.c_str(), databasePathW.c_str());
+
+    if(!valid)
     {
-        CmdLineCacheLoad(root);
+        dputs("\nFailed to read database file!");
+        dbLoadFailed = true;
     }
+    else
+        dbLoadFailed = false;
 
-    if(loadType == DbLoadSaveType::DebugData || loadType == DbLoadSaveType::All)
+    if(loadDebugData)
     {
-        // Finally load all structures
-        CommentCacheLoad(root);
-        LabelCacheLoad(root);
-        BookmarkCacheLoad(root);
-        FunctionCacheLoad(root);
-        LoopCacheLoad(root);
-        BpCacheLoad(root);
+        BpCacheLoadFinish();
 
         // Load notes
-        const char* text = json_string_value(json_object_get(root, "notes"));
-        GuiSetDebuggeeNotes(text);
+        GuiSetDebuggeeNotes(notes);
     }
 
-    // Free root
-    json_decref(root);
-
     if(loadType != DbLoadSaveType::CommandLine)
         dprintf("%ums\n", GetTickCount() - ticks);
 }
 
 void DbClose()
 {
-    DbSave(DbLoadSaveType::All);
+    bool loadFailed;
+    {
+        SHARED_ACQUIRE(LockDatabase);
+        loadFailed = dbLoadFailed;
+    }
+    if(loadFailed)
+        dputs("The database failed to load, it was not saved to keep the file intact.");
+    else
+        DbSave(DbLoadSaveType::All);
     CommentClear();
     LabelClear();
     BookmarkClear();
@@ -236,7 +322,7 @@ void DbSetPath(const char* Directory, const char* ModulePath)
             }
         }
 
-        if(settingboolget("Engine", "SaveDatabaseInProgramDirectory"))
+        if(SettingGetBool(SettingEngineSaveDatabaseInProgramDirectory))
         {
             // Absolute path in the program directory
             sprintf_s(dbpath, "%s\\%s.%s", fileDir, dbName, dbType);
@@ -246,6 +332,7 @@ void DbSetPath(const char* Directory, const char* ModulePath)
             // Relative path in debugger directory
             sprintf_s(dbpath, "%s\\%s.%s", dbbasepath, dbName, dbType);
         }
+        dbLoadFailed = false;
 
         dprintf("Database file: %s\n", dbpath);
     }
@@ -15,12 +15,18 @@
 #include "plugin_loader.h"
 #include "breakpoint.h"
 #include "symbolinfo.h"
+#include "symbolloader.h"
 #include "variable.h"
 #include "x64_dbg.h"
 #include "exception.h"
 #include "error.h"
 #include "module.h"
 #include "commandline.h"
+#include "stackinfo.h"
+#include "stringformat.h"
+#include "tracerecord.h"
+#include "settings.h"
+#include "autoanalysis.h"
 
 static PROCESS_INFORMATION g_pi = {0, 0, 0, 0};
 static char szBaseFileName[MAX_PATH] = "";
@@ -42,9 +48,36 @@ static HANDLE hProcess = 0;
 static HANDLE hMemMapThread = 0;
 static bool bStopMemMapThread = false;
 static HANDLE hTimeWastedCounterThread = 0;
+static HANDLE hTimeWastedCounterEvent = 0;
 static bool bStopTimeWastedCounterThread = false;
 static String lastDebugText;
 static duint timeWastedDebugging = 0;
+static char traceCondition[MAX_CONDITIONAL_EXPR_SIZE] = "";
+static duint traceStepsLeft = 0;
+static duint traceSteps = 0;
+static bool traceStepOver = false;
+static HANDLE hGuiUpdateThread = 0;
+static HANDLE hGuiUpdateEvent = 0;
+static HANDLE hCallStackThread = 0;
+static HANDLE hCallStackEvent = 0;
+static volatile bool bStopGuiUpdateThreads = false;
+static volatile LONG guiUpdateGeneration = 0;
+
+#define GUI_UPDATE_INTERVAL 16 //milliseconds between two refreshes, about one per frame
+#define MEMMAP_UPDATE_DELAY 100 //milliseconds without new requests before the memory map is refreshed
+#define MEMMAP_UPDATE_MAXDELAY 1000 //maximum milliseconds a memory map refresh can be delayed by new requests
+
+struct GUIUPDATEREQUEST
+{
+    duint disasmAddr;
+    duint cip;
+    duint csp;
+    DWORD threadId;
+    bool stack;
+    bool pending; //false when the debuggee resumed after the request
+};
+
+static GUIUPDATEREQUEST guiUpdateRequest;
 char szFileName[MAX_PATH] = "";
 char szSymbolCachePath[MAX_PATH] = "";
 char sqlitedb[deflen] = "";
@@ -55,27 +88,19 @@ bool bEnableSourceDebugging = true;
 
 static DWORD WINAPI memMapThread(void* ptr)
 {
-    while(!bStopMemMapThread)
+    //requests come from MemUpdateMapAsync() (module/thread events, pauses)
+    while(MemUpdateMapWait(INFINITE) && !bStopMemMapThread)
     {
-        while(!DbgIsDebugging())
-        {
-            if(bStopMemMapThread)
-                break;
-            Sleep(1);
-        }
-
-        // Execute the update only if the delta if >= 1 second
-        if((GetTickCount() - memMapThreadCounter) >= 1000)
-        {
-            MemUpdateMap();
-            GuiUpdateMemoryView();
-
-            memMapThreadCounter = GetTickCount();
-        }
-
-        Sleep(50);
+        //debounce bursts of requests (a lot of DLLs loading for example)
+        DWORD firstRequest = GetTickCount();
+        while(!bStopMemMapThread && GetTickCount() - firstRequest < MEMMAP_UPDATE_MAXDELAY && MemUpdateMapWait(MEMMAP_UPDATE_DELAY));
+        if(bStopMemMapThread)
+            break;
+        if(!DbgIsDebugging())
+            continue;
+        MemUpdateMap();
+        GuiUpdateMemoryView();
     }
-
     return 0;
 }
 
@@ -86,37 +111,139 @@ static DWORD WINAPI timeWastedCounterThread(void* ptr)
     GuiUpdateTimeWastedCounter();
     while(!bStopTimeWastedCounterThread)
     {
-        while(!DbgIsDebugging())
+        //the event is signaled when a process is created and when the thread has to stop
+        if(!DbgIsDebugging())
         {
-            if(bStopTimeWastedCounterThread)
-                break;
-            Sleep(1);
+            WaitForSingleObject(hTimeWastedCounterEvent, INFINITE);
+            continue;
         }
-        if(bStopTimeWastedCounterThread)
-            break;
         timeWastedDebugging++;
         GuiUpdateTimeWastedCounter();
-        Sleep(1000);
+        WaitForSingleObject(hTimeWastedCounterEvent, 1000);
     }
     BridgeSettingSetUint("Engine", "TimeWastedDebugging", timeWastedDebugging);
     return 0;
 }
 
+static DWORD WINAPI callStackThread(void* ptr)
+{
+    //the event is auto-reset, so any number of requests during a refresh results in a single new refresh
+    while(WaitForSingleObject(hCallStackEvent, INFINITE) == WAIT_OBJECT_0 && !bStopGuiUpdateThreads)
+    {
+        if(DbgIsDebugging() && !bStopGuiUpdateThreads)
+            GuiUpdateCallStack();
+    }
+    return 0;
+}
+
+/**
+\brief Checks whether a refresh can be abandoned, because a newer pause arrived or the debugger is closing.
+*/
+static bool guiupdatestale(LONG generation)
+{
+    return bStopGuiUpdateThreads || generation != guiUpdateGeneration;
+}
+
+static void guiupdate(const GUIUPDATEREQUEST & request, LONG generation)
+{
+    static duint cacheCsp = 0;
+    if(MemIsValidReadPtr(request.disasmAddr))
+    {
+        if(bEnableSourceDebugging)
+        {
+            char szSourceFile[MAX_STRING_SIZE] = "";
+            int line = 0;
+            if(SymGetSourceLine(request.cip, szSourceFile, &line))
+                GuiLoadSourceFile(szSourceFile, line);
+        }
+        if(guiupdatestale(generation))
+            return;
+        GuiDisasmAt(request.disasmAddr, request.cip);
+    }
+    if(guiupdatestale(generation)) //a newer pause arrived, skip the rest
+        return;
+    if(request.stack)
+        DebugUpdateStack(request.csp, request.csp);
+    if(request.csp != cacheCsp)
+    {
+        cacheCsp = request.csp;
+        SetEvent(hCallStackEvent);
+    }
+    if(guiupdatestale(generation))
+        return;
+    char modname[MAX_MODULE_SIZE] = "";
+    char modtext[MAX_MODULE_SIZE * 2] = "";
+    if(!ModNameFromAddr(request.disasmAddr, modname, true))
+        *modname = 0;
+    else
+        sprintf(modtext, "Module: %s - ", modname);
+    char title[1024] = "";
+    sprintf(title, "File: %s - PID: %X - %sThread: %X", szBaseFileName, fdProcessInfo->dwProcessId, modtext, request.threadId);
+    GuiUpdateWindowTitle(title);
+    if(guiupdatestale(generation))
+        return;
+    GuiUpdateAllViews();
+}
+
+static DWORD WINAPI guiUpdateThread(void* ptr)
+{
+    LONG doneGeneration = 0;
+    DWORD lastUpdate = GetTickCount() - GUI_UPDATE_INTERVAL;
+    while(WaitForSingleObject(hGuiUpdateEvent, INFINITE) == WAIT_OBJECT_0 && !bStopGuiUpdateThreads)
+    {
+        //wait for the rest of the frame, requests that arrive meanwhile replace the pending one
+        DWORD elapsed = GetTickCount() - lastUpdate;
+        if(elapsed < GUI_UPDATE_INTERVAL)
+            Sleep(GUI_UPDATE_INTERVAL - elapsed);
+        if(bStopGuiUpdateThreads)
+            break;
+        SHARED_ACQUIRE(LockGuiUpdate);
+        GUIUPDATEREQUEST request = guiUpdateRequest;
+        LONG generation = guiUpdateGeneration;
+        SHARED_RELEASE();
+        if(generation == doneGeneration || !request.pending || !DbgIsDebugging())
+            continue;
+        doneGeneration = generation;
+        guiupdate(request, generation);
+        lastUpdate = GetTickCount();
+    }
+    return 0;
+}
+
 void dbginit()
 {
     ExceptionCodeInit();
     ErrorCodeInit();
     hMemMapThread = CreateThread(nullptr, 0, memMapThread, nullptr, 0, nullptr);
+    hTimeWastedCounterEvent = CreateEventW(nullptr, false, false, nullptr);
     hTimeWastedCounterThread = CreateThread(nullptr, 0, timeWastedCounterThread, nullptr, 0, nullptr);
+    hGuiUpdateEvent = CreateEventW(nullptr, false, false, nullptr);
+    hCallStackEvent = CreateEventW(nullptr, false, false, nullptr);
+    hGuiUpdateThread = CreateThread(nullptr, 0, guiUpdateThread, nullptr, 0, nullptr);
+    hCallStackThread = CreateThread(nullptr, 0, callStackThread, nullptr, 0, nullptr);
+    SymLoaderInit();
+    AutoAnalyseInit();
 }
 
 void dbgstop()
 {
     bStopMemMapThread = true;
-    memMapThreadCounter = 0;
+    MemUpdateMapAsync();
     bStopTimeWastedCounterThread = true;
+    SetEvent(hTimeWastedCounterEvent);
+    bStopGuiUpdateThreads = true;
+    SetEvent(hGuiUpdateEvent);
+    SetEvent(hCallStackEvent);
     WaitForThreadTermination(hMemMapThread);
     WaitForThreadTermination(hTimeWastedCounterThread);
+    //a refresh in progress stops at its next step, the events can only be closed once both threads are gone
+    WaitForThreadTermination(hGuiUpdateThread);
+    WaitForThreadTermination(hCallStackThread);
+    SymLoaderStop();
+    AutoAnalyseStop();
+    CloseHandle(hTimeWastedCounterEvent);
+    CloseHandle(hGuiUpdateEvent);
+    CloseHandle(hCallStackEvent);
 }
 
 duint dbgdebuggedbase()
@@ -207,45 +334,44 @@ bool dbgcmddel(const char* name)
     return true;
 }
 
-DWORD WINAPI updateCallStackThread(void* ptr)
+/**
+\brief Schedules a refresh of the GUI for the current state of the active thread. The refresh runs on the GUI update thread, at most once per frame, and only the newest request is handled.
+\param disasm_addr The address to show in the disassembly.
+\param stack true to also update the stack view.
+*/
+void DebugUpdateGui(duint disasm_addr, bool stack)
 {
-    GuiUpdateCallStack();
-    return 0;
+    //capture the state now, the debuggee might run again before the refresh happens
+    GUIUPDATEREQUEST request;
+    request.disasmAddr = disasm_addr;
+    request.cip = GetContextDataEx(hActiveThread, UE_CIP);
+    request.csp = GetContextDataEx(hActiveThread, UE_CSP);
+    request.threadId = ThreadGetId(hActiveThread);
+    request.stack = stack;
+    request.pending = true;
+    EXCLUSIVE_ACQUIRE(LockGuiUpdate);
+    guiUpdateRequest = request;
+    InterlockedIncrement(&guiUpdateGeneration);
+    EXCLUSIVE_RELEASE();
+    //stack comments cached while the debuggee ran (the stack view repaints when scrolled) can be stale
+    stackcommentinvalidate();
+    SetEvent(hGuiUpdateEvent);
+    //the debuggee might have changed its memory layout since the last pause
+    MemUpdateMapAsync();
+    //load the symbols around the new location first
+    SymLoaderPrioritize(request.cip);
+    //analyse the module of the new location first
+    AutoAnalysePrioritize(request.cip);
 }
 
-void DebugUpdateGui(duint disasm_addr, bool stack)
+/**
+\brief Drops the GUI refresh that is still queued when the debuggee resumes. A refresh in progress stops at its next check, the state it shows is no longer current.
+*/
+void DebugCancelGuiUpdate()
 {
-    duint cip = GetContextDataEx(hActiveThread, UE_CIP);
-    if(MemIsValidReadPtr(disasm_addr))
-    {
-        if(bEnableSourceDebugging)
-        {
-            char szSourceFile[MAX_STRING_SIZE] = "";
-            int line = 0;
-            if(SymGetSourceLine(cip, szSourceFile, &line))
-                GuiLoadSourceFile(szSourceFile, line);
-        }
-        GuiDisasmAt(disasm_addr, cip);
-    }
-    duint csp = GetContextDataEx(hActiveThread, UE_CSP);
-    if(stack)
-        DebugUpdateStack(csp, csp);
-    static duint cacheCsp = 0;
-    if(csp != cacheCsp)
-    {
-        cacheCsp = csp;
-        CloseHandle(CreateThread(0, 0, updateCallStackThread, 0, 0, 0));
-    }
-    char modname[MAX_MODULE_SIZE] = "";
-    char modtext[MAX_MODULE_SIZE * 2] = "";
-    if(!ModNameFromAddr(disasm_addr, modname, true))
-        *modname = 0;
-    else
-        sprintf(modtext, "Module: %s - ", modname);
-    char title[1024] = "";
-    sprintf(title, "File: %s - PID: %X - %sThread: %X", szBaseFileName, fdProcessInfo->dwProcessId, modtext, ThreadGetId(hActiveThread));
-    GuiUpdateWindowTitle(title);
-    GuiUpdateAllViews();
+    EXCLUSIVE_ACQUIRE(LockGuiUpdate);
+    guiUpdateRequest.pending = false;
+    InterlockedIncrement(&guiUpdateGeneration);
 }
 
 void DebugUpdateStack(duint dumpAddr, duint csp, bool forceDump)
@@ -259,6 +385,40 @@ void DebugUpdateStack(duint dumpAddr, duint csp, bool forceDump)
     GuiStackDumpAt(dumpAddr, csp);
 }
 
+/**
+\brief Evaluates the condition and log text of a breakpoint that was hit. This runs in the exception handler, so a breakpoint that does not pause costs no GUI updates or plugin callbacks.
+\param [in,out] bp The breakpoint that was hit, the hit counter is updated.
+\return true if the debuggee should pause, false if it can be resumed immediately.
+*/
+static bool cbBreakpointCondition(BREAKPOINT & bp)
+{
+    bp.hitCount = BpIncrementHitCount(bp.addr, bp.type);
+    //a single shot breakpoint is gone after its first hit, whether the condition holds or not
+    if(bp.singleshoot)
+    {
+        if(bp.type == BPHARDWARE)
+            DeleteHardwareBreakPoint(TITANGETDRX(bp.titantype));
+        else if(bp.type == BPMEMORY && (bp.watchCount || bp.watchHardware)) //TitanEngine only removes a single shot guard over the whole region
+            dbgremovememorybreakpoint(&bp);
+        BpDelete(bp.addr, bp.type);
+    }
+    if(*bp.condition)
+    {
+        duint value = 0;
+        if(!valfromstring(bp.condition, &value, false))
+        {
+            dprintf("Invalid breakpoint condition \"%s\" at " fhex "!\n", bp.condition, bp.addr);
+            return true;
+        }
+        if(!value)
+            return false;
+    }
+    if(!*bp.logText)
+        return true;
+    dprintf("%s\n", stringformatinline(bp.logText).c_str());
+    return false;
+}
+
 void cbUserBreakpoint()
 {
     hActiveThread = ThreadGetHandle(((DEBUG_EVENT*)GetDebugData())->dwThreadId);
@@ -266,10 +426,12 @@ void cbUserBreakpoint()
     BRIDGEBP pluginBp;
     PLUG_CB_BREAKPOINT bpInfo;
     bpInfo.breakpoint = 0;
-    if(!BpGet(GetContextDataEx(hActiveThread, UE_CIP), BPNORMAL, 0, &bp) && bp.enabled)
+    if(!BpGet(GetContextDataEx(hActiveThread, UE_CIP), BPNORMAL, 0, &bp))
         dputs("Breakpoint reached not in list!");
     else
     {
+        if(!cbBreakpointCondition(bp))
+            return;
         const char* bptype = "INT3";
         int titantype = bp.titantype;
         if((titantype & UE_BREAKPOINT_TYPE_UD2) == UE_BREAKPOINT_TYPE_UD2)
@@ -291,8 +453,6 @@ void cbUserBreakpoint()
             else
                 dprintf("%s breakpoint at " fhex "!\n", bptype, bp.addr);
         }
-        if(bp.singleshoot)
-            BpDelete(bp.addr, BPNORMAL);
         BpToBridge(&bp, &pluginBp);
         bpInfo.breakpoint = &pluginBp;
     }
@@ -321,6 +481,8 @@ void cbHardwareBreakpoint(void* ExceptionAddress)
         dputs("Hardware breakpoint reached not in list!");
     else
     {
+        if(!cbBreakpointCondition(bp))
+            return;
         const char* bpsize = "";
         switch(TITANGETSIZE(bp.titantype)) //size
         {
@@ -384,22 +546,23 @@ void cbHardwareBreakpoint(void* ExceptionAddress)
     wait(WAITID_RUN);
 }
 
-void cbMemoryBreakpoint(void* ExceptionAddress)
+/**
+\brief Reports a memory breakpoint hit and pauses the debuggee.
+\param bp The breakpoint that was hit, nullptr if it is not in the list.
+\param ExceptionAddress The accessed address.
+\param cip The instruction pointer of the accessing thread.
+*/
+static void cbMemoryBreakpointPause(const BREAKPOINT* bp, duint ExceptionAddress, duint cip)
 {
-    hActiveThread = ThreadGetHandle(((DEBUG_EVENT*)GetDebugData())->dwThreadId);
-    duint cip = GetContextDataEx(hActiveThread, UE_CIP);
-    duint size;
-    duint base = MemFindBaseAddr((duint)ExceptionAddress, &size, true);
-    BREAKPOINT bp;
     BRIDGEBP pluginBp;
     PLUG_CB_BREAKPOINT bpInfo;
     bpInfo.breakpoint = 0;
-    if(!BpGet(base, BPMEMORY, 0, &bp))
+    if(!bp)
         dputs("Memory breakpoint reached not in list!");
     else
     {
         const char* bptype = "";
-        switch(bp.titantype)
+        switch(bp->titantype)
         {
         case UE_MEMORY_READ:
             bptype = " (read)";
@@ -414,26 +577,24 @@ void cbMemoryBreakpoint(void* ExceptionAddress)
             bptype = " (read/write/execute)";
             break;
         }
-        const char* symbolicname = SymGetSymbolicName(bp.addr);
+        const char* symbolicname = SymGetSymbolicName(bp->addr);
         if(symbolicname)
         {
-            if(*bp.name)
-                dprintf("Memory breakpoint%s \"%s\" at %s (" fhex ", " fhex ")!\n", bptype, bp.name, symbolicname, bp.addr, ExceptionAddress);
+            if(*bp->name)
+                dprintf("Memory breakpoint%s \"%s\" at %s (" fhex ", " fhex ")!\n", bptype, bp->name, symbolicname, bp->addr, ExceptionAddress);
             else
-                dprintf("Memory breakpoint%s at %s (" fhex ", " fhex ")!\n", bptype, symbolicname, bp.addr, ExceptionAddress);
+                dprintf("Memory breakpoint%s at %s (" fhex ", " fhex ")!\n", bptype, symbolicname, bp->addr, ExceptionAddress);
         }
         else
         {
-            if(*bp.name)
-                dprintf("Memory breakpoint%s \"%s\" at " fhex " (" fhex ")!\n", bptype, bp.name, bp.addr, ExceptionAddress);
+            if(*bp->name)
+                dprintf("Memory breakpoint%s \"%s\" at " fhex " (" fhex ")!\n", bptype, bp->name, bp->addr, ExceptionAddress);
             else
-                dprintf("Memory breakpoint%s at " fhex " (" fhex ")!\n", bptype, bp.addr, ExceptionAddress);
+                dprintf("Memory breakpoint%s at " fhex " (" fhex ")!\n", bptype, bp->addr, ExceptionAddress);
         }
-        BpToBridge(&bp, &pluginBp);
+        BpToBridge(bp, &pluginBp);
         bpInfo.breakpoint = &pluginBp;
     }
-    if(bp.singleshoot)
-        BpDelete(bp.addr, BPMEMORY); //delete from breakpoint list
     GuiSetDebugState(paused);
     DebugUpdateGui(cip, true);
     //lock
@@ -447,6 +608,157 @@ void cbMemoryBreakpoint(void* ExceptionAddress)
     wait(WAITID_RUN);
 }
 
+void cbMemoryBreakpoint(void* ExceptionAddress)
+{
+    hActiveThread = ThreadGetHandle(((DEBUG_EVENT*)GetDebugData())->dwThreadId);
+    duint cip = GetContextDataEx(hActiveThread, UE_CIP);
+    duint size;
+    //the region is known already, only refresh the memory map when it is not
+    duint base = MemFindBaseAddr((duint)ExceptionAddress, &size);
+    if(!base)
+        base = MemFindBaseAddr((duint)ExceptionAddress, &size, true);
+    BREAKPOINT bp;
+    if(!BpGet(base, BPMEMORY, 0, &bp))
+    {
+        cbMemoryBreakpointPause(nullptr, (duint)ExceptionAddress, cip);
+        return;
+    }
+    //the access only shares a guarded page with the watched ranges, the guard is restored so resume right away
+    if(!BpMemoryWatchHit(bp, (duint)ExceptionAddress))
+        return;
+    if(!cbBreakpointCondition(bp))
+        return;
+    cbMemoryBreakpointPause(&bp, (duint)ExceptionAddress, cip);
+}
+
+void cbMemoryWatchHardware(void* ExceptionAddress)
+{
+    hActiveThread = ThreadGetHandle(((DEBUG_EVENT*)GetDebugData())->dwThreadId);
+    duint cip = GetContextDataEx(hActiveThread, UE_CIP);
+    //the debug register holds the address of the memory breakpoint
+    BREAKPOINT bp;
+    if(!BpGet((duint)ExceptionAddress, BPMEMORY, 0, &bp) || !bp.watchHardware)
+    {
+        cbMemoryBreakpointPause(nullptr, (duint)ExceptionAddress, cip);
+        return;
+    }
+    if(!cbBreakpointCondition(bp))
+        return;
+    cbMemoryBreakpointPause(&bp, (duint)ExceptionAddress, cip);
+}
+
+/**
+\brief Gets the debug register settings that watch a memory range, if it fits in one.
+\param addr The start of the range, it has to be aligned to its size.
+\param size The size of the range (1, 2, 4 or 8 on x64).
+\param type The memory breakpoint type (UE_MEMORY*).
+\param [out] hwtype The hardware breakpoint type (UE_HARDWARE*).
+\param [out] hwsize The hardware breakpoint size (UE_HARDWARE_SIZE*).
+\return true if the range fits in a debug register, false otherwise.
+*/
+bool dbgmemorywatchhardware(duint addr, duint size, DWORD type, DWORD* hwtype, DWORD* hwsize)
+{
+    switch(size)
+    {
+    case 1:
+        *hwsize = UE_HARDWARE_SIZE_1;
+        break;
+    case 2:
+        *hwsize = UE_HARDWARE_SIZE_2;
+        break;
+    case 4:
+        *hwsize = UE_HARDWARE_SIZE_4;
+        break;
+#ifdef _WIN64
+    case 8:
+        *hwsize = UE_HARDWARE_SIZE_8;
+        break;
+#endif // _WIN64
+    default:
+        return false;
+    }
+    if((addr % size) != 0)
+        return false;
+    switch(type)
+    {
+    case UE_MEMORY_WRITE:
+        *hwtype = UE_HARDWARE_WRITE;
+        break;
+    case UE_MEMORY_EXECUTE:
+        if(size != 1)
+            return false;
+        *hwtype = UE_HARDWARE_EXECUTE;
+        break;
+    case UE_MEMORY:
+        *hwtype = UE_HARDWARE_READWRITE;
+        break;
+    default: //debug registers cannot trap reads only, they would break on writes too
+        return false;
+    }
+    return true;
+}
+
+/**
+\brief Arms a memory breakpoint: a guard over the whole region, a guard on every page of the watched ranges or a debug register for a hardware watch.
+\param bp The memory breakpoint.
+\return true if it succeeds, false otherwise.
+*/
+bool dbgsetmemorybreakpoint(const BREAKPOINT* bp)
+{
+    if(bp->watchHardware)
+    {
+        DWORD hwtype, hwsize, drx = 0;
+        if(!dbgmemorywatchhardware(bp->addr, bp->watch[0].size, bp->titantype, &hwtype, &hwsize) || !GetUnusedHardwareBreakPointRegister(&drx))
+            return false;
+        //only record the register once it holds the watch
+        if(!SetHardwareBreakPoint(bp->addr, drx, hwtype, hwsize, (void*)cbMemoryWatchHardware))
+            return false;
+        BpSetMemoryWatchHardware(bp->addr, true, (unsigned char)drx);
+        return true;
+    }
+    if(!bp->watchCount)
+    {
+        duint size = 0;
+        MemFindBaseAddr(bp->addr, &size);
+        return SetMemoryBPXEx(bp->addr, size, bp->titantype, !bp->singleshoot, (void*)cbMemoryBreakpoint);
+    }
+    //accesses next to the watched ranges are filtered by the handler, so the page guards always have to be restored
+    std::vector<duint> pages;
+    BpMemoryWatchPages(*bp, pages);
+    for(auto page : pages)
+    {
+        if(!SetMemoryBPXEx(page, PAGE_SIZE, bp->titantype, true, (void*)cbMemoryBreakpoint))
+            return false;
+    }
+    return true;
+}
+
+/**
+\brief Removes the guards or the debug register that dbgsetmemorybreakpoint armed.
+\param bp The memory breakpoint.
+\return true if it succeeds, false otherwise.
+*/
+bool dbgremovememorybreakpoint(const BREAKPOINT* bp)
+{
+    if(bp->watchHardware)
+        return DeleteHardwareBreakPoint(bp->watchDrx);
+    if(!bp->watchCount)
+    {
+        duint size = 0;
+        MemFindBaseAddr(bp->addr, &size);
+        return RemoveMemoryBPX(bp->addr, size);
+    }
+    std::vector<duint> pages;
+    BpMemoryWatchPages(*bp, pages);
+    bool result = true;
+    for(auto page : pages)
+    {
+        if(!RemoveMemoryBPX(page, PAGE_SIZE))
+            result = false;
+    }
+    return result;
+}
+
 void cbLibrarianBreakpoint(void* lpData)
 {
     bBreakOnNextDll = true;
@@ -551,9 +863,7 @@ bool cbSetModuleBreakpoints(const BREAKPOINT* bp)
 
     case BPMEMORY:
     {
-        duint size = 0;
-        MemFindBaseAddr(bp->addr, &size);
-        if(!SetMemoryBPXEx(bp->addr, size, bp->titantype, !bp->singleshoot, (void*)cbMemoryBreakpoint))
+        if(!dbgsetmemorybreakpoint(bp))
             dprintf("Could not set memory breakpoint " fhex "! (SetMemoryBPXEx)\n", bp->addr);
     }
     break;
@@ -591,7 +901,7 @@ static bool cbRemoveModuleBreakpoints(const BREAKPOINT* bp)
             dprintf("Could not delete breakpoint " fhex "! (DeleteBPX)\n", bp->addr);
         break;
     case BPMEMORY:
-        if(!RemoveMemoryBPX(bp->addr, 0))
+        if(!dbgremovememorybreakpoint(bp))
             dprintf("Could not delete memory breakpoint " fhex "! (RemoveMemoryBPX)\n", bp->addr);
         break;
     case BPHARDWARE:
@@ -655,6 +965,63 @@ void cbRtrStep()
         StepOver((void*)cbRtrStep);
 }
 
+/**
+\brief Starts a recorded trace from the active thread. The debuggee has to be resumed with cbDebugRun afterwards.
+\param condition Expression that stops the trace when it is nonzero, evaluated before every instruction. Can be empty.
+\param maxsteps Maximum number of instructions to trace.
+\param stepover true to step over calls, false to trace into them.
+*/
+void dbgtracestart(const char* condition, duint maxsteps, bool stepover)
+{
+    strcpy_s(traceCondition, condition);
+    traceStepsLeft = maxsteps;
+    traceSteps = 0;
+    traceStepOver = stepover;
+    duint setting = 0;
+    if(BridgeSettingGetUint("Engine", "TraceBufferSize", &setting) && setting)
+        TraceRecordSetMaxSize(setting);
+    TraceRecordBegin(hActiveThread, ThreadGetId(hActiveThread));
+    if(stepover)
+        StepOver((void*)cbTraceStep);
+    else
+        StepInto((void*)cbTraceStep);
+    dbgsetstepping(true);
+}
+
+void cbTraceStep()
+{
+    //this runs for every traced instruction, the GUI is only updated when the trace stops
+    hActiveThread = ThreadGetHandle(((DEBUG_EVENT*)GetDebugData())->dwThreadId);
+    TraceRecordEnd();
+    traceSteps++;
+    bool stop = traceStepsLeft <= 1;
+    if(traceStepsLeft)
+        traceStepsLeft--;
+    if(!stop && *traceCondition)
+    {
+        duint value = 0;
+        if(!valfromstring(traceCondition, &value, false))
+        {
+            dprintf("Invalid trace condition \"%s\"!\n", traceCondition);
+            stop = true;
+        }
+        else if(value)
+            stop = true;
+    }
+    if(!stop)
+    {
+        TraceRecordBegin(hActiveThread, ((DEBUG_EVENT*)GetDebugData())->dwThreadId);
+        if(traceStepOver)
+            StepOver((void*)cbTraceStep);
+        else
+            StepInto((void*)cbTraceStep);
+        return;
+    }
+    TraceRecordFlush();
+    dprintf("Trace finished after %" fext "u steps (%llu events in the trace buffer)\n", traceSteps, TraceRecordEventCount());
+    cbStep();
+}
+
 static void cbCreateProcess(CREATE_PROCESS_DEBUG_INFO* CreateProcessInfo)
 {
     void* base = CreateProcessInfo->lpBaseOfImage;
@@ -664,6 +1031,9 @@ static void cbCreateProcess(CREATE_PROCESS_DEBUG_INFO* CreateProcessInfo)
         strcpy_s(DebugFileName, "??? (GetFileNameFromHandle failed!)");
     dprintf("Process Started: " fhex " %s\n", base, DebugFileName);
 
+    //start counting the time wasted debugging
+    SetEvent(hTimeWastedCounterEvent);
+
     //update memory map
     MemUpdateMap();
     GuiUpdateMemoryView();
@@ -673,7 +1043,7 @@ static void cbCreateProcess(CREATE_PROCESS_DEBUG_INFO* CreateProcessInfo)
     // Init program database
     DbLoad(DbLoadSaveType::DebugData);
 
-    SafeSymSetOptions(SYMOPT_DEBUG | SYMOPT_LOAD_LINES | SYMOPT_ALLOW_ABSOLUTE_SYMBOLS | SYMOPT_FAVOR_COMPRESSED | SYMOPT_IGNORE_NT_SYMPATH);
+    SafeSymSetOptions(SYMOPT_DEBUG | SYMOPT_DEFERRED_LOADS | SYMOPT_LOAD_LINES | SYMOPT_ALLOW_ABSOLUTE_SYMBOLS | SYMOPT_FAVOR_COMPRESSED | SYMOPT_IGNORE_NT_SYMPATH);
     GuiSymbolLogClear();
     char szServerSearchPath[MAX_PATH * 2] = "";
     sprintf_s(szServerSearchPath, "SRV*%s", szSymbolCachePath);
@@ -685,7 +1055,11 @@ static void cbCreateProcess(CREATE_PROCESS_DEBUG_INFO* CreateProcessInfo)
     memset(&modInfo, 0, sizeof(modInfo));
     modInfo.SizeOfStruct = sizeof(modInfo);
     if(SafeSymGetModuleInfo64(fdProcessInfo->hProcess, (DWORD64)base, &modInfo))
+    {
         ModLoad((duint)base, modInfo.ImageSize, modInfo.ImageName);
+        SymLoaderAdd((duint)base, modInfo.ModuleName);
+        AutoAnalyseAdd((duint)base, modInfo.ModuleName);
+    }
 
     char modname[256] = "";
     if(ModNameFromAddr((duint)base, modname, true))
@@ -697,7 +1071,7 @@ static void cbCreateProcess(CREATE_PROCESS_DEBUG_INFO* CreateProcessInfo)
         pDebuggedBase = pCreateProcessBase; //debugged base = executable
         char command[256] = "";
 
-        if(settingboolget("Events", "TlsCallbacks"))
+        if(SettingGetBool(SettingEventsTlsCallbacks))
         {
             DWORD NumberOfCallBacks = 0;
             TLSGrabCallBackDataW(StringUtils::Utf8ToUtf16(DebugFileName).c_str(), 0, &NumberOfCallBacks);
@@ -728,7 +1102,7 @@ static void cbCreateProcess(CREATE_PROCESS_DEBUG_INFO* CreateProcessInfo)
             }
         }
 
-        if(settingboolget("Events", "EntryBreakpoint"))
+        if(SettingGetBool(SettingEventsEntryBreakpoint))
         {
             sprintf(command, "bp " fhex ",\"entry breakpoint\",ss", (duint)CreateProcessInfo->lpStartAddress);
             cmddirectexec(command);
@@ -759,6 +1133,8 @@ static void cbExitProcess(EXIT_PROCESS_DEBUG_INFO* ExitProcess)
     callbackInfo.ExitProcess = ExitProcess;
     plugincbcall(CB_EXITPROCESS, &callbackInfo);
     //unload main module
+    SymLoaderRemove(pCreateProcessBase);
+    AutoAnalyseRemove(pCreateProcessBase);
     SafeSymUnloadModule64(fdProcessInfo->hProcess, pCreateProcessBase);
 }
 
@@ -768,7 +1144,7 @@ static void cbCreateThread(CREATE_THREAD_DEBUG_INFO* CreateThread)
     DWORD dwThreadId = ((DEBUG_EVENT*)GetDebugData())->dwThreadId;
     hActiveThread = ThreadGetHandle(dwThreadId);
 
-    if(settingboolget("Events", "ThreadEntry"))
+    if(SettingGetBool(SettingEventsThreadEntry))
     {
         char command[256] = "";
         sprintf(command, "bp " fhex ",\"Thread %X\",ss", (duint)CreateThread->lpStartAddress, dwThreadId);
@@ -782,7 +1158,10 @@ static void cbCreateThread(CREATE_THREAD_DEBUG_INFO* CreateThread)
 
     dprintf("Thread %X created\n", dwThreadId);
 
-    if(settingboolget("Events", "ThreadStart"))
+    //the new thread has a stack and a TEB
+    MemUpdateMapAsync();
+
+    if(SettingGetBool(SettingEventsThreadStart))
     {
         //update memory map
         MemUpdateMap();
@@ -810,7 +1189,10 @@ static void cbExitThread(EXIT_THREAD_DEBUG_INFO* ExitThread)
     ThreadExit(dwThreadId);
     dprintf("Thread %X exit\n", dwThreadId);
 
-    if(settingboolget("Events", "ThreadEnd"))
+    //the stack of the thread is released
+    MemUpdateMapAsync();
+
+    if(SettingGetBool(SettingEventsThreadEnd))
     {
         //update GUI
         GuiSetDebugState(paused);
@@ -844,7 +1226,7 @@ static void cbSystemBreakpoint(void* ExceptionData)
     callbackInfo.reserved = 0;
     plugincbcall(CB_SYSTEMBREAKPOINT, &callbackInfo);
 
-    if(bIsAttached ? settingboolget("Events", "AttachBreakpoint") : settingboolget("Events", "SystemBreakpoint"))
+    if(bIsAttached ? SettingGetBool(SettingEventsAttachBreakpoint) : SettingGetBool(SettingEventsSystemBreakpoint))
     {
         //update GUI
         GuiSetDebugState(paused);
@@ -873,7 +1255,11 @@ static void cbLoadDll(LOAD_DLL_DEBUG_INFO* LoadDll)
     memset(&modInfo, 0, sizeof(modInfo));
     modInfo.SizeOfStruct = sizeof(IMAGEHLP_MODULE64);
     if(SafeSymGetModuleInfo64(fdProcessInfo->hProcess, (DWORD64)base, &modInfo))
+    {
         ModLoad((duint)base, modInfo.ImageSize, modInfo.ImageName);
+        SymLoaderAdd((duint)base, modInfo.ModuleName);
+        AutoAnalyseAdd((duint)base, modInfo.ModuleName);
+    }
 
     // Update memory map
     MemUpdateMapAsync();
@@ -890,7 +1276,7 @@ static void cbLoadDll(LOAD_DLL_DEBUG_INFO* LoadDll)
     {
         bIsDebuggingThis = true;
         pDebuggedBase = (duint)base;
-        if(settingboolget("Events", "EntryBreakpoint"))
+        if(SettingGetBool(SettingEventsEntryBreakpoint))
         {
             bAlreadySetEntry = true;
             sprintf(command, "bp " fhex ",\"entry breakpoint\",ss", pDebuggedBase + pDebuggedEntry);
@@ -899,7 +1285,7 @@ static void cbLoadDll(LOAD_DLL_DEBUG_INFO* LoadDll)
     }
     GuiUpdateBreakpointsView();
 
-    if(settingboolget("Events", "TlsCallbacks"))
+    if(SettingGetBool(SettingEventsTlsCallbacks))
     {
         DWORD NumberOfCallBacks = 0;
         TLSGrabCallBackDataW(StringUtils::Utf8ToUtf16(DLLDebugFileName).c_str(), 0, &NumberOfCallBacks);
@@ -933,7 +1319,7 @@ static void cbLoadDll(LOAD_DLL_DEBUG_INFO* LoadDll)
         }
     }
 
-    if((bBreakOnNextDll || settingboolget("Events", "DllEntry")) && !bAlreadySetEntry)
+    if((bBreakOnNextDll || SettingGetBool(SettingEventsDllEntry)) && !bAlreadySetEntry)
     {
         duint oep = GetPE32DataW(StringUtils::Utf8ToUtf16(DLLDebugFileName).c_str(), 0, UE_OEP);
         if(oep)
@@ -953,7 +1339,7 @@ static void cbLoadDll(LOAD_DLL_DEBUG_INFO* LoadDll)
     callbackInfo.modname = modname;
     plugincbcall(CB_LOADDLL, &callbackInfo);
 
-    if(bBreakOnNextDll || settingboolget("Events", "DllLoad"))
+    if(bBreakOnNextDll || SettingGetBool(SettingEventsDllLoad))
     {
         bBreakOnNextDll = false;
         //update GUI
@@ -981,10 +1367,12 @@ static void cbUnloadDll(UNLOAD_DLL_DEBUG_INFO* UnloadDll)
     if(ModNameFromAddr((duint)base, modname, true))
         BpEnumAll(cbRemoveModuleBreakpoints, modname);
     GuiUpdateBreakpointsView();
+    SymLoaderRemove((duint)base);
+    AutoAnalyseRemove((duint)base);
     SafeSymUnloadModule64(fdProcessInfo->hProcess, (DWORD64)base);
     dprintf("DLL Unloaded: " fhex " %s\n", base, modname);
 
-    if(bBreakOnNextDll || settingboolget("Events", "DllUnload"))
+    if(bBreakOnNextDll || SettingGetBool(SettingEventsDllUnload))
     {
         bBreakOnNextDll = false;
         //update GUI
@@ -1030,7 +1418,7 @@ static void cbOutputDebugString(OUTPUT_DEBUG_STRING_INFO* DebugString)
         }
     }
 
-    if(settingboolget("Events", "DebugStrings"))
+    if(SettingGetBool(SettingEventsDebugStrings))
     {
         //update GUI
         GuiSetDebugState(paused);
@@ -1240,6 +1628,8 @@ DWORD WINAPI threadDebugLoop(void* lpParameter)
     stopInfo.reserved = 0;
     plugincbcall(CB_STOPDEBUG, &stopInfo);
     //cleanup dbghelp
+    SymLoaderClear();
+    AutoAnalyseClear();
     SafeSymRegisterCallback64(hProcess, nullptr, 0);
     SafeSymCleanup(hProcess);
     //message the user/do final stuff
@@ -1249,6 +1639,7 @@ DWORD WINAPI threadDebugLoop(void* lpParameter)
     ModClear();
     ThreadClear();
     SymClearMemoryCache();
+    stackcommentcacheclear();
     GuiSetDebugState(stopped);
     dputs("Debugging stopped!");
     varset("$hp", (duint)0, true);
@@ -1273,42 +1664,6 @@ bool cbDeleteAllBreakpoints(const BREAKPOINT* bp)
     return false;
 }
 
-bool cbEnableAllBreakpoints(const BREAKPOINT* bp)
-{
-    if(bp->type != BPNORMAL || bp->enabled)
-        return true;
-
-    if(!BpEnable(bp->addr, BPNORMAL, true))
-    {
-        dprintf("Could not enable breakpoint " fhex " (BpEnable)\n", bp->addr);
-        return false;
-    }
-    if(!SetBPX(bp->addr, bp->titantype, (void*)cbUserBreakpoint))
-    {
-        dprintf("Could not enable breakpoint " fhex " (SetBPX)\n", bp->addr);
-        return false;
-    }
-    return true;
-}
-
-bool cbDisableAllBreakpoints(const BREAKPOINT* bp)
-{
-    if(bp->type != BPNORMAL || !bp->enabled)
-        return true;
-
-    if(!BpEnable(bp->addr, BPNORMAL, false))
-    {
-        dprintf("Could not disable breakpoint " fhex " (BpEnable)\n", bp->addr);
-        return false;
-    }
-    if(!DeleteBPX(bp->addr))
-    {
-        dprintf("Could not disable breakpoint " fhex " (DeleteBPX)\n", bp->addr);
-        return false;
-    }
-    return true;
-}
-
 bool cbEnableAllHardwareBreakpoints(const BREAKPOINT* bp)
 {
     if(bp->type != BPHARDWARE || bp->enabled)
@@ -1356,14 +1711,12 @@ bool cbEnableAllMemoryBreakpoints(const BREAKPOINT* bp)
 {
     if(bp->type != BPMEMORY || bp->enabled)
         return true;
-    duint size = 0;
-    MemFindBaseAddr(bp->addr, &size);
     if(!BpEnable(bp->addr, BPMEMORY, true))
     {
         dprintf("Could not enable memory breakpoint " fhex " (BpEnable)\n", bp->addr);
         return false;
     }
-    if(!SetMemoryBPXEx(bp->addr, size, bp->titantype, !bp->singleshoot, (void*)cbMemoryBreakpoint))
+    if(!dbgsetmemorybreakpoint(bp))
     {
         dprintf("Could not enable memory breakpoint " fhex " (SetMemoryBPXEx)\n", bp->addr);
         return false;
@@ -1380,7 +1733,7 @@ bool cbDisableAllMemoryBreakpoints(const BREAKPOINT* bp)
         dprintf("Could not disable memory breakpoint " fhex " (BpEnable)\n", bp->addr);
         return false;
     }
-    if(!RemoveMemoryBPX(bp->addr, 0))
+    if(!dbgremovememorybreakpoint(bp))
     {
         dprintf("Could not disable memory breakpoint " fhex " (RemoveMemoryBPX)\n", bp->addr);
         return false;
@@ -1404,9 +1757,16 @@ bool cbBreakpointList(const BREAKPOINT* bp)
         type = "GP";
     bool enabled = bp->enabled;
     if(*bp->name)
-        dprintf("%d:%s:" fhex ":\"%s\"\n", enabled, type, bp->addr, bp->name);
+        dprintf("%d:%s:" fhex ":\"%s\"", enabled, type, bp->addr, bp->name);
     else
-        dprintf("%d:%s:" fhex "\n", enabled, type, bp->addr);
+        dprintf("%d:%s:" fhex, enabled, type, bp->addr);
+    if(bp->hitCount)
+        dprintf(" hits:%" fext "u", bp->hitCount);
+    if(*bp->condition)
+        dprintf(" condition:\"%s\"", bp->condition);
+    if(*bp->logText)
+        dprintf(" log:\"%s\"", bp->logText);
+    dprintf("\n");
     return true;
 }
 
@@ -1414,14 +1774,12 @@ bool cbDeleteAllMemoryBreakpoints(const BREAKPOINT* bp)
 {
     if(!bp->enabled)
         return true;
-    duint size;
-    MemFindBaseAddr(bp->addr, &size);
     if(!BpDelete(bp->addr, BPMEMORY))
     {
         dprintf("Delete memory breakpoint failed (BpDelete): " fhex "\n", bp->addr);
         return false;
     }
-    if(!RemoveMemoryBPX(bp->addr, size))
+    if(!dbgremovememorybreakpoint(bp))
     {
         dprintf("Delete memory breakpoint failed (RemoveMemoryBPX): " fhex "\n", bp->addr);
         return false;
@@ -1508,6 +1866,8 @@ DWORD WINAPI threadAttachLoop(void* lpParameter)
     stopInfo.reserved = 0;
     plugincbcall(CB_STOPDEBUG, &stopInfo);
     //cleanup dbghelp
+    SymLoaderClear();
+    AutoAnalyseClear();
     SafeSymRegisterCallback64(hProcess, nullptr, 0);
     SafeSymCleanup(hProcess);
     //message the user/do final stuff
@@ -1517,6 +1877,7 @@ DWORD WINAPI threadAttachLoop(void* lpParameter)
     ModClear();
     ThreadClear();
     SymClearMemoryCache();
+    stackcommentcacheclear();
     GuiSetDebugState(stopped);
     dputs("debugging stopped!");
     varset("$hp", (duint)0, true);
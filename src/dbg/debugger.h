@@ -67,6 +67,7 @@ bool dbgisrunning();
 bool dbgisdll();
 void dbgsetattachevent(HANDLE handle);
 void DebugUpdateGui(duint disasm_addr, bool stack);
+void DebugCancelGuiUpdate();
 void DebugUpdateStack(duint dumpAddr, duint csp, bool forceDump = false);
 void dbgsetskipexceptions(bool skip);
 void dbgsetstepping(bool stepping);
@@ -83,19 +84,20 @@ bool dbgsetcmdline(const char* cmd_line, cmdline_error_t* cmd_line_error);
 bool dbggetcmdline(char** cmd_line, cmdline_error_t* cmd_line_error);
 void dbgstartscriptthread(CBPLUGINSCRIPT cbScript);
 duint dbggetdebuggedbase();
+void dbgtracestart(const char* condition, duint maxsteps, bool stepover);
 
 void cbStep();
 void cbRtrStep();
+void cbTraceStep();
 void cbSystemBreakpoint(void* ExceptionData);
 void cbMemoryBreakpoint(void* ExceptionAddress);
+void cbMemoryWatchHardware(void* ExceptionAddress);
 void cbHardwareBreakpoint(void* ExceptionAddress);
 void cbUserBreakpoint();
 void cbDebugLoadLibBPX();
 void cbLibrarianBreakpoint(void* lpData);
 DWORD WINAPI threadDebugLoop(void* lpParameter);
 bool cbDeleteAllBreakpoints(const BREAKPOINT* bp);
-bool cbEnableAllBreakpoints(const BREAKPOINT* bp);
-bool cbDisableAllBreakpoints(const BREAKPOINT* bp);
 bool cbEnableAllHardwareBreakpoints(const BREAKPOINT* bp);
 bool cbDisableAllHardwareBreakpoints(const BREAKPOINT* bp);
 bool cbEnableAllMemoryBreakpoints(const BREAKPOINT* bp);
@@ -106,6 +108,9 @@ bool cbDeleteAllHardwareBreakpoints(const BREAKPOINT* bp);
 DWORD WINAPI threadAttachLoop(void* lpParameter);
 void cbDetach();
 bool cbSetModuleBreakpoints(const BREAKPOINT* bp);
+bool dbgmemorywatchhardware(duint addr, duint size, DWORD type, DWORD* hwtype, DWORD* hwsize);
+bool dbgsetmemorybreakpoint(const BREAKPOINT* bp);
+bool dbgremovememorybreakpoint(const BREAKPOINT* bp);
 
 //variables
 extern PROCESS_INFORMATION* fdProcessInfo;
@@ -22,6 +22,10 @@
 #include "label.h"
 #include "bookmark.h"
 #include "function.h"
+#include "stackinfo.h"
+#include "tracerecord.h"
+
+#define TRACE_DEFAULT_MAX_STEPS 50000
 
 static bool bScyllaLoaded = false;
 duint LoadLibThreadID;
@@ -130,6 +134,8 @@ CMDRESULT cbDebugRun(int argc, char* argv[])
         return STATUS_ERROR;
     }
     GuiSetDebugState(running);
+    stackcommentcacheclear();
+    DebugCancelGuiUpdate();
     unlock(WAITID_RUN);
     PLUG_CB_RESUMEDEBUG callbackInfo;
     callbackInfo.reserved = 0;
@@ -263,6 +269,70 @@ CMDRESULT cbDebugSetBPX(int argc, char* argv[]) //bp addr [,name [,type]]
     return STATUS_CONTINUE;
 }
 
+static CMDRESULT setbreakpointbatch(std::vector<duint> & addrs, bool singleshoot)
+{
+    int type = singleshoot ? UE_SINGLESHOOT : UE_BREAKPOINT;
+    //skip addresses that have a breakpoint in TitanEngine already
+    addrs.erase(std::remove_if(addrs.begin(), addrs.end(), [](duint addr)
+    {
+        return IsBPXEnabled(addr);
+    }), addrs.end());
+    size_t requested = addrs.size();
+    //the original bytes are read page by page and the list is updated at once
+    BpNewBatch(addrs, singleshoot, type);
+    int set = 0;
+    for(auto addr : addrs)
+    {
+        if(SetBPX(addr, type, (void*)cbUserBreakpoint))
+            set++;
+        else
+        {
+            dprintf("Error setting breakpoint at " fhex "! (SetBPX)\n", addr);
+            BpDelete(addr, BPNORMAL);
+        }
+    }
+    dprintf("%d/%d breakpoints set!\n", set, int(requested));
+    GuiUpdateAllViews();
+    return STATUS_CONTINUE;
+}
+
+CMDRESULT cbDebugSetExportBPX(int argc, char* argv[]) //bpexports module [,ss]
+{
+    if(argc < 2)
+    {
+        dputs("Not enough arguments!");
+        return STATUS_ERROR;
+    }
+    duint base = strlen(argv[1]) < MAX_MODULE_SIZE ? ModBaseFromName(argv[1]) : 0;
+    if(!base && (!valfromstring(argv[1], &base) || !(base = ModBaseFromAddr(base))))
+    {
+        dprintf("Invalid module \"%s\"!\n", argv[1]);
+        return STATUS_ERROR;
+    }
+    std::vector<duint> addrs;
+    apienumexports(base, [&addrs](duint base, const char* mod, const char* name, duint addr)
+    {
+        addrs.push_back(addr);
+    });
+    return setbreakpointbatch(addrs, argc > 2 && scmp(argv[2], "ss"));
+}
+
+CMDRESULT cbDebugSetReferenceBPX(int argc, char* argv[]) //bpref [ss]
+{
+    int count = GuiReferenceGetRowCount();
+    std::vector<duint> addrs;
+    addrs.reserve(count);
+    for(int i = 0; i < count; i++)
+    {
+        char* cell = GuiReferenceGetCellContentCopy(i, 0);
+        duint addr;
+        if(cell && valfromstring(cell, &addr))
+            addrs.push_back(addr);
+        BridgeFree(cell);
+    }
+    return setbreakpointbatch(addrs, argc > 1 && scmp(argv[1], "ss"));
+}
+
 CMDRESULT cbDebugDeleteBPX(int argc, char* argv[])
 {
     if(argc < 2) //delete all breakpoints
@@ -328,8 +398,24 @@ CMDRESULT cbDebugEnableBPX(int argc, char* argv[])
             dputs("No breakpoints to enable!");
             return STATUS_CONTINUE;
         }
-        if(!BpEnumAll(cbEnableAllBreakpoints)) //at least one enable failed
+        //the original bytes are read page by page and the list is updated at once
+        std::vector<BREAKPOINT> changed;
+        BpEnableBatch(true, changed);
+        bool failed = false;
+        for(auto & bp : changed)
+        {
+            if(!SetBPX(bp.addr, bp.titantype, (void*)cbUserBreakpoint))
+            {
+                dprintf("Could not enable breakpoint " fhex " (SetBPX)\n", bp.addr);
+                BpEnable(bp.addr, BPNORMAL, false);
+                failed = true;
+            }
+        }
+        if(failed) //at least one enable failed
+        {
+            GuiUpdateAllViews();
             return STATUS_ERROR;
+        }
         dputs("All breakpoints enabled!");
         GuiUpdateAllViews();
         return STATUS_CONTINUE;
@@ -386,8 +472,23 @@ CMDRESULT cbDebugDisableBPX(int argc, char* argv[])
             dputs("No breakpoints to disable!");
             return STATUS_CONTINUE;
         }
-        if(!BpEnumAll(cbDisableAllBreakpoints)) //at least one deletion failed
+        std::vector<BREAKPOINT> changed;
+        BpEnableBatch(false, changed);
+        bool failed = false;
+        for(auto & bp : changed)
+        {
+            if(!DeleteBPX(bp.addr))
+            {
+                dprintf("Could not disable breakpoint " fhex " (DeleteBPX)\n", bp.addr);
+                BpEnable(bp.addr, BPNORMAL, true); //the breakpoint is still set in TitanEngine
+                failed = true;
+            }
+        }
+        if(failed) //at least one deletion failed
+        {
+            GuiUpdateAllViews();
             return STATUS_ERROR;
+        }
         dputs("All breakpoints disabled!");
         GuiUpdateAllViews();
         return STATUS_CONTINUE;
@@ -444,6 +545,91 @@ CMDRESULT cbDebugBplist(int argc, char* argv[])
     return STATUS_CONTINUE;
 }
 
+static bool findBreakpoint(const char* text, BREAKPOINT & found)
+{
+    //look for a breakpoint of any type, by name first and then by address
+    const BP_TYPE types[] = { BPNORMAL, BPHARDWARE, BPMEMORY };
+    for(auto type : types)
+        if(BpGet(0, type, text, &found))
+            return true;
+    duint addr = 0;
+    if(!valfromstring(text, &addr))
+        return false;
+    for(auto type : types)
+        if(BpGet(addr, type, 0, &found))
+            return true;
+    //memory breakpoints are stored by the base of the page range
+    return BpGet(MemFindBaseAddr(addr, 0), BPMEMORY, 0, &found);
+}
+
+CMDRESULT cbDebugSetBreakpointCondition(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        dputs("not enough arguments!");
+        return STATUS_ERROR;
+    }
+    BREAKPOINT found;
+    if(!findBreakpoint(argv[1], found))
+    {
+        dprintf("No such breakpoint \"%s\"\n", argv[1]);
+        return STATUS_ERROR;
+    }
+    const char* condition = argc > 2 ? argv[2] : "";
+    if(!BpSetCondition(found.addr, found.type, condition))
+    {
+        dprintf("Can't set condition on breakpoint \"%s\"\n", argv[1]);
+        return STATUS_ERROR;
+    }
+    if(*condition)
+        dprintf("Breakpoint " fhex " breaks when \"%s\" is nonzero\n", found.addr, condition);
+    else
+        dprintf("Breakpoint " fhex " is unconditional\n", found.addr);
+    return STATUS_CONTINUE;
+}
+
+CMDRESULT cbDebugSetBreakpointLog(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        dputs("not enough arguments!");
+        return STATUS_ERROR;
+    }
+    BREAKPOINT found;
+    if(!findBreakpoint(argv[1], found))
+    {
+        dprintf("No such breakpoint \"%s\"\n", argv[1]);
+        return STATUS_ERROR;
+    }
+    const char* text = argc > 2 ? argv[2] : "";
+    if(!BpSetLogText(found.addr, found.type, text))
+    {
+        dprintf("Can't set log text on breakpoint \"%s\"\n", argv[1]);
+        return STATUS_ERROR;
+    }
+    if(*text)
+        dprintf("Breakpoint " fhex " logs and continues\n", found.addr);
+    else
+        dprintf("Breakpoint " fhex " pauses the debuggee\n", found.addr);
+    return STATUS_CONTINUE;
+}
+
+CMDRESULT cbDebugResetBreakpointHitCount(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        dputs("not enough arguments!");
+        return STATUS_ERROR;
+    }
+    BREAKPOINT found;
+    if(!findBreakpoint(argv[1], found) || !BpResetHitCount(found.addr, found.type))
+    {
+        dprintf("No such breakpoint \"%s\"\n", argv[1]);
+        return STATUS_ERROR;
+    }
+    return STATUS_CONTINUE;
+}
+
 CMDRESULT cbDebugStepInto(int argc, char* argv[])
 {
     StepInto((void*)cbStep);
@@ -487,6 +673,100 @@ CMDRESULT cbDebugeSingleStep(int argc, char* argv[])
     return cbDebugSingleStep(argc, argv);
 }
 
+static CMDRESULT cbDebugTraceConditional(int argc, char* argv[], bool stepover)
+{
+    if(argc < 2)
+    {
+        dputs("not enough arguments!");
+        return STATUS_ERROR;
+    }
+    if(strlen(argv[1]) >= MAX_CONDITIONAL_EXPR_SIZE)
+    {
+        dputs("condition too long!");
+        return STATUS_ERROR;
+    }
+    duint maxsteps = TRACE_DEFAULT_MAX_STEPS;
+    if(argc > 2 && !valfromstring(argv[2], &maxsteps, false))
+        return STATUS_ERROR;
+    if(!maxsteps)
+        maxsteps = TRACE_DEFAULT_MAX_STEPS;
+    dbgtracestart(argv[1], maxsteps, stepover);
+    return cbDebugRun(argc, argv);
+}
+
+CMDRESULT cbDebugTraceIntoConditional(int argc, char* argv[])
+{
+    return cbDebugTraceConditional(argc, argv, false);
+}
+
+CMDRESULT cbDebugTraceOverConditional(int argc, char* argv[])
+{
+    return cbDebugTraceConditional(argc, argv, true);
+}
+
+CMDRESULT cbDebugTraceSave(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        dputs("not enough arguments!");
+        return STATUS_ERROR;
+    }
+    if(!TraceRecordSave(argv[1]))
+    {
+        dprintf("Failed to write trace file \"%s\"!\n", argv[1]);
+        return STATUS_ERROR;
+    }
+    dprintf("%llu trace events written to \"%s\"\n", TraceRecordEventCount(), argv[1]);
+    return STATUS_CONTINUE;
+}
+
+CMDRESULT cbDebugTraceClear(int argc, char* argv[])
+{
+    TraceRecordClear();
+    dputs("Trace buffer cleared!");
+    return STATUS_CONTINUE;
+}
+
+CMDRESULT cbDebugTraceLog(int argc, char* argv[]) //tracelog file[,start[,count]]
+{
+    if(argc < 2)
+    {
+        dputs("not enough arguments!");
+        return STATUS_ERROR;
+    }
+    TraceReader reader;
+    if(!reader.Open(argv[1]))
+    {
+        dprintf("Failed to open trace file \"%s\"!\n", argv[1]);
+        return STATUS_ERROR;
+    }
+    const TRACEFILEHEADER & header = reader.Header();
+    dprintf("%llu trace events (%llu-%llu) in %u blocks\n", header.EventCount, header.FirstEvent, header.FirstEvent + header.EventCount, header.BlockCount);
+    duint start = duint(header.FirstEvent);
+    duint count = 100;
+    if(argc > 2 && !valfromstring(argv[2], &start, false))
+        return STATUS_ERROR;
+    if(argc > 3 && !valfromstring(argv[3], &count, false))
+        return STATUS_ERROR;
+    for(duint i = start; i < start + count; i++)
+    {
+        TRACEEVENT event;
+        if(!reader.Read(i, event))
+            break;
+        dprintf("%" fext "u: %X " fhex, i, event.ThreadId, event.Address);
+        for(unsigned char j = 0; j < event.MemoryCount; j++)
+        {
+            const TRACEMEMORY & memory = event.Memory[j];
+            if(memory.Written)
+                dprintf(" [" fhex "]=" fhex "->" fhex, memory.Address, memory.OldValue, memory.NewValue);
+            else
+                dprintf(" [" fhex "]=" fhex, memory.Address, memory.OldValue);
+        }
+        dprintf("\n");
+    }
+    return STATUS_CONTINUE;
+}
+
 CMDRESULT cbDebugHide(int argc, char* argv[])
 {
     if(HideDebugger(fdProcessInfo->hProcess, UE_HIDE_PEBONLY))
@@ -510,6 +790,26 @@ CMDRESULT cbDebugDisasm(int argc, char* argv[])
     return STATUS_CONTINUE;
 }
 
+static bool setmemorywatchhardware(duint addr, duint size, DWORD type, bool singleshoot)
+{
+    DWORD hwtype, hwsize, drx = 0;
+    if(!dbgmemorywatchhardware(addr, size, type, &hwtype, &hwsize) || BpGet(addr, BPMEMORY, 0, nullptr) || !GetUnusedHardwareBreakPointRegister(&drx))
+        return false;
+    //the watch stays a memory breakpoint, only the debug register it lives in is recorded
+    if(!BpNew(addr, true, singleshoot, 0, BPMEMORY, type, 0))
+        return false;
+    BpAddMemoryWatch(addr, addr, size);
+    BpSetMemoryWatchHardware(addr, true, (unsigned char)drx);
+    if(!SetHardwareBreakPoint(addr, drx, hwtype, hwsize, (void*)cbMemoryWatchHardware))
+    {
+        BpDelete(addr, BPMEMORY);
+        return false;
+    }
+    dprintf("Memory breakpoint at " fhex " set! (hardware, DR%d)\n", addr, drx);
+    GuiUpdateAllViews();
+    return true;
+}
+
 CMDRESULT cbDebugSetMemoryBpx(int argc, char* argv[])
 {
     if(argc < 2)
@@ -522,6 +822,7 @@ CMDRESULT cbDebugSetMemoryBpx(int argc, char* argv[])
         return STATUS_ERROR;
     bool restore = false;
     char arg3[deflen] = "";
+    int sizearg = 4; //the watched size follows the type
     if(argc > 3)
         strcpy_s(arg3, argv[3]);
     if(argc > 2)
@@ -531,7 +832,10 @@ CMDRESULT cbDebugSetMemoryBpx(int argc, char* argv[])
         else if(*argv[2] == '0')
             restore = false;
         else
+        {
             strcpy_s(arg3, argv[2]);
+            sizearg = 3;
+        }
     }
     DWORD type = UE_MEMORY;
     if(*arg3)
@@ -552,25 +856,90 @@ CMDRESULT cbDebugSetMemoryBpx(int argc, char* argv[])
             break;
         }
     }
-    duint size = 0;
-    duint base = MemFindBaseAddr(addr, &size, true);
+    duint watchsize = 0; //0 = watch the whole region
+    if(argc > sizearg && !valfromstring(argv[sizearg], &watchsize))
+        return STATUS_ERROR;
     bool singleshoot = false;
     if(!restore)
         singleshoot = true;
+    duint size = 0;
+    duint base = MemFindBaseAddr(addr, &size, true);
+    if(watchsize && addr + watchsize > base + size)
+    {
+        dputs("The watched range has to be inside a single memory region!");
+        return STATUS_ERROR;
+    }
     BREAKPOINT bp;
+    if(BpGet(addr, BPMEMORY, 0, &bp) && bp.watchHardware)
+    {
+        dputs("Memory breakpoint in a debug register already set on this address!");
+        return STATUS_ERROR;
+    }
     if(BpGet(base, BPMEMORY, 0, &bp))
     {
+        //all watches in a region share the page guards of a single memory breakpoint
+        if(bp.watchHardware)
+        {
+            dputs("Memory breakpoint in a debug register already set on this region!");
+            return STATUS_ERROR;
+        }
+        if(bp.titantype != type)
+        {
+            dputs("Memory breakpoint with a different type already set on this region!");
+            return STATUS_ERROR;
+        }
+        std::vector<duint> guarded;
+        BpMemoryWatchPages(bp, guarded);
+        if(!watchsize)
+            BpClearMemoryWatch(base);
+        else if(bp.watchCount && !BpAddMemoryWatch(base, addr, watchsize))
+        {
+            dputs("Too many watched ranges on this region!");
+            return STATUS_ERROR;
+        }
         if(!bp.enabled)
             return DbgCmdExecDirect(StringUtils::sprintf("bpme " fhex, bp.addr).c_str()) ? STATUS_CONTINUE : STATUS_ERROR;
-        dputs("Memory breakpoint already set!");
+        BpGet(base, BPMEMORY, 0, &bp);
+        if(!bp.watchCount && !guarded.empty())
+        {
+            //the whole region is watched now, replace the page guards by a guard over the region
+            for(auto page : guarded)
+                RemoveMemoryBPX(page, PAGE_SIZE);
+            if(!dbgsetmemorybreakpoint(&bp))
+            {
+                dputs("Error setting memory breakpoint! (SetMemoryBPXEx)");
+                return STATUS_ERROR;
+            }
+        }
+        else
+        {
+            //only guard the pages that no other watch covers yet
+            std::vector<duint> pages;
+            BpMemoryWatchPages(bp, pages);
+            for(auto page : pages)
+            {
+                if(!std::binary_search(guarded.begin(), guarded.end(), page) && !SetMemoryBPXEx(page, PAGE_SIZE, type, true, (void*)cbMemoryBreakpoint))
+                {
+                    dputs("Error setting memory breakpoint! (SetMemoryBPXEx)");
+                    return STATUS_ERROR;
+                }
+            }
+        }
+        dprintf("Memory watch at " fhex " added to the memory breakpoint at " fhex "!\n", addr, base);
         return STATUS_CONTINUE;
     }
+    //small aligned ranges fit in a debug register, which does not slow down accesses to the rest of the page
+    if(watchsize && setmemorywatchhardware(addr, watchsize, type, singleshoot))
+        return STATUS_CONTINUE;
     if(!BpNew(base, true, singleshoot, 0, BPMEMORY, type, 0))
     {
         dputs("Error setting memory breakpoint! (BpNew)");
         return STATUS_ERROR;
     }
-    if(!SetMemoryBPXEx(base, size, type, restore, (void*)cbMemoryBreakpoint))
+    if(watchsize)
+        BpAddMemoryWatch(base, addr, watchsize);
+    BpGet(base, BPMEMORY, 0, &bp);
+    if(!dbgsetmemorybreakpoint(&bp))
     {
         dputs("Error setting memory breakpoint! (SetMemoryBPXEx)");
         return STATUS_ERROR;
@@ -598,14 +967,12 @@ CMDRESULT cbDebugDeleteMemoryBreakpoint(int argc, char* argv[])
     BREAKPOINT found;
     if(BpGet(0, BPMEMORY, argv[1], &found)) //found a breakpoint with name
     {
-        duint size;
-        MemFindBaseAddr(found.addr, &size);
         if(!BpDelete(found.addr, BPMEMORY))
         {
             dprintf("Delete memory breakpoint failed: " fhex " (BpDelete)\n", found.addr);
             return STATUS_ERROR;
         }
-        if(!RemoveMemoryBPX(found.addr, size))
+        if(found.enabled && !dbgremovememorybreakpoint(&found))
         {
             dprintf("Delete memory breakpoint failed: " fhex " (RemoveMemoryBPX)\n", found.addr);
             return STATUS_ERROR;
@@ -618,14 +985,12 @@ CMDRESULT cbDebugDeleteMemoryBreakpoint(int argc, char* argv[])
         dprintf("No such memory breakpoint \"%s\"\n", argv[1]);
         return STATUS_ERROR;
     }
-    duint size;
-    MemFindBaseAddr(found.addr, &size);
     if(!BpDelete(found.addr, BPMEMORY))
     {
         dprintf("Delete memory breakpoint failed: " fhex " (BpDelete)\n", found.addr);
         return STATUS_ERROR;
     }
-    if(!RemoveMemoryBPX(found.addr, size))
+    if(found.enabled && !dbgremovememorybreakpoint(&found))
     {
         dprintf("Delete memory breakpoint failed: " fhex " (RemoveMemoryBPX)\n", found.addr);
         return STATUS_ERROR;
@@ -1411,9 +1776,7 @@ CMDRESULT cbDebugEnableMemoryBreakpoint(int argc, char* argv[])
         GuiUpdateAllViews();
         return STATUS_CONTINUE;
     }
-    duint size = 0;
-    MemFindBaseAddr(found.addr, &size);
-    if(!BpEnable(found.addr, BPMEMORY, true) || !SetMemoryBPXEx(found.addr, size, found.titantype, !found.singleshoot, (void*)cbMemoryBreakpoint))
+    if(!BpEnable(found.addr, BPMEMORY, true) || !dbgsetmemorybreakpoint(&found))
     {
         dprintf("Could not enable memory breakpoint " fhex "\n", found.addr);
         return STATUS_ERROR;
@@ -1450,9 +1813,7 @@ CMDRESULT cbDebugDisableMemoryBreakpoint(int argc, char* argv[])
         dputs("Memory breakpoint already disabled!");
         return STATUS_CONTINUE;
     }
-    duint size = 0;
-    MemFindBaseAddr(found.addr, &size);
-    if(!BpEnable(found.addr, BPMEMORY, false) || !RemoveMemoryBPX(found.addr, size))
+    if(!BpEnable(found.addr, BPMEMORY, false) || !dbgremovememorybreakpoint(&found))
     {
         dprintf("Could not disable memory breakpoint " fhex "\n", found.addr);
         return STATUS_ERROR;
@@ -1518,8 +1879,10 @@ CMDRESULT cbDebugDownloadSymbol(int argc, char* argv[])
     {
         dputs("SymLoadModuleEx failed!");
         SafeSymSetSearchPathW(fdProcessInfo->hProcess, szOldSearchPath);
+        SymNameCacheClear();
         return STATUS_ERROR;
     }
+    SymNameCacheClear();
     if(!SafeSymSetSearchPathW(fdProcessInfo->hProcess, szOldSearchPath))
     {
         dputs("SymSetSearchPathW (2) failed!");
@@ -1921,10 +2284,8 @@ CMDRESULT cbDebugLoadLib(int argc, char* argv[])
         return STATUS_ERROR;
     }
 
-    int size = 0;
     int counter = 0;
     duint LoadLibraryA = 0;
-    char command[50] = "";
     char error[MAX_ERROR_SIZE] = "";
 
     GetFullContextDataEx(LoadLibThread, &backupctx);
@@ -1936,26 +2297,21 @@ CMDRESULT cbDebugLoadLib(int argc, char* argv[])
     }
 
     // Arch specific asm code
+    std::vector<String> lines;
 #ifdef _WIN64
-    sprintf(command, "mov rcx, " fhex, (duint)DLLNameMem);
-#else
-    sprintf(command, "push " fhex, DLLNameMem);
-#endif // _WIN64
-
-    assembleat((duint)ASMAddr, command, &size, error, true);
-    counter += size;
-
-#ifdef _WIN64
-    sprintf(command, "mov rax, " fhex, LoadLibraryA);
-    assembleat((duint)ASMAddr + counter, command, &size, error, true);
-    counter += size;
-    sprintf(command, "call rax");
+    lines.push_back(StringUtils::sprintf("mov rcx, " fhex, (duint)DLLNameMem));
+    lines.push_back(StringUtils::sprintf("mov rax, " fhex, LoadLibraryA));
+    lines.push_back("call rax");
 #else
-    sprintf(command, "call " fhex, LoadLibraryA);
+    lines.push_back(StringUtils::sprintf("push " fhex, DLLNameMem));
+    lines.push_back(StringUtils::sprintf("call " fhex, LoadLibraryA));
 #endif // _WIN64
 
-    assembleat((duint)ASMAddr + counter, command, &size, error, true);
-    counter += size;
+    if(!assembleblockat((duint)ASMAddr, lines, &counter, error))
+    {
+        dprintf("Error: couldn't assemble the loader code (%s)\n", error);
+        return STATUS_ERROR;
+    }
 
     SetContextDataEx(LoadLibThread, UE_CIP, (duint)ASMAddr);
     SetBPX((duint)ASMAddr + counter, UE_SINGLESHOOT | UE_BREAKPOINT_TYPE_INT3, (void*)cbDebugLoadLibBPX);
@@ -11,16 +11,26 @@ CMDRESULT cbDebugRun(int argc, char* argv[]);
 CMDRESULT cbDebugErun(int argc, char* argv[]);
 CMDRESULT cbDebugSetBPXOptions(int argc, char* argv[]);
 CMDRESULT cbDebugSetBPX(int argc, char* argv[]);
+CMDRESULT cbDebugSetExportBPX(int argc, char* argv[]);
+CMDRESULT cbDebugSetReferenceBPX(int argc, char* argv[]);
 CMDRESULT cbDebugDeleteBPX(int argc, char* argv[]);
 CMDRESULT cbDebugEnableBPX(int argc, char* argv[]);
 CMDRESULT cbDebugDisableBPX(int argc, char* argv[]);
 CMDRESULT cbDebugBplist(int argc, char* argv[]);
+CMDRESULT cbDebugSetBreakpointCondition(int argc, char* argv[]);
+CMDRESULT cbDebugSetBreakpointLog(int argc, char* argv[]);
+CMDRESULT cbDebugResetBreakpointHitCount(int argc, char* argv[]);
 CMDRESULT cbDebugStepInto(int argc, char* argv[]);
 CMDRESULT cbDebugeStepInto(int argc, char* argv[]);
 CMDRESULT cbDebugStepOver(int argc, char* argv[]);
 CMDRESULT cbDebugeStepOver(int argc, char* argv[]);
 CMDRESULT cbDebugSingleStep(int argc, char* argv[]);
 CMDRESULT cbDebugeSingleStep(int argc, char* argv[]);
+CMDRESULT cbDebugTraceIntoConditional(int argc, char* argv[]);
+CMDRESULT cbDebugTraceOverConditional(int argc, char* argv[]);
+CMDRESULT cbDebugTraceSave(int argc, char* argv[]);
+CMDRESULT cbDebugTraceClear(int argc, char* argv[]);
+CMDRESULT cbDebugTraceLog(int argc, char* argv[]);
 CMDRESULT cbDebugHide(int argc, char* argv[]);
 CMDRESULT cbDebugDisasm(int argc, char* argv[]);
 CMDRESULT cbDebugSetMemoryBpx(int argc, char* argv[]);
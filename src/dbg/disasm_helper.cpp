@@ -273,17 +273,21 @@ static bool isunicodestring(const unsigned char* data, int maxlen)
     return true;
 }
 
+static bool ispossiblestring(const unsigned char* data)
+{
+    unsigned char test[11];
+    memset(test, 0, sizeof(test));
+    memcpy(test, data, sizeof(test) - 3);
+    return isasciistring(test, sizeof(test)) || isunicodestring(test, _countof(test));
+}
+
 bool disasmispossiblestring(duint addr)
 {
-    unsigned char data[11];
+    unsigned char data[8];
     memset(data, 0, sizeof(data));
-    if(!MemRead(addr, data, sizeof(data) - 3))
+    if(!MemRead(addr, data, sizeof(data)))
         return false;
-    duint test = 0;
-    memcpy(&test, data, sizeof(duint));
-    if(isasciistring(data, sizeof(data)) || isunicodestring(data, _countof(data)))
-        return true;
-    return false;
+    return ispossiblestring(data);
 }
 
 bool disasmgetstringat(duint addr, STRING_TYPE* type, char* ascii, char* unicode, int maxlen)
@@ -295,13 +299,22 @@ bool disasmgetstringat(duint addr, STRING_TYPE* type, char* ascii, char* unicode
     Memory<unsigned char*> data((maxlen + 1) * 2, "disasmgetstringat:data");
     if(!MemRead(addr, data(), (maxlen + 1) * 2))
         return false;
+    return disasmgetstringat(data(), type, ascii, unicode, maxlen);
+}
+
+bool disasmgetstringat(unsigned char* data, STRING_TYPE* type, char* ascii, char* unicode, int maxlen)
+{
+    if(type)
+        *type = str_none;
+    if(!ispossiblestring(data))
+        return false;
 
     // Save a few pointer casts
-    auto asciiData = (char*)data();
-    auto unicodeData = (wchar_t*)data();
+    auto asciiData = (char*)data;
+    auto unicodeData = (wchar_t*)data;
 
     // First check if this was an ASCII only string
-    if(isasciistring(data(), maxlen))
+    if(isasciistring(data, maxlen))
     {
         if(type)
             *type = str_ascii;
@@ -314,7 +327,7 @@ bool disasmgetstringat(duint addr, STRING_TYPE* type, char* ascii, char* unicode
         return true;
     }
 
-    if(isunicodestring(data(), maxlen))
+    if(isunicodestring(data, maxlen))
     {
         if(type)
             *type = str_unicode;
@@ -12,6 +12,7 @@ void disasmget(unsigned char* buffer, duint addr, DISASM_INSTR* instr);
 void disasmget(duint addr, DISASM_INSTR* instr);
 bool disasmispossiblestring(duint addr);
 bool disasmgetstringat(duint addr, STRING_TYPE* type, char* ascii, char* unicode, int maxlen);
+bool disasmgetstringat(unsigned char* data, STRING_TYPE* type, char* ascii, char* unicode, int maxlen);
 int disasmgetsize(duint addr, unsigned char* data);
 int disasmgetsize(duint addr);
 
@@ -8,18 +8,23 @@ public:
     // This class guarantees that the returned allocated memory
     // will always be zeroed
     //
+    // Small buffers come from the arena of the current thread, so
+    // a Memory object has to be destroyed on the thread that
+    // allocated it (which is always the case for locals)
+    //
     explicit Memory(const char* Reason = "Memory:???")
     {
         m_Ptr = nullptr;
         m_Size = 0;
         m_Reason = Reason;
+        m_Arena = false;
     }
 
     explicit Memory(size_t Size, const char* Reason = "Memory:???")
     {
-        m_Ptr = reinterpret_cast<T>(emalloc(Size));
-        m_Size = Size;
         m_Reason = Reason;
+        m_Ptr = reinterpret_cast<T>(allocate(Size));
+        m_Size = Size;
 
         memset(m_Ptr, 0, Size);
     }
@@ -27,14 +32,16 @@ public:
     ~Memory()
     {
         if(m_Ptr)
-            efree(m_Ptr);
+            release();
     }
 
     T realloc(size_t Size, const char* Reason = "Memory:???")
     {
-        m_Ptr = reinterpret_cast<T>(erealloc(m_Ptr, Size));
-        m_Size = Size;
+        if(m_Ptr)
+            release();
         m_Reason = Reason;
+        m_Ptr = reinterpret_cast<T>(allocate(Size));
+        m_Size = Size;
 
         return (T)memset(m_Ptr, 0, m_Size);
     }
@@ -50,7 +57,23 @@ public:
     }
 
 private:
+    void* allocate(size_t Size)
+    {
+        void* ptr = ArenaAlloc(Size, m_Reason);
+        m_Arena = ptr != nullptr;
+        return m_Arena ? ptr : emalloc(Size, m_Reason);
+    }
+
+    void release()
+    {
+        if(m_Arena)
+            ArenaFree(m_Ptr);
+        else
+            efree(m_Ptr, m_Reason);
+    }
+
     T           m_Ptr;
     size_t      m_Size;
     const char* m_Reason;
+    bool        m_Arena;
 };
\ No newline at end of file
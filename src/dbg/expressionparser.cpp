@@ -79,8 +79,11 @@ ExpressionParser::ExpressionParser(const String & expression)
 {
     _tokens.clear();
     _prefixTokens.clear();
+    _program.clear();
+    _stackSize = 0;
     tokenize(fixClosingBrackets(expression));
     shuntingYard();
+    compile();
 }
 
 String ExpressionParser::fixClosingBrackets(const String & expression)
@@ -279,6 +282,38 @@ void ExpressionParser::shuntingYard()
     _prefixTokens = queue;
 }
 
+void ExpressionParser::compile()
+{
+    //turn the RPN queue into a program with the number literals and register names already resolved
+    _program.reserve(_prefixTokens.size());
+    size_t depth = 0;
+    for(const auto & token : _prefixTokens)
+    {
+        Instruction instr;
+        instr.type = token.type();
+        instr.constant = false;
+        instr.reg = -1;
+        instr.value = 0;
+        if(token.isOperator())
+        {
+            if(instr.type != Token::Type::OperatorUnarySub && instr.type != Token::Type::OperatorNot && depth)
+                depth--;
+        }
+        else
+        {
+            instr.constant = valconstfromstring(token.data().c_str(), &instr.value);
+            if(!instr.constant && !valregisterfromstring(token.data().c_str(), &instr.reg))
+                instr.data = token.data();
+            if(++depth > _stackSize)
+                _stackSize = depth;
+        }
+        _program.push_back(instr);
+    }
+    //only the program is needed from now on, the parser stays cached
+    std::vector<Token>().swap(_tokens);
+    std::vector<Token>().swap(_prefixTokens);
+}
+
 #ifdef _WIN64
 #include <intrin.h>
 
@@ -382,33 +417,34 @@ bool ExpressionParser::signedoperation(const Token::Type type, const dsint op1,
     return true;
 }
 
-bool ExpressionParser::calculate(duint & value, bool signedcalc, bool silent, bool baseonly, int* value_size, bool* isvar, bool* hexonly)
+bool ExpressionParser::calculate(duint & value, bool signedcalc, bool silent, bool baseonly, int* value_size, bool* isvar, bool* hexonly) const
 {
     value = 0;
-    if(!_prefixTokens.size())
+    if(!_program.size())
         return false;
-    std::stack<duint> stack;
-    //calculate the result from the RPN queue
-    for(const auto & token : _prefixTokens)
+    std::vector<duint> stack;
+    stack.reserve(_stackSize);
+    //calculate the result from the compiled RPN program
+    for(const auto & instr : _program)
     {
-        if(token.isOperator())
+        if(instr.type != Token::Type::Data)
         {
             duint op1 = 0;
             duint op2 = 0;
             duint result = 0;
-            switch(token.type())
+            switch(instr.type)
             {
             case Token::Type::OperatorUnarySub:
             case Token::Type::OperatorNot:
                 if(stack.size() < 1)
                     return false;
-                op1 = stack.top();
-                stack.pop();
+                op1 = stack.back();
+                stack.pop_back();
                 if(signedcalc)
-                    signedoperation(token.type(), op1, op2, result);
+                    signedoperation(instr.type, op1, op2, result);
                 else
-                    unsignedoperation(token.type(), op1, op2, result);
-                stack.push(result);
+                    unsignedoperation(instr.type, op1, op2, result);
+                stack.push_back(result);
                 break;
             case Token::Type::OperatorMul:
             case Token::Type::OperatorHiMul:
@@ -423,31 +459,45 @@ bool ExpressionParser::calculate(duint & value, bool signedcalc, bool silent, bo
             case Token::Type::OperatorOr:
                 if(stack.size() < 2)
                     return false;
-                op2 = stack.top();
-                stack.pop();
-                op1 = stack.top();
-                stack.pop();
+                op2 = stack.back();
+                stack.pop_back();
+                op1 = stack.back();
+                stack.pop_back();
                 if(signedcalc)
-                    signedoperation(token.type(), op1, op2, result);
+                    signedoperation(instr.type, op1, op2, result);
                 else
-                    unsignedoperation(token.type(), op1, op2, result);
-                stack.push(result);
+                    unsignedoperation(instr.type, op1, op2, result);
+                stack.push_back(result);
                 break;
             default: //do nothing
                 break;
             }
         }
+        else if(instr.constant)
+        {
+            if(value_size)
+                *value_size = 0;
+            if(isvar)
+                *isvar = false;
+            stack.push_back(instr.value);
+        }
+        else if(instr.reg != -1)
+        {
+            duint result;
+            valregisterget(instr.reg, &result, silent, value_size, isvar);
+            stack.push_back(result);
+        }
         else
         {
             duint result;
-            if(!valfromstring_noexpr(token.data().c_str(), &result, silent, baseonly, value_size, isvar, hexonly))
+            if(!valfromstring_noexpr(instr.data.c_str(), &result, silent, baseonly, value_size, isvar, hexonly))
                 return false;
-            stack.push(result);
+            stack.push_back(result);
         }
 
     }
     if(stack.empty())  //empty result stack means error
         return false;
-    value = stack.top();
+    value = stack.back();
     return true;
 }
\ No newline at end of file
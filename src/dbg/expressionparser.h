@@ -7,7 +7,7 @@ class ExpressionParser
 {
 public:
     ExpressionParser(const String & expression);
-    bool calculate(duint & value, bool signedcalc, bool silent, bool baseonly, int* value_size, bool* isvar, bool* hexonly);
+    bool calculate(duint & value, bool signedcalc, bool silent, bool baseonly, int* value_size, bool* isvar, bool* hexonly) const;
 
     class Token
     {
@@ -57,11 +57,23 @@ private:
     void tokenize(const String & expression);
     void shuntingYard();
     void addOperatorToken(const char ch, const Token::Type type);
-    bool unsignedoperation(const Token::Type type, const duint op1, const duint op2, duint & result);
-    bool signedoperation(const Token::Type type, const dsint op1, const dsint op2, duint & result);
+    void compile();
+    static bool unsignedoperation(const Token::Type type, const duint op1, const duint op2, duint & result);
+    static bool signedoperation(const Token::Type type, const dsint op1, const dsint op2, duint & result);
+
+    struct Instruction
+    {
+        Token::Type type;
+        bool constant; //operand is a number literal, value is resolved at compile time
+        int reg; //operand is a register (valregisterfromstring index), -1 otherwise
+        duint value;
+        String data;
+    };
 
     std::vector<Token> _tokens;
     std::vector<Token> _prefixTokens;
+    std::vector<Instruction> _program;
+    size_t _stackSize;
     String _curToken;
 };
 
@@ -131,88 +131,63 @@ void FunctionDelRange(duint Start, duint End)
     }
 }
 
-void FunctionCacheSave(JSON Root)
+void FunctionCacheSave(JsonWriter & Writer)
 {
     EXCLUSIVE_ACQUIRE(LockFunctions);
 
-    // Allocate JSON object array
-    const JSON jsonFunctions = json_array();
-    const JSON jsonAutoFunctions = json_array();
-
-    for(auto & i : functions)
+    // Write the user-set and the auto-set functions as separate arrays
+    for(int manual = 1; manual >= 0; manual--)
     {
-        JSON currentFunction = json_object();
-
-        json_object_set_new(currentFunction, "module", json_string(i.second.mod));
-        json_object_set_new(currentFunction, "start", json_hex(i.second.start));
-        json_object_set_new(currentFunction, "end", json_hex(i.second.end));
-        json_object_set_new(currentFunction, "icount", json_hex(i.second.instructioncount));
-
-        if(i.second.manual)
-            json_array_append_new(jsonFunctions, currentFunction);
-        else
-            json_array_append_new(jsonAutoFunctions, currentFunction);
-    }
+        bool empty = true;
+        for(auto & i : functions)
+        {
+            if(i.second.manual != (manual != 0))
+                continue;
 
-    if(json_array_size(jsonFunctions))
-        json_object_set(Root, "functions", jsonFunctions);
+            if(empty)
+            {
+                Writer.ArrayBegin(manual ? "functions" : "autofunctions");
+                empty = false;
+            }
 
-    if(json_array_size(jsonAutoFunctions))
-        json_object_set(Root, "autofunctions", jsonAutoFunctions);
+            Writer.ObjectBegin();
+            Writer.WriteString("module", i.second.mod);
+            Writer.WriteHex("start", i.second.start);
+            Writer.WriteHex("end", i.second.end);
+            Writer.WriteHex("icount", i.second.instructioncount);
+            Writer.ObjectEnd();
+        }
 
-    // Decrease reference count to avoid leaking memory
-    json_decref(jsonFunctions);
-    json_decref(jsonAutoFunctions);
+        if(!empty)
+            Writer.ArrayEnd();
+    }
 }
 
-void FunctionCacheLoad(JSON Root)
+void FunctionCacheLoad(const JsonEntry & Entry, bool Manual)
 {
-    EXCLUSIVE_ACQUIRE(LockFunctions);
+    FUNCTIONSINFO functionInfo;
+    memset(&functionInfo, 0, sizeof(FUNCTIONSINFO));
 
-    // Delete existing entries
-    functions.clear();
-
-    // Inline lambda to enumerate all JSON array indices
-    auto InsertFunctions = [](const JSON Object, bool Manual)
-    {
-        size_t i;
-        JSON value;
-        json_array_foreach(Object, i, value)
-        {
-            FUNCTIONSINFO functionInfo;
-            memset(&functionInfo, 0, sizeof(FUNCTIONSINFO));
-
-            // Copy module name
-            const char* mod = json_string_value(json_object_get(value, "module"));
+    // Copy module name
+    const char* mod = Entry.GetString("module");
 
-            if(mod && *mod && strlen(mod) < MAX_MODULE_SIZE)
-                strcpy_s(functionInfo.mod, mod);
+    if(mod && *mod && strlen(mod) < MAX_MODULE_SIZE)
+        strcpy_s(functionInfo.mod, mod);
 
-            // Function address
-            functionInfo.start = (duint)json_hex_value(json_object_get(value, "start"));
-            functionInfo.end = (duint)json_hex_value(json_object_get(value, "end"));
-            functionInfo.manual = Manual;
-            functionInfo.instructioncount = (duint)json_hex_value(json_object_get(value, "icount"));
+    // Function address
+    functionInfo.start = Entry.GetHex("start");
+    functionInfo.end = Entry.GetHex("end");
+    functionInfo.manual = Manual;
+    functionInfo.instructioncount = Entry.GetHex("icount");
 
-            // Sanity check
-            if(functionInfo.end < functionInfo.start)
-                continue;
-
-            const duint key = ModHashFromName(functionInfo.mod);
-            functions.insert(std::make_pair(ModuleRange(key, Range(functionInfo.start, functionInfo.end)), functionInfo));
-        }
-    };
+    // Sanity check
+    if(functionInfo.end < functionInfo.start)
+        return;
 
-    const JSON jsonFunctions = json_object_get(Root, "functions");
-    const JSON jsonAutoFunctions = json_object_get(Root, "autofunctions");
+    const duint key = ModHashFromName(functionInfo.mod);
 
-    // Manual
-    if(jsonFunctions)
-        InsertFunctions(jsonFunctions, true);
-
-    // Auto
-    if(jsonAutoFunctions)
-        InsertFunctions(jsonAutoFunctions, false);
+    EXCLUSIVE_ACQUIRE(LockFunctions);
+    functions.insert(std::make_pair(ModuleRange(key, Range(functionInfo.start, functionInfo.end)), functionInfo));
 }
 
 bool FunctionEnum(FUNCTIONSINFO* List, size_t* Size)
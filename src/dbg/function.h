@@ -1,6 +1,7 @@
 #pragma once
 
 #include "addrinfo.h"
+#include "jsonstream.h"
 
 struct FUNCTIONSINFO
 {
@@ -16,7 +17,7 @@ bool FunctionGet(duint Address, duint* Start = nullptr, duint* End = nullptr, du
 bool FunctionOverlaps(duint Start, duint End);
 bool FunctionDelete(duint Address);
 void FunctionDelRange(duint Start, duint End);
-void FunctionCacheSave(JSON Root);
-void FunctionCacheLoad(JSON Root);
+void FunctionCacheSave(JsonWriter & Writer);
+void FunctionCacheLoad(const JsonEntry & Entry, bool Manual);
 bool FunctionEnum(FUNCTIONSINFO* List, size_t* Size);
 void FunctionClear();
\ No newline at end of file
@@ -33,6 +33,14 @@
 #include "exceptiondirectoryanalysis.h"
 #include "_scriptapi_stack.h"
 #include "threading.h"
+#include "plugin_loader.h"
+#include "symbolinfo.h"
+#include "stringextract.h"
+#include "memdump.h"
+#include "allocator.h"
+#include "yarachunk.h"
+#include <ppl.h>
+#include <thread>
 
 static bool bRefinit = false;
 static int maxFindResults = 5000;
@@ -461,6 +469,38 @@ CMDRESULT cbInstrAssemble(int argc, char* argv[])
     return STATUS_CONTINUE;
 }
 
+CMDRESULT cbInstrAssembleBlock(int argc, char* argv[])
+{
+    if(argc < 3)  //asmblock addr,"instr1;label:;instr2..."
+    {
+        dputs("not enough arguments!");
+        return STATUS_ERROR;
+    }
+    duint addr = 0;
+    if(!valfromstring(argv[1], &addr))
+    {
+        dprintf("invalid expression: \"%s\"!\n", argv[1]);
+        return STATUS_ERROR;
+    }
+    if(!DbgMemIsValidReadPtr(addr))
+    {
+        dprintf("invalid address: " fhex "!\n", addr);
+        return STATUS_ERROR;
+    }
+    std::vector<String> lines = StringUtils::Split(argv[2], ';');
+    char error[MAX_ERROR_SIZE] = "";
+    int size = 0;
+    if(!assembleblockat(addr, lines, &size, error))
+    {
+        varset("$result", 0, false);
+        dprintf("failed to assemble block (%s)\n", error);
+        return STATUS_ERROR;
+    }
+    varset("$result", size, false);
+    GuiUpdateAllViews();
+    return STATUS_CONTINUE;
+}
+
 CMDRESULT cbInstrFunctionAdd(int argc, char* argv[])
 {
     if(argc < 3)
@@ -944,14 +984,15 @@ bool cbRefStr(Capstone* disasm, BASIC_INSTRUCTION_INFO* basicinfo, REFINFO* refi
     char string[1024] = "";
     if(basicinfo->branch)  //branches have no strings (jmp dword [401000])
         return false;
+    StringMapCache* strings = (StringMapCache*)refinfo->userinfo; //module strings are extracted once per search
     if((basicinfo->type & TYPE_VALUE) == TYPE_VALUE)
     {
-        if(disasmgetstringat(basicinfo->value.value, &strtype, string, string, 500))
+        if(strings->GetStringAt(basicinfo->value.value, &strtype, string, string, 500))
             found = true;
     }
     if((basicinfo->type & TYPE_MEMORY) == TYPE_MEMORY)
     {
-        if(!found && disasmgetstringat(basicinfo->memory.value, &strtype, string, string, 500))
+        if(!found && strings->GetStringAt(basicinfo->memory.value, &strtype, string, string, 500))
             found = true;
     }
     if(found)
@@ -993,12 +1034,64 @@ CMDRESULT cbInstrRefStr(int argc, char* argv[])
             refFindType = CURRENT_REGION;
 
     duint ticks = GetTickCount();
-    int found = RefFind(addr, size, cbRefStr, 0, false, "Strings", (REFFINDTYPE)refFindType);
+    StringMapCache strings;
+    int found = RefFind(addr, size, cbRefStr, &strings, false, "Strings", (REFFINDTYPE)refFindType);
     dprintf("%u string(s) in %ums\n", found, GetTickCount() - ticks);
     varset("$result", found, false);
     return STATUS_CONTINUE;
 }
 
+CMDRESULT cbInstrModStrings(int argc, char* argv[])
+{
+    duint addr;
+    if(argc < 2 || !valfromstring(argv[1], &addr, true))
+        addr = GetContextDataEx(hActiveThread, UE_CIP);
+    duint base = ModBaseFromAddr(addr);
+    duint size = base ? ModSizeFromAddr(base) : 0;
+    if(!size)
+    {
+        dprintf("no module found at " fhex "!\n", addr);
+        return STATUS_ERROR;
+    }
+
+    duint ticks = GetTickCount();
+    StringMap strings;
+    if(!strings.Load(base, size))
+    {
+        dputs("failed to read the module memory!");
+        return STATUS_ERROR;
+    }
+    std::vector<STRINGINFO> list;
+    strings.Enumerate(list);
+
+    char modname[MAX_MODULE_SIZE] = "";
+    if(!ModNameFromAddr(base, modname, true))
+        sprintf_s(modname, "%p", base);
+    char title[MAX_MODULE_SIZE + 32] = "";
+    sprintf_s(title, "Strings (%s)", modname);
+    GuiReferenceInitialize(title);
+    GuiReferenceAddColumn(2 * sizeof(duint), "Address");
+    GuiReferenceAddColumn(500, "String");
+    GuiReferenceSetSearchStartCol(1); //only search the strings
+    GuiReferenceSetRowCount(int(list.size()));
+    for(int i = 0; i < int(list.size()); i++)
+    {
+        char addrText[20] = "";
+        sprintf(addrText, "%p", list[i].addr);
+        GuiReferenceSetCellContent(i, 0, addrText);
+        String text;
+        strings.GetString(list[i].addr, nullptr, text);
+        String dispString = list[i].type == str_ascii ? "\"" : "L\"";
+        dispString += StringUtils::Escape(text);
+        dispString += "\"";
+        GuiReferenceSetCellContent(i, 1, dispString.c_str());
+    }
+    GuiReferenceReloadData();
+    dprintf("%u string(s) in %ums\n", int(list.size()), GetTickCount() - ticks);
+    varset("$result", list.size(), false);
+    return STATUS_CONTINUE;
+}
+
 CMDRESULT cbInstrSetstr(int argc, char* argv[])
 {
     if(argc < 3)
@@ -1749,19 +1842,92 @@ static String yara_print_hex_string(const uint8_t* data, int length)
     return result;
 }
 
+struct YaraMatch
+{
+    duint addr;
+    String rule;
+    String pattern;
+};
+
 struct YaraScanInfo
 {
     duint base;
     int index;
     bool rawFile;
     const char* modname;
+    std::vector<YaraMatch>* matches; //collect the matches instead of reporting them (parallel scans)
+    duint limit; //only collect matches before base + limit (chunk overlap)
 
-    YaraScanInfo(duint base, bool rawFile, const char* modname)
-        : base(base), index(0), rawFile(rawFile), modname(modname)
+    YaraScanInfo(duint base, bool rawFile, const char* modname, std::vector<YaraMatch>* matches = nullptr, duint limit = ~duint(0))
+        : base(base), index(0), rawFile(rawFile), modname(modname), matches(matches), limit(limit)
     {
     }
 };
 
+struct YaraRulesCacheEntry
+{
+    FILETIME lastWrite;
+    std::shared_ptr<YR_RULES> rules;
+};
+
+static std::unordered_map<String, YaraRulesCacheEntry> yaraRulesCache;
+
+static std::shared_ptr<YR_RULES> yaragetrules(const char* rulesFile)
+{
+    //the compiled rules are reused until the rules file changes
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if(!GetFileAttributesExW(StringUtils::Utf8ToUtf16(rulesFile).c_str(), GetFileExInfoStandard, &attributes))
+    {
+        dprintf("Failed to read the rules file \"%s\"\n", rulesFile);
+        return nullptr;
+    }
+    auto found = yaraRulesCache.find(rulesFile);
+    if(found != yaraRulesCache.end() && !CompareFileTime(&found->second.lastWrite, &attributes.ftLastWriteTime))
+        return found->second.rules;
+
+    String rulesContent;
+    if(!FileHelper::ReadAllText(rulesFile, rulesContent))
+    {
+        dprintf("Failed to read the rules file \"%s\"\n", rulesFile);
+        return nullptr;
+    }
+
+    std::shared_ptr<YR_RULES> result;
+    YR_COMPILER* yrCompiler;
+    if(yr_compiler_create(&yrCompiler) == ERROR_SUCCESS)
+    {
+        yr_compiler_set_callback(yrCompiler, yaraCompilerCallback, 0);
+        if(yr_compiler_add_string(yrCompiler, rulesContent.c_str(), nullptr) == 0)   //no errors found
+        {
+            YR_RULES* yrRules;
+            if(yr_compiler_get_rules(yrCompiler, &yrRules) == ERROR_SUCCESS)
+                result = std::shared_ptr<YR_RULES>(yrRules, yr_rules_destroy);
+            else
+                dputs("error while getting the rules!");
+        }
+        else
+            dputs("errors in the rules file!");
+        yr_compiler_destroy(yrCompiler);
+    }
+    else
+        dputs("yr_compiler_create failed!");
+
+    if(result)
+    {
+        YaraRulesCacheEntry entry;
+        entry.lastWrite = attributes.ftLastWriteTime;
+        entry.rules = result;
+        yaraRulesCache[rulesFile] = entry;
+    }
+    return result;
+}
+
+void yararulescacheclear()
+{
+    //the rules have to be destroyed before yr_finalize
+    yaraRulesCache.clear();
+}
+
 static int yaraScanCallback(int message, void* message_data, void* user_data)
 {
     YaraScanInfo* scanInfo = (YaraScanInfo*)user_data;
@@ -1773,6 +1939,22 @@ static int yaraScanCallback(int message, void* message_data, void* user_data)
         YR_RULE* yrRule = (YR_RULE*)message_data;
         auto addReference = [scanInfo, yrRule](duint addr, const char* identifier, const std::string & pattern)
         {
+            if(scanInfo->matches)
+            {
+                if(addr - scanInfo->base >= scanInfo->limit) //found again by the next chunk
+                    return;
+                YaraMatch match;
+                match.addr = addr;
+                match.rule = yrRule->identifier;
+                if(identifier)
+                {
+                    match.rule += ".";
+                    match.rule += identifier;
+                }
+                match.pattern = pattern;
+                scanInfo->matches->push_back(match);
+                return;
+            }
             auto index = scanInfo->index;
             GuiReferenceSetRowCount(index + 1);
             scanInfo->index++;
@@ -1793,13 +1975,17 @@ static int yaraScanCallback(int message, void* message_data, void* user_data)
 
         if(STRING_IS_NULL(yrRule->strings))
         {
-            dprintf("[YARA] Global rule \"%s\' matched!\n", yrRule->identifier);
-            GuiReferenceSetRowCount(1);
+            if(!scanInfo->matches)
+            {
+                dprintf("[YARA] Global rule \"%s\' matched!\n", yrRule->identifier);
+                GuiReferenceSetRowCount(1);
+            }
             addReference(base, nullptr, "");
         }
         else
         {
-            dprintf("[YARA] Rule \"%s\" matched:\n", yrRule->identifier);
+            if(!scanInfo->matches)
+                dprintf("[YARA] Rule \"%s\" matched:\n", yrRule->identifier);
             YR_STRING* string;
             yr_rule_strings_foreach(yrRule, string)
             {
@@ -1818,7 +2004,8 @@ static int yaraScanCallback(int message, void* message_data, void* user_data)
                     else
                         addr = base + offset;
 
-                    dprintf("[YARA] String \"%s\" : %s on 0x%" fext "X\n", string->identifier, pattern.c_str(), addr);
+                    if(!scanInfo->matches)
+                        dprintf("[YARA] String \"%s\" : %s on 0x%" fext "X\n", string->identifier, pattern.c_str(), addr);
 
                     addReference(addr, string->identifier, pattern);
                 }
@@ -1830,13 +2017,15 @@ static int yaraScanCallback(int message, void* message_data, void* user_data)
     case CALLBACK_MSG_RULE_NOT_MATCHING:
     {
         YR_RULE* yrRule = (YR_RULE*)message_data;
-        dprintf("[YARA] Rule \"%s\" did not match!\n", yrRule->identifier);
+        if(!scanInfo->matches)
+            dprintf("[YARA] Rule \"%s\" did not match!\n", yrRule->identifier);
     }
     break;
 
     case CALLBACK_MSG_SCAN_FINISHED:
     {
-        dputs("[YARA] Scan finished!");
+        if(!scanInfo->matches)
+            dputs("[YARA] Scan finished!");
     }
     break;
 
@@ -1913,72 +2102,148 @@ CMDRESULT cbInstrYara(int argc, char* argv[])
         return STATUS_ERROR;
     }
 
-    String rulesContent;
-    if(!FileHelper::ReadAllText(argv[1], rulesContent))
+    auto yrRules = yaragetrules(argv[1]);
+    if(!yrRules)
+        return STATUS_ERROR;
+
+    //initialize new reference tab
+    char modname[MAX_MODULE_SIZE] = "";
+    if(!ModNameFromAddr(base, modname, true))
+        sprintf_s(modname, "%p", base);
+    String fullName;
+    const char* fileName = strrchr(argv[1], '\\');
+    if(fileName)
+        fullName = fileName + 1;
+    else
+        fullName = argv[1];
+    fullName += " (";
+    fullName += modname;
+    fullName += ")"; //nanana, very ugly code (long live open source)
+    GuiReferenceInitialize(fullName.c_str());
+    GuiReferenceAddColumn(sizeof(duint) * 2, "Address");
+    GuiReferenceAddColumn(48, "Rule");
+    GuiReferenceAddColumn(0, "Data");
+    GuiReferenceSetRowCount(0);
+    GuiReferenceReloadData();
+    YaraScanInfo scanInfo(base, rawFile, argv[2]);
+    duint ticks = GetTickCount();
+    dputs("[YARA] Scan started...");
+    int err = yr_rules_scan_mem(yrRules.get(), data(), size, 0, yaraScanCallback, &scanInfo, 0);
+    GuiReferenceReloadData();
+    bool bSuccess = false;
+    switch(err)
     {
-        dprintf("Failed to read the rules file \"%s\"\n", argv[1]);
+    case ERROR_SUCCESS:
+        dprintf("%u scan results in %ums...\n", scanInfo.index, GetTickCount() - ticks);
+        bSuccess = true;
+        break;
+    case ERROR_TOO_MANY_MATCHES:
+        dputs("too many matches!");
+        break;
+    default:
+        dputs("error while scanning memory!");
+        break;
+    }
+    return bSuccess ? STATUS_CONTINUE : STATUS_ERROR;
+}
+
+#define YARA_CHUNK_SIZE (16 * 1024 * 1024)
+#define YARA_CHUNK_OVERLAP (64 * 1024) //longest match that is found across a chunk boundary
+#define YARA_MAX_WORKERS 16 //YR_RULES supports up to MAX_THREADS (32) concurrent scans
+
+CMDRESULT cbInstrYaraAll(int argc, char* argv[])
+{
+    if(argc < 2)  //yaraall rulesFile
+    {
+        dputs("not enough arguments!");
         return STATUS_ERROR;
     }
+    auto yrRules = yaragetrules(argv[1]);
+    if(!yrRules)
+        return STATUS_ERROR;
 
-    bool bSuccess = false;
-    YR_COMPILER* yrCompiler;
-    if(yr_compiler_create(&yrCompiler) == ERROR_SUCCESS)
+    //every committed and accessible region is scanned separately
+    std::vector<SimplePage> regions;
     {
-        yr_compiler_set_callback(yrCompiler, yaraCompilerCallback, 0);
-        if(yr_compiler_add_string(yrCompiler, rulesContent.c_str(), nullptr) == 0)   //no errors found
+        SHARED_ACQUIRE(LockMemoryPages);
+        for(const auto & page : memoryPages)
         {
-            YR_RULES* yrRules;
-            if(yr_compiler_get_rules(yrCompiler, &yrRules) == ERROR_SUCCESS)
+            const MEMORY_BASIC_INFORMATION & mbi = page.second.mbi;
+            if(mbi.State != MEM_COMMIT || (mbi.Protect & (PAGE_NOACCESS | PAGE_GUARD)))
+                continue;
+            regions.push_back(SimplePage(duint(mbi.BaseAddress), mbi.RegionSize));
+        }
+    }
+
+    duint workers = max(std::thread::hardware_concurrency(), 1);
+    if(workers > 1)
+        workers--;
+    workers = min(min(workers, duint(YARA_MAX_WORKERS)), max(regions.size(), duint(1)));
+    auto workerMatches = new std::vector<YaraMatch>[workers];
+    volatile LONG nextRegion = -1;
+    volatile LONG scanErrors = 0;
+    duint ticks = GetTickCount();
+    dprintf("[YARA] Scanning %d regions with %d threads...\n", int(regions.size()), int(workers));
+
+    concurrency::parallel_for(duint(0), workers, [&](duint i)
+    {
+        //the read buffer is bounded by the chunk size, regions are claimed one at a time
+        std::vector<uint8_t> data;
+        for(LONG r = InterlockedIncrement(&nextRegion); r < LONG(regions.size()); r = InterlockedIncrement(&nextRegion))
+        {
+            const SimplePage & region = regions[r];
+            YaraForEachChunk<duint>(region.size, YARA_CHUNK_SIZE, YARA_CHUNK_OVERLAP, [&](duint Offset, duint ChunkSize, duint Limit)
             {
-                //initialize new reference tab
-                char modname[MAX_MODULE_SIZE] = "";
-                if(!ModNameFromAddr(base, modname, true))
-                    sprintf_s(modname, "%p", base);
-                String fullName;
-                const char* fileName = strrchr(argv[1], '\\');
-                if(fileName)
-                    fullName = fileName + 1;
-                else
-                    fullName = argv[1];
-                fullName += " (";
-                fullName += modname;
-                fullName += ")"; //nanana, very ugly code (long live open source)
-                GuiReferenceInitialize(fullName.c_str());
-                GuiReferenceAddColumn(sizeof(duint) * 2, "Address");
-                GuiReferenceAddColumn(48, "Rule");
-                GuiReferenceAddColumn(0, "Data");
-                GuiReferenceSetRowCount(0);
-                GuiReferenceReloadData();
-                YaraScanInfo scanInfo(base, rawFile, argv[2]);
-                duint ticks = GetTickCount();
-                dputs("[YARA] Scan started...");
-                int err = yr_rules_scan_mem(yrRules, data(), size, 0, yaraScanCallback, &scanInfo, 0);
-                GuiReferenceReloadData();
-                switch(err)
+                //unread bytes are zero instead of the previous chunk, incomplete chunks count as errors
+                data.assign(ChunkSize, 0);
+                duint bytesRead = 0;
+                if(!MemRead(region.address + Offset, data.data(), ChunkSize, &bytesRead))
+                    bytesRead = 0;
+                if(bytesRead < ChunkSize)
+                    InterlockedIncrement(&scanErrors);
+                if(bytesRead)
                 {
-                case ERROR_SUCCESS:
-                    dprintf("%u scan results in %ums...\n", scanInfo.index, GetTickCount() - ticks);
-                    bSuccess = true;
-                    break;
-                case ERROR_TOO_MANY_MATCHES:
-                    dputs("too many matches!");
-                    break;
-                default:
-                    dputs("error while scanning memory!");
-                    break;
+                    YaraScanInfo scanInfo(region.address + Offset, false, "", &workerMatches[i], Limit);
+                    if(yr_rules_scan_mem(yrRules.get(), data.data(), ChunkSize, 0, yaraScanCallback, &scanInfo, 0) != ERROR_SUCCESS)
+                        InterlockedIncrement(&scanErrors);
                 }
-                yr_rules_destroy(yrRules);
-            }
-            else
-                dputs("error while getting the rules!");
+            });
         }
-        else
-            dputs("errors in the rules file!");
-        yr_compiler_destroy(yrCompiler);
+    });
+
+    //merge the results of the workers in address order
+    std::vector<YaraMatch> matches;
+    for(duint i = 0; i < workers; i++)
+        std::move(workerMatches[i].begin(), workerMatches[i].end(), std::back_inserter(matches));
+    delete[] workerMatches;
+    std::stable_sort(matches.begin(), matches.end(), [](const YaraMatch & a, const YaraMatch & b)
+    {
+        return a.addr < b.addr;
+    });
+
+    String fullName;
+    const char* fileName = strrchr(argv[1], '\\');
+    fullName = fileName ? fileName + 1 : argv[1];
+    fullName += " (all memory)";
+    GuiReferenceInitialize(fullName.c_str());
+    GuiReferenceAddColumn(sizeof(duint) * 2, "Address");
+    GuiReferenceAddColumn(48, "Rule");
+    GuiReferenceAddColumn(0, "Data");
+    GuiReferenceSetRowCount(int(matches.size()));
+    for(int i = 0; i < int(matches.size()); i++)
+    {
+        char addr_text[deflen] = "";
+        sprintf(addr_text, fhex, matches[i].addr);
+        GuiReferenceSetCellContent(i, 0, addr_text); //Address
+        GuiReferenceSetCellContent(i, 1, matches[i].rule.c_str()); //Rule
+        GuiReferenceSetCellContent(i, 2, matches[i].pattern.c_str()); //Data
     }
-    else
-        dputs("yr_compiler_create failed!");
-    return bSuccess ? STATUS_CONTINUE : STATUS_ERROR;
+    GuiReferenceReloadData();
+    if(scanErrors)
+        dprintf("[YARA] %d chunks could not be read or scanned completely!\n", int(scanErrors));
+    dprintf("%u scan results in %ums...\n", int(matches.size()), GetTickCount() - ticks);
+    varset("$result", matches.size(), false);
+    return STATUS_CONTINUE;
 }
 
 CMDRESULT cbInstrYaramod(int argc, char* argv[])
@@ -2333,20 +2598,69 @@ CMDRESULT cbInstrSavedata(int argc, char* argv[])
     if(!valfromstring(argv[2], &addr, false) || !valfromstring(argv[3], &size, false))
         return STATUS_ERROR;
 
-    Memory<unsigned char*> data(size);
-    if(!MemRead(addr, data(), data.size()))
+    std::vector<MEMDUMPREGION> regions(1);
+    regions[0].addr = addr;
+    regions[0].size = size;
+    MEMDUMPRESULT result;
+    if(!MemDumpToFile(argv[1], regions, false, &result))
     {
-        dputs("Failed to read memory...");
+        dputs("Failed to write file...");
         return STATUS_ERROR;
     }
 
-    if(!FileHelper::WriteAllData(argv[1], data(), data.size()))
+    dprintf("%p[% " fext "X] written to \"%s\" !\n", addr, size, argv[1]);
+    if(result.unreadable)
+        dprintf("%" fext "X unreadable byte(s) were written as zeros, see \"%s.map\"\n", result.unreadable, argv[1]);
+
+    return STATUS_CONTINUE;
+}
+
+CMDRESULT cbInstrSaveRegions(int argc, char* argv[])
+{
+    if(argc < 4 || argc % 2)  //saveregions filename,addr1,size1[,addr2,size2...]
+    {
+        dputs("Not enough arguments...");
+        return STATUS_ERROR;
+    }
+    std::vector<MEMDUMPREGION> regions;
+    for(int i = 2; i + 1 < argc; i += 2)
+    {
+        MEMDUMPREGION region;
+        if(!valfromstring(argv[i], &region.addr, false) || !valfromstring(argv[i + 1], &region.size, false))
+            return STATUS_ERROR;
+        if(region.size)
+            regions.push_back(region);
+    }
+
+    duint ticks = GetTickCount();
+    MEMDUMPRESULT result;
+    if(!MemDumpToFile(argv[1], regions, true, &result))
     {
         dputs("Failed to write file...");
         return STATUS_ERROR;
     }
 
-    dprintf("%p[% " fext "X] written to \"%s\" !\n", addr, size, argv[1]);
+    dprintf("%d region(s), %" fext "X byte(s) written to \"%s\" in %ums, region map in \"%s.map\"\n", int(regions.size()), result.written, argv[1], GetTickCount() - ticks, argv[1]);
+    if(result.unreadable)
+        dprintf("%" fext "X unreadable byte(s) were written as zeros\n", result.unreadable);
+
+    return STATUS_CONTINUE;
+}
+
+CMDRESULT cbInstrPluginStats(int argc, char* argv[])
+{
+    plugincbstats();
+    return STATUS_CONTINUE;
+}
 
+CMDRESULT cbInstrSymCacheStats(int argc, char* argv[])
+{
+    SymNameCacheStats();
+    return STATUS_CONTINUE;
+}
+
+CMDRESULT cbInstrAllocStats(int argc, char* argv[])
+{
+    AllocStatsPrint(false);
     return STATUS_CONTINUE;
 }
\ No newline at end of file
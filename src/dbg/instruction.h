@@ -19,6 +19,7 @@ CMDRESULT cbInstrBookmarkDel(int argc, char* argv[]);
 CMDRESULT cbInstrLoaddb(int argc, char* argv[]);
 CMDRESULT cbInstrSavedb(int argc, char* argv[]);
 CMDRESULT cbInstrAssemble(int argc, char* argv[]);
+CMDRESULT cbInstrAssembleBlock(int argc, char* argv[]);
 CMDRESULT cbInstrFunctionAdd(int argc, char* argv[]);
 CMDRESULT cbInstrFunctionDel(int argc, char* argv[]);
 
@@ -47,6 +48,7 @@ CMDRESULT cbInstrRefinit(int argc, char* argv[]);
 CMDRESULT cbInstrRefadd(int argc, char* argv[]);
 CMDRESULT cbInstrRefFind(int argc, char* argv[]);
 CMDRESULT cbInstrRefStr(int argc, char* argv[]);
+CMDRESULT cbInstrModStrings(int argc, char* argv[]);
 CMDRESULT cbInstrRefFindRange(int argc, char* argv[]);
 
 CMDRESULT cbInstrSetstr(int argc, char* argv[]);
@@ -66,6 +68,8 @@ CMDRESULT cbInstrSleep(int argc, char* argv[]);
 CMDRESULT cbInstrFindAsm(int argc, char* argv[]);
 CMDRESULT cbInstrYara(int argc, char* argv[]);
 CMDRESULT cbInstrYaramod(int argc, char* argv[]);
+CMDRESULT cbInstrYaraAll(int argc, char* argv[]);
+void yararulescacheclear();
 CMDRESULT cbInstrLog(int argc, char* argv[]);
 
 CMDRESULT cbInstrCapstone(int argc, char* argv[]);
@@ -78,5 +82,9 @@ CMDRESULT cbInstrExanalyse(int argc, char* argv[]);
 CMDRESULT cbInstrVirtualmod(int argc, char* argv[]);
 CMDRESULT cbInstrSetMaxFindResult(int argc, char* argv[]);
 CMDRESULT cbInstrSavedata(int argc, char* argv[]);
+CMDRESULT cbInstrSaveRegions(int argc, char* argv[]);
+CMDRESULT cbInstrPluginStats(int argc, char* argv[]);
+CMDRESULT cbInstrSymCacheStats(int argc, char* argv[]);
+CMDRESULT cbInstrAllocStats(int argc, char* argv[]);
 
 #endif // _INSTRUCTIONS_H
@@ -0,0 +1,703 @@
+/**
+@file jsonstream.cpp
+
+@brief Implements a streaming JSON writer and an entry based JSON reader for the program database.
+*/
+
+#include "jsonstream.h"
+#include "lz4\lz4.h"
+
+static const char jsonStreamMagic[8] = { 'X', '6', '4', 'D', 'B', 'L', 'Z', '4' };
+static const DWORD jsonStreamVersion = 1;
+
+static bool writeall(HANDLE File, const void* Data, size_t Size)
+{
+    DWORD written = 0;
+    return !!WriteFile(File, Data, DWORD(Size), &written, nullptr) && written == DWORD(Size);
+}
+
+static bool readall(HANDLE File, void* Data, size_t Size)
+{
+    DWORD read = 0;
+    return !!ReadFile(File, Data, DWORD(Size), &read, nullptr) && read == DWORD(Size);
+}
+
+JsonWriter::JsonWriter()
+    : m_File(INVALID_HANDLE_VALUE),
+      m_Compress(false),
+      m_Indent(false),
+      m_Failed(false),
+      m_Used(0),
+      m_Depth(0)
+{
+    memset(m_Count, 0, sizeof(m_Count));
+}
+
+JsonWriter::~JsonWriter()
+{
+    if(m_File != INVALID_HANDLE_VALUE)
+        CloseHandle(m_File);
+}
+
+/**
+\brief Creates (or overwrites) the output file.
+\param FileName UTF-8 path of the file.
+\param Compress Write LZ4 compressed blocks instead of plain text.
+\param Indent Indent the output by four spaces per level, like JSON_INDENT(4).
+\return true if the file was created.
+*/
+bool JsonWriter::Open(const char* FileName, bool Compress, bool Indent)
+{
+    m_File = CreateFileW(StringUtils::Utf8ToUtf16(FileName).c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(m_File == INVALID_HANDLE_VALUE)
+        return false;
+    m_Compress = Compress;
+    m_Indent = Indent;
+    m_Buffer.resize(JSONSTREAM_BLOCK_SIZE);
+    if(m_Compress)
+    {
+        m_Compressed.resize(LZ4_compressBound(JSONSTREAM_BLOCK_SIZE));
+        JSONSTREAMHEADER header;
+        memcpy(header.Magic, jsonStreamMagic, sizeof(header.Magic));
+        header.Version = jsonStreamVersion;
+        header.BlockSize = JSONSTREAM_BLOCK_SIZE;
+        m_Failed = !writeall(m_File, &header, sizeof(header));
+    }
+    return true;
+}
+
+/**
+\brief Flushes the remaining output and closes the file.
+\return false if any write failed.
+*/
+bool JsonWriter::Close()
+{
+    if(m_File == INVALID_HANDLE_VALUE)
+        return false;
+    if(m_Indent)
+        raw("\n", 1);
+    flush();
+    CloseHandle(m_File);
+    m_File = INVALID_HANDLE_VALUE;
+    return !m_Failed;
+}
+
+void JsonWriter::ObjectBegin(const char* Key)
+{
+    key(Key);
+    raw("{", 1);
+    if(++m_Depth >= JSONSTREAM_MAX_DEPTH)
+        m_Failed = true;
+    else
+        m_Count[m_Depth] = 0;
+}
+
+void JsonWriter::ObjectEnd()
+{
+    bool empty = m_Depth >= JSONSTREAM_MAX_DEPTH || !m_Count[m_Depth];
+    m_Depth--;
+    if(!empty)
+        newline();
+    raw("}", 1);
+}
+
+void JsonWriter::ArrayBegin(const char* Key)
+{
+    key(Key);
+    raw("[", 1);
+    if(++m_Depth >= JSONSTREAM_MAX_DEPTH)
+        m_Failed = true;
+    else
+        m_Count[m_Depth] = 0;
+}
+
+void JsonWriter::ArrayEnd()
+{
+    bool empty = m_Depth >= JSONSTREAM_MAX_DEPTH || !m_Count[m_Depth];
+    m_Depth--;
+    if(!empty)
+        newline();
+    raw("]", 1);
+}
+
+void JsonWriter::WriteString(const char* Key, const char* Value)
+{
+    key(Key);
+    quoted(Value);
+}
+
+/**
+\brief Writes a value as a hexadecimal string, in the format of json_hex().
+*/
+void JsonWriter::WriteHex(const char* Key, duint Value)
+{
+    char hex[32];
+    sprintf_s(hex, "0x%" fext "X", Value);
+    key(Key);
+    quoted(hex);
+}
+
+void JsonWriter::WriteInteger(const char* Key, LONGLONG Value)
+{
+    char text[32];
+    sprintf_s(text, "%lld", Value);
+    key(Key);
+    raw(text, strlen(text));
+}
+
+void JsonWriter::WriteBoolean(const char* Key, bool Value)
+{
+    key(Key);
+    if(Value)
+        raw("true", 4);
+    else
+        raw("false", 5);
+}
+
+/**
+\brief Gets the number of members written to the root object (or array).
+*/
+size_t JsonWriter::RootSize() const
+{
+    return m_Count[1];
+}
+
+void JsonWriter::key(const char* Key)
+{
+    if(m_Depth > 0 && m_Depth < JSONSTREAM_MAX_DEPTH)
+    {
+        if(m_Count[m_Depth]++)
+            raw(",", 1);
+        newline();
+    }
+    if(Key)
+    {
+        quoted(Key);
+        if(m_Indent)
+            raw(": ", 2);
+        else
+            raw(":", 1);
+    }
+}
+
+void JsonWriter::raw(const char* Data, size_t Length)
+{
+    while(Length)
+    {
+        size_t size = min(Length, m_Buffer.size() - m_Used);
+        memcpy(m_Buffer.data() + m_Used, Data, size);
+        m_Used += size;
+        Data += size;
+        Length -= size;
+        if(m_Used == m_Buffer.size())
+            flush();
+    }
+}
+
+void JsonWriter::quoted(const char* Text)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+    raw("\"", 1);
+    if(Text)
+    {
+        const char* run = Text;
+        for(; *Text; Text++)
+        {
+            unsigned char ch = *Text;
+            if(ch >= 0x20 && ch != '\"' && ch != '\\')
+                continue;
+            raw(run, Text - run);
+            run = Text + 1;
+            switch(ch)
+            {
+            case '\"':
+                raw("\\\"", 2);
+                break;
+            case '\\':
+                raw("\\\\", 2);
+                break;
+            case '\n':
+                raw("\\n", 2);
+                break;
+            case '\r':
+                raw("\\r", 2);
+                break;
+            case '\t':
+                raw("\\t", 2);
+                break;
+            default:
+            {
+                char escape[6] = { '\\', 'u', '0', '0', hexDigits[ch >> 4], hexDigits[ch & 0xF] };
+                raw(escape, sizeof(escape));
+            }
+            break;
+            }
+        }
+        raw(run, Text - run);
+    }
+    raw("\"", 1);
+}
+
+void JsonWriter::newline()
+{
+    if(!m_Indent)
+        return;
+    raw("\n", 1);
+    for(int i = 0; i < m_Depth; i++)
+        raw("    ", 4);
+}
+
+void JsonWriter::flush()
+{
+    if(!m_Used || m_Failed)
+    {
+        m_Used = 0;
+        return;
+    }
+    if(m_Compress)
+    {
+        JSONSTREAMBLOCK block;
+        block.RawSize = DWORD(m_Used);
+        int compressedSize = LZ4_compress(m_Buffer.data(), m_Compressed.data(), int(m_Used));
+        if(compressedSize > 0 && DWORD(compressedSize) < block.RawSize)
+        {
+            block.CompressedSize = DWORD(compressedSize);
+            m_Failed = !writeall(m_File, &block, sizeof(block)) || !writeall(m_File, m_Compressed.data(), block.CompressedSize);
+        }
+        else
+        {
+            block.CompressedSize = block.RawSize;
+            m_Failed = !writeall(m_File, &block, sizeof(block)) || !writeall(m_File, m_Buffer.data(), m_Used);
+        }
+    }
+    else
+        m_Failed = !writeall(m_File, m_Buffer.data(), m_Used);
+    m_Used = 0;
+}
+
+JsonEntry::JsonEntry()
+    : m_Type(JsonTypeNull)
+{
+}
+
+JSONVALUETYPE JsonEntry::Type() const
+{
+    return m_Type;
+}
+
+/**
+\brief Gets the (unescaped) text of a scalar entry. Numbers and literals are returned as written.
+*/
+const char* JsonEntry::Value() const
+{
+    return m_Value.c_str();
+}
+
+/**
+\brief Gets a string member, like json_string_value(json_object_get(...)).
+\return nullptr if the member does not exist or is not a string.
+*/
+const char* JsonEntry::GetString(const char* Key) const
+{
+    auto member = find(Key);
+    if(!member || member->m_Type != JsonTypeString)
+        return nullptr;
+    return member->m_Value.c_str();
+}
+
+/**
+\brief Gets a member written by JsonWriter::WriteHex() or json_hex().
+*/
+duint JsonEntry::GetHex(const char* Key) const
+{
+    auto text = GetString(Key);
+    duint value = 0;
+    if(text)
+        sscanf_s(text, "0x%" fext "X", &value);
+    return value;
+}
+
+LONGLONG JsonEntry::GetInteger(const char* Key) const
+{
+    auto member = find(Key);
+    if(!member || member->m_Type != JsonTypeNumber)
+        return 0;
+    return _strtoi64(member->m_Value.c_str(), nullptr, 10);
+}
+
+bool JsonEntry::GetBoolean(const char* Key) const
+{
+    auto member = find(Key);
+    return member && member->m_Type == JsonTypeBoolean && member->m_Value == "true";
+}
+
+/**
+\brief Gets the elements of an array member.
+\return nullptr if the member does not exist or is not an array.
+*/
+const std::vector<JsonEntry>* JsonEntry::GetArray(const char* Key) const
+{
+    auto member = find(Key);
+    if(!member || member->m_Type != JsonTypeArray)
+        return nullptr;
+    return &member->m_Children;
+}
+
+const JsonEntry* JsonEntry::find(const char* Key) const
+{
+    if(m_Type != JsonTypeObject)
+        return nullptr;
+    // Entries only have a handful of members, a linear search is the fastest
+    for(const auto & child : m_Children)
+        if(child.m_Key == Key)
+            return &child;
+    return nullptr;
+}
+
+JsonReader::JsonReader()
+    : m_File(INVALID_HANDLE_VALUE),
+      m_Framed(false),
+      m_BlockSize(JSONSTREAM_BLOCK_SIZE),
+      m_Pos(0),
+      m_End(0)
+{
+}
+
+JsonReader::~JsonReader()
+{
+    Close();
+}
+
+/**
+\brief Opens a file for parsing. Files that start with a JSONSTREAMHEADER are decompressed block by block, anything else is read as plain text.
+\param FileName UTF-8 path of the file.
+\return true if the file was opened.
+*/
+bool JsonReader::Open(const char* FileName)
+{
+    Close();
+    m_File = CreateFileW(StringUtils::Utf8ToUtf16(FileName).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(m_File == INVALID_HANDLE_VALUE)
+        return false;
+    JSONSTREAMHEADER header;
+    if(readall(m_File, &header, sizeof(header)) &&
+            !memcmp(header.Magic, jsonStreamMagic, sizeof(header.Magic)) &&
+            header.Version == jsonStreamVersion &&
+            header.BlockSize &&
+            header.BlockSize <= 64 * 1024 * 1024)
+    {
+        m_Framed = true;
+        m_BlockSize = header.BlockSize;
+        m_Compressed.resize(LZ4_compressBound(int(m_BlockSize)));
+    }
+    else
+        SetFilePointer(m_File, 0, nullptr, FILE_BEGIN);
+    m_Buffer.resize(m_BlockSize);
+    return true;
+}
+
+void JsonReader::Close()
+{
+    if(m_File != INVALID_HANDLE_VALUE)
+        CloseHandle(m_File);
+    m_File = INVALID_HANDLE_VALUE;
+    m_Framed = false;
+    m_BlockSize = JSONSTREAM_BLOCK_SIZE;
+    m_Pos = m_End = 0;
+}
+
+/**
+\brief Returns whether the file was written by JsonWriter with compression enabled.
+*/
+bool JsonReader::Compressed() const
+{
+    return m_Framed;
+}
+
+/**
+\brief Parses the file. The root must be an object. Only the entry that is passed to the callback is kept in memory.
+\param Callback Called with the member name of the root object and one entry per array element (or the value itself).
+\return false if the file is not valid JSON. Entries before the error have been passed to the callback already.
+*/
+bool JsonReader::Parse(const JSONENTRYPROC & Callback)
+{
+    skipws();
+    if(get() != '{')
+        return false;
+    skipws();
+    if(peek() == '}')
+        return true;
+    while(true)
+    {
+        String section;
+        skipws();
+        if(!parseString(section))
+            return false;
+        skipws();
+        if(get() != ':')
+            return false;
+        skipws();
+        if(peek() == '[')
+        {
+            get();
+            skipws();
+            if(peek() == ']')
+                get();
+            else
+            {
+                while(true)
+                {
+                    JsonEntry entry;
+                    if(!parseValue(entry, 2))
+                        return false;
+                    Callback(section, entry);
+                    skipws();
+                    int ch = get();
+                    if(ch == ']')
+                        break;
+                    if(ch != ',')
+                        return false;
+                }
+            }
+        }
+        else
+        {
+            JsonEntry entry;
+            if(!parseValue(entry, 1))
+                return false;
+            Callback(section, entry);
+        }
+        skipws();
+        int ch = get();
+        if(ch == '}')
+            return true;
+        if(ch != ',')
+            return false;
+    }
+}
+
+bool JsonReader::fill()
+{
+    m_Pos = m_End = 0;
+    if(m_File == INVALID_HANDLE_VALUE)
+        return false;
+    if(!m_Framed)
+    {
+        DWORD read = 0;
+        if(!ReadFile(m_File, m_Buffer.data(), DWORD(m_Buffer.size()), &read, nullptr))
+            return false;
+        m_End = read;
+        return read != 0;
+    }
+    JSONSTREAMBLOCK block;
+    if(!readall(m_File, &block, sizeof(block)))
+        return false;
+    if(!block.RawSize || block.RawSize > m_BlockSize || block.CompressedSize > m_Compressed.size())
+        return false;
+    if(block.CompressedSize == block.RawSize)
+    {
+        if(!readall(m_File, m_Buffer.data(), block.RawSize))
+            return false;
+    }
+    else
+    {
+        if(!readall(m_File, m_Compressed.data(), block.CompressedSize))
+            return false;
+        if(LZ4_decompress_safe(m_Compressed.data(), m_Buffer.data(), int(block.CompressedSize), int(block.RawSize)) != int(block.RawSize))
+            return false;
+    }
+    m_End = block.RawSize;
+    return true;
+}
+
+int JsonReader::peek()
+{
+    if(m_Pos == m_End && !fill())
+        return -1;
+    return (unsigned char)m_Buffer[m_Pos];
+}
+
+int JsonReader::get()
+{
+    int ch = peek();
+    if(ch != -1)
+        m_Pos++;
+    return ch;
+}
+
+void JsonReader::skipws()
+{
+    while(true)
+    {
+        int ch = peek();
+        if(ch != ' ' && ch != '\t' && ch != '\r' && ch != '\n')
+            return;
+        m_Pos++;
+    }
+}
+
+bool JsonReader::parseHex4(unsigned & Value)
+{
+    Value = 0;
+    for(int i = 0; i < 4; i++)
+    {
+        int ch = get();
+        Value <<= 4;
+        if(ch >= '0' && ch <= '9')
+            Value |= ch - '0';
+        else if(ch >= 'a' && ch <= 'f')
+            Value |= ch - 'a' + 10;
+        else if(ch >= 'A' && ch <= 'F')
+            Value |= ch - 'A' + 10;
+        else
+            return false;
+    }
+    return true;
+}
+
+bool JsonReader::parseString(String & Value)
+{
+    if(get() != '\"')
+        return false;
+    while(true)
+    {
+        if(m_Pos == m_End && !fill())
+            return false;
+
+        // Copy everything up to the next quote or escape at once
+        size_t start = m_Pos;
+        while(m_Pos < m_End && m_Buffer[m_Pos] != '\"' && m_Buffer[m_Pos] != '\\')
+            m_Pos++;
+        Value.append(m_Buffer.data() + start, m_Pos - start);
+        if(m_Pos == m_End)
+            continue;
+
+        if(m_Buffer[m_Pos++] == '\"')
+            return true;
+        switch(get())
+        {
+        case '\"':
+            Value.push_back('\"');
+            break;
+        case '\\':
+            Value.push_back('\\');
+            break;
+        case '/':
+            Value.push_back('/');
+            break;
+        case 'b':
+            Value.push_back('\b');
+            break;
+        case 'f':
+            Value.push_back('\f');
+            break;
+        case 'n':
+            Value.push_back('\n');
+            break;
+        case 'r':
+            Value.push_back('\r');
+            break;
+        case 't':
+            Value.push_back('\t');
+            break;
+        case 'u':
+        {
+            unsigned codepoint;
+            if(!parseHex4(codepoint))
+                return false;
+            if(codepoint >= 0xD800 && codepoint <= 0xDBFF)
+            {
+                unsigned low;
+                if(get() != '\\' || get() != 'u' || !parseHex4(low) || low < 0xDC00 || low > 0xDFFF)
+                    return false;
+                codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+            }
+            // Encode as UTF-8
+            if(codepoint < 0x80)
+                Value.push_back(char(codepoint));
+            else if(codepoint < 0x800)
+            {
+                Value.push_back(char(0xC0 | (codepoint >> 6)));
+                Value.push_back(char(0x80 | (codepoint & 0x3F)));
+            }
+            else if(codepoint < 0x10000)
+            {
+                Value.push_back(char(0xE0 | (codepoint >> 12)));
+                Value.push_back(char(0x80 | ((codepoint >> 6) & 0x3F)));
+                Value.push_back(char(0x80 | (codepoint & 0x3F)));
+            }
+            else
+            {
+                Value.push_back(char(0xF0 | (codepoint >> 18)));
+                Value.push_back(char(0x80 | ((codepoint >> 12) & 0x3F)));
+                Value.push_back(char(0x80 | ((codepoint >> 6) & 0x3F)));
+                Value.push_back(char(0x80 | (codepoint & 0x3F)));
+            }
+        }
+        break;
+        default:
+            return false;
+        }
+    }
+}
+
+bool JsonReader::parseValue(JsonEntry & Entry, int Depth)
+{
+    if(Depth > JSONSTREAM_MAX_DEPTH)
+        return false;
+    skipws();
+    int ch = peek();
+    if(ch == '{' || ch == '[')
+    {
+        bool object = ch == '{';
+        char close = object ? '}' : ']';
+        get();
+        Entry.m_Type = object ? JsonTypeObject : JsonTypeArray;
+        skipws();
+        if(peek() == close)
+        {
+            get();
+            return true;
+        }
+        while(true)
+        {
+            JsonEntry child;
+            if(object)
+            {
+                skipws();
+                if(!parseString(child.m_Key))
+                    return false;
+                skipws();
+                if(get() != ':')
+                    return false;
+            }
+            if(!parseValue(child, Depth + 1))
+                return false;
+            Entry.m_Children.push_back(std::move(child));
+            skipws();
+            ch = get();
+            if(ch == close)
+                return true;
+            if(ch != ',')
+                return false;
+        }
+    }
+    if(ch == '\"')
+    {
+        Entry.m_Type = JsonTypeString;
+        return parseString(Entry.m_Value);
+    }
+
+    // Numbers and literals
+    while((ch = peek()) != -1 && (isalnum(ch) || ch == '-' || ch == '+' || ch == '.'))
+        Entry.m_Value.push_back(char(get()));
+    if(Entry.m_Value == "true" || Entry.m_Value == "false")
+        Entry.m_Type = JsonTypeBoolean;
+    else if(Entry.m_Value == "null")
+        Entry.m_Type = JsonTypeNull;
+    else if(!Entry.m_Value.empty() && (isdigit((unsigned char)Entry.m_Value[0]) || Entry.m_Value[0] == '-'))
+        Entry.m_Type = JsonTypeNumber;
+    else
+        return false;
+    return true;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "_global.h"
+#include <functional>
+
+#define JSONSTREAM_BLOCK_SIZE (256 * 1024)
+#define JSONSTREAM_MAX_DEPTH 32
+
+#pragma pack(push, 1)
+struct JSONSTREAMHEADER
+{
+    char Magic[8];
+    DWORD Version;
+    DWORD BlockSize;
+};
+
+struct JSONSTREAMBLOCK
+{
+    DWORD RawSize;
+    DWORD CompressedSize; // Equal to RawSize when the block is stored uncompressed
+};
+#pragma pack(pop)
+
+/**
+\brief Writes JSON text to a file as it is generated. The output is buffered and, when compression is enabled, written as LZ4 compressed blocks behind a JSONSTREAMHEADER.
+*/
+class JsonWriter
+{
+public:
+    JsonWriter();
+    ~JsonWriter();
+    bool Open(const char* FileName, bool Compress, bool Indent);
+    bool Close();
+    void ObjectBegin(const char* Key = nullptr);
+    void ObjectEnd();
+    void ArrayBegin(const char* Key = nullptr);
+    void ArrayEnd();
+    void WriteString(const char* Key, const char* Value);
+    void WriteHex(const char* Key, duint Value);
+    void WriteInteger(const char* Key, LONGLONG Value);
+    void WriteBoolean(const char* Key, bool Value);
+    size_t RootSize() const;
+
+private:
+    void key(const char* Key);
+    void raw(const char* Data, size_t Length);
+    void quoted(const char* Text);
+    void newline();
+    void flush();
+
+    HANDLE m_File;
+    bool m_Compress;
+    bool m_Indent;
+    bool m_Failed;
+    std::vector<char> m_Buffer;
+    std::vector<char> m_Compressed;
+    size_t m_Used;
+    int m_Depth;
+    size_t m_Count[JSONSTREAM_MAX_DEPTH]; // Members written at every nesting level
+};
+
+enum JSONVALUETYPE
+{
+    JsonTypeString,
+    JsonTypeNumber,
+    JsonTypeBoolean,
+    JsonTypeNull,
+    JsonTypeArray,
+    JsonTypeObject
+};
+
+/**
+\brief A single entry (usually one object of a top level array) handed to the JsonReader callback. Nested arrays and objects are kept as child entries.
+*/
+class JsonEntry
+{
+public:
+    JsonEntry();
+    JSONVALUETYPE Type() const;
+    const char* Value() const;
+    const char* GetString(const char* Key) const;
+    duint GetHex(const char* Key) const;
+    LONGLONG GetInteger(const char* Key) const;
+    bool GetBoolean(const char* Key) const;
+    const std::vector<JsonEntry>* GetArray(const char* Key) const;
+
+private:
+    friend class JsonReader;
+
+    const JsonEntry* find(const char* Key) const;
+
+    String m_Key;
+    JSONVALUETYPE m_Type;
+    String m_Value;
+    std::vector<JsonEntry> m_Children;
+};
+
+typedef std::function<void(const String & Section, const JsonEntry & Entry)> JSONENTRYPROC;
+
+/**
+\brief Parses a JSON file written by JsonWriter (or any plain JSON file) without building a DOM. For every member of the root object the callback is invoked once per array element, or once with the value itself when it is not an array.
+*/
+class JsonReader
+{
+public:
+    JsonReader();
+    ~JsonReader();
+    bool Open(const char* FileName);
+    void Close();
+    bool Compressed() const;
+    bool Parse(const JSONENTRYPROC & Callback);
+
+private:
+    bool fill();
+    int peek();
+    int get();
+    void skipws();
+    bool parseHex4(unsigned & Value);
+    bool parseString(String & Value);
+    bool parseValue(JsonEntry & Entry, int Depth);
+
+    HANDLE m_File;
+    bool m_Framed;
+    DWORD m_BlockSize;
+    std::vector<char> m_Buffer;
+    std::vector<char> m_Compressed;
+    size_t m_Pos;
+    size_t m_End;
+};
@@ -2,6 +2,7 @@
 #include "threading.h"
 #include "module.h"
 #include "memory.h"
+#include "stackinfo.h"
 
 std::unordered_map<duint, LABELSINFO> labels;
 
@@ -40,6 +41,7 @@ bool LabelSet(duint Address, const char* Text, bool Manual)
     if(!labels.insert(std::make_pair(ModHashFromAddr(key), labelInfo)).second)
         labels[key] = labelInfo;
 
+    stackcommentinvalidate();
     return true;
 }
 
@@ -87,6 +89,7 @@ bool LabelDelete(duint Address)
     ASSERT_DEBUGGING("Export call");
     EXCLUSIVE_ACQUIRE(LockLabels);
 
+    stackcommentinvalidate();
     return (labels.erase(ModHashFromAddr(Address)) > 0);
 }
 
@@ -109,6 +112,7 @@ void LabelDelRange(duint Start, duint End)
             return;
 
         EXCLUSIVE_ACQUIRE(LockLabels);
+        stackcommentinvalidate();
         for(auto itr = labels.begin(); itr != labels.end();)
         {
             const auto & currentLabel = itr->second;
@@ -128,103 +132,76 @@ void LabelDelRange(duint Start, duint End)
     }
 }
 
-void LabelCacheSave(JSON Root)
+void LabelCacheSave(JsonWriter & Writer)
 {
     EXCLUSIVE_ACQUIRE(LockLabels);
 
-    // Create the sub-root structures in memory
-    const JSON jsonLabels = json_array();
-    const JSON jsonAutoLabels = json_array();
-
-    // Iterator each label
-    for(auto & itr : labels)
+    // Write the user-set and the auto-set labels as separate arrays
+    for(int manual = 1; manual >= 0; manual--)
     {
-        JSON jsonLabel = json_object();
-        json_object_set_new(jsonLabel, "module", json_string(itr.second.mod));
-        json_object_set_new(jsonLabel, "address", json_hex(itr.second.addr));
-        json_object_set_new(jsonLabel, "text", json_string(itr.second.text));
-
-        // Was the label manually added?
-        if(itr.second.manual)
-            json_array_append_new(jsonLabels, jsonLabel);
-        else
-            json_array_append_new(jsonAutoLabels, jsonLabel);
-    }
+        bool empty = true;
+        for(auto & itr : labels)
+        {
+            if(itr.second.manual != (manual != 0))
+                continue;
 
-    // Apply the object to the global root
-    if(json_array_size(jsonLabels))
-        json_object_set(Root, "labels", jsonLabels);
+            if(empty)
+            {
+                Writer.ArrayBegin(manual ? "labels" : "autolabels");
+                empty = false;
+            }
 
-    if(json_array_size(jsonAutoLabels))
-        json_object_set(Root, "autolabels", jsonAutoLabels);
+            Writer.ObjectBegin();
+            Writer.WriteString("module", itr.second.mod);
+            Writer.WriteHex("address", itr.second.addr);
+            Writer.WriteString("text", itr.second.text);
+            Writer.ObjectEnd();
+        }
 
-    json_decref(jsonLabels);
-    json_decref(jsonAutoLabels);
+        if(!empty)
+            Writer.ArrayEnd();
+    }
 }
 
-void LabelCacheLoad(JSON Root)
+void LabelCacheLoad(const JsonEntry & Entry, bool Manual)
 {
-    EXCLUSIVE_ACQUIRE(LockLabels);
-
-    // Inline lambda to parse each JSON entry
-    auto AddLabels = [](const JSON Object, bool Manual)
-    {
-        size_t i;
-        JSON value;
-
-        json_array_foreach(Object, i, value)
-        {
-            LABELSINFO labelInfo;
-            memset(&labelInfo, 0, sizeof(LABELSINFO));
-
-            // Module
-            const char* mod = json_string_value(json_object_get(value, "module"));
-
-            if(mod && strlen(mod) < MAX_MODULE_SIZE)
-                strcpy_s(labelInfo.mod, mod);
-
-            // Address/Manual
-            labelInfo.addr = (duint)json_hex_value(json_object_get(value, "address"));
-            labelInfo.manual = Manual;
+    LABELSINFO labelInfo;
+    memset(&labelInfo, 0, sizeof(LABELSINFO));
 
-            // Text string
-            const char* text = json_string_value(json_object_get(value, "text"));
+    // Module
+    const char* mod = Entry.GetString("module");
 
-            if(text)
-                strcpy_s(labelInfo.text, text);
-            else
-            {
-                // Skip empty strings
-                continue;
-            }
+    if(mod && strlen(mod) < MAX_MODULE_SIZE)
+        strcpy_s(labelInfo.mod, mod);
 
-            // Go through the string replacing '&' with spaces
-            for(char* ptr = labelInfo.text; ptr[0] != '\0'; ptr++)
-            {
-                if(ptr[0] == '&')
-                    ptr[0] = ' ';
-            }
+    // Address/Manual
+    labelInfo.addr = Entry.GetHex("address");
+    labelInfo.manual = Manual;
 
-            // Finally insert the data
-            const duint key = ModHashFromName(labelInfo.mod) + labelInfo.addr;
+    // Text string
+    const char* text = Entry.GetString("text");
 
-            labels.insert(std::make_pair(key, labelInfo));
-        }
-    };
-
-    // Remove previous data
-    labels.clear();
+    if(text)
+        strcpy_s(labelInfo.text, text);
+    else
+    {
+        // Skip empty strings
+        return;
+    }
 
-    const JSON jsonLabels = json_object_get(Root, "labels");
-    const JSON jsonAutoLabels = json_object_get(Root, "autolabels");
+    // Go through the string replacing '&' with spaces
+    for(char* ptr = labelInfo.text; ptr[0] != '\0'; ptr++)
+    {
+        if(ptr[0] == '&')
+            ptr[0] = ' ';
+    }
 
-    // Load user-set labels
-    if(jsonLabels)
-        AddLabels(jsonLabels, true);
+    // Finally insert the data
+    const duint key = ModHashFromName(labelInfo.mod) + labelInfo.addr;
 
-    // Load auto-set labels
-    if(jsonAutoLabels)
-        AddLabels(jsonAutoLabels, false);
+    EXCLUSIVE_ACQUIRE(LockLabels);
+    labels.insert(std::make_pair(key, labelInfo));
+    stackcommentinvalidate();
 }
 
 bool LabelEnum(LABELSINFO* List, size_t* Size)
@@ -262,4 +239,5 @@ void LabelClear()
 {
     EXCLUSIVE_ACQUIRE(LockLabels);
     labels.clear();
+    stackcommentinvalidate();
 }
\ No newline at end of file
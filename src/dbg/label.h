@@ -1,6 +1,7 @@
 #pragma once
 
 #include "_global.h"
+#include "jsonstream.h"
 
 struct LABELSINFO
 {
@@ -15,7 +16,7 @@ bool LabelFromString(const char* Text, duint* Address);
 bool LabelGet(duint Address, char* Text);
 bool LabelDelete(duint Address);
 void LabelDelRange(duint Start, duint End);
-void LabelCacheSave(JSON root);
-void LabelCacheLoad(JSON root);
+void LabelCacheSave(JsonWriter & Writer);
+void LabelCacheLoad(const JsonEntry & Entry, bool Manual);
 bool LabelEnum(LABELSINFO* List, size_t* Size);
 void LabelClear();
\ No newline at end of file
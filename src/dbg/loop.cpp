@@ -137,94 +137,65 @@ bool LoopDelete(int Depth, duint Address)
     return false;
 }
 
-void LoopCacheSave(JSON Root)
+void LoopCacheSave(JsonWriter & Writer)
 {
     EXCLUSIVE_ACQUIRE(LockLoops);
 
-    // Create the root JSON objects
-    const JSON jsonLoops = json_array();
-    const JSON jsonAutoLoops = json_array();
-
-    // Write all entries
-    for(auto & itr : loops)
+    // Write the user-set and the auto-set loops as separate arrays
+    for(int manual = 1; manual >= 0; manual--)
     {
-        const LOOPSINFO & currentLoop = itr.second;
-        JSON currentJson = json_object();
-
-        json_object_set_new(currentJson, "module", json_string(currentLoop.mod));
-        json_object_set_new(currentJson, "start", json_hex(currentLoop.start));
-        json_object_set_new(currentJson, "end", json_hex(currentLoop.end));
-        json_object_set_new(currentJson, "depth", json_integer(currentLoop.depth));
-        json_object_set_new(currentJson, "parent", json_hex(currentLoop.parent));
-
-        if(currentLoop.manual)
-            json_array_append_new(jsonLoops, currentJson);
-        else
-            json_array_append_new(jsonAutoLoops, currentJson);
-    }
-
-    // Append a link to the global root
-    if(json_array_size(jsonLoops))
-        json_object_set(Root, "loops", jsonLoops);
+        bool empty = true;
+        for(auto & itr : loops)
+        {
+            const LOOPSINFO & currentLoop = itr.second;
+            if(currentLoop.manual != (manual != 0))
+                continue;
 
-    if(json_array_size(jsonAutoLoops))
-        json_object_set(Root, "autoloops", jsonAutoLoops);
+            if(empty)
+            {
+                Writer.ArrayBegin(manual ? "loops" : "autoloops");
+                empty = false;
+            }
+
+            Writer.ObjectBegin();
+            Writer.WriteString("module", currentLoop.mod);
+            Writer.WriteHex("start", currentLoop.start);
+            Writer.WriteHex("end", currentLoop.end);
+            Writer.WriteInteger("depth", currentLoop.depth);
+            Writer.WriteHex("parent", currentLoop.parent);
+            Writer.ObjectEnd();
+        }
 
-    // Release memory/references
-    json_decref(jsonLoops);
-    json_decref(jsonAutoLoops);
+        if(!empty)
+            Writer.ArrayEnd();
+    }
 }
 
-void LoopCacheLoad(JSON Root)
+void LoopCacheLoad(const JsonEntry & Entry, bool Manual)
 {
-    EXCLUSIVE_ACQUIRE(LockLoops);
-
-    // Inline lambda to parse each JSON entry
-    auto AddLoops = [](const JSON Object, bool Manual)
-    {
-        size_t i;
-        JSON value;
-
-        json_array_foreach(Object, i, value)
-        {
-            LOOPSINFO loopInfo;
-            memset(&loopInfo, 0, sizeof(LOOPSINFO));
-
-            // Module name
-            const char* mod = json_string_value(json_object_get(value, "module"));
-
-            if(mod && strlen(mod) < MAX_MODULE_SIZE)
-                strcpy_s(loopInfo.mod, mod);
-
-            // All other variables
-            loopInfo.start = (duint)json_hex_value(json_object_get(value, "start"));
-            loopInfo.end = (duint)json_hex_value(json_object_get(value, "end"));
-            loopInfo.depth = (int)json_integer_value(json_object_get(value, "depth"));
-            loopInfo.parent = (duint)json_hex_value(json_object_get(value, "parent"));
-            loopInfo.manual = Manual;
-
-            // Sanity check: Make sure the loop starts before it ends
-            if(loopInfo.end < loopInfo.start)
-                continue;
+    LOOPSINFO loopInfo;
+    memset(&loopInfo, 0, sizeof(LOOPSINFO));
 
-            // Insert into global list
-            loops.insert(std::make_pair(DepthModuleRange(loopInfo.depth, ModuleRange(ModHashFromName(loopInfo.mod), Range(loopInfo.start, loopInfo.end))), loopInfo));
-        }
-    };
+    // Module name
+    const char* mod = Entry.GetString("module");
 
-    // Remove existing entries
-    loops.clear();
+    if(mod && strlen(mod) < MAX_MODULE_SIZE)
+        strcpy_s(loopInfo.mod, mod);
 
-    const JSON jsonLoops = json_object_get(Root, "loops");
-    const JSON jsonAutoLoops = json_object_get(Root, "autoloops");
+    // All other variables
+    loopInfo.start = Entry.GetHex("start");
+    loopInfo.end = Entry.GetHex("end");
+    loopInfo.depth = (int)Entry.GetInteger("depth");
+    loopInfo.parent = Entry.GetHex("parent");
+    loopInfo.manual = Manual;
 
-    // Load user-set loops
-    if(jsonLoops)
-        AddLoops(jsonLoops, true);
+    // Sanity check: Make sure the loop starts before it ends
+    if(loopInfo.end < loopInfo.start)
+        return;
 
-    // Load auto-set loops
-    if(jsonAutoLoops)
-        AddLoops(jsonAutoLoops, false);
+    // Insert into global list
+    EXCLUSIVE_ACQUIRE(LockLoops);
+    loops.insert(std::make_pair(DepthModuleRange(loopInfo.depth, ModuleRange(ModHashFromName(loopInfo.mod), Range(loopInfo.start, loopInfo.end))), loopInfo));
 }
 
 bool LoopEnum(LOOPSINFO* List, size_t* Size)
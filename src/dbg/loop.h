@@ -2,6 +2,7 @@
 #define _LOOP_H
 
 #include "addrinfo.h"
+#include "jsonstream.h"
 
 struct LOOPSINFO
 {
@@ -17,8 +18,8 @@ bool LoopAdd(duint Start, duint End, bool Manual);
 bool LoopGet(int Depth, duint Address, duint* Start, duint* End);
 bool LoopOverlaps(int Depth, duint Start, duint End, int* FinalDepth);
 bool LoopDelete(int Depth, duint Address);
-void LoopCacheSave(JSON Root);
-void LoopCacheLoad(JSON Root);
+void LoopCacheSave(JsonWriter & Writer);
+void LoopCacheLoad(const JsonEntry & Entry, bool Manual);
 bool LoopEnum(LOOPSINFO* List, size_t* Size);
 void LoopClear();
 
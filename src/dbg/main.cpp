@@ -5,10 +5,13 @@
  */
 
 #include "_global.h"
+#include "allocator.h"
 
 extern "C" DLL_EXPORT BOOL APIENTRY DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved)
 {
     if(fdwReason == DLL_PROCESS_ATTACH)
         hInst = hinstDLL;
+    else if(fdwReason == DLL_THREAD_DETACH)
+        ArenaThreadExit();
     return TRUE;
 }
@@ -0,0 +1,185 @@
+/**
+ @file memdump.cpp
+
+ @brief Streams debuggee memory to a file in bounded chunks.
+ */
+
+#include "memdump.h"
+#include "memory.h"
+#include "handle.h"
+#include "filehelper.h"
+#include "memdumplayout.h"
+
+typedef MemDumpRange<duint> MEMDUMPRANGE;
+
+/**
+\brief Two chunk buffers that are written with overlapped I/O, so the next chunk is read while the previous one is written.
+*/
+class MemDumpWriter
+{
+public:
+    MemDumpWriter(HANDLE hFile)
+        : m_File(hFile), m_Current(0), m_Failed(false)
+    {
+        for(int i = 0; i < 2; i++)
+        {
+            memset(&m_Overlapped[i], 0, sizeof(m_Overlapped[i]));
+            m_Overlapped[i].hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+            m_Pending[i] = false;
+        }
+    }
+
+    ~MemDumpWriter()
+    {
+        Wait();
+        for(int i = 0; i < 2; i++)
+            CloseHandle(m_Overlapped[i].hEvent);
+    }
+
+    // Returns the buffer of the next chunk, after the previous write from it completed
+    unsigned char* Acquire(size_t Size)
+    {
+        wait(m_Current);
+        m_Buffer[m_Current].resize(Size);
+        return m_Buffer[m_Current].data();
+    }
+
+    bool Write(ULONGLONG Offset, size_t Size)
+    {
+        OVERLAPPED & overlapped = m_Overlapped[m_Current];
+        overlapped.Offset = DWORD(Offset);
+        overlapped.OffsetHigh = DWORD(Offset >> 32);
+        if(!WriteFile(m_File, m_Buffer[m_Current].data(), DWORD(Size), nullptr, &overlapped) && GetLastError() != ERROR_IO_PENDING)
+            m_Failed = true;
+        else
+            m_Pending[m_Current] = true;
+        m_Current ^= 1;
+        return !m_Failed;
+    }
+
+    bool Wait()
+    {
+        wait(0);
+        wait(1);
+        return !m_Failed;
+    }
+
+private:
+    void wait(int Index)
+    {
+        if(!m_Pending[Index])
+            return;
+        DWORD written = 0;
+        if(!GetOverlappedResult(m_File, &m_Overlapped[Index], &written, TRUE) || written != m_Buffer[Index].size())
+            m_Failed = true;
+        m_Pending[Index] = false;
+    }
+
+    HANDLE m_File;
+    OVERLAPPED m_Overlapped[2];
+    bool m_Pending[2];
+    std::vector<unsigned char> m_Buffer[2];
+    int m_Current;
+    bool m_Failed;
+};
+
+static void readchunk(duint Address, unsigned char* Buffer, duint Size, std::vector<MEMDUMPRANGE> & Unreadable, ULONGLONG Offset)
+{
+    // MemRead succeeds on partial reads, the pages that cannot be read are written as zeros
+    MemDumpReadChunk<duint>(Address, Buffer, Size, PAGE_SIZE, Offset, Unreadable, [](duint Address, unsigned char* Buffer, duint Size)
+    {
+        duint bytesRead = 0;
+        if(!MemRead(Address, Buffer, Size, &bytesRead))
+            return duint(0);
+        return bytesRead;
+    });
+}
+
+static bool writemap(const char* FileName, const std::vector<MEMDUMPRANGE> & Regions, const std::vector<MEMDUMPRANGE> & Unreadable)
+{
+    String map;
+    char line[128] = "";
+    for(const auto & region : Regions)
+    {
+        sprintf_s(line, "region %p %" fext "X %llX\r\n", region.addr, region.size, region.offset);
+        map += line;
+    }
+    for(const auto & range : Unreadable)
+    {
+        sprintf_s(line, "unreadable %p %" fext "X %llX\r\n", range.addr, range.size, range.offset);
+        map += line;
+    }
+    return FileHelper::WriteAllText(StringUtils::sprintf("%s.map", FileName), map);
+}
+
+bool MemDumpToFile(const char* FileName, const std::vector<MEMDUMPREGION> & Regions, bool Sparse, MEMDUMPRESULT* Result)
+{
+    if(Result)
+        memset(Result, 0, sizeof(MEMDUMPRESULT));
+    if(Regions.empty())
+        return false;
+
+    Handle hFile = CreateFileW(StringUtils::Utf8ToUtf16(FileName).c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_FLAG_OVERLAPPED, nullptr);
+    if(hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    // Sparse dumps keep the distance between the regions, the gaps do not take disk space
+    std::vector<MEMDUMPRANGE> regions;
+    ULONGLONG fileSize = MemDumpLayout<duint>(Regions, Sparse, regions);
+    if(Sparse)
+    {
+        DWORD bytesReturned = 0;
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(overlapped));
+        overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        if(DeviceIoControl(hFile, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, nullptr, &overlapped) || GetLastError() == ERROR_IO_PENDING)
+            GetOverlappedResult(hFile, &overlapped, &bytesReturned, TRUE);
+        CloseHandle(overlapped.hEvent);
+    }
+
+    std::vector<MEMDUMPRANGE> unreadable;
+    bool success = true;
+    {
+        MemDumpWriter writer(hFile);
+        for(size_t i = 0; i < regions.size() && success; i++)
+        {
+            const MEMDUMPRANGE & region = regions[i];
+            // Chunks after the first one start on a page boundary
+            success = MemDumpForEachChunk<duint>(region.addr, region.size, MEMDUMP_CHUNK_SIZE, PAGE_SIZE, [&](duint Address, duint ChunkSize)
+            {
+                ULONGLONG offset = region.offset + (Address - region.addr);
+                unsigned char* buffer = writer.Acquire(ChunkSize);
+                readchunk(Address, buffer, ChunkSize, unreadable, offset);
+                if(!writer.Write(offset, ChunkSize))
+                    return false;
+                if(Result)
+                    Result->written += ChunkSize;
+                return true;
+            });
+        }
+        if(!writer.Wait())
+            success = false;
+    }
+
+    // Trailing holes of a sparse file still count towards the file size
+    LARGE_INTEGER end;
+    end.QuadPart = fileSize;
+    if(success && (!SetFilePointerEx(hFile, end, nullptr, FILE_BEGIN) || !SetEndOfFile(hFile)))
+        success = false;
+
+    if(Result)
+    {
+        for(const auto & range : unreadable)
+            Result->unreadable += range.size;
+    }
+
+    // The sidecar map is only needed when the file is not a plain copy of the memory
+    if(success && (Sparse || regions.size() > 1 || !unreadable.empty()))
+    {
+        if(!writemap(FileName, regions, unreadable))
+            success = false;
+        else if(Result)
+            Result->hasMap = true;
+    }
+    return success;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "_global.h"
+
+#define MEMDUMP_CHUNK_SIZE (4 * 1024 * 1024)
+
+struct MEMDUMPREGION
+{
+    duint addr;
+    duint size;
+};
+
+struct MEMDUMPRESULT
+{
+    duint written;    // Bytes of debuggee memory written to the file
+    duint unreadable; // Bytes that could not be read and were written as zeros
+    bool hasMap;      // Whether the "<file>.map" sidecar was written
+};
+
+bool MemDumpToFile(const char* FileName, const std::vector<MEMDUMPREGION> & Regions, bool Sparse, MEMDUMPRESULT* Result);
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+#include <cstring>
+
+/**
+\brief A range of debuggee memory and its position in the dump file.
+*/
+template<typename Address>
+struct MemDumpRange
+{
+    Address addr;
+    Address size;
+    unsigned long long offset; // Position in the output file
+};
+
+/**
+\brief Places the regions in the dump file. A plain dump writes the regions one after the other, a sparse dump keeps the distance between them. This header does not depend on the Windows types, so it can be tested on its own.
+\param Regions The regions to dump, anything with addr and size members.
+\param Sparse Whether to keep the distance between the regions.
+\param [out] Ranges The regions with their file offsets, in the order of Regions.
+\return The size of the dump file.
+*/
+template<typename Address, typename Region>
+unsigned long long MemDumpLayout(const std::vector<Region> & Regions, bool Sparse, std::vector<MemDumpRange<Address>> & Ranges)
+{
+    Ranges.clear();
+    if(Regions.empty())
+        return 0;
+    Address lowest = Regions[0].addr;
+    for(const auto & region : Regions)
+        lowest = region.addr < lowest ? region.addr : lowest;
+    unsigned long long fileSize = 0;
+    for(const auto & region : Regions)
+    {
+        MemDumpRange<Address> range;
+        range.addr = region.addr;
+        range.size = region.size;
+        range.offset = Sparse ? region.addr - lowest : fileSize;
+        Ranges.push_back(range);
+        if(range.offset + range.size > fileSize)
+            fileSize = range.offset + range.size;
+    }
+    return fileSize;
+}
+
+/**
+\brief Calls Proc(Address, Size) for every chunk of a region. The first chunk ends where a chunk would end if the region started on a page boundary, so every following chunk starts on a page boundary and no chunk is larger than ChunkSize.
+\return false if Proc returned false.
+*/
+template<typename Address, typename ChunkProc>
+bool MemDumpForEachChunk(Address Addr, Address Size, Address ChunkSize, Address PageSize, ChunkProc Proc)
+{
+    for(Address done = 0; done < Size;)
+    {
+        const Address address = Addr + done;
+        Address chunkSize = ChunkSize - (address & (PageSize - 1));
+        if(chunkSize > Size - done)
+            chunkSize = Size - done;
+        if(!Proc(address, chunkSize))
+            return false;
+        done += chunkSize;
+    }
+    return true;
+}
+
+/**
+\brief Reads a chunk with Read(Address, Buffer, Size), which returns the number of bytes it read. When the chunk cannot be read at once, it is read page by page. The bytes that cannot be read are zeroed and recorded in Unreadable, merged with the previous unreadable range when they continue it in memory and in the file.
+\param Offset The position of the chunk in the file.
+*/
+template<typename Address, typename ReadProc>
+void MemDumpReadChunk(Address Addr, unsigned char* Buffer, Address Size, Address PageSize, unsigned long long Offset, std::vector<MemDumpRange<Address>> & Unreadable, ReadProc Read)
+{
+    if(Read(Addr, Buffer, Size) == Size)
+        return;
+
+    for(Address i = 0; i < Size;)
+    {
+        Address readSize = PageSize - ((Addr + i) & (PageSize - 1));
+        if(readSize > Size - i)
+            readSize = Size - i;
+        const Address bytesRead = Read(Addr + i, Buffer + i, readSize);
+        if(bytesRead < readSize)
+        {
+            const Address missing = readSize - bytesRead;
+            const Address start = i + bytesRead;
+            memset(Buffer + start, 0, size_t(missing));
+            if(!Unreadable.empty() && Unreadable.back().addr + Unreadable.back().size == Addr + start && Unreadable.back().offset + Unreadable.back().size == Offset + start)
+                Unreadable.back().size += missing;
+            else
+            {
+                MemDumpRange<Address> range;
+                range.addr = Addr + start;
+                range.size = missing;
+                range.offset = Offset + start;
+                Unreadable.push_back(range);
+            }
+        }
+        i += readSize;
+    }
+}
@@ -10,6 +10,7 @@
 #include "threading.h"
 #include "thread.h"
 #include "module.h"
+#include "stackinfo.h"
 
 #define PAGE_SHIFT              (12)
 //#define PAGE_SIZE               (4096)
@@ -19,7 +20,7 @@
 
 std::map<Range, MEMPAGE, RangeCompare> memoryPages;
 bool bListAllPages = false;
-DWORD memMapThreadCounter = 0;
+static HANDLE hMemMapEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
 
 void MemUpdateMap()
 {
@@ -234,9 +235,15 @@ void MemUpdateMap()
 
 void MemUpdateMapAsync()
 {
-    // Setting the last tick to 0 will force the thread to execute MemUpdateMap()
-    // as soon as possible
-    InterlockedExchange((volatile LONG*)&memMapThreadCounter, 0);
+    // Wake up the memory map thread, it will execute MemUpdateMap() once the
+    // requests stop coming in
+    SetEvent(hMemMapEvent);
+}
+
+bool MemUpdateMapWait(DWORD Timeout)
+{
+    // The event is auto-reset, so multiple requests are merged into one
+    return WaitForSingleObject(hMemMapEvent, Timeout) == WAIT_OBJECT_0;
 }
 
 duint MemFindBaseAddr(duint Address, duint* Size, bool Refresh)
@@ -329,6 +336,9 @@ bool MemWrite(duint BaseAddress, const void* Buffer, duint Size, duint* NumberOf
     if(!NumberOfBytesWritten)
         NumberOfBytesWritten = &bytesWrittenTemp;
 
+    // Stack comments describe the memory that is about to change
+    stackcommentinvalidate();
+
     // Try a regular WriteProcessMemory call
     bool ret = MemoryWriteSafe(fdProcessInfo->hProcess, (LPVOID)BaseAddress, Buffer, Size, NumberOfBytesWritten);
 
@@ -387,8 +397,7 @@ bool MemPatch(duint BaseAddress, const void* Buffer, duint Size, duint* NumberOf
     // Are we able to write on this page?
     if(MemWrite(BaseAddress, Buffer, Size, NumberOfBytesWritten))
     {
-        for(duint i = 0; i < Size; i++)
-            PatchSet(BaseAddress + i, oldData()[i], ((const unsigned char*)Buffer)[i]);
+        PatchSetRange(BaseAddress, oldData(), (const unsigned char*)Buffer, Size);
 
         // Done
         return true;
@@ -6,7 +6,6 @@
 
 extern std::map<Range, MEMPAGE, RangeCompare> memoryPages;
 extern bool bListAllPages;
-extern DWORD memMapThreadCounter;
 
 struct SimplePage
 {
@@ -22,6 +21,7 @@ struct SimplePage
 
 void MemUpdateMap();
 void MemUpdateMapAsync();
+bool MemUpdateMapWait(DWORD Timeout);
 duint MemFindBaseAddr(duint Address, duint* Size, bool Refresh = false);
 bool MemRead(duint BaseAddress, void* Buffer, duint Size, duint* NumberOfBytesRead = nullptr);
 bool MemWrite(duint BaseAddress, const void* Buffer, duint Size, duint* NumberOfBytesWritten = nullptr);
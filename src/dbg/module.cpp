@@ -5,6 +5,8 @@
 #include "murmurhash.h"
 #include "memory.h"
 #include "label.h"
+#include "stackunwind.h"
+#include "breakpoint.h"
 
 std::map<Range, MODINFO, RangeCompare> modinfo;
 
@@ -134,6 +136,9 @@ bool ModLoad(duint Base, duint Size, const char* FullPath)
     modinfo.insert(std::make_pair(Range(Base, Base + Size - 1), info));
     EXCLUSIVE_RELEASE();
 
+    // Rebase the breakpoints of this module
+    BpRefreshModule((String(info.name) + info.extension).c_str());
+
     // Put labels for virtual module exports
     if(virtualModule)
     {
@@ -161,9 +166,16 @@ bool ModUnload(duint Base)
         return false;
 
     // Remove it from the list
+    String name = String(found->second.name) + found->second.extension;
     modinfo.erase(found);
     EXCLUSIVE_RELEASE();
 
+    // Deactivate the breakpoints of this module
+    BpRefreshModule(name.c_str());
+
+    // Drop the cached unwind information
+    UnwindTableRemove(Base);
+
     // Update symbols
     SymUpdateModuleList();
     return true;
@@ -176,6 +188,12 @@ void ModClear()
     modinfo.clear();
     EXCLUSIVE_RELEASE();
 
+    // Deactivate all module breakpoints
+    BpRefreshAll();
+
+    // Drop the cached unwind information
+    UnwindTableClear();
+
     // Tell the symbol updater
     GuiSymbolUpdateModuleList(0, nullptr);
 }
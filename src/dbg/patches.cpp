@@ -9,73 +9,109 @@
 #include "debugger.h"
 #include "threading.h"
 #include "module.h"
+#include "patchextents.h"
 
-std::unordered_map<duint, PATCHINFO> patches;
-
-bool PatchSet(duint Address, unsigned char OldByte, unsigned char NewByte)
+struct PATCHMODULE
 {
-    ASSERT_DEBUGGING("Export call");
+    char mod[MAX_MODULE_SIZE];
+    std::map<duint, PatchExtent> extents; // RVA of the first byte -> contiguous patched bytes
+};
 
-    // Address must be valid
-    if(!MemIsValidReadPtr(Address))
-        return false;
+// Key is the module hash, patches outside of modules use key 0 and store the VA
+static std::unordered_map<duint, PATCHMODULE> patches;
 
-    // Don't patch anything if the new and old values are the same
-    if(OldByte == NewByte)
-        return true;
+static duint patchmodulekey(duint Address, duint* Base, duint* Size)
+{
+    SHARED_ACQUIRE(LockModules);
+    MODINFO* info = ModInfoFromAddr(Address);
+    if(!info)
+    {
+        *Base = 0;
+        *Size = 0;
+        return 0;
+    }
+    *Base = info->base;
+    *Size = info->size;
+    return info->hash;
+}
 
-    PATCHINFO newPatch;
-    newPatch.addr = Address - ModBaseFromAddr(Address);
-    newPatch.oldbyte = OldByte;
-    newPatch.newbyte = NewByte;
-    ModNameFromAddr(Address, newPatch.mod, true);
+static duint patchmodulebase(duint Key, const PATCHMODULE & Module)
+{
+    return Key ? ModBaseFromName(Module.mod) : 0;
+}
 
-    // Generate a key for this address
-    const duint key = ModHashFromAddr(Address);
+bool PatchSet(duint Address, unsigned char OldByte, unsigned char NewByte)
+{
+    return PatchSetRange(Address, &OldByte, &NewByte, 1);
+}
 
-    EXCLUSIVE_ACQUIRE(LockPatches);
+bool PatchSetRange(duint Address, const unsigned char* OldData, const unsigned char* NewData, duint Size)
+{
+    ASSERT_DEBUGGING("Export call");
 
-    // Find any patch with this specific address
-    auto found = patches.find(key);
+    // Address must be valid
+    if(!Size || !MemIsValidReadPtr(Address))
+        return false;
 
-    if(found != patches.end())
+    // A range that crosses a module boundary is stored per module
+    for(duint done = 0; done < Size;)
     {
-        if(found->second.oldbyte == NewByte)
+        duint address = Address + done;
+        duint base, size;
+        duint key = patchmodulekey(address, &base, &size);
+        duint count = Size - done;
+        if(key)
+            count = min(count, base + size - address);
+        else
         {
-            // The patch was undone here
-            patches.erase(found);
-            return true;
+            duint nextBase = ModBaseFromAddr(address + count - 1);
+            if(nextBase)
+                count = nextBase - address;
         }
 
-        // Keep the original byte from the previous patch
-        newPatch.oldbyte = found->second.oldbyte;
-        found->second = newPatch;
-    }
-    else
-    {
-        // The entry was never found, insert it
-        patches.insert(std::make_pair(key, newPatch));
-    }
+        EXCLUSIVE_ACQUIRE(LockPatches);
+        auto found = patches.find(key);
+        if(found == patches.end())
+        {
+            PATCHMODULE module;
+            *module.mod = '\0';
+            if(key)
+                ModNameFromAddr(address, module.mod, true);
+            found = patches.insert(std::make_pair(key, module)).first;
+        }
+        PatchSetExtent(found->second.extents, address - base, OldData + done, NewData + done, count);
+        if(found->second.extents.empty())
+            patches.erase(found);
+        EXCLUSIVE_RELEASE();
 
+        done += count;
+    }
     return true;
 }
 
 bool PatchGet(duint Address, PATCHINFO* Patch)
 {
     ASSERT_DEBUGGING("Export call");
+    duint base, size;
+    duint key = patchmodulekey(Address, &base, &size);
     SHARED_ACQUIRE(LockPatches);
 
-    // Find this specific address in the list
-    auto found = patches.find(ModHashFromAddr(Address));
-
-    if(found == patches.end())
+    // Find the extent that contains this address
+    auto module = patches.find(key);
+    if(module == patches.end())
+        return false;
+    auto found = PatchFindExtent(module->second.extents, Address - base);
+    if(found == module->second.extents.end())
         return false;
 
     // Did the user request an output buffer?
     if(Patch)
     {
-        *Patch = found->second;
-        Patch->addr += ModBaseFromAddr(Address);
+        duint offset = Address - base - found->first;
+        strcpy_s(Patch->mod, module->second.mod);
+        Patch->addr = Address;
+        Patch->oldbyte = found->second.oldbytes[offset];
+        Patch->newbyte = found->second.newbytes[offset];
     }
 
     // Return true because the patch was found
@@ -85,20 +121,9 @@ bool PatchGet(duint Address, PATCHINFO* Patch)
 bool PatchDelete(duint Address, bool Restore)
 {
     ASSERT_DEBUGGING("Export call");
-    EXCLUSIVE_ACQUIRE(LockPatches);
-
-    // Do a list lookup with hash
-    auto found = patches.find(ModHashFromAddr(Address));
-
-    if(found == patches.end())
+    if(!PatchGet(Address, nullptr))
         return false;
-
-    // Restore the original byte at this address
-    if(Restore)
-        MemWrite((found->second.addr + ModBaseFromAddr(Address)), &found->second.oldbyte, sizeof(char));
-
-    // Finally remove it from the list
-    patches.erase(found);
+    PatchDelRange(Address, Address + 1, Restore);
     return true;
 }
 
@@ -106,45 +131,80 @@ void PatchDelRange(duint Start, duint End, bool Restore)
 {
     ASSERT_DEBUGGING("Export call");
 
-    // Are all bookmarks going to be deleted?
+    // Are all patches going to be deleted?
     // 0x00000000 - 0xFFFFFFFF
     if(Start == 0 && End == ~0)
     {
         EXCLUSIVE_ACQUIRE(LockPatches);
         patches.clear();
+        return;
     }
-    else
+
+    // Module bases are resolved before the lock, they take LockModules
+    std::vector<std::pair<duint, duint>> bases;
+    {
+        SHARED_ACQUIRE(LockPatches);
+        for(auto & module : patches)
+            bases.push_back(std::make_pair(module.first, patchmodulebase(module.first, module.second)));
+    }
+
+    EXCLUSIVE_ACQUIRE(LockPatches);
+    for(auto & base : bases)
     {
-        // Make sure 'Start' and 'End' reference the same module
-        duint moduleBase = ModBaseFromAddr(Start);
+        auto found = patches.find(base.first);
+        if(found == patches.end() || (base.first && !base.second))
+            continue;
+        PatchDelExtents(found->second.extents, base.second, Start, End, [Restore](duint Address, const unsigned char* OldBytes, duint Size)
+        {
+            // Restore the original bytes if necessary
+            if(Restore)
+                MemWrite(Address, OldBytes, Size);
+        });
+        if(found->second.extents.empty())
+            patches.erase(found);
+    }
+}
 
-        if(moduleBase != ModBaseFromAddr(End))
-            return;
+bool PatchEnum(PATCHINFO* List, size_t* Size)
+{
+    ASSERT_DEBUGGING("Export call");
+    ASSERT_FALSE(!List && !Size);
+    SHARED_ACQUIRE(LockPatches);
 
-        // VA to RVA in module
-        Start -= moduleBase;
-        End -= moduleBase;
+    // Did the user request the size?
+    if(Size)
+    {
+        size_t count = 0;
+        for(auto & module : patches)
+            for(auto & extent : module.second.extents)
+                count += extent.second.newbytes.size();
+        *Size = count * sizeof(PATCHINFO);
 
-        EXCLUSIVE_ACQUIRE(LockPatches);
-        for(auto itr = patches.begin(); itr != patches.end();)
+        if(!List)
+            return true;
+    }
+
+    // Expand the extents to one entry per byte, the module base is resolved once per module
+    for(auto & module : patches)
+    {
+        duint base = patchmodulebase(module.first, module.second);
+        for(auto & extent : module.second.extents)
         {
-            const auto & currentPatch = itr->second;
-            // [Start, End)
-            if(currentPatch.addr >= Start && currentPatch.addr < End)
+            for(duint i = 0; i < extent.second.newbytes.size(); i++)
             {
-                // Restore the original byte if necessary
-                if(Restore)
-                    MemWrite((currentPatch.addr + moduleBase), &currentPatch.oldbyte, sizeof(char));
-
-                itr = patches.erase(itr);
+                strcpy_s(List->mod, module.second.mod);
+                List->addr = base + extent.first + i;
+                List->oldbyte = extent.second.oldbytes[i];
+                List->newbyte = extent.second.newbytes[i];
+                List++;
             }
-            else
-                ++itr;
         }
     }
+
+    return true;
 }
 
-bool PatchEnum(PATCHINFO* List, size_t* Size)
+bool PatchEnumRange(PATCHRANGE* List, size_t* Size)
 {
     ASSERT_DEBUGGING("Export call");
     ASSERT_FALSE(!List && !Size);
@@ -153,61 +213,76 @@ bool PatchEnum(PATCHINFO* List, size_t* Size)
     // Did the user request the size?
     if(Size)
     {
-        *Size = patches.size() * sizeof(PATCHINFO);
+        size_t count = 0;
+        for(auto & module : patches)
+            count += module.second.extents.size();
+        *Size = count * sizeof(PATCHRANGE);
 
         if(!List)
             return true;
     }
 
-    // Copy each vector entry to a C-style array
-    for(auto & itr : patches)
+    for(auto & module : patches)
     {
-        *List = itr.second;
-        List->addr += ModBaseFromName(itr.second.mod);;
-        List++;
+        duint base = patchmodulebase(module.first, module.second);
+        for(auto & extent : module.second.extents)
+        {
+            strcpy_s(List->mod, module.second.mod);
+            List->addr = base + extent.first;
+            List->size = extent.second.newbytes.size();
+            List++;
+        }
     }
 
     return true;
 }
 
-int PatchFile(const PATCHINFO* List, int Count, const char* FileName, char* Error)
+bool PatchGetRange(duint Address, duint Size, unsigned char* OldBytes, unsigned char* NewBytes)
 {
-    //
-    // This function returns an int based on the number
-    // of patches applied. -1 indicates a failure.
-    //
-    if(Count <= 0)
-    {
-        // Notify the user of the error
-        if(Error)
-            strcpy_s(Error, MAX_ERROR_SIZE, "No patches to apply");
+    ASSERT_DEBUGGING("Export call");
+    duint base, size;
+    duint key = patchmodulekey(Address, &base, &size);
+    SHARED_ACQUIRE(LockPatches);
 
-        return -1;
-    }
+    auto module = patches.find(key);
+    if(module == patches.end())
+        return false;
 
-    // Get a copy of the first module name in the array
-    char moduleName[MAX_MODULE_SIZE];
-    strcpy_s(moduleName, List[0].mod);
+    // Touching extents are merged, so a range of patched bytes is always part of a single extent
+    duint rva = Address - base;
+    auto found = PatchFindExtent(module->second.extents, rva);
+    if(found == module->second.extents.end())
+        return false;
+    duint offset = rva - found->first;
+    if(Size > found->second.newbytes.size() - offset)
+        return false;
 
-    // Check if all patches are in the same module
-    for(int i = 0; i < Count; i++)
-    {
-        if(_stricmp(List[i].mod, moduleName))
-        {
-            if(Error)
-                sprintf_s(Error, MAX_ERROR_SIZE, "Not all patches are in module %s", moduleName);
+    if(OldBytes)
+        memcpy(OldBytes, found->second.oldbytes.data() + offset, Size);
+    if(NewBytes)
+        memcpy(NewBytes, found->second.newbytes.data() + offset, Size);
+    return true;
+}
 
-            return -1;
-        }
-    }
+struct PATCHFILEEXTENT
+{
+    duint addr;
+    duint size;
+    const unsigned char* bytes;
+};
 
+/**
+\brief Writes extents of new bytes to a copy of a module. Returns the number of bytes written, -1 on failure.
+*/
+static int patchfile(const char* ModuleName, const std::vector<PATCHFILEEXTENT> & Extents, const char* FileName, char* Error)
+{
     // See if the module was loaded
-    duint moduleBase = ModBaseFromName(moduleName);
+    duint moduleBase = ModBaseFromName(ModuleName);
 
     if(!moduleBase)
     {
         if(Error)
-            sprintf_s(Error, MAX_ERROR_SIZE, "Failed to get base of module %s", moduleName);
+            sprintf_s(Error, MAX_ERROR_SIZE, "Failed to get base of module %s", ModuleName);
 
         return -1;
     }
@@ -217,7 +292,7 @@ int PatchFile(const PATCHINFO* List, int Count, const char* FileName, char* Erro
     if(!ModPathFromAddr(moduleBase, modPath, MAX_PATH))
     {
         if(Error)
-            sprintf_s(Error, MAX_ERROR_SIZE, "Failed to get module path of module %s", moduleName);
+            sprintf_s(Error, MAX_ERROR_SIZE, "Failed to get module path of module %s", ModuleName);
 
         return -1;
     }
@@ -237,24 +312,72 @@ int PatchFile(const PATCHINFO* List, int Count, const char* FileName, char* Erro
     ULONG_PTR fileMapVa;
     if(!StaticFileLoadW(StringUtils::Utf8ToUtf16(FileName).c_str(), UE_ACCESS_ALL, false, &fileHandle, &loadedSize, &fileMap, &fileMapVa))
     {
-        strcpy_s(Error, MAX_ERROR_SIZE, "StaticFileLoad failed");
+        if(Error)
+            strcpy_s(Error, MAX_ERROR_SIZE, "StaticFileLoad failed");
         return -1;
     }
 
-    // Begin iterating all patches, applying them to a file
+    // Section table of the file, so every section is translated to a file offset only once
+    PIMAGE_SECTION_HEADER sections = nullptr;
+    WORD sectionCount = 0;
+    auto dosHeader = PIMAGE_DOS_HEADER(fileMapVa);
+    if(loadedSize >= sizeof(IMAGE_DOS_HEADER) && dosHeader->e_magic == IMAGE_DOS_SIGNATURE && dosHeader->e_lfanew > 0 && duint(dosHeader->e_lfanew) + sizeof(IMAGE_NT_HEADERS) <= loadedSize)
+    {
+        auto ntHeaders = PIMAGE_NT_HEADERS(fileMapVa + dosHeader->e_lfanew);
+        sections = IMAGE_FIRST_SECTION(ntHeaders);
+        sectionCount = ntHeaders->FileHeader.NumberOfSections;
+        if(ntHeaders->Signature != IMAGE_NT_SIGNATURE || ULONG_PTR(sections + sectionCount) > fileMapVa + loadedSize)
+            sectionCount = 0;
+    }
+
+    // Begin iterating all extents, applying them to a file
     int patchCount = 0;
+    duint rangeStart = 0; // Cached RVA range [rangeStart, rangeEnd) with its raw offset
+    duint rangeEnd = 0;
+    duint rangeOffset = 0;
 
-    for(int i = 0; i < Count; i++)
+    for(const auto & extent : Extents)
     {
-        // Convert the virtual address to an offset within disk file data
-        unsigned char* ptr = (unsigned char*)ConvertVAtoFileOffsetEx(fileMapVa, loadedSize, moduleBase, List[i].addr, false, true);
+        for(duint done = 0; done < extent.size;)
+        {
+            duint rva = extent.addr + done - moduleBase;
+            if(rva < rangeStart || rva >= rangeEnd)
+            {
+                // Find the raw data of the section that contains the patch
+                rangeStart = rangeEnd = 0;
+                for(WORD j = 0; j < sectionCount; j++)
+                {
+                    duint start = sections[j].VirtualAddress;
+                    duint rawSize = sections[j].SizeOfRawData;
+                    if(rva >= start && rva < start + rawSize && sections[j].PointerToRawData + rawSize <= loadedSize)
+                    {
+                        rangeStart = start;
+                        rangeEnd = start + rawSize;
+                        rangeOffset = sections[j].PointerToRawData;
+                        break;
+                    }
+                }
+            }
 
-        // Skip patches that do not have a raw address
-        if(!ptr)
-            continue;
+            if(rva >= rangeStart && rva < rangeEnd)
+            {
+                // Copy everything up to the end of the section at once
+                duint count = min(extent.size - done, rangeEnd - rva);
+                memcpy((unsigned char*)(fileMapVa + rangeOffset + (rva - rangeStart)), extent.bytes + done, count);
+                patchCount += int(count);
+                done += count;
+                continue;
+            }
 
-        *ptr = List[i].newbyte;
-        patchCount++;
+            // Headers and unusual layouts are left to the generic conversion, bytes without a raw address are skipped
+            auto ptr = (unsigned char*)ConvertVAtoFileOffsetEx(fileMapVa, loadedSize, moduleBase, extent.addr + done, false, true);
+            if(ptr)
+            {
+                *ptr = extent.bytes[done];
+                patchCount++;
+            }
+            done++;
+        }
     }
 
     // Unload the file from memory and commit changes to disk
@@ -273,6 +396,88 @@ int PatchFile(const PATCHINFO* List, int Count, const char* FileName, char* Erro
     return patchCount;
 }
 
+template<typename T>
+static bool patchfilemodule(const T* List, int Count, char* ModuleName, char* Error)
+{
+    if(Count <= 0)
+    {
+        // Notify the user of the error
+        if(Error)
+            strcpy_s(Error, MAX_ERROR_SIZE, "No patches to apply");
+
+        return false;
+    }
+
+    // Get a copy of the first module name in the array
+    strcpy_s(ModuleName, MAX_MODULE_SIZE, List[0].mod);
+
+    // Check if all patches are in the same module
+    for(int i = 0; i < Count; i++)
+    {
+        if(_stricmp(List[i].mod, ModuleName))
+        {
+            if(Error)
+                sprintf_s(Error, MAX_ERROR_SIZE, "Not all patches are in module %s", ModuleName);
+
+            return false;
+        }
+    }
+    return true;
+}
+
+int PatchFile(const PATCHINFO* List, int Count, const char* FileName, char* Error)
+{
+    //
+    // This function returns an int based on the number
+    // of patches applied. -1 indicates a failure.
+    //
+    char moduleName[MAX_MODULE_SIZE];
+    if(!patchfilemodule(List, Count, moduleName, Error))
+        return -1;
+
+    // Every byte is an extent of its own
+    std::vector<PATCHFILEEXTENT> extents(Count);
+    for(int i = 0; i < Count; i++)
+    {
+        extents[i].addr = List[i].addr;
+        extents[i].size = 1;
+        extents[i].bytes = &List[i].newbyte;
+    }
+    return patchfile(moduleName, extents, FileName, Error);
+}
+
+int PatchFileRange(const PATCHRANGE* List, int Count, const char* FileName, char* Error)
+{
+    //
+    // This function returns the number of bytes
+    // written. -1 indicates a failure.
+    //
+    char moduleName[MAX_MODULE_SIZE];
+    if(!patchfilemodule(List, Count, moduleName, Error))
+        return -1;
+
+    // The new bytes come from the patch store, ranges that are no longer patched are skipped
+    duint total = 0;
+    for(int i = 0; i < Count; i++)
+        total += List[i].size;
+    std::vector<unsigned char> bytes(total);
+    std::vector<PATCHFILEEXTENT> extents;
+    extents.reserve(Count);
+    duint offset = 0;
+    for(int i = 0; i < Count; i++)
+    {
+        if(!PatchGetRange(List[i].addr, List[i].size, nullptr, bytes.data() + offset))
+            continue;
+        PATCHFILEEXTENT extent;
+        extent.addr = List[i].addr;
+        extent.size = List[i].size;
+        extent.bytes = bytes.data() + offset;
+        extents.push_back(extent);
+        offset += List[i].size;
+    }
+    return patchfile(moduleName, extents, FileName, Error);
+}
+
 void PatchClear(const char* Module)
 {
     EXCLUSIVE_ACQUIRE(LockPatches);
@@ -285,8 +490,7 @@ void PatchClear(const char* Module)
     }
     else
     {
-        // Otherwise iterate over each patch and check the owner
-        // module for the address
+        // Otherwise iterate over each patched module and check its name
         for(auto itr = patches.begin(); itr != patches.end();)
         {
             if(!_stricmp(itr->second.mod, Module))
@@ -295,4 +499,4 @@ void PatchClear(const char* Module)
                 ++itr;
         }
     }
-}
\ No newline at end of file
+}
@@ -10,10 +10,21 @@ struct PATCHINFO
     unsigned char newbyte;
 };
 
+struct PATCHRANGE
+{
+    char mod[MAX_MODULE_SIZE];
+    duint addr;
+    duint size;
+};
+
 bool PatchSet(duint Address, unsigned char OldByte, unsigned char NewByte);
+bool PatchSetRange(duint Address, const unsigned char* OldData, const unsigned char* NewData, duint Size);
 bool PatchGet(duint Address, PATCHINFO* Patch);
+bool PatchGetRange(duint Address, duint Size, unsigned char* OldBytes, unsigned char* NewBytes);
 bool PatchDelete(duint Address, bool Restore);
 void PatchDelRange(duint Start, duint End, bool Restore);
 bool PatchEnum(PATCHINFO* List, size_t* Size);
+bool PatchEnumRange(PATCHRANGE* List, size_t* Size);
 int PatchFile(const PATCHINFO* List, int Count, const char* FileName, char* Error);
+int PatchFileRange(const PATCHRANGE* List, int Count, const char* FileName, char* Error);
 void PatchClear(const char* Module = nullptr);
\ No newline at end of file
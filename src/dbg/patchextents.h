@@ -0,0 +1,145 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <iterator>
+#include <utility>
+
+/**
+\brief Contiguous patched bytes of a module.
+*/
+struct PatchExtent
+{
+    std::vector<unsigned char> oldbytes;
+    std::vector<unsigned char> newbytes;
+};
+
+/**
+\brief Finds the extent that contains Rva. This header does not depend on the Windows types, so it can be tested on its own.
+\return Extents.end() if Rva is not patched.
+*/
+template<typename Address>
+typename std::map<Address, PatchExtent>::iterator PatchFindExtent(std::map<Address, PatchExtent> & Extents, Address Rva)
+{
+    // Last extent that starts at or before Rva
+    auto found = Extents.upper_bound(Rva);
+    if(found == Extents.begin())
+        return Extents.end();
+    --found;
+    if(Rva - found->first >= found->second.newbytes.size())
+        return Extents.end();
+    return found;
+}
+
+/**
+\brief Patches [Rva, Rva + Size). The extents that overlap or touch the range are merged with it, the original bytes of existing patches are kept. Bytes that are back to their original value are removed and split their extent.
+*/
+template<typename Address>
+void PatchSetExtent(std::map<Address, PatchExtent> & Extents, Address Rva, const unsigned char* OldData, const unsigned char* NewData, Address Size)
+{
+    Address start = Rva;
+    Address end = Rva + Size;
+
+    // Collect the extents that overlap or touch [start, end)
+    auto first = Extents.upper_bound(start);
+    if(first != Extents.begin())
+    {
+        auto previous = std::prev(first);
+        if(previous->first + previous->second.newbytes.size() >= start)
+            first = previous;
+    }
+    auto last = first;
+    Address mergedStart = start;
+    Address mergedEnd = end;
+    for(; last != Extents.end() && last->first <= end; ++last)
+    {
+        Address extentEnd = last->first + last->second.newbytes.size();
+        if(last->first < mergedStart)
+            mergedStart = last->first;
+        if(extentEnd > mergedEnd)
+            mergedEnd = extentEnd;
+    }
+
+    // Merge them into one buffer
+    Address mergedSize = mergedEnd - mergedStart;
+    std::vector<unsigned char> oldBytes(mergedSize);
+    std::vector<unsigned char> newBytes(mergedSize);
+    std::vector<bool> patched(mergedSize, false);
+    for(auto itr = first; itr != last; ++itr)
+    {
+        Address offset = itr->first - mergedStart;
+        for(Address i = 0; i < itr->second.newbytes.size(); i++)
+        {
+            oldBytes[offset + i] = itr->second.oldbytes[i];
+            newBytes[offset + i] = itr->second.newbytes[i];
+            patched[offset + i] = true;
+        }
+    }
+    for(Address i = 0; i < Size; i++)
+    {
+        Address offset = start - mergedStart + i;
+        if(!patched[offset])
+            oldBytes[offset] = OldData[i];
+        newBytes[offset] = NewData[i];
+        patched[offset] = true;
+    }
+    Extents.erase(first, last);
+
+    // Bytes that are back to their original value split the extent
+    for(Address i = 0; i < mergedSize;)
+    {
+        if(!patched[i] || oldBytes[i] == newBytes[i])
+        {
+            i++;
+            continue;
+        }
+        Address runStart = i;
+        while(i < mergedSize && patched[i] && oldBytes[i] != newBytes[i])
+            i++;
+        PatchExtent & extent = Extents[mergedStart + runStart];
+        extent.oldbytes.assign(oldBytes.begin() + runStart, oldBytes.begin() + i);
+        extent.newbytes.assign(newBytes.begin() + runStart, newBytes.begin() + i);
+    }
+}
+
+/**
+\brief Deletes the patched bytes in [Start, End), the parts of an extent outside of the range are kept.
+\param Base The address of RVA 0.
+\param Restore Called as Restore(Address, OldBytes, Size) for every deleted part, to write the original bytes back.
+*/
+template<typename Address, typename RestoreProc>
+void PatchDelExtents(std::map<Address, PatchExtent> & Extents, Address Base, Address Start, Address End, RestoreProc Restore)
+{
+    for(auto itr = Extents.begin(); itr != Extents.end();)
+    {
+        Address extentStart = Base + itr->first;
+        Address extentEnd = extentStart + itr->second.newbytes.size();
+        if(extentEnd <= Start || extentStart >= End)
+        {
+            ++itr;
+            continue;
+        }
+
+        Address deleteStart = extentStart > Start ? extentStart : Start;
+        Address deleteEnd = extentEnd < End ? extentEnd : End;
+        PatchExtent extent = std::move(itr->second);
+        itr = Extents.erase(itr);
+
+        Restore(deleteStart, extent.oldbytes.data() + (deleteStart - extentStart), deleteEnd - deleteStart);
+
+        // Keep the parts outside of the range
+        if(extentStart < deleteStart)
+        {
+            PatchExtent & head = Extents[extentStart - Base];
+            head.oldbytes.assign(extent.oldbytes.begin(), extent.oldbytes.begin() + (deleteStart - extentStart));
+            head.newbytes.assign(extent.newbytes.begin(), extent.newbytes.begin() + (deleteStart - extentStart));
+        }
+        if(deleteEnd < extentEnd)
+        {
+            PatchExtent & tail = Extents[deleteEnd - Base];
+            tail.oldbytes.assign(extent.oldbytes.begin() + (deleteEnd - extentStart), extent.oldbytes.end());
+            tail.newbytes.assign(extent.newbytes.begin() + (deleteEnd - extentStart), extent.newbytes.end());
+            itr = Extents.upper_bound(deleteEnd - Base);
+        }
+    }
+}
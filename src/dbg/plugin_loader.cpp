@@ -24,6 +24,15 @@ static int curPluginHandle = 0;
 */
 static std::vector<PLUG_CALLBACK> pluginCallbackList;
 
+#define CB_COUNT (CB_WINEVENTGLOBAL + 1)
+
+typedef std::shared_ptr<const std::vector<PLUG_CALLBACK>> PLUG_CALLBACK_ARRAY;
+
+/**
+\brief Immutable snapshot of the callbacks per CBTYPE. The snapshots are replaced atomically when a callback is (un)registered, so plugincbcall() never has to lock or copy.
+*/
+static PLUG_CALLBACK_ARRAY pluginCallbacks[CB_COUNT];
+
 /**
 \brief List of plugin commands.
 */
@@ -321,6 +330,8 @@ void pluginunload()
     {
         EXCLUSIVE_ACQUIRE(LockPluginCallbackList);
         pluginCallbackList.clear(); //remove all callbacks
+        for(int i = 0; i < CB_COUNT; i++)
+            std::atomic_store(&pluginCallbacks[i], PLUG_CALLBACK_ARRAY());
     }
     {
         EXCLUSIVE_ACQUIRE(LockPluginMenuList);
@@ -334,6 +345,22 @@ void pluginunload()
     GuiMenuClear(GUI_PLUGIN_MENU); //clear the plugin menu
 }
 
+/**
+\brief Publishes a new snapshot of the callbacks of a certain type. The caller must hold LockPluginCallbackList exclusively.
+\param cbType The type of the callbacks to publish.
+*/
+static void pluginpublishcallbacks(CBTYPE cbType)
+{
+    auto callbacks = std::make_shared<std::vector<PLUG_CALLBACK>>();
+    for(const auto & currentCallback : pluginCallbackList)
+        if(currentCallback.cbType == cbType)
+            callbacks->push_back(currentCallback);
+    PLUG_CALLBACK_ARRAY published;
+    if(!callbacks->empty())
+        published = callbacks;
+    std::atomic_store(&pluginCallbacks[cbType], published);
+}
+
 /**
 \brief Register a plugin callback.
 \param pluginHandle Handle of the plugin to register a callback for.
@@ -342,13 +369,19 @@ void pluginunload()
 */
 void pluginregistercallback(int pluginHandle, CBTYPE cbType, CBPLUGIN cbPlugin)
 {
+    if(cbType < 0 || cbType >= CB_COUNT || !cbPlugin)
+        return;
     pluginunregistercallback(pluginHandle, cbType); //remove previous callback
     PLUG_CALLBACK cbStruct;
     cbStruct.pluginHandle = pluginHandle;
     cbStruct.cbType = cbType;
     cbStruct.cbPlugin = cbPlugin;
+    cbStruct.stats = std::make_shared<PLUG_CALLBACK_STATS>();
+    cbStruct.stats->calls = 0;
+    cbStruct.stats->ticks = 0;
     EXCLUSIVE_ACQUIRE(LockPluginCallbackList);
     pluginCallbackList.push_back(cbStruct);
+    pluginpublishcallbacks(cbType);
 }
 
 /**
@@ -365,6 +398,7 @@ bool pluginunregistercallback(int pluginHandle, CBTYPE cbType)
         if(currentCallback.pluginHandle == pluginHandle && currentCallback.cbType == cbType)
         {
             pluginCallbackList.erase(it);
+            pluginpublishcallbacks(cbType);
             return true;
         }
     }
@@ -378,17 +412,54 @@ bool pluginunregistercallback(int pluginHandle, CBTYPE cbType)
 */
 void plugincbcall(CBTYPE cbType, void* callbackInfo)
 {
+    if(cbType < 0 || cbType >= CB_COUNT)
+        return;
+    //the snapshot stays alive until this call is done, even if a callback is unregistered meanwhile
+    auto callbacks = std::atomic_load(&pluginCallbacks[cbType]);
+    if(!callbacks)
+        return;
+    for(const auto & currentCallback : *callbacks)
+    {
+        LARGE_INTEGER start, end;
+        QueryPerformanceCounter(&start);
+        currentCallback.cbPlugin(cbType, callbackInfo);
+        QueryPerformanceCounter(&end);
+        InterlockedIncrement64(&currentCallback.stats->calls);
+        InterlockedExchangeAdd64(&currentCallback.stats->ticks, end.QuadPart - start.QuadPart);
+    }
+}
+
+/**
+\brief Prints the number of calls and the time spent in every registered plugin callback.
+*/
+void plugincbstats()
+{
+    static const char* cbNames[CB_COUNT] =
+    {
+        "CB_INITDEBUG", "CB_STOPDEBUG", "CB_CREATEPROCESS", "CB_EXITPROCESS", "CB_CREATETHREAD", "CB_EXITTHREAD",
+        "CB_SYSTEMBREAKPOINT", "CB_LOADDLL", "CB_UNLOADDLL", "CB_OUTPUTDEBUGSTRING", "CB_EXCEPTION", "CB_BREAKPOINT",
+        "CB_PAUSEDEBUG", "CB_RESUMEDEBUG", "CB_STEPPED", "CB_ATTACH", "CB_DETACH", "CB_DEBUGEVENT", "CB_MENUENTRY",
+        "CB_WINEVENT", "CB_WINEVENTGLOBAL"
+    };
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    std::unordered_map<int, String> pluginNames;
+    {
+        SHARED_ACQUIRE(LockPluginList);
+        for(const auto & currentPlugin : pluginList)
+            pluginNames[currentPlugin.initStruct.pluginHandle] = currentPlugin.initStruct.pluginName;
+    }
     SHARED_ACQUIRE(LockPluginCallbackList);
-    auto callbackList = pluginCallbackList; //copy for thread-safety reasons
-    SHARED_RELEASE();
-    for(const auto & currentCallback : callbackList)
+    for(const auto & currentCallback : pluginCallbackList)
     {
-        if(currentCallback.cbType == cbType)
-        {
-            CBPLUGIN cbPlugin = currentCallback.cbPlugin;
-            if(!IsBadReadPtr((const void*)cbPlugin, sizeof(duint)))
-                cbPlugin(cbType, callbackInfo);
-        }
+        LONGLONG calls = currentCallback.stats->calls;
+        double totalms = double(currentCallback.stats->ticks) * 1000.0 / double(frequency.QuadPart);
+        dprintf("%s: %s, %lld calls, %.3fms total, %.3fus average\n",
+                pluginNames[currentCallback.pluginHandle].c_str(),
+                cbNames[currentCallback.cbType],
+                calls,
+                totalms,
+                calls ? totalms * 1000.0 / double(calls) : 0.0);
     }
 }
 
@@ -575,16 +646,14 @@ void pluginmenucall(int hEntry)
         {
             PLUG_CB_MENUENTRY menuEntryInfo;
             menuEntryInfo.hEntry = currentMenu.hEntryPlugin;
-            SectionLocker<LockPluginCallbackList, true> callbackLock; //shared lock
-            auto j = pluginCallbackList.begin();
-            while(j != pluginCallbackList.end())
+            auto callbacks = std::atomic_load(&pluginCallbacks[CB_MENUENTRY]);
+            if(!callbacks)
+                return;
+            for(const auto & currentCallback : *callbacks)
             {
-                const auto currentCallback = *j;
-                ++j;
-                if(currentCallback.pluginHandle == currentMenu.pluginHandle && currentCallback.cbType == CB_MENUENTRY)
+                if(currentCallback.pluginHandle == currentMenu.pluginHandle)
                 {
                     menuLock.Unlock();
-                    callbackLock.Unlock();
                     currentCallback.cbPlugin(CB_MENUENTRY, &menuEntryInfo);
                     return;
                 }
@@ -3,6 +3,7 @@
 
 #include "_global.h"
 #include "_plugins.h"
+#include <memory>
 
 //typedefs
 typedef bool (*PLUGINIT)(PLUG_INITSTRUCT* initStruct);
@@ -30,11 +31,18 @@ struct PLUG_DATA
     PLUG_INITSTRUCT initStruct;
 };
 
+struct PLUG_CALLBACK_STATS
+{
+    volatile LONGLONG calls;
+    volatile LONGLONG ticks; //QueryPerformanceCounter ticks spent in the callback
+};
+
 struct PLUG_CALLBACK
 {
     int pluginHandle;
     CBTYPE cbType;
     CBPLUGIN cbPlugin;
+    std::shared_ptr<PLUG_CALLBACK_STATS> stats;
 };
 
 struct PLUG_COMMAND
@@ -49,6 +57,7 @@ void pluginunload();
 void pluginregistercallback(int pluginHandle, CBTYPE cbType, CBPLUGIN cbPlugin);
 bool pluginunregistercallback(int pluginHandle, CBTYPE cbType);
 void plugincbcall(CBTYPE cbType, void* callbackInfo);
+void plugincbstats();
 bool plugincmdregister(int pluginHandle, const char* command, CBPLUGINCOMMAND cbCommand, bool debugonly);
 bool plugincmdunregister(int pluginHandle, const char* command);
 int pluginmenuadd(int hMenu, const char* title);
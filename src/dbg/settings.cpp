@@ -0,0 +1,112 @@
+/**
+ @file settings.cpp
+
+ @brief Typed cache of the bridge settings that are read on hot paths.
+ */
+
+#include "settings.h"
+#include "threading.h"
+
+struct SETTINGENTRY
+{
+    String section;
+    String key;
+    duint defaultValue;
+    volatile duint value;
+};
+
+static SETTINGENTRY settingEntries[MAX_SETTINGS];
+static volatile LONG settingCount = 0;
+
+static void settingadd(SETTINGHANDLE Handle, const char* Section, const char* Key, duint Default)
+{
+    SETTINGENTRY & entry = settingEntries[Handle];
+    entry.section = Section;
+    entry.key = Key;
+    entry.defaultValue = Default;
+    entry.value = Default;
+}
+
+static void settingload(SETTINGENTRY & Entry)
+{
+    duint value;
+    if(!BridgeSettingGetUint(Entry.section.c_str(), Entry.key.c_str(), &value))
+        value = Entry.defaultValue;
+    Entry.value = value;
+}
+
+static void cbSettingChanged(const char* Section, const char* Key)
+{
+    // Only the entries of the changed key (or section) are loaded again
+    SHARED_ACQUIRE(LockSettings);
+    for(LONG i = 0; i < settingCount; i++)
+    {
+        SETTINGENTRY & entry = settingEntries[i];
+        if(Section && entry.section != Section)
+            continue;
+        if(Key && entry.key != Key)
+            continue;
+        settingload(entry);
+    }
+}
+
+void SettingInit()
+{
+    EXCLUSIVE_ACQUIRE(LockSettings);
+    if(settingCount)
+        return;
+    settingadd(SettingEventsSystemBreakpoint, "Events", "SystemBreakpoint", 0);
+    settingadd(SettingEventsAttachBreakpoint, "Events", "AttachBreakpoint", 0);
+    settingadd(SettingEventsTlsCallbacks, "Events", "TlsCallbacks", 0);
+    settingadd(SettingEventsEntryBreakpoint, "Events", "EntryBreakpoint", 0);
+    settingadd(SettingEventsDllEntry, "Events", "DllEntry", 0);
+    settingadd(SettingEventsDllLoad, "Events", "DllLoad", 0);
+    settingadd(SettingEventsDllUnload, "Events", "DllUnload", 0);
+    settingadd(SettingEventsThreadEntry, "Events", "ThreadEntry", 0);
+    settingadd(SettingEventsThreadStart, "Events", "ThreadStart", 0);
+    settingadd(SettingEventsThreadEnd, "Events", "ThreadEnd", 0);
+    settingadd(SettingEventsDebugStrings, "Events", "DebugStrings", 0);
+    settingadd(SettingEngineDisableDatabaseCompression, "Engine", "DisableDatabaseCompression", 0);
+    settingadd(SettingEngineSaveDatabaseInProgramDirectory, "Engine", "SaveDatabaseInProgramDirectory", 0);
+    settingadd(SettingEngineIndentDatabase, "Engine", "IndentDatabase", 0);
+    settingadd(SettingEngineAutoAnalyse, "Engine", "AutoAnalyse", 0);
+    for(int i = 0; i < SettingLast; i++)
+        settingload(settingEntries[i]);
+    settingCount = SettingLast;
+    EXCLUSIVE_RELEASE();
+
+    // Every BridgeSettingSet (from the GUI or the debugger) updates the cached values
+    BridgeSettingAddCallback(cbSettingChanged);
+}
+
+SETTINGHANDLE SettingRegister(const char* Section, const char* Key, duint Default)
+{
+    if(!Section || !Key)
+        return -1;
+    EXCLUSIVE_ACQUIRE(LockSettings);
+    for(LONG i = 0; i < settingCount; i++)
+    {
+        if(settingEntries[i].section == Section && settingEntries[i].key == Key)
+            return i;
+    }
+    if(settingCount >= MAX_SETTINGS)
+        return -1;
+    SETTINGHANDLE handle = settingCount;
+    settingadd(handle, Section, Key, Default);
+    settingload(settingEntries[handle]);
+    settingCount = handle + 1;
+    return handle;
+}
+
+duint SettingGetUint(SETTINGHANDLE Handle)
+{
+    // No lock, the handle is valid for the lifetime of the debugger and the value is a single load
+    if(Handle < 0 || Handle >= MAX_SETTINGS)
+        return 0;
+    return settingEntries[Handle].value;
+}
+
+bool SettingGetBool(SETTINGHANDLE Handle)
+{
+    return SettingGetUint(Handle) != 0;
+}
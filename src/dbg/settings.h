@@ -0,0 +1,33 @@
+#pragma once
+
+#include "_global.h"
+
+// Settings that are read on hot paths, registered by SettingInit
+enum SETTINGID
+{
+    SettingEventsSystemBreakpoint,
+    SettingEventsAttachBreakpoint,
+    SettingEventsTlsCallbacks,
+    SettingEventsEntryBreakpoint,
+    SettingEventsDllEntry,
+    SettingEventsDllLoad,
+    SettingEventsDllUnload,
+    SettingEventsThreadEntry,
+    SettingEventsThreadStart,
+    SettingEventsThreadEnd,
+    SettingEventsDebugStrings,
+    SettingEngineDisableDatabaseCompression,
+    SettingEngineSaveDatabaseInProgramDirectory,
+    SettingEngineIndentDatabase,
+    SettingEngineAutoAnalyse,
+    SettingLast
+};
+
+#define MAX_SETTINGS 256
+
+typedef int SETTINGHANDLE;
+
+void SettingInit();
+SETTINGHANDLE SettingRegister(const char* Section, const char* Key, duint Default = 0);
+duint SettingGetUint(SETTINGHANDLE Handle);
+bool SettingGetBool(SETTINGHANDLE Handle);
@@ -9,9 +9,40 @@
 #include "variable.h"
 #include "x64_dbg.h"
 #include "debugger.h"
+#include "commandparser.h"
+
+enum SCRIPTOPCODE
+{
+    opnone, //empty line, comment or label
+    opret,
+    opinvalid,
+    oppause,
+    opnop,
+    opcommand,
+    opbranch
+};
+
+struct SCRIPTINSTRUCTION
+{
+    SCRIPTOPCODE opcode;
+    SCRIPTBRANCHTYPE branchtype;
+    int labelline; //line of the branch label (1-based)
+    duint generation; //command registry generation of the binding (0 = not bound)
+    CBCOMMAND cbCommand;
+    bool debugonly;
+    bool isvar;
+    bool formatted; //bound through specialformat (x=y -> mov x,y), which depends on the debuggee state
+    std::vector<String> args; //formatted command (argv[0]) and the pre-split arguments
+    std::vector<char> argdata; //writable deflen buffers for the arguments
+    std::vector<char*> argv;
+};
+
+#define SCRIPT_YIELD_LINES 1000 //lines executed between two sleeps of the run loop, a sleep per line caps scripts at the timer resolution
 
 static std::vector<LINEMAPENTRY> linemap;
 
+static std::vector<SCRIPTINSTRUCTION> scriptcode;
+
 static std::vector<SCRIPTBP> scriptbplist;
 
 static std::vector<int> scriptstack;
@@ -24,26 +55,28 @@ static bool volatile bIsRunning = false;
 
 static SCRIPTBRANCHTYPE scriptgetbranchtype(const char* text)
 {
-    char newtext[MAX_SCRIPT_LINE_SIZE] = "";
-    strcpy_s(newtext, StringUtils::Trim(text).c_str());
-    if(!strstr(newtext, " "))
-        strcat(newtext, " ");
-    if(!strncmp(newtext, "jmp ", 4) || !strncmp(newtext, "goto ", 5))
-        return scriptjmp;
-    else if(!strncmp(newtext, "jbe ", 4) || !strncmp(newtext, "ifbe ", 5) || !strncmp(newtext, "ifbeq ", 6) || !strncmp(newtext, "jle ", 4) || !strncmp(newtext, "ifle ", 5) || !strncmp(newtext, "ifleq ", 6))
-        return scriptjbejle;
-    else if(!strncmp(newtext, "jae ", 4) || !strncmp(newtext, "ifae ", 5) || !strncmp(newtext, "ifaeq ", 6) || !strncmp(newtext, "jge ", 4) || !strncmp(newtext, "ifge ", 5) || !strncmp(newtext, "ifgeq ", 6))
-        return scriptjaejge;
-    else if(!strncmp(newtext, "jne ", 4) || !strncmp(newtext, "ifne ", 5) || !strncmp(newtext, "ifneq ", 6) || !strncmp(newtext, "jnz ", 4) || !strncmp(newtext, "ifnz ", 5))
-        return scriptjnejnz;
-    else if(!strncmp(newtext, "je ", 3)  || !strncmp(newtext, "ife ", 4) || !strncmp(newtext, "ifeq ", 5) || !strncmp(newtext, "jz ", 3) || !strncmp(newtext, "ifz ", 4))
-        return scriptjejz;
-    else if(!strncmp(newtext, "jb ", 3) || !strncmp(newtext, "ifb ", 4) || !strncmp(newtext, "jl ", 3) || !strncmp(newtext, "ifl ", 4))
-        return scriptjbjl;
-    else if(!strncmp(newtext, "ja ", 3) || !strncmp(newtext, "ifa ", 4) || !strncmp(newtext, "jg ", 3) || !strncmp(newtext, "ifg ", 4))
-        return scriptjajg;
-    else if(!strncmp(newtext, "call ", 5))
-        return scriptcall;
+    static const struct
+    {
+        const char* name;
+        SCRIPTBRANCHTYPE type;
+    } branches[] =
+    {
+        { "jmp", scriptjmp }, { "goto", scriptjmp },
+        { "jbe", scriptjbejle }, { "ifbe", scriptjbejle }, { "ifbeq", scriptjbejle }, { "jle", scriptjbejle }, { "ifle", scriptjbejle }, { "ifleq", scriptjbejle },
+        { "jae", scriptjaejge }, { "ifae", scriptjaejge }, { "ifaeq", scriptjaejge }, { "jge", scriptjaejge }, { "ifge", scriptjaejge }, { "ifgeq", scriptjaejge },
+        { "jne", scriptjnejnz }, { "ifne", scriptjnejnz }, { "ifneq", scriptjnejnz }, { "jnz", scriptjnejnz }, { "ifnz", scriptjnejnz },
+        { "je", scriptjejz }, { "ife", scriptjejz }, { "ifeq", scriptjejz }, { "jz", scriptjejz }, { "ifz", scriptjejz },
+        { "jb", scriptjbjl }, { "ifb", scriptjbjl }, { "jl", scriptjbjl }, { "ifl", scriptjbjl },
+        { "ja", scriptjajg }, { "ifa", scriptjajg }, { "jg", scriptjajg }, { "ifg", scriptjajg },
+        { "call", scriptcall }
+    };
+    String newtext = StringUtils::Trim(text);
+    size_t len = newtext.find(' ');
+    if(len == String::npos)
+        len = newtext.length();
+    for(const auto & branch : branches)
+        if(strlen(branch.name) == len && !strncmp(newtext.c_str(), branch.name, len))
+            return branch.type;
     return scriptnobranch;
 }
 
@@ -311,10 +344,24 @@ static bool scriptisinternalcommand(const char* text, const char* cmd)
     return false;
 }
 
-static CMDRESULT scriptinternalcmdexec(const char* cmd)
+static SCRIPTOPCODE scriptinternalopcode(const char* cmd)
 {
     if(scriptisinternalcommand(cmd, "ret")) //script finished
+        return opret;
+    else if(scriptisinternalcommand(cmd, "invalid")) //invalid command for testing
+        return opinvalid;
+    else if(scriptisinternalcommand(cmd, "pause")) //pause the script
+        return oppause;
+    else if(scriptisinternalcommand(cmd, "nop")) //do nothing
+        return opnop;
+    return opcommand;
+}
+
+static CMDRESULT scriptinternalopexec(SCRIPTOPCODE opcode)
+{
+    switch(opcode)
     {
+    case opret:
         if(!scriptstack.size()) //nothing on the stack
         {
             GuiScriptMessage("Script finished!");
@@ -323,19 +370,26 @@ static CMDRESULT scriptinternalcmdexec(const char* cmd)
         scriptIp = scriptstack.back(); //set scriptIp to the call address (scriptinternalstep will step over it)
         scriptstack.pop_back(); //remove last stack entry
         return STATUS_CONTINUE;
-    }
-    else if(scriptisinternalcommand(cmd, "invalid")) //invalid command for testing
+    case opinvalid:
         return STATUS_ERROR;
-    else if(scriptisinternalcommand(cmd, "pause")) //pause the script
+    case oppause:
         return STATUS_PAUSE;
-    else if(scriptisinternalcommand(cmd, "nop")) //do nothing
+    default:
         return STATUS_CONTINUE;
+    }
+}
+
+static CMDRESULT scriptinternalcmdexec(const char* cmd)
+{
+    SCRIPTOPCODE opcode = scriptinternalopcode(cmd);
+    if(opcode != opcommand)
+        return scriptinternalopexec(opcode);
     char command[deflen] = "";
     strcpy_s(command, StringUtils::Trim(cmd).c_str());
-    COMMAND* found = cmdfindmain(command);
+    auto found = cmdfindmain(command);
     if(!found) //invalid command
         return STATUS_ERROR;
-    if(arraycontains(found->name, "var")) //var
+    if(arraycontains(found->name.c_str(), "var")) //var
     {
         cmddirectexec(command);
         return STATUS_CONTINUE;
@@ -346,6 +400,81 @@ static CMDRESULT scriptinternalcmdexec(const char* cmd)
     return res;
 }
 
+static void scriptcompile()
+{
+    int linecount = (int)linemap.size();
+    std::vector<SCRIPTINSTRUCTION>().swap(scriptcode);
+    scriptcode.resize(linecount);
+    for(int i = 0; i < linecount; i++)
+    {
+        const auto & line = linemap.at(i);
+        auto & instr = scriptcode.at(i);
+        instr.opcode = opnone;
+        instr.branchtype = scriptnobranch;
+        instr.labelline = 0;
+        instr.generation = 0;
+        instr.cbCommand = nullptr;
+        instr.debugonly = false;
+        instr.isvar = false;
+        instr.formatted = false;
+        if(line.type == linecommand)
+            instr.opcode = scriptinternalopcode(line.u.command);
+        else if(line.type == linebranch)
+        {
+            instr.opcode = opbranch;
+            instr.branchtype = line.u.branch.type;
+            instr.labelline = scriptlabelfind(line.u.branch.branchlabel);
+        }
+    }
+}
+
+static bool scriptbind(SCRIPTINSTRUCTION & instr, const char* cmd)
+{
+    // Lines that need formatting (x=y -> mov x,y) are bound again on every execution, the result depends on the debuggee state
+    char command[deflen] = "";
+    strcpy_s(command, StringUtils::Trim(cmd).c_str());
+    instr.formatted = !cmdfind(command);
+    auto found = cmdfindmain(command);
+    if(!found || !found->cbCommand)
+        return false;
+    instr.generation = cmdgeneration();
+    instr.cbCommand = found->cbCommand;
+    instr.debugonly = found->debugonly;
+    instr.isvar = arraycontains(found->name.c_str(), "var");
+    Command parsed(command);
+    int argcount = parsed.GetArgCount();
+    instr.args.resize(argcount + 1);
+    instr.args[0] = command;
+    for(int i = 0; i < argcount; i++)
+        instr.args[i + 1] = parsed.GetArg(i);
+    instr.argdata.resize((argcount + 1) * deflen);
+    instr.argv.resize(argcount + 1);
+    for(int i = 0; i <= argcount; i++)
+        instr.argv[i] = instr.argdata.data() + i * deflen;
+    return true;
+}
+
+static CMDRESULT scriptcompiledexec(SCRIPTINSTRUCTION & instr, const char* cmd)
+{
+    if(instr.opcode != opcommand)
+        return scriptinternalopexec(instr.opcode);
+    if((instr.generation != cmdgeneration() || instr.formatted) && !scriptbind(instr, cmd))
+        return STATUS_ERROR; //invalid command
+    if(instr.debugonly && !DbgIsDebugging())
+        return STATUS_ERROR;
+
+    // The arguments are writable, so the previous execution may have changed them
+    int argc = (int)instr.argv.size();
+    for(int i = 0; i < argc; i++)
+        strcpy_s(instr.argv[i], deflen, instr.args[i].c_str());
+    CMDRESULT res = instr.cbCommand(argc, instr.argv.data());
+    if(instr.isvar)
+        return STATUS_CONTINUE;
+    while(DbgIsDebugging() && dbgisrunning()) //while not locked (NOTE: possible deadlock)
+        Sleep(10);
+    return res;
+}
+
 static bool scriptinternalbranch(SCRIPTBRANCHTYPE type) //determine if we should jump
 {
     duint ezflag = 0;
@@ -393,10 +522,17 @@ static bool scriptinternalbranch(SCRIPTBRANCHTYPE type) //determine if we should
 static bool scriptinternalcmd()
 {
     bool bContinue = true;
-    LINEMAPENTRY cur = linemap.at(scriptIp - 1);
-    if(cur.type == linecommand)
+    auto & instr = scriptcode.at(scriptIp - 1);
+    if(instr.opcode == opbranch)
     {
-        switch(scriptinternalcmdexec(cur.u.command))
+        if(instr.branchtype == scriptcall) //calls have a special meaning
+            scriptstack.push_back(scriptIp);
+        if(scriptinternalbranch(instr.branchtype))
+            scriptIp = instr.labelline;
+    }
+    else if(instr.opcode != opnone)
+    {
+        switch(scriptcompiledexec(instr, linemap.at(scriptIp - 1).u.command))
         {
         case STATUS_CONTINUE:
             break;
@@ -416,13 +552,6 @@ static bool scriptinternalcmd()
             break;
         }
     }
-    else if(cur.type == linebranch)
-    {
-        if(cur.u.branch.type == scriptcall) //calls have a special meaning
-            scriptstack.push_back(scriptIp);
-        if(scriptinternalbranch(cur.u.branch.type))
-            scriptIp = scriptlabelfind(cur.u.branch.branchlabel);
-    }
     return bContinue;
 }
 
@@ -442,6 +571,7 @@ static DWORD WINAPI scriptRunThread(void* arg)
         scriptIp--;
     scriptIp = scriptinternalstep(scriptIp);
     bool bContinue = true;
+    unsigned int executed = 0;
     while(bContinue && !bAbort) //run loop
     {
         bContinue = scriptinternalcmd();
@@ -454,7 +584,8 @@ static DWORD WINAPI scriptRunThread(void* arg)
             scriptIp = scriptinternalstep(scriptIp); //this is the next ip
         if(scriptinternalbpget(scriptIp)) //breakpoint=stop run loop
             bContinue = false;
-        Sleep(1); //don't fry the processor
+        if(++executed % SCRIPT_YIELD_LINES == 0)
+            Sleep(1); //don't fry the processor
     }
     bIsRunning = false; //not running anymore
     GuiScriptSetIp(scriptIp);
@@ -471,6 +602,7 @@ static DWORD WINAPI scriptLoadThread(void* filename)
     bAbort = false;
     if(!scriptcreatelinemap((const char*)filename))
         return 0;
+    scriptcompile();
     int lines = (int)linemap.size();
     const char** script = (const char**)BridgeAlloc(lines * sizeof(const char*));
     for(int i = 0; i < lines; i++) //add script lines
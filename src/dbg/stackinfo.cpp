@@ -11,58 +11,197 @@
 #include "_exports.h"
 #include "module.h"
 #include "thread.h"
+#include "threading.h"
+#include "stackunwind.h"
+#include "stringextract.h"
 
-bool stackcommentget(duint addr, STACK_COMMENT* comment)
+#define STACK_COMMENT_WINDOW 128 //number of stack slots annotated per batch
+#define STACK_DISASM_SIZE 256 //bytes read around a pointer to detect return addresses
+#define STACK_STRING_SIZE 500 //maximum string length in a stack comment
+#define STACK_MAYBE_CALL 1 //a call opcode precedes the pointer, it might be a return address
+#define STACK_MAYBE_STRING 2 //the pointer starts with two ASCII or UTF-16 string characters
+
+struct STACKCOMMENTENTRY
+{
+    bool valid;
+    STACK_COMMENT comment;
+};
+
+static std::unordered_map<duint, STACKCOMMENTENTRY> stackComments;
+
+// Bumped whenever debuggee memory, labels or comments change. The cached comments are only used while
+// stackCommentsGeneration (protected by LockStackComments) still matches it.
+static volatile LONG stackCommentGeneration = 0;
+static LONG stackCommentsGeneration = 0;
+
+/**
+\brief Page cache used by a single annotation batch. Every page is read from the debuggee at most once.
+*/
+class StackPageCache
+{
+public:
+    void Want(duint addr, duint size)
+    {
+        duint start = addr & ~(PAGE_SIZE - 1);
+        for(duint page = start; page < addr + size && page >= start; page += PAGE_SIZE)
+            m_Wanted.insert(page);
+    }
+
+    void ReadAll()
+    {
+        // std::set is sorted, so the pages are read in address order
+        for(auto page : m_Wanted)
+        {
+            if(m_Pages.count(page))
+                continue;
+            auto & data = m_Pages[page];
+            data.resize(PAGE_SIZE);
+            if(!MemRead(page, data.data(), PAGE_SIZE))
+                data.clear();
+        }
+        m_Wanted.clear();
+    }
+
+    bool IsValid(duint addr) const
+    {
+        auto found = m_Pages.find(addr & ~(PAGE_SIZE - 1));
+        return found != m_Pages.end() && !found->second.empty();
+    }
+
+    // Same semantics as MemRead: true when at least one byte was copied, unreadable bytes are zero
+    bool Read(duint addr, unsigned char* dest, duint size) const
+    {
+        memset(dest, 0, size);
+        bool read = false;
+        for(duint offset = 0; offset < size;)
+        {
+            duint page = (addr + offset) & ~(PAGE_SIZE - 1);
+            duint pageOffset = (addr + offset) - page;
+            duint chunk = min(PAGE_SIZE - pageOffset, size - offset);
+            auto found = m_Pages.find(page);
+            if(found != m_Pages.end() && !found->second.empty())
+            {
+                memcpy(dest + offset, found->second.data() + pageOffset, chunk);
+                read = true;
+            }
+            offset += chunk;
+        }
+        return read;
+    }
+
+private:
+    std::set<duint> m_Wanted;
+    std::unordered_map<duint, std::vector<unsigned char>> m_Pages;
+};
+
+static void stackformataddress(duint addr, char* text, size_t size)
+{
+    char label[MAX_LABEL_SIZE] = "";
+    ADDRINFO addrinfo;
+    addrinfo.flags = flaglabel;
+    if(_dbg_addrinfoget(addr, SEG_DEFAULT, &addrinfo))
+        strcpy_s(label, addrinfo.label);
+    char module[MAX_MODULE_SIZE] = "";
+    ModNameFromAddr(addr, module, false);
+    *text = 0;
+    if(*module)
+        sprintf_s(text, size, "%s.", module);
+    if(!*label)
+        sprintf_s(label, fhex, addr);
+    strcat_s(text, size, label);
+}
+
+// Bit i is set when data[i] is the opcode of a call (E8, FF or 9A)
+static inline unsigned int stackcallopcodemask(const unsigned char* data)
+{
+    __m128i block = _mm_loadu_si128((const __m128i*)data);
+    __m128i call = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8((char)0xE8)), _mm_cmpeq_epi8(block, _mm_set1_epi8((char)0xFF)));
+    call = _mm_or_si128(call, _mm_cmpeq_epi8(block, _mm_set1_epi8((char)0x9A)));
+    return (unsigned int)_mm_movemask_epi8(call);
+}
+
+// Bit i is set when data[i] is zero
+static inline unsigned int stackzeromask(const unsigned char* data)
+{
+    __m128i block = _mm_loadu_si128((const __m128i*)data);
+    return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_setzero_si128()));
+}
+
+/**
+rief Classifies all slots of a batch at once, so the disassembler and the string checks only run on the candidates.
+\param cache The pages of the batch.
+\param slots The stack slots.
+\param count The number of slots.
+\param [out] kinds STACK_MAYBE_* flags for every slot.
+*/
+static void stackclassify(const StackPageCache & cache, const duint* slots, duint count, std::vector<unsigned char> & kinds)
+{
+    // The 16 bytes in front of every pointer and the first 4 bytes it points to, packed so they can be tested 16 bytes at a time
+    std::vector<unsigned char> front(count * 16);
+    std::vector<unsigned char> heads((count + 3) / 4 * 16);
+    for(duint i = 0; i < count; i++)
+    {
+        duint data = slots[i];
+        if(!cache.IsValid(data))
+            continue;
+        if(data >= 16)
+            cache.Read(data - 16, front.data() + i * 16, 16);
+        cache.Read(data, heads.data() + i * 4, 4);
+    }
+
+    kinds.assign(count, 0);
+
+    // A return address directly follows its call, an instruction is at most 15 bytes long
+    for(duint i = 0; i < count; i++)
+    {
+        if(stackcallopcodemask(front.data() + i * 16) & 0xFFFE)
+            kinds[i] |= STACK_MAYBE_CALL;
+    }
+
+    // disasmgetstringat needs two ASCII characters, or two UTF-16 characters with a zero high byte
+    for(duint i = 0; i < count; i += 4)
+    {
+        unsigned int chars = stringcharmask(heads.data() + i * 4);
+        unsigned int zeros = stackzeromask(heads.data() + i * 4);
+        for(duint j = 0; j < 4 && i + j < count; j++)
+        {
+            unsigned int c = (chars >> (j * 4)) & 0xF;
+            unsigned int z = (zeros >> (j * 4)) & 0xF;
+            if((c & 0x3) == 0x3 || ((c & 0x5) == 0x5 && (z & 0xA) == 0xA))
+                kinds[i + j] |= STACK_MAYBE_STRING;
+        }
+    }
+}
+
+static bool stackcommentfromcache(const StackPageCache & cache, duint data, unsigned char kind, STACK_COMMENT* comment)
 {
-    duint data = 0;
     memset(comment, 0, sizeof(STACK_COMMENT));
-    MemRead(addr, &data, sizeof(duint));
-    if(!MemIsValidReadPtr(data)) //the stack value is no pointer
+    if(!cache.IsValid(data)) //the stack value is no pointer
         return false;
 
-    duint size = 0;
-    duint base = MemFindBaseAddr(data, &size);
-    duint readStart = data - 16 * 4;
-    if(readStart < base)
-        readStart = base;
-    unsigned char disasmData[256];
-    MemRead(readStart, disasmData, sizeof(disasmData));
-    duint prev = disasmback(disasmData, 0, sizeof(disasmData), data - readStart, 1);
-    duint previousInstr = readStart + prev;
-
     BASIC_INSTRUCTION_INFO basicinfo;
-    bool valid = disasmfast(disasmData + prev, previousInstr, &basicinfo);
+    bool valid = false;
+    if(kind & STACK_MAYBE_CALL)
+    {
+        duint size = 0;
+        duint base = MemFindBaseAddr(data, &size);
+        duint readStart = data - 16 * 4;
+        if(readStart < base)
+            readStart = base;
+        unsigned char disasmData[STACK_DISASM_SIZE];
+        cache.Read(readStart, disasmData, sizeof(disasmData));
+        duint prev = disasmback(disasmData, 0, sizeof(disasmData), data - readStart, 1);
+        duint previousInstr = readStart + prev;
+        valid = disasmfast(disasmData + prev, previousInstr, &basicinfo) && previousInstr + basicinfo.size == data;
+    }
     if(valid && basicinfo.call) //call
     {
-        char label[MAX_LABEL_SIZE] = "";
-        ADDRINFO addrinfo;
-        addrinfo.flags = flaglabel;
-        if(_dbg_addrinfoget(data, SEG_DEFAULT, &addrinfo))
-            strcpy_s(label, addrinfo.label);
-        char module[MAX_MODULE_SIZE] = "";
-        ModNameFromAddr(data, module, false);
         char returnToAddr[MAX_COMMENT_SIZE] = "";
-        if(*module)
-            sprintf(returnToAddr, "%s.", module);
-        if(!*label)
-            sprintf(label, fhex, data);
-        strcat(returnToAddr, label);
-
-        data = basicinfo.addr;
-        if(data)
+        stackformataddress(data, returnToAddr, sizeof(returnToAddr));
+        if(basicinfo.addr)
         {
-            *label = 0;
-            addrinfo.flags = flaglabel;
-            if(_dbg_addrinfoget(data, SEG_DEFAULT, &addrinfo))
-                strcpy_s(label, addrinfo.label);
-            *module = 0;
-            ModNameFromAddr(data, module, false);
             char returnFromAddr[MAX_COMMENT_SIZE] = "";
-            if(*module)
-                sprintf(returnFromAddr, "%s.", module);
-            if(!*label)
-                sprintf(label, fhex, data);
-            strcat_s(returnFromAddr, label);
+            stackformataddress(basicinfo.addr, returnFromAddr, sizeof(returnFromAddr));
             sprintf_s(comment->comment, "return to %s from %s", returnToAddr, returnFromAddr);
         }
         else
@@ -74,7 +213,8 @@ bool stackcommentget(duint addr, STACK_COMMENT* comment)
     //string
     STRING_TYPE strtype;
     char string[512] = "";
-    if(disasmgetstringat(data, &strtype, string, string, 500))
+    unsigned char stringData[(STACK_STRING_SIZE + 1) * 2];
+    if((kind & STACK_MAYBE_STRING) && cache.Read(data, stringData, sizeof(stringData)) && disasmgetstringat(stringData, &strtype, string, string, STACK_STRING_SIZE))
     {
         if(strtype == str_ascii)
             sprintf(comment->comment, "\"%s\"", string);
@@ -109,6 +249,102 @@ bool stackcommentget(duint addr, STACK_COMMENT* comment)
     return false;
 }
 
+void stackcommentbatch(duint start, duint count)
+{
+    if(!count)
+        return;
+
+    // Results computed from memory that changed in the meantime are not stored
+    LONG generation = stackCommentGeneration;
+
+    // Read all stack slots at once
+    Memory<duint*> slots(count * sizeof(duint), "stackcommentbatch:slots");
+    if(!MemRead(start, slots(), slots.size()))
+        return;
+
+    // Collect every page the annotations will need, then read each page once
+    StackPageCache cache;
+    for(duint i = 0; i < count; i++)
+    {
+        duint data = slots()[i];
+        if(!data)
+            continue;
+        cache.Want(data, 1);
+    }
+    cache.ReadAll();
+    for(duint i = 0; i < count; i++)
+    {
+        duint data = slots()[i];
+        if(!cache.IsValid(data))
+            continue;
+        duint size = 0;
+        duint base = MemFindBaseAddr(data, &size);
+        duint readStart = data - 16 * 4;
+        if(readStart < base)
+            readStart = base;
+        cache.Want(readStart, STACK_DISASM_SIZE);
+        cache.Want(data, (STACK_STRING_SIZE + 1) * 2);
+    }
+    cache.ReadAll();
+
+    // Classify every slot against the cached pages
+    std::vector<unsigned char> kinds;
+    stackclassify(cache, slots(), count, kinds);
+    std::vector<std::pair<duint, STACKCOMMENTENTRY>> results;
+    results.reserve(count);
+    for(duint i = 0; i < count; i++)
+    {
+        STACKCOMMENTENTRY entry;
+        entry.valid = stackcommentfromcache(cache, slots()[i], kinds[i], &entry.comment);
+        results.push_back(std::make_pair(start + i * sizeof(duint), entry));
+    }
+
+    EXCLUSIVE_ACQUIRE(LockStackComments);
+    if(generation != stackCommentGeneration)
+        return;
+    if(stackCommentsGeneration != generation)
+    {
+        stackComments.clear();
+        stackCommentsGeneration = generation;
+    }
+    for(const auto & result : results)
+        stackComments[result.first] = result.second;
+}
+
+void stackcommentcacheclear()
+{
+    EXCLUSIVE_ACQUIRE(LockStackComments);
+    stackComments.clear();
+}
+
+/**
+\brief Marks the cached stack comments as stale. Cheap enough to be called on every memory write.
+*/
+void stackcommentinvalidate()
+{
+    InterlockedIncrement(&stackCommentGeneration);
+}
+
+bool stackcommentget(duint addr, STACK_COMMENT* comment)
+{
+    for(int i = 0; i < 2; i++)
+    {
+        {
+            SHARED_ACQUIRE(LockStackComments);
+            auto found = stackComments.find(addr);
+            if(found != stackComments.end() && stackCommentsGeneration == stackCommentGeneration)
+            {
+                *comment = found->second.comment;
+                return found->second.valid;
+            }
+        }
+        // Annotate the window starting at the requested slot, the next rows will be cache hits
+        stackcommentbatch(addr, STACK_COMMENT_WINDOW);
+    }
+    memset(comment, 0, sizeof(STACK_COMMENT));
+    return false;
+}
+
 BOOL CALLBACK StackReadProcessMemoryProc64(HANDLE hProcess, DWORD64 lpBaseAddress, PVOID lpBuffer, DWORD nSize, LPDWORD lpNumberOfBytesRead)
 {
     // Fix for 64-bit sizes
@@ -177,6 +413,110 @@ void StackEntryFromFrame(CALLSTACKENTRY* Entry, duint Address, duint From, duint
         sprintf_s(Entry->comment, "return to %s from ???", returnToAddr);
 }
 
+#ifdef _WIN64
+#define MAX_CALLSTACK_DEPTH 1000
+
+/**
+\brief Unwinds the call stack with the cached .pdata tables of the modules.
+\param [in,out] context The context of the thread. When the unwinding stops early, it holds the frame where it stopped.
+\param [in,out] csp The stack pointer of the thread, or of the frame where the unwinding stopped.
+\param [out] callstackVector The unwound frames are appended here.
+\return true if the stack was walked completely, false if the caller has to continue from context with StackWalk64.
+*/
+static bool stackunwindcallstack(CONTEXT & context, duint & csp, std::vector<CALLSTACKENTRY> & callstackVector)
+{
+    // Take a single snapshot of the stack, every frame is unwound from it
+    duint stackSize = 0;
+    duint stackBase = MemFindBaseAddr(csp, &stackSize);
+    if(!stackBase)
+        return false;
+    duint snapshotSize = stackBase + stackSize - csp;
+    Memory<unsigned char*> snapshot(snapshotSize, "stackunwindcallstack:snapshot");
+    if(!MemRead(csp, snapshot(), snapshotSize))
+        return false;
+    auto readStack = [&](duint addr, duint* value)
+    {
+        if(addr < csp || addr + sizeof(duint) > csp + snapshotSize)
+            return false;
+        memcpy(value, snapshot() + (addr - csp), sizeof(duint));
+        return true;
+    };
+    auto readCode = [](duint addr, unsigned char* buffer, size_t size)
+    {
+        duint read = 0;
+        if(MemRead(addr, buffer, size, &read) && read)
+            return size_t(read);
+        //an epilog at the end of the last code page
+        duint pageSize = PAGE_SIZE - (addr & (PAGE_SIZE - 1));
+        if(pageSize < size && MemRead(addr, buffer, pageSize, &read))
+            return size_t(read);
+        return size_t(0);
+    };
+
+    UNWIND_CONTEXT unwindContext;
+    unwindContext.Rip = context.Rip;
+    unwindContext.Regs[0] = context.Rax;
+    unwindContext.Regs[1] = context.Rcx;
+    unwindContext.Regs[2] = context.Rdx;
+    unwindContext.Regs[3] = context.Rbx;
+    unwindContext.Regs[4] = csp;
+    unwindContext.Regs[5] = context.Rbp;
+    unwindContext.Regs[6] = context.Rsi;
+    unwindContext.Regs[7] = context.Rdi;
+    unwindContext.Regs[8] = context.R8;
+    unwindContext.Regs[9] = context.R9;
+    unwindContext.Regs[10] = context.R10;
+    unwindContext.Regs[11] = context.R11;
+    unwindContext.Regs[12] = context.R12;
+    unwindContext.Regs[13] = context.R13;
+    unwindContext.Regs[14] = context.R14;
+    unwindContext.Regs[15] = context.R15;
+
+    for(int i = 0; i < MAX_CALLSTACK_DEPTH; i++)
+    {
+        duint from = unwindContext.Rip;
+        duint previousCsp = unwindContext.Regs[4];
+        duint imageBase = 0;
+        auto table = UnwindTableFromAddr(from, &imageBase);
+        //code without module unwind data (JIT code, shellcode) is no leaf, leave it to dbghelp
+        UNWIND_CONTEXT frameContext = unwindContext;
+        if(!table || !table->VirtualUnwind(imageBase, unwindContext, readStack, readCode))
+        {
+            context.Rip = frameContext.Rip;
+            context.Rax = frameContext.Regs[0];
+            context.Rcx = frameContext.Regs[1];
+            context.Rdx = frameContext.Regs[2];
+            context.Rbx = frameContext.Regs[3];
+            context.Rsp = frameContext.Regs[4];
+            context.Rbp = frameContext.Regs[5];
+            context.Rsi = frameContext.Regs[6];
+            context.Rdi = frameContext.Regs[7];
+            context.R8 = frameContext.Regs[8];
+            context.R9 = frameContext.Regs[9];
+            context.R10 = frameContext.Regs[10];
+            context.R11 = frameContext.Regs[11];
+            context.R12 = frameContext.Regs[12];
+            context.R13 = frameContext.Regs[13];
+            context.R14 = frameContext.Regs[14];
+            context.R15 = frameContext.Regs[15];
+            csp = context.Rsp;
+            return false;
+        }
+        if(!unwindContext.Rip) //base reached
+            break;
+
+        CALLSTACKENTRY entry;
+        memset(&entry, 0, sizeof(CALLSTACKENTRY));
+        StackEntryFromFrame(&entry, unwindContext.Regs[4] - sizeof(duint), from, unwindContext.Rip);
+        callstackVector.push_back(entry);
+
+        if(unwindContext.Regs[4] <= previousCsp) //no progress, the unwind data is bogus
+            break;
+    }
+    return true;
+}
+#endif //_WIN64
+
 void stackgetcallstack(duint csp, CALLSTACK* callstack)
 {
     // Gather context data
@@ -220,7 +560,19 @@ void stackgetcallstack(duint csp, CALLSTACK* callstack)
     std::vector<CALLSTACKENTRY> callstackVector;
     callstackVector.reserve(20);
 
-    while(true)
+    // Unwind in-process with the cached .pdata tables, dbghelp continues from the first frame they do not cover
+    bool unwound = false;
+#ifdef _WIN64
+    unwound = stackunwindcallstack(context, csp, callstackVector);
+    if(!unwound)
+    {
+        frame.AddrPC.Offset = context.Rip;
+        frame.AddrFrame.Offset = context.Rsp;
+        frame.AddrStack.Offset = csp;
+    }
+#endif //_WIN64
+
+    while(!unwound)
     {
         if(!StackWalk64(
                     machineType,
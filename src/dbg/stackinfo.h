@@ -18,6 +18,9 @@ struct CALLSTACK
 };
 
 bool stackcommentget(duint addr, STACK_COMMENT* comment);
+void stackcommentbatch(duint start, duint count);
+void stackcommentcacheclear();
+void stackcommentinvalidate();
 void stackgetcallstack(duint csp, CALLSTACK* callstack);
 
 #endif //_STACKINFO_H
\ No newline at end of file
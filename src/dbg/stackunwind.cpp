@@ -0,0 +1,61 @@
+/**
+ @file stackunwind.cpp
+
+ @brief Implements the cache of the x64 unwind tables used by the call stack.
+ */
+
+#include "stackunwind.h"
+#include "threading.h"
+#include "module.h"
+#include "TitanEngine\TitanEngine.h"
+
+static std::map<duint, std::shared_ptr<UnwindTable>> unwindTables;
+
+std::shared_ptr<UnwindTable> UnwindTableFromAddr(duint Address, duint* ImageBase)
+{
+    duint base = ModBaseFromAddr(Address);
+    if(!base)
+        return nullptr;
+    if(ImageBase)
+        *ImageBase = base;
+
+    {
+        SHARED_ACQUIRE(LockUnwindTables);
+        auto found = unwindTables.find(base);
+        if(found != unwindTables.end())
+            return found->second;
+    }
+
+    // Parse the module file only once, failures are cached as empty tables
+    auto table = std::make_shared<UnwindTable>();
+    char modulePath[MAX_PATH] = "";
+    if(ModPathFromAddr(base, modulePath, _countof(modulePath)))
+    {
+        HANDLE fileHandle;
+        DWORD fileSize;
+        HANDLE fileMapHandle;
+        ULONG_PTR fileMapVa;
+        WString wszModulePath = StringUtils::Utf8ToUtf16(modulePath);
+        if(StaticFileLoadW(wszModulePath.c_str(), UE_ACCESS_READ, false, &fileHandle, &fileSize, &fileMapHandle, &fileMapVa))
+        {
+            table->Load((const unsigned char*)fileMapVa, fileSize);
+            StaticFileUnloadW(wszModulePath.c_str(), false, fileHandle, fileSize, fileMapHandle, fileMapVa);
+        }
+    }
+
+    EXCLUSIVE_ACQUIRE(LockUnwindTables);
+    unwindTables[base] = table;
+    return table;
+}
+
+void UnwindTableRemove(duint Base)
+{
+    EXCLUSIVE_ACQUIRE(LockUnwindTables);
+    unwindTables.erase(Base);
+}
+
+void UnwindTableClear()
+{
+    EXCLUSIVE_ACQUIRE(LockUnwindTables);
+    unwindTables.clear();
+}
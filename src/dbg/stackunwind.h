@@ -0,0 +1,9 @@
+#pragma once
+
+#include "_global.h"
+#include "unwindtable.h"
+#include <memory>
+
+std::shared_ptr<UnwindTable> UnwindTableFromAddr(duint Address, duint* ImageBase);
+void UnwindTableRemove(duint Base);
+void UnwindTableClear();
@@ -0,0 +1,168 @@
+/**
+ @file stringextract.cpp
+
+ @brief Extracts the strings of a memory range in a single pass.
+ */
+
+#include "stringextract.h"
+#include "stringutils.h"
+#include "memory.h"
+#include "module.h"
+#include "disasm_helper.h"
+
+StringMap::StringMap()
+    : m_Base(0)
+{
+}
+
+bool StringMap::Load(duint Base, duint Size)
+{
+    if(!Size)
+        return false;
+
+    // Pages that cannot be read stay zero and contain no strings
+    std::vector<unsigned char> data(Size);
+    duint bytesRead = 0;
+    MemRead(Base, data.data(), Size, &bytesRead);
+    Build(Base, data.data(), Size);
+    return bytesRead != 0;
+}
+
+void StringMap::Build(duint Base, const unsigned char* Data, duint Size)
+{
+    m_Base = Base;
+    m_Data.assign(Data, Data + Size);
+    m_Ascii.clear();
+    m_Unicode.clear();
+    ScanAscii();
+    ScanUnicode(0);
+    ScanUnicode(1);
+}
+
+bool StringMap::Contains(duint Address) const
+{
+    return Address >= m_Base && Address - m_Base < m_Data.size();
+}
+
+void StringMap::ScanAscii()
+{
+    StringScanAscii(m_Data.data(), duint(m_Data.size()), [this](duint Start, duint End)
+    {
+        m_Ascii.insert(std::make_pair(Range(m_Base + Start, m_Base + End - 1), str_ascii));
+    });
+}
+
+void StringMap::ScanUnicode(duint Parity)
+{
+    StringScanUnicode(m_Data.data(), duint(m_Data.size()), Parity, [this](duint Start, duint End)
+    {
+        m_Unicode.insert(std::make_pair(Range(m_Base + Start, m_Base + End - 1), str_unicode));
+    });
+}
+
+bool StringMap::GetString(duint Address, STRING_TYPE* Type, String & Text) const
+{
+    if(Type)
+        *Type = str_none;
+    if(!Contains(Address))
+        return false;
+
+    auto found = m_Ascii.find(Range(Address, Address));
+    if(found != m_Ascii.end())
+    {
+        duint length = found->first.second + 1 - Address;
+        if(length < 2)
+            return false;
+        Text.assign((const char*)m_Data.data() + (Address - m_Base), length);
+        if(Type)
+            *Type = str_ascii;
+        return true;
+    }
+
+    found = m_Unicode.find(Range(Address, Address));
+    if(found != m_Unicode.end() && (Address - found->first.first) % 2 == 0)
+    {
+        duint length = (found->first.second + 1 - Address) / 2;
+        if(length < 2)
+            return false;
+
+        // Truncate each wchar_t to char
+        const unsigned char* data = m_Data.data() + (Address - m_Base);
+        Text.resize(length);
+        for(duint i = 0; i < length; i++)
+            Text[i] = char(data[i * 2]);
+        if(Type)
+            *Type = str_unicode;
+        return true;
+    }
+    return false;
+}
+
+bool StringMap::GetStringAt(duint Address, STRING_TYPE* Type, char* Ascii, char* Unicode, int MaxLen) const
+{
+    // Same results as disasmgetstringat, strings that do not fit are rejected
+    STRING_TYPE type;
+    String text;
+    if(Type)
+        *Type = str_none;
+    if(!GetString(Address, &type, text) || text.length() + 2 > duint(MaxLen))
+        return false;
+
+    String escaped = StringUtils::Escape(text);
+    if(type == str_ascii)
+        strncpy_s(Ascii, min(int(escaped.length()) + 1, MaxLen), escaped.c_str(), _TRUNCATE);
+    else
+        strncpy_s(Unicode, min(int(escaped.length()) + 1, MaxLen), escaped.c_str(), _TRUNCATE);
+    if(Type)
+        *Type = type;
+    return true;
+}
+
+void StringMap::Enumerate(std::vector<STRINGINFO> & Strings) const
+{
+    Strings.clear();
+    Strings.reserve(m_Ascii.size() + m_Unicode.size());
+    for(const auto & string : m_Ascii)
+    {
+        STRINGINFO info;
+        info.addr = string.first.first;
+        info.length = string.first.second + 1 - string.first.first;
+        info.type = str_ascii;
+        Strings.push_back(info);
+    }
+    for(const auto & string : m_Unicode)
+    {
+        STRINGINFO info;
+        info.addr = string.first.first;
+        info.length = (string.first.second + 1 - string.first.first) / 2;
+        info.type = str_unicode;
+        Strings.push_back(info);
+    }
+    std::sort(Strings.begin(), Strings.end(), [](const STRINGINFO & a, const STRINGINFO & b)
+    {
+        return a.addr < b.addr;
+    });
+}
+
+size_t StringMap::Size() const
+{
+    return m_Ascii.size() + m_Unicode.size();
+}
+
+bool StringMapCache::GetStringAt(duint Address, STRING_TYPE* Type, char* Ascii, char* Unicode, int MaxLen)
+{
+    auto found = m_Modules.find(Range(Address, Address));
+    if(found == m_Modules.end())
+    {
+        duint base = ModBaseFromAddr(Address);
+        duint size = base ? ModSizeFromAddr(base) : 0;
+        if(!size)
+            return disasmgetstringat(Address, Type, Ascii, Unicode, MaxLen);
+
+        // The whole module is read once, every following lookup in it is served from the map
+        std::unique_ptr<StringMap> strings(new StringMap());
+        strings->Load(base, size);
+        found = m_Modules.insert(std::make_pair(Range(base, base + size - 1), std::move(strings))).first;
+    }
+    return found->second->GetStringAt(Address, Type, Ascii, Unicode, MaxLen);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "_global.h"
+#include "addrinfo.h"
+#include "stringscan.h"
+#include <memory>
+
+struct STRINGINFO
+{
+    duint addr;
+    duint length; // Characters, without the terminator
+    STRING_TYPE type;
+};
+
+/**
+\brief Interval map of the null terminated ASCII and UTF-16 strings in a block of debuggee memory.
+The memory is read and scanned once, lookups do not touch the debuggee.
+*/
+class StringMap
+{
+public:
+    StringMap();
+    bool Load(duint Base, duint Size);
+    void Build(duint Base, const unsigned char* Data, duint Size);
+    bool Contains(duint Address) const;
+    bool GetString(duint Address, STRING_TYPE* Type, String & Text) const;
+    bool GetStringAt(duint Address, STRING_TYPE* Type, char* Ascii, char* Unicode, int MaxLen) const;
+    void Enumerate(std::vector<STRINGINFO> & Strings) const;
+    size_t Size() const;
+
+private:
+    void ScanAscii();
+    void ScanUnicode(duint Parity);
+
+    duint m_Base;
+    std::vector<unsigned char> m_Data;
+    std::map<Range, STRING_TYPE, RangeCompare> m_Ascii;
+    std::map<Range, STRING_TYPE, RangeCompare> m_Unicode;
+};
+
+/**
+\brief Builds a StringMap for every module that is looked up, addresses outside of modules are read directly.
+*/
+class StringMapCache
+{
+public:
+    bool GetStringAt(duint Address, STRING_TYPE* Type, char* Ascii, char* Unicode, int MaxLen);
+
+private:
+    std::map<Range, std::unique_ptr<StringMap>, RangeCompare> m_Modules;
+};
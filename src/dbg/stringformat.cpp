@@ -1,6 +1,7 @@
 #include "stringformat.h"
 #include "value.h"
 #include "disasm_helper.h"
+#include <functional>
 
 namespace ValueType
 {
@@ -92,7 +93,39 @@ static String handleFormatString(const String & formatString, const FormatValueV
     return "[Formatting Error]";
 }
 
-String stringformat(String format, const FormatValueVector & values)
+static String handleInlineFormatString(const String & formatString)
+{
+    //{x:expression} where x is an optional type, hex is the default
+    ValueType::ValueType type = ValueType::Hex;
+    size_t add = 0;
+    if(formatString.length() > 2 && formatString[1] == ':')
+    {
+        add = 2;
+        switch(formatString[0])
+        {
+        case 'd':
+            type = ValueType::SignedDecimal;
+            break;
+        case 'u':
+            type = ValueType::UnsignedDecimal;
+            break;
+        case 'p':
+            type = ValueType::Pointer;
+            break;
+        case 's':
+            type = ValueType::String;
+            break;
+        case 'x':
+            break;
+        default:
+            add = 0;
+            break;
+        }
+    }
+    return printValue(formatString.c_str() + add, type);
+}
+
+static String formatloop(String format, const std::function<String(const String &)> & handleFormat)
 {
     StringUtils::ReplaceAll(format, "\\n", "\n");
     int len = (int)format.length();
@@ -125,7 +158,7 @@ String stringformat(String format, const FormatValueVector & values)
             inFormatter = false;
             if(formatString.length())
             {
-                output += handleFormatString(formatString, values);
+                output += handleFormat(formatString);
                 formatString.clear();
             }
         }
@@ -135,6 +168,22 @@ String stringformat(String format, const FormatValueVector & values)
             output += format[i];
     }
     if(inFormatter && formatString.size())
-        output += handleFormatString(formatString, values);
+        output += handleFormat(formatString);
     return output;
+}
+
+String stringformat(String format, const FormatValueVector & values)
+{
+    return formatloop(format, [&values](const String & formatString)
+    {
+        return handleFormatString(formatString, values);
+    });
+}
+
+/**
+\brief Formats a string where the brackets contain the expressions themselves, for example "eax={eax}, arg={p:[esp+4]}".
+*/
+String stringformatinline(String format)
+{
+    return formatloop(format, handleInlineFormatString);
 }
\ No newline at end of file
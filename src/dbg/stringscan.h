@@ -0,0 +1,92 @@
+#pragma once
+
+#include <emmintrin.h>
+
+// Matches isprint() || isspace() in the "C" locale
+static inline bool isstringchar(unsigned char ch)
+{
+    return (ch >= 0x20 && ch < 0x7F) || (ch >= 0x09 && ch <= 0x0D);
+}
+
+// Bit i is set when data[i] is a string character
+static inline unsigned int stringcharmask(const unsigned char* data)
+{
+    // Bytes >= 0x80 are negative in the signed compares, so they never match
+    __m128i block = _mm_loadu_si128((const __m128i*)data);
+    __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(0x1F)), _mm_cmplt_epi8(block, _mm_set1_epi8(0x7F)));
+    __m128i space = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(0x08)), _mm_cmplt_epi8(block, _mm_set1_epi8(0x0E)));
+    return (unsigned int)_mm_movemask_epi8(_mm_or_si128(printable, space));
+}
+
+/**
+\brief Calls Proc(Start, End) for every null terminated ASCII string of at least two characters in Data, with [Start, End) the characters. The bytes are classified 16 at a time with SSE2. This header does not depend on the Windows types, so it can be tested on its own.
+*/
+template<typename Size, typename StringProc>
+void StringScanAscii(const unsigned char* Data, Size DataSize, StringProc Proc)
+{
+    Size start = 0;
+    bool inString = false;
+    for(Size i = 0; i < DataSize; i += 16)
+    {
+        Size count = DataSize - i < 16 ? DataSize - i : 16;
+        unsigned int mask = 0;
+        if(count == 16)
+            mask = stringcharmask(Data + i);
+        else
+        {
+            for(Size j = 0; j < count; j++)
+                if(isstringchar(Data[i + j]))
+                    mask |= 1 << j;
+        }
+
+        // Most blocks are either inside a string or contain no string characters at all
+        if(inString ? mask == 0xFFFF : mask == 0)
+            continue;
+
+        for(Size j = 0; j < count; j++)
+        {
+            Size offset = i + j;
+            if(mask & (1 << j))
+            {
+                if(!inString)
+                {
+                    inString = true;
+                    start = offset;
+                }
+            }
+            else if(inString)
+            {
+                inString = false;
+                if(!Data[offset] && offset - start >= 2)  // Only terminated strings of at least two characters
+                    Proc(start, offset);
+            }
+        }
+    }
+}
+
+/**
+\brief Calls Proc(Start, End) for every null terminated UTF-16 string of at least two characters that starts at an offset with the given Parity, with [Start, End) the bytes of the characters. Only characters below 0x100 are accepted.
+*/
+template<typename Size, typename StringProc>
+void StringScanUnicode(const unsigned char* Data, Size DataSize, Size Parity, StringProc Proc)
+{
+    Size start = 0;
+    bool inString = false;
+    for(Size i = Parity; i + 1 < DataSize; i += 2)
+    {
+        if(!Data[i + 1] && isstringchar(Data[i]))  // Extended ASCII only
+        {
+            if(!inString)
+            {
+                inString = true;
+                start = i;
+            }
+        }
+        else if(inString)
+        {
+            inString = false;
+            if(!Data[i] && !Data[i + 1] && (i - start) / 2 >= 2)
+                Proc(start, i);
+        }
+    }
+}
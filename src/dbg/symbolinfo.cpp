@@ -10,6 +10,8 @@
 #include "module.h"
 #include "label.h"
 #include "addrinfo.h"
+#include "threading.h"
+#include "symbolloader.h"
 
 struct SYMBOLCBDATA
 {
@@ -21,6 +23,19 @@ typedef std::vector<SYMBOLINFO> SYMBOLINFOVECTOR;
 typedef std::map<ULONG64, SYMBOLINFOVECTOR> SYMBOLINFOMAP;
 SYMBOLINFOMAP modulesCacheList;
 
+struct SYMBOLNAMECACHEENTRY
+{
+    bool found; // negative results are cached too
+    String decorated;
+    String undecorated; // empty when the name could not be undecorated
+};
+
+#define MAX_SYMBOL_NAME_CACHE 65536
+
+static std::unordered_map<duint, SYMBOLNAMECACHEENTRY> symbolNameCache;
+static volatile LONGLONG symbolNameCacheHits = 0;
+static volatile LONGLONG symbolNameCacheMisses = 0;
+
 
 BOOL CALLBACK EnumSymbols(PSYMBOL_INFO SymInfo, ULONG SymbolSize, PVOID UserContext)
 {
@@ -107,6 +122,9 @@ bool SymGetModuleList(std::vector<SYMBOLMODULEINFO>* List)
 
 void SymUpdateModuleList()
 {
+    // The set of loaded symbols changed
+    SymNameCacheClear();
+
     // Build the vector of modules
     std::vector<SYMBOLMODULEINFO> modList;
 
@@ -187,6 +205,9 @@ void SymDownloadAllSymbols(const char* SymbolStore)
         }
     }
 
+    // The reloaded modules might have different symbols now
+    SymNameCacheClear();
+
     // Restore the old search path
     if(!SafeSymSetSearchPathW(fdProcessInfo->hProcess, oldSearchPath))
         dputs("SymSetSearchPathW (2) failed!");
@@ -219,41 +240,109 @@ bool SymAddrFromName(const char* Name, duint* Address)
     return true;
 }
 
-const char* SymGetSymbolicName(duint Address)
+bool SymNameFromAddr(duint Address, char* Name, size_t NameSize, bool* Undecorated)
 {
-    //
-    // This resolves an address to a module and symbol:
-    // [modname.]symbolname
-    //
-    char label[MAX_SYM_NAME];
+    SYMBOLNAMECACHEENTRY entry;
 
-    // User labels have priority, but if one wasn't found,
-    // default to a symbol lookup
-    if(!LabelGet(Address, label))
+    SHARED_ACQUIRE(LockSymbolCache);
+    auto found = symbolNameCache.find(Address);
+    bool cached = found != symbolNameCache.end();
+    if(cached)
+        entry = found->second;
+    SHARED_RELEASE();
+
+    if(cached)
+        InterlockedIncrement64(&symbolNameCacheHits);
+    else
     {
+        // Do not wait for the background loader, ask it to hurry up instead
+        if(SymLoaderIsPending(Address))
+        {
+            SymLoaderPrioritize(Address);
+            return false;
+        }
+
+        InterlockedIncrement64(&symbolNameCacheMisses);
+
         char buffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME * sizeof(char)];
 
         PSYMBOL_INFO symbol = (PSYMBOL_INFO)buffer;
         symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
         symbol->MaxNameLen = MAX_LABEL_SIZE;
 
-        // Perform a symbol lookup
+        // Only symbols that start exactly at the address count
         DWORD64 displacement = 0;
+        entry.found = SafeSymFromAddr(fdProcessInfo->hProcess, (DWORD64)Address, &displacement, symbol) && !displacement;
 
-        if(!SafeSymFromAddr(fdProcessInfo->hProcess, (DWORD64)Address, &displacement, symbol))
-            return nullptr;
+        if(entry.found)
+        {
+            // Terminate the string for sanity
+            symbol->Name[symbol->MaxNameLen - 1] = '\0';
+            entry.decorated = symbol->Name;
+
+            // Keep both names, so bUndecorateSymbolNames can change without flushing the cache
+            char undecorated[MAX_SYM_NAME];
+            if(SafeUnDecorateSymbolName(symbol->Name, undecorated, MAX_SYM_NAME, UNDNAME_COMPLETE))
+                entry.undecorated = undecorated;
+        }
 
-        // If the symbol wasn't at offset 0 (start from the beginning) ignore it
-        if(displacement != 0)
-            return nullptr;
+        EXCLUSIVE_ACQUIRE(LockSymbolCache);
 
-        // Terminate the string for sanity
-        symbol->Name[symbol->MaxNameLen - 1] = '\0';
+        // Start over when the cache is full, the entries are cheap to rebuild
+        if(symbolNameCache.size() >= MAX_SYMBOL_NAME_CACHE)
+            symbolNameCache.clear();
 
-        if(!bUndecorateSymbolNames || !SafeUnDecorateSymbolName(symbol->Name, label, MAX_SYM_NAME, UNDNAME_COMPLETE))
-            strcpy_s(label, symbol->Name);
+        symbolNameCache.emplace(Address, entry);
     }
 
+    if(!entry.found)
+        return false;
+
+    bool undecorated = bUndecorateSymbolNames && !entry.undecorated.empty();
+    strncpy_s(Name, NameSize, undecorated ? entry.undecorated.c_str() : entry.decorated.c_str(), _TRUNCATE);
+
+    if(Undecorated)
+        *Undecorated = undecorated;
+
+    return true;
+}
+
+void SymNameCacheClear()
+{
+    EXCLUSIVE_ACQUIRE(LockSymbolCache);
+    symbolNameCache.clear();
+}
+
+void SymNameCacheStats()
+{
+    LONGLONG hits = symbolNameCacheHits;
+    LONGLONG misses = symbolNameCacheMisses;
+    LONGLONG total = hits + misses;
+
+    SHARED_ACQUIRE(LockSymbolCache);
+    size_t entries = symbolNameCache.size();
+    SHARED_RELEASE();
+
+    dprintf("Symbol name cache: %d entries, %lld hits, %lld misses (%.2f%% hit rate)\n",
+            int(entries),
+            hits,
+            misses,
+            total ? double(hits) * 100.0 / double(total) : 0.0);
+}
+
+const char* SymGetSymbolicName(duint Address)
+{
+    //
+    // This resolves an address to a module and symbol:
+    // [modname.]symbolname
+    //
+    char label[MAX_SYM_NAME];
+
+    // User labels have priority, but if one wasn't found,
+    // default to a symbol lookup
+    if(!LabelGet(Address, label) && !SymNameFromAddr(Address, label, sizeof(label)))
+        return nullptr;
+
     // TODO: FIXME: STATIC VARIABLE
     static char symbolicname[MAX_MODULE_SIZE + MAX_SYM_NAME];
     char modname[MAX_MODULE_SIZE];
@@ -273,6 +362,13 @@ bool SymGetSourceLine(duint Cip, char* FileName, int* Line)
 
     lineInfo.SizeOfStruct = sizeof(IMAGEHLP_LINE64);
 
+    // The symbols of this module are not loaded yet
+    if(SymLoaderIsPending(Cip))
+    {
+        SymLoaderPrioritize(Cip);
+        return false;
+    }
+
     // Perform a symbol lookup from a specific address
     DWORD displacement;
 
@@ -320,6 +416,8 @@ bool SymGetSourceLine(duint Cip, char* FileName, int* Line)
 
 void SymClearMemoryCache()
 {
+    SymNameCacheClear();
+
     for(auto & itr : modulesCacheList)
     {
         SYMBOLINFOVECTOR* pModuleVector = &itr.second;
@@ -10,6 +10,9 @@ bool SymGetModuleList(std::vector<SYMBOLMODULEINFO>* List);
 void SymUpdateModuleList();
 void SymDownloadAllSymbols(const char* SymbolStore);
 bool SymAddrFromName(const char* Name, duint* Address);
+bool SymNameFromAddr(duint Address, char* Name, size_t NameSize, bool* Undecorated = nullptr);
+void SymNameCacheClear();
+void SymNameCacheStats();
 const char* SymGetSymbolicName(duint Address);
 void SymClearMemoryCache();
 bool SymGetSymbolInfo(PSYMBOL_INFO SymInfo, SYMBOLINFO* curSymbol, bool isImported);
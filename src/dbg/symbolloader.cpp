@@ -0,0 +1,159 @@
+/**
+ @file symbolloader.cpp
+
+ @brief Loads the symbols of the debuggee modules on a background thread.
+ */
+
+#include "symbolloader.h"
+#include "threading.h"
+#include "debugger.h"
+#include "module.h"
+#include "symbolqueue.h"
+
+#define SYMLOADER_STOP_TIMEOUT 5000 //milliseconds to wait for the loader thread at shutdown, a symbol server might ignore the cancellation
+
+typedef SymbolLoadQueue<duint>::Request SYMLOADREQUEST;
+
+static SymbolLoadQueue<duint> symLoadQueue;
+static HANDLE hSymLoaderThread = 0;
+static HANDLE hSymLoaderEvent = 0;
+static volatile bool bStopSymLoaderThread = false;
+
+static bool symloadnext(SYMLOADREQUEST & Request)
+{
+    EXCLUSIVE_ACQUIRE(LockSymbolLoader);
+    return symLoadQueue.Next(Request);
+}
+
+/**
+\brief Cancels a download of the private session as soon as the loader has to stop, symsrv asks for it while it downloads.
+*/
+static BOOL CALLBACK symloadcallback(HANDLE hProcess, ULONG ActionCode, ULONG64 CallbackData, ULONG64 UserContext)
+{
+    UNREFERENCED_PARAMETER(hProcess);
+    UNREFERENCED_PARAMETER(CallbackData);
+    UNREFERENCED_PARAMETER(UserContext);
+    if(ActionCode == CBA_DEFERRED_SYMBOL_LOAD_CANCEL)
+        return bStopSymLoaderThread;
+    return FALSE;
+}
+
+/**
+\brief Downloads and parses the symbols of a module in a dbghelp session of its own. The session is keyed by a duplicate
+       of the process handle and is only used by the loader thread, so it does not take LockSym: module loads and unloads
+       on the debug thread do not wait for a symbol server. The main session then only parses the cached, local file.
+*/
+static void symloadprefetch(const SYMLOADREQUEST & Request)
+{
+    wchar_t searchPath[MAX_PATH * 2] = L"";
+    if(!SafeSymGetSearchPathW(fdProcessInfo->hProcess, searchPath, _countof(searchPath)))
+        return;
+    char modulePath[MAX_PATH] = "";
+    if(!ModPathFromAddr(Request.Base, modulePath, _countof(modulePath)))
+        return;
+
+    HANDLE hSession = nullptr;
+    if(!DuplicateHandle(GetCurrentProcess(), fdProcessInfo->hProcess, GetCurrentProcess(), &hSession, 0, false, DUPLICATE_SAME_ACCESS))
+        return;
+    if(SymInitializeW(hSession, searchPath, false))
+    {
+        SymRegisterCallback64(hSession, symloadcallback, 0);
+        if(SymLoadModuleExW(hSession, nullptr, StringUtils::Utf8ToUtf16(modulePath).c_str(), nullptr, (DWORD64)Request.Base, (DWORD)Request.Size, nullptr, 0))
+        {
+            // The first lookup downloads (SYMOPT_DEFERRED_LOADS) and parses the symbols
+            char buffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME * sizeof(char)];
+            PSYMBOL_INFO symbol = (PSYMBOL_INFO)buffer;
+            symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+            symbol->MaxNameLen = MAX_LABEL_SIZE;
+            DWORD64 displacement = 0;
+            SymFromAddr(hSession, (DWORD64)Request.Base, &displacement, symbol);
+        }
+        SymCleanup(hSession);
+    }
+    CloseHandle(hSession);
+}
+
+static DWORD WINAPI symLoaderThread(void* ptr)
+{
+    while(WaitForSingleObject(hSymLoaderEvent, INFINITE) == WAIT_OBJECT_0 && !bStopSymLoaderThread)
+    {
+        SYMLOADREQUEST request;
+        while(!bStopSymLoaderThread && symloadnext(request))
+        {
+            symloadprefetch(request);
+            if(bStopSymLoaderThread)
+                break;
+
+            // The modules are registered with SYMOPT_DEFERRED_LOADS, the first lookup parses the symbols
+            char buffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME * sizeof(char)];
+            PSYMBOL_INFO symbol = (PSYMBOL_INFO)buffer;
+            symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+            symbol->MaxNameLen = MAX_LABEL_SIZE;
+            DWORD64 displacement = 0;
+            SafeSymFromAddr(fdProcessInfo->hProcess, (DWORD64)request.Base, &displacement, symbol);
+
+            int done, total;
+            {
+                EXCLUSIVE_ACQUIRE(LockSymbolLoader);
+                symLoadQueue.Finish(done, total);
+            }
+
+            GuiSymbolSetProgress(total ? done * 100 / total : 100);
+            GuiAddStatusBarMessage(StringUtils::sprintf("Symbols loaded for %s (%d/%d)\n", request.Name.c_str(), done, total).c_str());
+
+            // Views that asked for this module got no symbols, show them now
+            GuiUpdateDisassemblyView();
+        }
+    }
+    return 0;
+}
+
+void SymLoaderInit()
+{
+    hSymLoaderEvent = CreateEventW(nullptr, false, false, nullptr);
+    hSymLoaderThread = CreateThread(nullptr, 0, symLoaderThread, nullptr, 0, nullptr);
+}
+
+void SymLoaderStop()
+{
+    bStopSymLoaderThread = true;
+    SetEvent(hSymLoaderEvent);
+    //the event stays open when the thread is still stuck in a download, it would wait on a closed handle
+    if(WaitForThreadTermination(hSymLoaderThread, SYMLOADER_STOP_TIMEOUT))
+        CloseHandle(hSymLoaderEvent);
+}
+
+void SymLoaderAdd(duint Base, const char* Name)
+{
+    duint size = ModSizeFromAddr(Base);
+
+    EXCLUSIVE_ACQUIRE(LockSymbolLoader);
+    symLoadQueue.Add(Base, size, Name);
+    EXCLUSIVE_RELEASE();
+
+    SetEvent(hSymLoaderEvent);
+}
+
+void SymLoaderRemove(duint Base)
+{
+    EXCLUSIVE_ACQUIRE(LockSymbolLoader);
+    symLoadQueue.Remove(Base);
+}
+
+void SymLoaderClear()
+{
+    EXCLUSIVE_ACQUIRE(LockSymbolLoader);
+    symLoadQueue.Clear();
+}
+
+bool SymLoaderIsPending(duint Address)
+{
+    SHARED_ACQUIRE(LockSymbolLoader);
+    return symLoadQueue.IsPending(Address);
+}
+
+void SymLoaderPrioritize(duint Address)
+{
+    EXCLUSIVE_ACQUIRE(LockSymbolLoader);
+    symLoadQueue.Prioritize(Address);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "_global.h"
+
+void SymLoaderInit();
+void SymLoaderStop();
+void SymLoaderAdd(duint Base, const char* Name);
+void SymLoaderRemove(duint Base);
+void SymLoaderClear();
+bool SymLoaderIsPending(duint Address);
+void SymLoaderPrioritize(duint Address);
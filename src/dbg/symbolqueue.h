@@ -0,0 +1,156 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+/**
+\brief The modules waiting for their symbols, ordered by priority, and the module being loaded. This header does not depend on the Windows types, so it can be tested on its own. It is not synchronized, the symbol loader guards it with LockSymbolLoader.
+*/
+template<typename Address>
+class SymbolLoadQueue
+{
+public:
+    struct Request
+    {
+        Address Base;
+        Address Size;
+        std::string Name;
+        long long Priority; // the highest priority is loaded first
+    };
+
+    SymbolLoadQueue()
+        : m_Current(0),
+          m_CurrentSize(0),
+          m_Sequence(0),
+          m_Done(0),
+          m_Total(0)
+    {
+    }
+
+    /**
+    \brief Queues a module. Modules are loaded in the order they were added, unless they are prioritized.
+    */
+    void Add(Address Base, Address Size, const std::string & Name)
+    {
+        Request request;
+        request.Base = Base;
+        request.Size = Size;
+        request.Name = Name;
+        request.Priority = -(++m_Sequence);
+        m_Requests.push_back(request);
+        m_Total++;
+    }
+
+    /**
+    \brief Drops a module that was not loaded yet (it was unloaded from the debuggee).
+    \return true if the module was queued.
+    */
+    bool Remove(Address Base)
+    {
+        for(auto i = m_Requests.begin(); i != m_Requests.end(); ++i)
+        {
+            if(i->Base == Base)
+            {
+                m_Requests.erase(i);
+                m_Total--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Clear()
+    {
+        m_Requests.clear();
+        m_Done = 0;
+        m_Total = 0;
+    }
+
+    /**
+    \brief Takes the module with the highest priority, it is the current module until Finish is called.
+    \return false if the queue is empty.
+    */
+    bool Next(Request & Result)
+    {
+        m_Current = 0;
+        m_CurrentSize = 0;
+        if(m_Requests.empty())
+            return false;
+
+        auto next = m_Requests.begin();
+        for(auto i = m_Requests.begin(); i != m_Requests.end(); ++i)
+        {
+            if(i->Priority > next->Priority)
+                next = i;
+        }
+
+        Result = *next;
+        m_Requests.erase(next);
+        m_Current = Result.Base;
+        m_CurrentSize = Result.Size;
+        return true;
+    }
+
+    /**
+    \brief Marks the current module as loaded.
+    \param [out] Done The number of modules loaded since the last Clear.
+    \param [out] Total The number of modules queued since the last Clear.
+    */
+    void Finish(int & Done, int & Total)
+    {
+        m_Current = 0;
+        m_CurrentSize = 0;
+        Done = ++m_Done;
+        Total = m_Total;
+    }
+
+    /**
+    \brief Checks whether the symbols of the module at Va are still queued or being loaded.
+    */
+    bool IsPending(Address Va) const
+    {
+        // Nothing is pending most of the time
+        if(!m_Current && m_Requests.empty())
+            return false;
+
+        if(Va >= m_Current && Va < m_Current + m_CurrentSize)
+            return true;
+
+        for(auto & request : m_Requests)
+        {
+            if(Va >= request.Base && Va < request.Base + request.Size)
+                return true;
+        }
+        return false;
+    }
+
+    /**
+    \brief Loads the module at Va next. The module that was asked for last wins.
+    \return true if the module was queued.
+    */
+    bool Prioritize(Address Va)
+    {
+        for(auto & request : m_Requests)
+        {
+            if(Va >= request.Base && Va < request.Base + request.Size)
+            {
+                request.Priority = ++m_Sequence;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t Size() const
+    {
+        return m_Requests.size();
+    }
+
+private:
+    std::vector<Request> m_Requests;
+    Address m_Current; // base of the module that is being loaded
+    Address m_CurrentSize;
+    long long m_Sequence;
+    int m_Done;
+    int m_Total;
+};
@@ -0,0 +1,136 @@
+#include "unittest.h"
+#include "commandhash.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cctype>
+
+// Compares the alias hash map behind cmdfind() with the linked list scan it replaced.
+// The command names are taken from the registrations in x64_dbg.cpp.
+
+static std::vector<std::string> loadcommands(const char* path)
+{
+    std::vector<std::string> commands;
+    std::ifstream file(path);
+    std::stringstream text;
+    text << file.rdbuf();
+    std::string source = text.str();
+    const std::string marker = "dbgcmdnew(\"";
+    for(size_t pos = source.find(marker); pos != std::string::npos; pos = source.find(marker, pos))
+    {
+        pos += marker.size();
+        size_t end = source.find('"', pos);
+        std::string name;
+        for(size_t i = pos; i < end; i++)
+        {
+            if(source[i] == '\\' && source.compare(i, 2, "\\1") == 0)
+            {
+                name.push_back('\1');
+                i++;
+            }
+            else
+                name.push_back(source[i]);
+        }
+        commands.push_back(name);
+    }
+    return commands;
+}
+
+static std::vector<std::string> splitaliases(const std::string & name)
+{
+    std::vector<std::string> aliases;
+    std::string current;
+    for(auto ch : name)
+    {
+        if(ch == '\1')
+        {
+            aliases.push_back(current);
+            current.clear();
+        }
+        else
+            current.push_back(ch);
+    }
+    aliases.push_back(current);
+    return aliases;
+}
+
+static bool stricmpequal(const char* a, const char* b)
+{
+    for(; *a && *b; a++, b++)
+        if(tolower((unsigned char)*a) != tolower((unsigned char)*b))
+            return false;
+    return *a == *b;
+}
+
+// The old lookup: walk every command and compare every alias (arraycontains)
+static const std::string* listfind(const std::vector<std::string> & list, const char* name)
+{
+    for(const auto & command : list)
+    {
+        char temp[256];
+        size_t len = command.size() < sizeof(temp) - 1 ? command.size() : sizeof(temp) - 1;
+        memcpy(temp, command.c_str(), len);
+        temp[len] = '\0';
+        const char* alias = temp;
+        for(size_t i = 0; i <= len; i++)
+        {
+            if(temp[i] == '\1' || !temp[i])
+            {
+                temp[i] = '\0';
+                if(stricmpequal(alias, name))
+                    return &command;
+                alias = temp + i + 1;
+            }
+        }
+    }
+    return nullptr;
+}
+
+int main(int argc, char* argv[])
+{
+    auto commands = loadcommands(argc > 1 ? argv[1] : "../../x64_dbg.cpp");
+    if(commands.empty())
+    {
+        puts("no commands found, pass the path of x64_dbg.cpp");
+        return 1;
+    }
+
+    std::unordered_map<std::string, const std::string*, CommandHash, CommandEqual> map;
+    std::vector<std::string> lookups;
+    for(const auto & command : commands)
+    {
+        for(const auto & alias : splitaliases(command))
+        {
+            map[alias] = &command;
+            std::string upper = alias;
+            for(auto & ch : upper)
+                ch = (char)toupper((unsigned char)ch);
+            lookups.push_back(upper);
+        }
+    }
+    lookups.push_back("notacommand");
+    printf("%zu commands, %zu aliases\n", commands.size(), map.size());
+
+    // Both lookups have to agree before they are timed
+    for(const auto & name : lookups)
+    {
+        auto found = map.find(name);
+        CHECK((found == map.end() ? nullptr : found->second) == listfind(commands, name.c_str()));
+    }
+
+    size_t next = 0, hits = 0;
+    unitbench("list scan (old cmdfind)", 200000, [&]()
+    {
+        hits += listfind(commands, lookups[next++ % lookups.size()].c_str()) != nullptr;
+    });
+    next = 0;
+    unitbench("alias hash map (cmdfind)", 200000, [&]()
+    {
+        hits += map.count(lookups[next++ % lookups.size()]);
+    });
+    printf("(%zu hits)\n", hits);
+    return unitresult("bench_commandmap");
+}
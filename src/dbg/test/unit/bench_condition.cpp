@@ -0,0 +1,116 @@
+#include "unittest.h"
+#include "expressionparser.h"
+#include "value.h"
+#include <strings.h>
+
+// Cost of evaluating a breakpoint condition on every hit, the work left on the fast resume path.
+// The register context is fake: the names are searched like getregister() used to, one compare per name.
+
+static const char* registerNames[] =
+{
+    "eax", "ebx", "ecx", "edx", "edi", "esi", "ebp", "esp", "eip", "eflags", "gs", "fs", "es", "ds", "cs", "ss",
+    "ax", "bx", "cx", "dx", "si", "di", "bp", "sp", "ip", "ah", "al", "bh", "bl", "ch", "cl", "dh", "dl",
+    "sih", "sil", "dih", "dil", "bph", "bpl", "sph", "spl", "iph", "ipl", "dr0", "dr1", "dr2", "dr3", "dr6", "dr4",
+    "dr7", "dr5", "cip", "csp", "cflags", "rax", "rbx", "rcx", "rdx", "rdi", "rsi", "rbp", "rsp", "rip", "rflags",
+    "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15", "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"
+};
+static const int registerCount = int(sizeof(registerNames) / sizeof(*registerNames));
+static duint registerValues[registerCount];
+static bool resolveRegisters = true; // false: registers are looked up by name on every evaluation
+
+static int findregister(const char* string)
+{
+    for(int i = 0; i < registerCount; i++)
+        if(!strcasecmp(string, registerNames[i]))
+            return i;
+    return -1;
+}
+
+bool valconstfromstring(const char* string, duint* value)
+{
+    if(!*string || findregister(string) != -1)
+        return false;
+    char* end;
+    *value = strtoull(string, &end, 16);
+    return !*end;
+}
+
+bool valregisterfromstring(const char* string, int* index)
+{
+    *index = resolveRegisters ? findregister(string) : -1;
+    return *index != -1;
+}
+
+bool valregisterget(int index, duint* value, bool, int* value_size, bool* isvar)
+{
+    *value = registerValues[index];
+    if(value_size)
+        *value_size = sizeof(duint);
+    if(isvar)
+        *isvar = true;
+    return true;
+}
+
+bool valfromstring_noexpr(const char* string, duint* value, bool silent, bool, int* value_size, bool* isvar, bool*)
+{
+    int index = findregister(string);
+    if(index == -1)
+        return false;
+    return valregisterget(index, value, silent, value_size, isvar);
+}
+
+int main()
+{
+    for(int i = 0; i < registerCount; i++)
+        registerValues[i] = duint(i) * 0x1111;
+
+    const char* conditions[] =
+    {
+        "eax-0",
+        "(ecx&FF)-11",
+        "edx*4+ebx-r15d",
+        "rsp+8-(rbp&FFFFFFF0)"
+    };
+    const int conditionCount = int(sizeof(conditions) / sizeof(*conditions));
+
+    std::vector<ExpressionParser> compiled;
+    for(int i = 0; i < conditionCount; i++)
+        compiled.push_back(ExpressionParser(conditions[i]));
+    resolveRegisters = false;
+    std::vector<ExpressionParser> byName;
+    for(int i = 0; i < conditionCount; i++)
+        byName.push_back(ExpressionParser(conditions[i]));
+
+    // All three ways have to agree before they are timed
+    for(int i = 0; i < conditionCount; i++)
+    {
+        duint a = 0, b = 0, c = 1;
+        CHECK(compiled[i].calculate(a, false, true, false, nullptr, nullptr, nullptr));
+        CHECK(byName[i].calculate(b, false, true, false, nullptr, nullptr, nullptr));
+        CHECK(ExpressionParser(conditions[i]).calculate(c, false, true, false, nullptr, nullptr, nullptr));
+        CHECK(a == b && b == c);
+    }
+
+    duint sink = 0;
+    int next = 0;
+    unitbench("parse every hit", 500000, [&]()
+    {
+        duint value;
+        ExpressionParser(conditions[next++ % conditionCount]).calculate(value, false, true, false, nullptr, nullptr, nullptr);
+        sink += value;
+    });
+    unitbench("cached, registers by name", 500000, [&]()
+    {
+        duint value;
+        byName[next++ % conditionCount].calculate(value, false, true, false, nullptr, nullptr, nullptr);
+        sink += value;
+    });
+    unitbench("cached, registers resolved", 500000, [&]()
+    {
+        duint value;
+        compiled[next++ % conditionCount].calculate(value, false, true, false, nullptr, nullptr, nullptr);
+        sink += value;
+    });
+    printf("(%llu)\n", (unsigned long long)sink);
+    return unitresult("bench_condition");
+}
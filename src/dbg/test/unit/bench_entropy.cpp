@@ -0,0 +1,35 @@
+#include "unittest.h"
+#include "entropyreference.h"
+
+// Compares the sliding window MeasurePoints with one block copy and histogram per point.
+// The entropy view graphs 1 MiB blocks of a 64 MiB file with 1024 points.
+
+int main()
+{
+    auto data = entropyData(64 * 1024 * 1024, 4);
+    const int blockSize = 1024 * 1024;
+    const int pointCount = 1024;
+    std::vector<double> copied, sliding;
+    double copyTime = unitbench("block copy per point", 3, [&]()
+    {
+        measurePointsCopy(data.data(), (int)data.size(), blockSize, copied, pointCount);
+    });
+    double slidingTime = unitbench("sliding window (threads)", 3, [&]()
+    {
+        Entropy::MeasurePoints(data.data(), (int)data.size(), blockSize, sliding, pointCount);
+    });
+    size_t position = 0;
+    std::vector<double> streamed;
+    unitbench("sliding window (stream)", 1, [&]()
+    {
+        Entropy::MeasureStream([&](unsigned char* buffer, long long size)
+        {
+            memcpy(buffer, data.data() + position, (size_t)size);
+            position += (size_t)size;
+            return size;
+        }, (long long)data.size(), blockSize, streamed, pointCount);
+    });
+    printf("(%zu points, %.1fx)\n", sliding.size(), copyTime / slidingTime);
+    CHECK(sliding.size() == copied.size() && streamed.size() == copied.size());
+    return unitresult("bench_entropy");
+}
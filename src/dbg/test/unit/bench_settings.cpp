@@ -0,0 +1,69 @@
+#include "unittest.h"
+#include "settings.h"
+
+// Utf8Ini::Deserialize reports parse errors with a message box, it is not used here
+static int MessageBoxA(void*, const char*, const char*, int)
+{
+    return 0;
+}
+
+#include "Utf8Ini.h"
+
+// Compares a cached setting handle with the settingboolget() path it replaced on the debug event handlers:
+// the ini lock, the Utf8Ini lookup, the copy and sscanf of BridgeSettingGetUint.
+
+static Utf8Ini ini;
+static std::mutex iniLock;
+
+bool BridgeSettingGetUint(const char* section, const char* key, duint* value)
+{
+    char newvalue[2048] = "";
+    {
+        std::lock_guard<std::mutex> lock(iniLock);
+        auto foundValue = ini.GetValue(section, key);
+        if(!foundValue.length())
+            return false;
+        strcpy(newvalue, foundValue.c_str());
+    }
+    return sscanf(newvalue, "%llX", value) == 1;
+}
+
+bool BridgeSettingAddCallback(CBSETTINGCHANGED)
+{
+    return true;
+}
+
+static bool settingboolget(const char* section, const char* name)
+{
+    duint setting;
+    if(!BridgeSettingGetUint(section, name, &setting))
+        return false;
+    return setting != 0;
+}
+
+int main()
+{
+    // A settings file of a typical size
+    const char* sections[] = { "Engine", "Events", "Disassembler", "Gui", "Colors", "Shortcuts" };
+    for(const char* section : sections)
+        for(int i = 0; i < 40; i++)
+            ini.SetValue(section, "Setting" + std::to_string(i), "0");
+    ini.SetValue("Events", "DllLoad", "1");
+    ini.SetValue("Events", "ThreadStart", "0");
+    SettingInit();
+
+    size_t hits = 0;
+    double oldTime = unitbench("settingboolget (ini lookup)", 1000000, [&]()
+    {
+        hits += settingboolget("Events", "DllLoad");
+        hits += settingboolget("Events", "ThreadStart");
+    });
+    double newTime = unitbench("SettingGetBool (handle)", 1000000, [&]()
+    {
+        hits += SettingGetBool(SettingEventsDllLoad);
+        hits += SettingGetBool(SettingEventsThreadStart);
+    });
+    printf("(%zu hits, %.0fx)\n", hits, oldTime / newTime);
+    CHECK(hits == 2000000);
+    return unitresult("bench_settings");
+}
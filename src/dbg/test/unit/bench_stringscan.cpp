@@ -0,0 +1,23 @@
+#include "unittest.h"
+#include "stringscalar.h"
+
+// Compares the SSE2 string scan of StringMap with the byte by byte scan on 16 MiB of module-like bytes.
+
+int main()
+{
+    auto data = moduleData(16 * 1024 * 1024, 42);
+    StringRanges simd, scalar;
+    double scalarTime = unitbench("scalar scan (16 MiB)", 10, [&]()
+    {
+        scalar.clear();
+        scanAsciiScalar(data.data(), data.size(), scalar);
+    });
+    double simdTime = unitbench("SSE2 scan (16 MiB)", 10, [&]()
+    {
+        simd.clear();
+        scanAscii(data.data(), data.size(), simd);
+    });
+    printf("(%zu strings, %.1fx)\n", simd.size(), scalarTime / simdTime);
+    CHECK(simd == scalar);
+    return unitresult("bench_stringscan");
+}
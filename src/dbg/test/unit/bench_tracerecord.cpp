@@ -0,0 +1,53 @@
+#include "unittest.h"
+#include "tracesynthetic.h"
+
+// Cost of recording one trace event on the step path, and of reading events back from a trace file.
+// The LZ4 stand-in in stub/ stores the blocks as they are, so this measures the delta encoding and the file format.
+
+static const char* BenchFile = "bench_tracerecord.trace";
+
+int main()
+{
+    const size_t count = 1 << 16;
+    std::vector<TRACEEVENT> events;
+    events.reserve(count);
+    for(size_t i = 0; i < count; i++)
+        events.push_back(syntheticEvent(i));
+
+    TraceRecorder recorder;
+    recorder.SetMaxSize(size_t(-1));
+    size_t next = 0;
+    unitbench("TraceRecorder::Record", 1000000, [&]()
+    {
+        recorder.Record(events[next++ % count]);
+    });
+    recorder.Flush();
+    printf("%-40s %12.1f bytes/event\n", "encoded size", double(recorder.MemoryUsage()) / double(recorder.EventCount()));
+
+    recorder.Clear();
+    for(size_t i = 0; i < count; i++)
+        recorder.Record(events[i]);
+    unitbench("TraceRecorder::Save (65536 events)", 50, [&]()
+    {
+        recorder.Save(BenchFile);
+    });
+
+    TraceReader reader;
+    CHECK(reader.Open(BenchFile));
+    TRACEEVENT event;
+    ULONGLONG index = 0;
+    unitbench("TraceReader::Read (sequential)", 1000000, [&]()
+    {
+        reader.Read(index++ % count, event);
+    });
+    index = 0;
+    unitbench("TraceReader::Read (random block)", 20000, [&]()
+    {
+        index = (index + 40503) % count;
+        reader.Read(index, event);
+    });
+    CHECK(reader.Read(count - 1, event) && sameEvent(event, events[count - 1]));
+    reader.Close();
+    remove(BenchFile);
+    return unitresult("bench_tracerecord");
+}
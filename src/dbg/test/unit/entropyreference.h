@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Entropy.h"
+
+// The MeasurePoints that the sliding window replaced: one block copy and one histogram per point
+static double measureByteCopy(const unsigned char* data, int dataSize, int index, unsigned char* block, int blockSize)
+{
+    if(dataSize < blockSize)
+        return -1;
+    int start = index - blockSize / 2;
+    int end = index + blockSize / 2;
+    if(start < 0)
+    {
+        end += -start;
+        start = 0;
+    }
+    else if(end > dataSize)
+    {
+        start -= end - dataSize;
+        end = dataSize;
+    }
+    for(int i = start; i < end; i++)
+        block[i - start] = data[i];
+    return Entropy::MeasureData(block, blockSize);
+}
+
+static void measurePointsCopy(const unsigned char* data, int dataSize, int blockSize, std::vector<double> & points, int pointCount)
+{
+    points.clear();
+    if(dataSize < pointCount)
+        return;
+    if(dataSize % pointCount != 0)
+        pointCount += dataSize % pointCount;
+
+    std::vector<unsigned char> block(blockSize);
+    int interval = dataSize / pointCount;
+    points.reserve(pointCount);
+    for(int i = 0; i < dataSize; i += interval)
+        points.push_back(measureByteCopy(data, dataSize, i, block.data(), blockSize));
+}
+
+// Sections with different entropy: zeros, text, a repeating table and random bytes
+static std::vector<unsigned char> entropyData(size_t size, unsigned int seed)
+{
+    std::vector<unsigned char> data(size);
+    unsigned int state = seed;
+    for(size_t i = 0; i < size; i++)
+    {
+        state = state * 1103515245 + 12345;
+        switch((i / 4096) % 4)
+        {
+        case 0:
+            data[i] = 0;
+            break;
+        case 1:
+            data[i] = (unsigned char)('a' + (state >> 16) % 26);
+            break;
+        case 2:
+            data[i] = (unsigned char)(i % 16);
+            break;
+        default:
+            data[i] = (unsigned char)(state >> 16);
+            break;
+        }
+    }
+    return data;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "stringscan.h"
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstdlib>
+
+typedef std::vector<std::pair<size_t, size_t>> StringRanges;
+
+// The byte by byte scan that StringScanAscii replaced
+static void scanAsciiScalar(const unsigned char* data, size_t size, StringRanges & strings)
+{
+    size_t start = 0;
+    bool inString = false;
+    for(size_t i = 0; i < size; i++)
+    {
+        if(isstringchar(data[i]))
+        {
+            if(!inString)
+            {
+                inString = true;
+                start = i;
+            }
+        }
+        else if(inString)
+        {
+            inString = false;
+            if(!data[i] && i - start >= 2)
+                strings.push_back(std::make_pair(start, i));
+        }
+    }
+}
+
+static void scanAscii(const unsigned char* data, size_t size, StringRanges & strings)
+{
+    StringScanAscii(data, size, [&](size_t Start, size_t End)
+    {
+        strings.push_back(std::make_pair(Start, End));
+    });
+}
+
+// Module-like bytes: mostly code and data with some ASCII and UTF-16 strings
+static std::vector<unsigned char> moduleData(size_t size, unsigned int seed)
+{
+    std::vector<unsigned char> data(size);
+    srand(seed);
+    for(size_t i = 0; i < size;)
+    {
+        int kind = rand() % 8;
+        size_t length = std::min(size_t(1 + rand() % 64), size - i);
+        for(size_t j = 0; j < length; j++)
+        {
+            if(kind == 0)
+                data[i + j] = j + 1 == length ? 0 : (unsigned char)(0x20 + rand() % 0x5F);
+            else if(kind == 1)
+                data[i + j] = (j % 2 || j + 2 >= length) ? 0 : (unsigned char)(0x20 + rand() % 0x5F);
+            else if(kind == 2)
+                data[i + j] = 0;
+            else
+                data[i + j] = (unsigned char)rand();
+        }
+        i += length;
+    }
+    return data;
+}
@@ -0,0 +1,248 @@
+#pragma once
+
+// Stand-in for src/dbg/_global.h, so the platform independent sources can be built on their own.
+// Only what those sources use is provided, file handles are stdio streams.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <stack>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <unordered_map>
+#include <mutex> // stub/threading.h, before the min and max macros
+#include <atomic>
+
+typedef std::string String;
+typedef unsigned long long duint;
+typedef long long dsint;
+typedef long long LONGLONG;
+typedef unsigned long long ULONGLONG;
+typedef long long __int64;
+typedef unsigned int DWORD;
+typedef long LONG;
+typedef unsigned short WORD;
+typedef unsigned char BYTE;
+typedef FILE* HANDLE;
+
+#define fext "ll"
+#define fhex "%llX"
+#define INVALID_HANDLE_VALUE ((FILE*)0)
+
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#define sprintf_s(b, ...) snprintf(b, sizeof(b), __VA_ARGS__)
+#define sscanf_s sscanf
+#define _strtoi64 strtoll
+#define _stricmp strcasecmp
+
+#define GENERIC_WRITE 1
+#define GENERIC_READ 0
+#define CREATE_ALWAYS 1
+#define OPEN_EXISTING 0
+#define FILE_ATTRIBUTE_NORMAL 0
+#define FILE_FLAG_SEQUENTIAL_SCAN 0
+#define FILE_SHARE_READ 0
+#define FILE_BEGIN 0
+
+namespace StringUtils
+{
+inline String Utf8ToUtf16(const char* s)
+{
+    return s;
+}
+}
+
+inline HANDLE CreateFileW(const char* name, int, int, void*, int disposition, int, void*)
+{
+    return fopen(name, disposition == CREATE_ALWAYS ? "wb" : "rb");
+}
+
+inline bool WriteFile(HANDLE file, const void* data, DWORD size, DWORD* written, void*)
+{
+    *written = (DWORD)fwrite(data, 1, size, file);
+    return *written == size;
+}
+
+inline bool ReadFile(HANDLE file, void* data, DWORD size, DWORD* read, void*)
+{
+    *read = (DWORD)fread(data, 1, size, file);
+    return true;
+}
+
+inline void CloseHandle(HANDLE file)
+{
+    fclose(file);
+}
+
+inline DWORD SetFilePointer(HANDLE file, long offset, void*, int)
+{
+    fseek(file, offset, SEEK_SET);
+    return (DWORD)offset;
+}
+
+union LARGE_INTEGER
+{
+    LONGLONG QuadPart;
+};
+
+inline bool SetFilePointerEx(HANDLE file, LARGE_INTEGER offset, LARGE_INTEGER*, int)
+{
+    return fseek(file, (long)offset.QuadPart, SEEK_SET) == 0;
+}
+
+inline bool GetFileSizeEx(HANDLE file, LARGE_INTEGER* size)
+{
+    long position = ftell(file);
+    if(fseek(file, 0, SEEK_END))
+        return false;
+    size->QuadPart = ftell(file);
+    return fseek(file, position, SEEK_SET) == 0;
+}
+
+// Bridge settings, the tests implement these against a fake ini
+typedef void (*CBSETTINGCHANGED)(const char* section, const char* key);
+bool BridgeSettingGetUint(const char* section, const char* key, duint* value);
+bool BridgeSettingAddCallback(CBSETTINGCHANGED cbChanged);
+
+// Memory, TLS and interlocked functions for allocator.cpp. The SList is guarded by a mutex instead of being lock-free.
+typedef void* PVOID;
+typedef uintptr_t ULONG_PTR;
+
+#define MEM_COMMIT 0x1000
+#define MEM_RESERVE 0x2000
+#define MEM_RELEASE 0x8000
+#define PAGE_READWRITE 4
+#define GMEM_FIXED 0
+#define TLS_OUT_OF_INDEXES ((DWORD)0xFFFFFFFF)
+#define TLS_MINIMUM_AVAILABLE 64
+
+inline PVOID VirtualAlloc(PVOID, size_t size, DWORD, DWORD)
+{
+    return calloc(1, size);
+}
+
+inline bool VirtualFree(PVOID address, size_t, DWORD)
+{
+    free(address);
+    return true;
+}
+
+inline PVOID GlobalAlloc(DWORD, size_t size)
+{
+    return malloc(size);
+}
+
+inline PVOID GlobalFree(PVOID memory)
+{
+    free(memory);
+    return nullptr;
+}
+
+inline PVOID* tlsslots()
+{
+    static thread_local PVOID slots[TLS_MINIMUM_AVAILABLE];
+    return slots;
+}
+
+inline DWORD TlsAlloc()
+{
+    static std::atomic<DWORD> next(0);
+    DWORD index = next++;
+    return index < TLS_MINIMUM_AVAILABLE ? index : TLS_OUT_OF_INDEXES;
+}
+
+inline bool TlsFree(DWORD)
+{
+    return true;
+}
+
+inline PVOID TlsGetValue(DWORD index)
+{
+    return tlsslots()[index];
+}
+
+inline bool TlsSetValue(DWORD index, PVOID value)
+{
+    tlsslots()[index] = value;
+    return true;
+}
+
+inline LONG InterlockedCompareExchange(volatile LONG* destination, LONG exchange, LONG comparand)
+{
+    __atomic_compare_exchange_n(destination, &comparand, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return comparand;
+}
+
+inline PVOID InterlockedCompareExchangePointer(PVOID volatile* destination, PVOID exchange, PVOID comparand)
+{
+    __atomic_compare_exchange_n(destination, &comparand, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return comparand;
+}
+
+inline LONGLONG InterlockedIncrement64(volatile LONGLONG* addend)
+{
+    return __atomic_add_fetch(addend, 1, __ATOMIC_SEQ_CST);
+}
+
+inline LONGLONG InterlockedExchangeAdd64(volatile LONGLONG* addend, LONGLONG value)
+{
+    return __atomic_fetch_add(addend, value, __ATOMIC_SEQ_CST);
+}
+
+inline unsigned char _BitScanReverse(DWORD* index, DWORD mask)
+{
+    if(!mask)
+        return 0;
+    *index = 31 - __builtin_clz(mask);
+    return 1;
+}
+
+struct SLIST_ENTRY
+{
+    SLIST_ENTRY* Next;
+};
+typedef SLIST_ENTRY* PSLIST_ENTRY;
+
+struct SLIST_HEADER
+{
+    SLIST_ENTRY* First;
+};
+
+inline std::mutex & slistlock()
+{
+    static std::mutex lock;
+    return lock;
+}
+
+inline PSLIST_ENTRY InterlockedPushEntrySList(SLIST_HEADER* head, PSLIST_ENTRY entry)
+{
+    std::lock_guard<std::mutex> guard(slistlock());
+    auto first = head->First;
+    entry->Next = first;
+    head->First = entry;
+    return first;
+}
+
+inline PSLIST_ENTRY InterlockedPopEntrySList(SLIST_HEADER* head)
+{
+    std::lock_guard<std::mutex> guard(slistlock());
+    auto first = head->First;
+    if(first)
+        head->First = first->Next;
+    return first;
+}
+
+// Declared in src/dbg/_global.h, implemented in allocator.cpp
+void* ArenaAlloc(size_t size, const char* reason);
+void ArenaFree(void* ptr);
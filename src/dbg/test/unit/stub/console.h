@@ -0,0 +1,7 @@
+#pragma once
+
+#include "_global.h"
+
+// Stand-in for src/dbg/console.h, the tests implement these
+void dputs(const char* Text);
+void dprintf(const char* Format, ...);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <mutex>
+
+// Stand-in for src/dbg/threading.h, every lock is a plain mutex and shared acquisitions are exclusive
+
+enum SectionLock
+{
+    LockSettings,
+    LockLast
+};
+
+class SectionLocker
+{
+public:
+    explicit SectionLocker(SectionLock Lock)
+        : m_Lock(mutexes()[Lock])
+    {
+    }
+
+    void Unlock()
+    {
+        m_Lock.unlock();
+    }
+
+private:
+    static std::mutex* mutexes()
+    {
+        static std::mutex locks[LockLast];
+        return locks;
+    }
+
+    std::unique_lock<std::mutex> m_Lock;
+};
+
+#define EXCLUSIVE_ACQUIRE(Index)    SectionLocker __ThreadLock(Index)
+#define EXCLUSIVE_RELEASE()         __ThreadLock.Unlock()
+#define SHARED_ACQUIRE(Index)       SectionLocker __SThreadLock(Index)
+#define SHARED_RELEASE()            __SThreadLock.Unlock()
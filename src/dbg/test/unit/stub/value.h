@@ -0,0 +1,9 @@
+#pragma once
+
+#include "_global.h"
+
+// Stand-in for src/dbg/value.h, the tests implement these against a fake register context
+bool valfromstring_noexpr(const char* string, duint* value, bool silent = true, bool baseonly = false, int* value_size = 0, bool* isvar = 0, bool* hexonly = 0);
+bool valconstfromstring(const char* string, duint* value);
+bool valregisterfromstring(const char* string, int* index);
+bool valregisterget(int index, duint* value, bool silent, int* value_size, bool* isvar);
@@ -0,0 +1,312 @@
+#include "unittest.h"
+#include "allocator.h"
+#include <cstdarg>
+#include <cstdint>
+#include <thread>
+
+// AllocStatsPrint output
+static std::string printed;
+
+void dputs(const char* Text)
+{
+    printed += Text;
+    printed += '\n';
+}
+
+void dprintf(const char* Format, ...)
+{
+    char buffer[1024];
+    va_list args;
+    va_start(args, Format);
+    vsnprintf(buffer, sizeof(buffer), Format, args);
+    va_end(args);
+    printed += buffer;
+}
+
+// The statistics of a tag, merged by text like AllocStatsGet does
+static ALLOCSTATS stats(const char* Tag, bool Arena)
+{
+    std::vector<ALLOCSTATS> all;
+    AllocStatsGet(all);
+    for(const auto & entry : all)
+        if(entry.arena == Arena && strcmp(entry.tag, Tag) == 0)
+            return entry;
+    ALLOCSTATS none;
+    memset(&none, 0, sizeof(none));
+    none.tag = Tag;
+    none.arena = Arena;
+    return none;
+}
+
+static bool aligned(void* Ptr)
+{
+    return (uintptr_t(Ptr) & 15) == 0;
+}
+
+static void testPoolReuse()
+{
+    // A freed block is the next one handed out for its size class
+    void* first = PoolAlloc(16, "test:pool");
+    CHECK(first && aligned(first));
+    PoolFree(first);
+    void* second = PoolAlloc(1, "test:pool");
+    CHECK(second == first);
+    void* third = PoolAlloc(10, "test:pool");
+    CHECK(third && third != first && aligned(third));
+    PoolFree(third);
+    PoolFree(second);
+
+    // The free list is LIFO
+    void* a = PoolAlloc(100, "test:pool");
+    void* b = PoolAlloc(100, "test:pool");
+    PoolFree(a);
+    PoolFree(b);
+    CHECK(PoolAlloc(100, "test:pool") == b);
+    CHECK(PoolAlloc(100, "test:pool") == a);
+    PoolFree(a);
+    PoolFree(b);
+
+    PoolFree(nullptr);
+}
+
+static void testPoolClasses()
+{
+    // Every size up to the class size shares the block, one byte more does not
+    bool reused = true;
+    bool separate = true;
+    for(size_t classSize = 16; classSize <= ALLOC_POOL_MAX; classSize *= 2)
+    {
+        void* block = PoolAlloc(classSize / 2 + 1, "test:classes");
+        PoolFree(block);
+        void* same = PoolAlloc(classSize, "test:classes");
+        reused &= same == block;
+        if(classSize < ALLOC_POOL_MAX)
+        {
+            void* larger = PoolAlloc(classSize + 1, "test:classes");
+            separate &= larger != block;
+            PoolFree(larger);
+        }
+        PoolFree(same);
+    }
+    CHECK(reused);
+    CHECK(separate);
+
+    // Larger requests do not come from the pools
+    void* big = PoolAlloc(ALLOC_POOL_MAX + 1, "test:big");
+    CHECK(big && aligned(big));
+    memset(big, 0xCC, ALLOC_POOL_MAX + 1);
+    PoolFree(big);
+    ALLOCSTATS bigStats = stats("test:big", false);
+    CHECK(bigStats.allocations == 1 && bigStats.frees == 1);
+    CHECK(bigStats.totalBytes == ALLOC_POOL_MAX + 1 && bigStats.liveBytes == 0);
+}
+
+static void testPoolBlocksDoNotOverlap()
+{
+    // Fill every block completely, the headers of the neighbours must survive
+    std::vector<void*> blocks;
+    for(int i = 0; i < 3000; i++)
+    {
+        size_t size = size_t(1) << (i % 13);
+        void* block = PoolAlloc(size, "test:fill");
+        memset(block, i & 0xFF, size);
+        blocks.push_back(block);
+    }
+    bool intact = true;
+    for(int i = 0; i < 3000; i++)
+    {
+        size_t size = size_t(1) << (i % 13);
+        auto bytes = (unsigned char*)blocks[i];
+        intact &= bytes[0] == (i & 0xFF) && bytes[size - 1] == (i & 0xFF);
+    }
+    CHECK(intact);
+    for(auto block : blocks)
+        PoolFree(block);
+    ALLOCSTATS fill = stats("test:fill", false);
+    CHECK(fill.allocations == 3000 && fill.frees == 3000 && fill.liveBytes == 0);
+}
+
+static void testPoolStats()
+{
+    // Tags with the same text are merged, frees are charged to the tag of the allocation
+    static const char tagA[] = "test:stats";
+    static const char tagB[] = "test:stats";
+    void* a = PoolAlloc(10, tagA);
+    void* b = PoolAlloc(300, tagB);
+    void* c = PoolAlloc(20, "test:other");
+    PoolFree(a);
+    ALLOCSTATS merged = stats("test:stats", false);
+    CHECK(merged.allocations == 2 && merged.frees == 1);
+    CHECK(merged.totalBytes == 310 && merged.liveBytes == 300);
+    CHECK(stats("test:stats", true).allocations == 0);
+    PoolFree(b);
+    PoolFree(c);
+    merged = stats("test:stats", false);
+    CHECK(merged.frees == 2 && merged.liveBytes == 0);
+    ALLOCSTATS other = stats("test:other", false);
+    CHECK(other.allocations == 1 && other.frees == 1 && other.totalBytes == 20);
+
+    // Allocations without a reason
+    PoolFree(PoolAlloc(8, nullptr));
+    CHECK(stats("???", false).allocations == 1);
+}
+
+static void testPrint()
+{
+    void* leak = PoolAlloc(48, "test:leak");
+    printed.clear();
+    AllocStatsPrint(true);
+    CHECK(printed.find("test:leak: 1 allocation(s), 1 live (48 bytes), 48 bytes total") != std::string::npos);
+    CHECK(printed.find("test:stats") == std::string::npos);
+    printed.clear();
+    AllocStatsPrint(false);
+    CHECK(printed.find("test:stats: 2 allocation(s), 0 live (0 bytes), 310 bytes total") != std::string::npos);
+    CHECK(printed.find("test:leak") < printed.find("test:stats")); // sorted by live bytes
+    PoolFree(leak);
+}
+
+static void testArenaLifo()
+{
+    CHECK(ArenaAlloc(0, "test:arena") == nullptr);
+    CHECK(ArenaAlloc(ARENA_MAX_ALLOC + 1, "test:arena") == nullptr);
+
+    // Frees in reverse order give the space back at once
+    void* outer = ArenaAlloc(100, "test:arena");
+    void* inner = ArenaAlloc(100, "test:arena");
+    CHECK(outer && inner && aligned(outer) && aligned(inner));
+    CHECK((unsigned char*)inner == (unsigned char*)outer + 128); // 16 byte header, size rounded to 16
+    ArenaFree(inner);
+    CHECK(ArenaAlloc(50, "test:arena") == inner);
+    ArenaFree(inner);
+    ArenaFree(outer);
+    CHECK(ArenaAlloc(1, "test:arena") == outer);
+    ArenaFree(outer);
+}
+
+static void testArenaOutOfOrder()
+{
+    void* outer = ArenaAlloc(100, "test:arena");
+    void* a = ArenaAlloc(100, "test:arena");
+    void* b = ArenaAlloc(100, "test:arena");
+
+    // A free that is not the newest allocation leaves a hole until the arena is empty
+    ArenaFree(a);
+    void* c = ArenaAlloc(100, "test:arena");
+    CHECK(c == (unsigned char*)b + 128);
+    ArenaFree(c);
+    ArenaFree(b);
+    CHECK(ArenaAlloc(100, "test:arena") == b);
+    ArenaFree(b);
+    ArenaFree(outer);
+    CHECK(ArenaAlloc(100, "test:arena") == outer);
+    ArenaFree(outer);
+
+    ALLOCSTATS arena = stats("test:arena", true);
+    CHECK(arena.allocations == arena.frees && arena.liveBytes == 0);
+    CHECK(arena.totalBytes == 100 * 2 + 50 + 1 + 100 * 6);
+    CHECK(stats("test:arena", false).allocations == 0);
+}
+
+static void testArenaBlocks()
+{
+    // Every allocation of the maximum size needs a new block
+    void* a = ArenaAlloc(ARENA_MAX_ALLOC, "test:blocks");
+    void* b = ArenaAlloc(ARENA_MAX_ALLOC, "test:blocks");
+    void* c = ArenaAlloc(ARENA_MAX_ALLOC, "test:blocks");
+    CHECK(a && b && c);
+    memset(a, 1, ARENA_MAX_ALLOC);
+    memset(b, 2, ARENA_MAX_ALLOC);
+    memset(c, 3, ARENA_MAX_ALLOC);
+    CHECK(((unsigned char*)a)[ARENA_MAX_ALLOC - 1] == 1 && ((unsigned char*)b)[0] == 2);
+
+    // Only the newest block is kept once the arena is empty
+    ArenaFree(c);
+    ArenaFree(a);
+    ArenaFree(b);
+    void* next = ArenaAlloc(ARENA_MAX_ALLOC, "test:blocks");
+    CHECK(next == c);
+    ArenaFree(next);
+    ALLOCSTATS blocks = stats("test:blocks", true);
+    CHECK(blocks.allocations == 4 && blocks.frees == 4 && blocks.liveBytes == 0);
+}
+
+static void testArenaThreads()
+{
+    // Every thread has its own arena, a live allocation on one thread does not affect another
+    void* mine = ArenaAlloc(64, "test:threads");
+    void* theirs = nullptr;
+    void* theirsAgain = nullptr;
+    std::thread thread([&]()
+    {
+        theirs = ArenaAlloc(64, "test:threads");
+        ArenaFree(theirs);
+        theirsAgain = ArenaAlloc(64, "test:threads");
+        ArenaFree(theirsAgain);
+        ArenaThreadExit();
+    });
+    thread.join();
+    CHECK(theirs && theirs == theirsAgain && theirs != mine);
+    void* next = ArenaAlloc(64, "test:threads");
+    CHECK(next == (unsigned char*)mine + 80);
+    ArenaFree(next);
+    ArenaFree(mine);
+    ALLOCSTATS threads = stats("test:threads", true);
+    CHECK(threads.allocations == 4 && threads.frees == 4 && threads.liveBytes == 0);
+}
+
+static void testConcurrentPools()
+{
+    // The pools and the tag table are shared by all threads
+    const int threadCount = 4;
+    const int rounds = 20000;
+    std::vector<std::thread> threads;
+    bool intact[threadCount];
+    for(int t = 0; t < threadCount; t++)
+    {
+        threads.push_back(std::thread([&intact, t, rounds]()
+        {
+            intact[t] = true;
+            std::vector<unsigned char*> live;
+            for(int i = 0; i < rounds; i++)
+            {
+                size_t size = 1 + (i * 37) % 600;
+                auto block = (unsigned char*)PoolAlloc(size, "test:concurrent");
+                memset(block, t, size);
+                live.push_back(block);
+                if(live.size() > 8)
+                {
+                    intact[t] = intact[t] && live.front()[0] == t;
+                    PoolFree(live.front());
+                    live.erase(live.begin());
+                }
+            }
+            for(auto block : live)
+                PoolFree(block);
+            ArenaThreadExit();
+        }));
+    }
+    for(auto & thread : threads)
+        thread.join();
+    bool allIntact = true;
+    for(int t = 0; t < threadCount; t++)
+        allIntact &= intact[t];
+    CHECK(allIntact);
+    ALLOCSTATS concurrent = stats("test:concurrent", false);
+    CHECK(concurrent.allocations == threadCount * rounds && concurrent.frees == threadCount * rounds);
+    CHECK(concurrent.liveBytes == 0);
+}
+
+int main()
+{
+    testPoolReuse();
+    testPoolClasses();
+    testPoolBlocksDoNotOverlap();
+    testPoolStats();
+    testPrint();
+    testArenaLifo();
+    testArenaOutOfOrder();
+    testArenaBlocks();
+    testArenaThreads();
+    testConcurrentPools();
+    return unitresult("allocator");
+}
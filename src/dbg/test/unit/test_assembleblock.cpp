@@ -0,0 +1,176 @@
+#include "unittest.h"
+#include "assembleblock.h"
+#include <cstdint>
+#include <cstdlib>
+
+typedef uint64_t duint;
+typedef AssembleBlock<duint> Block;
+
+// A tiny instruction set in place of XEDParse:
+//   nop       90
+//   db N      N times CC
+//   jmp T     EB rel8 or E9 rel32, T is a label of the block or a hex address
+//   grow      one byte more on every call, it never settles
+struct FakeEncoder
+{
+    Block & block;
+    int growCalls = 0;
+
+    explicit FakeEncoder(Block & block)
+        : block(block)
+    {
+    }
+
+    bool operator()(duint address, const std::string & text, std::vector<unsigned char> & bytes, std::string & error)
+    {
+        if(text == "nop")
+        {
+            bytes.assign(1, 0x90);
+            return true;
+        }
+        if(text.compare(0, 3, "db ") == 0)
+        {
+            bytes.assign(atoi(text.c_str() + 3), 0xCC);
+            return true;
+        }
+        if(text == "grow")
+        {
+            bytes.assign(++growCalls, 0x90);
+            return true;
+        }
+        if(text.compare(0, 4, "jmp ") == 0)
+        {
+            std::string operand = text.substr(4);
+            duint target;
+            if(!block.Resolve(operand, target))
+            {
+                char* end;
+                target = strtoull(operand.c_str(), &end, 16);
+                if(*end || operand.empty())
+                {
+                    error = "unknown operand \"" + operand + "\"";
+                    return false;
+                }
+            }
+            int64_t rel8 = int64_t(target - (address + 2));
+            if(rel8 >= -128 && rel8 <= 127)
+            {
+                bytes = { 0xEB, (unsigned char)rel8 };
+                return true;
+            }
+            uint32_t rel32 = uint32_t(target - (address + 5));
+            bytes = { 0xE9, (unsigned char)rel32, (unsigned char)(rel32 >> 8), (unsigned char)(rel32 >> 16), (unsigned char)(rel32 >> 24) };
+            return true;
+        }
+        error = "invalid instruction";
+        return false;
+    }
+};
+
+static bool assembleLines(duint address, const std::vector<std::string> & lines, std::vector<unsigned char> & dest, std::string & error)
+{
+    Block block;
+    FakeEncoder encoder(block);
+    return block.Parse(lines, error) && block.Relax(address, std::ref(encoder), dest, error);
+}
+
+static int32_t rel32(const std::vector<unsigned char> & dest, size_t offset)
+{
+    return int32_t(dest[offset] | dest[offset + 1] << 8 | dest[offset + 2] << 16 | uint32_t(dest[offset + 3]) << 24);
+}
+
+// Labels, comments and blank lines
+static void testParse()
+{
+    std::vector<unsigned char> dest;
+    std::string error;
+    CHECK(assembleLines(0x1000, { "  start:  ", "nop ; comment", "", "; only a comment", "jmp start", "end:" }, dest, error));
+    CHECK(dest == std::vector<unsigned char>({ 0x90, 0xEB, 0xFD }));
+
+    CHECK(!assembleLines(0x1000, { "a:", "nop", "a:" }, dest, error));
+    CHECK(error == "line 3: invalid or duplicate label \"a\"");
+    CHECK(!assembleLines(0x1000, { "nop", ":" }, dest, error));
+    CHECK(error == "line 2: invalid or duplicate label \"\"");
+    CHECK(!assembleLines(0x1000, { "nop", "", "bogus" }, dest, error));
+    CHECK(error == "line 3: invalid instruction");
+
+    // Text with spaces, commas or brackets before the colon is an instruction, not a label
+    CHECK(!assembleLines(0x1000, { "jmp x:" }, dest, error));
+    CHECK(error == "line 1: unknown operand \"x:\"");
+}
+
+// Forward and backward labels resolve to their final addresses
+static void testLabels()
+{
+    std::vector<unsigned char> dest;
+    std::string error;
+    CHECK(assembleLines(0x1000, { "jmp forward", "back:", "db 3", "forward:", "jmp back", "jmp 1000" }, dest, error));
+    CHECK(dest == std::vector<unsigned char>({ 0xEB, 0x03, 0xCC, 0xCC, 0xCC, 0xEB, 0xFB, 0xEB, 0xF7 }));
+}
+
+// A forward branch that does not fit in rel8 grows and moves the labels after it
+static void testRelaxation()
+{
+    std::vector<unsigned char> dest;
+    std::string error;
+    CHECK(assembleLines(0x1000, { "jmp far", "db 126", "near:", "db 4", "far:", "jmp near" }, dest, error));
+    CHECK(dest.size() == 5 + 126 + 4 + 2);
+    CHECK(dest[0] == 0xE9 && rel32(dest, 1) == 126 + 4);
+    CHECK(dest[135] == 0xEB && (signed char)dest[136] == -6);
+
+    // Exactly at the limit the short form is kept
+    CHECK(assembleLines(0x1000, { "jmp far", "db 127", "far:" }, dest, error));
+    CHECK(dest.size() == 2 + 127 && dest[0] == 0xEB && dest[1] == 127);
+
+    // A chain of branches to the end of the block, each long one pushes the ones before it further out
+    std::vector<std::string> chain;
+    for(int i = 0; i < 6; i++)
+    {
+        chain.push_back("jmp l" + std::to_string(i));
+        chain.push_back("db 122");
+    }
+    for(int i = 0; i < 6; i++)
+        chain.push_back("l" + std::to_string(i) + ":");
+    CHECK(assembleLines(0x1000, chain, dest, error));
+    const size_t total = 5 * (5 + 122) + 2 + 122; // the last branch only skips 122 bytes
+    CHECK(dest.size() == total);
+    bool allLong = true;
+    for(int i = 0; i < 5; i++)
+        allLong = allLong && dest[i * 127] == 0xE9 && rel32(dest, i * 127 + 1) == int32_t(total - (i * 127 + 5));
+    CHECK(allLong);
+    CHECK(dest[5 * 127] == 0xEB && dest[5 * 127 + 1] == 122);
+}
+
+// An encoding that gets shorter after its size was reserved is padded with NOPs
+static void testPadding()
+{
+    // In the first pass "jmp 1085" is at 1002 and needs rel32, in the next one it is at 1005 and rel8 suffices
+    std::vector<unsigned char> dest;
+    std::string error;
+    CHECK(assembleLines(0x1000, { "jmp far", "jmp 1085", "db 130", "far:" }, dest, error));
+    CHECK(dest.size() == 5 + 5 + 130);
+    CHECK(dest[5] == 0xEB && dest[6] == 0x7E);
+    CHECK(dest[7] == 0x90 && dest[8] == 0x90 && dest[9] == 0x90);
+}
+
+static void testNoConvergence()
+{
+    Block block;
+    FakeEncoder encoder(block);
+    std::vector<unsigned char> dest;
+    std::string error;
+    CHECK(block.Parse({ "nop", "grow" }, error));
+    CHECK(!block.Relax(0x1000, std::ref(encoder), dest, error));
+    CHECK(error == "Branch sizes did not converge" && dest.empty());
+    CHECK(encoder.growCalls == MAX_RELAXATION_PASSES);
+}
+
+int main()
+{
+    testParse();
+    testLabels();
+    testRelaxation();
+    testPadding();
+    testNoConvergence();
+    return unitresult("assembleblock");
+}
@@ -0,0 +1,281 @@
+#include "unittest.h"
+#include "autoanalysisqueue.h"
+#include <cstdint>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+
+typedef uint64_t duint;
+typedef AutoAnalysisQueue<duint> Queue;
+
+static duint next(Queue & queue)
+{
+    Queue::Request request;
+    if(!queue.Next(request))
+        return 0;
+    return request.Base;
+}
+
+// Modules are analysed in the order they were loaded
+static void testOrder()
+{
+    Queue queue;
+    CHECK(queue.Add(0x10000, 0x1000, "a.dll") == 1);
+    CHECK(queue.Add(0x20000, 0x1000, "b.dll") == 2);
+    CHECK(queue.Add(0x30000, 0x1000, "c.dll") == 3);
+    CHECK(queue.Size() == 3);
+    CHECK(next(queue) == 0x10000);
+    CHECK(next(queue) == 0x20000);
+    CHECK(next(queue) == 0x30000);
+    CHECK(next(queue) == 0);
+    CHECK(queue.Size() == 0 && queue.Running() == 3);
+}
+
+// The module that contains CIP is analysed next, the one asked for last wins
+static void testPrioritize()
+{
+    Queue queue;
+    queue.Add(0x10000, 0x1000, "a.dll");
+    queue.Add(0x20000, 0x1000, "b.dll");
+    queue.Add(0x30000, 0x1000, "c.dll");
+    CHECK(queue.Prioritize(0x20FFF));
+    CHECK(queue.Prioritize(0x30000));
+    CHECK(!queue.Prioritize(0x31000));
+    CHECK(next(queue) == 0x30000);
+    CHECK(next(queue) == 0x20000);
+    CHECK(next(queue) == 0x10000);
+
+    // A running module cannot be prioritized
+    CHECK(!queue.Prioritize(0x10000));
+}
+
+static void testFinish()
+{
+    Queue queue;
+    queue.Add(0x10000, 0x1000, "a.dll");
+    queue.Add(0x20000, 0x1000, "b.dll");
+    Queue::Request a, b;
+    CHECK(queue.Next(a) && queue.Next(b));
+    CHECK(a.Name == "a.dll" && !a.Cancelled);
+    CHECK(!queue.IsCancelled(a.Id) && !queue.IsCancelled(b.Id));
+
+    // Requests can finish in any order
+    int done = 0, total = 0;
+    CHECK(queue.Finish(b.Id, done, total));
+    CHECK(done == 1 && total == 2);
+    CHECK(queue.Finish(a.Id, done, total));
+    CHECK(done == 2 && total == 2);
+    CHECK(queue.Running() == 0);
+
+    // A request that is not running counts as cancelled
+    CHECK(queue.IsCancelled(a.Id));
+    done = total = -1;
+    CHECK(!queue.Finish(a.Id, done, total));
+    CHECK(done == -1 && total == -1);
+}
+
+// Unloading a module drops it from the queue or cancels its analysis
+static void testRemove()
+{
+    Queue queue;
+    queue.Add(0x10000, 0x1000, "a.dll");
+    queue.Add(0x20000, 0x1000, "b.dll");
+    queue.Add(0x30000, 0x1000, "c.dll");
+    Queue::Request a;
+    CHECK(queue.Next(a));
+    CHECK(queue.Remove(0x20000));
+    CHECK(queue.Size() == 1);
+    CHECK(queue.Remove(0x10000));
+    CHECK(queue.IsCancelled(a.Id));
+    CHECK(!queue.Remove(0x10000)); // already cancelled
+    CHECK(!queue.Remove(0x40000));
+
+    // The results of the cancelled request are discarded and it is not counted
+    int done = 0, total = 0;
+    CHECK(!queue.Finish(a.Id, done, total));
+    Queue::Request c;
+    CHECK(queue.Next(c) && c.Base == 0x30000);
+    CHECK(queue.Finish(c.Id, done, total));
+    CHECK(done == 1 && total == 1);
+
+    // A module that is loaded again at the same base is a new request
+    queue.Add(0x10000, 0x1000, "a.dll");
+    CHECK(queue.Next(a) && !queue.IsCancelled(a.Id));
+}
+
+// Stopping the debuggee cancels everything and restarts the progress
+static void testClear()
+{
+    Queue queue;
+    queue.Add(0x10000, 0x1000, "a.dll");
+    queue.Add(0x20000, 0x1000, "b.dll");
+    queue.Add(0x30000, 0x1000, "c.dll");
+    Queue::Request a, b;
+    CHECK(queue.Next(a) && queue.Next(b));
+    int done = 0, total = 0;
+    CHECK(queue.Finish(a.Id, done, total));
+    queue.Clear();
+    CHECK(queue.Size() == 0 && queue.Running() == 1);
+    CHECK(queue.IsCancelled(b.Id));
+    CHECK(!queue.Remove(0x20000));
+    CHECK(!queue.Finish(b.Id, done, total));
+
+    queue.Add(0x50000, 0x1000, "d.dll");
+    Queue::Request d;
+    CHECK(queue.Next(d) && queue.Finish(d.Id, done, total));
+    CHECK(done == 1 && total == 1);
+    CHECK(d.Id == 4); // ids are never reused
+}
+
+/**
+\brief The worker pool of autoanalysis.cpp with a fake analysis. The analysis of a module polls IsCancelled like ControlFlowAnalysis does and otherwise runs until the gate opens.
+*/
+struct AnalysisPool
+{
+    Queue queue;
+    std::mutex lock; // LockAutoAnalysis
+    std::condition_variable signal;
+    int pending = 0; // the semaphore
+    bool stop = false;
+    std::atomic<bool> gate;
+    std::vector<duint> started;
+    std::set<duint> published;
+    std::set<duint> discarded;
+    int done = 0;
+    int total = 0;
+    std::vector<std::thread> threads;
+
+    explicit AnalysisPool(int ThreadCount)
+        : gate(false)
+    {
+        for(int i = 0; i < ThreadCount; i++)
+            threads.push_back(std::thread([this]() { worker(); }));
+    }
+
+    void add(duint Base)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        queue.Add(Base, 0x1000, "");
+        pending++;
+        signal.notify_one();
+    }
+
+    void worker()
+    {
+        for(;;)
+        {
+            Queue::Request request;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                signal.wait(guard, [this]() { return pending > 0 || stop; });
+                if(stop)
+                    return;
+                pending--;
+                if(!queue.Next(request))
+                    continue;
+                started.push_back(request.Base);
+            }
+
+            for(;;)
+            {
+                if(gate)
+                    break;
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    if(queue.IsCancelled(request.Id))
+                        break;
+                }
+                std::this_thread::yield();
+            }
+
+            std::lock_guard<std::mutex> guard(lock);
+            int requestDone, requestTotal;
+            if(queue.Finish(request.Id, requestDone, requestTotal))
+            {
+                published.insert(request.Base);
+                done = requestDone;
+                total = requestTotal;
+            }
+            else
+                discarded.insert(request.Base);
+        }
+    }
+
+    template<typename Predicate>
+    bool waitFor(Predicate Condition)
+    {
+        for(int i = 0; i < 10000; i++)
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if(Condition())
+                    return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return false;
+    }
+
+    void join()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stop = true;
+            signal.notify_all();
+        }
+        for(auto & thread : threads)
+            thread.join();
+    }
+};
+
+static void testPool()
+{
+    const int threadCount = 4;
+    AnalysisPool pool(threadCount);
+
+    // Every worker is busy, the debug loop can still queue, prioritize and unload modules
+    for(duint i = 1; i <= 4; i++)
+        pool.add(i << 16);
+    CHECK(pool.waitFor([&]() { return pool.queue.Running() == threadCount; }));
+    for(duint i = 5; i <= 8; i++)
+        pool.add(i << 16);
+    {
+        std::lock_guard<std::mutex> guard(pool.lock);
+        CHECK(pool.queue.Running() == threadCount && pool.queue.Size() == 4);
+        CHECK(pool.queue.Prioritize(0x80800));
+        CHECK(pool.queue.Remove(0x60000));
+        CHECK(pool.queue.Remove(0x20000)); // running
+    }
+
+    // The cancelled worker stops early and takes the module that contains CIP
+    CHECK(pool.waitFor([&]() { return pool.started.size() == 5; }));
+    {
+        std::lock_guard<std::mutex> guard(pool.lock);
+        CHECK(pool.started[4] == 0x80000);
+        CHECK(pool.discarded.size() == 1 && pool.discarded.count(0x20000));
+        CHECK(pool.published.empty());
+        CHECK(pool.queue.Running() == threadCount);
+    }
+
+    pool.gate = true;
+    CHECK(pool.waitFor([&]() { return pool.queue.Size() == 0 && pool.queue.Running() == 0; }));
+    pool.join();
+    CHECK(pool.started.size() == 7);
+    std::set<duint> expected = { 0x10000, 0x30000, 0x40000, 0x50000, 0x70000, 0x80000 };
+    CHECK(pool.published == expected);
+    CHECK(pool.discarded.size() == 1);
+    CHECK(pool.done == 6 && pool.total == 6);
+}
+
+int main()
+{
+    testOrder();
+    testPrioritize();
+    testFinish();
+    testRemove();
+    testClear();
+    testPool();
+    return unitresult("autoanalysisqueue");
+}
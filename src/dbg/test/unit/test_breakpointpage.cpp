@@ -0,0 +1,154 @@
+#include "unittest.h"
+#include "breakpointpage.h"
+#include <cstdint>
+#include <map>
+
+typedef uint64_t duint;
+
+static const duint PageSize = 0x1000;
+
+// Debuggee memory made of readable and unreadable pages
+struct FakeMemory
+{
+    std::map<duint, std::vector<unsigned char>> pages;
+    size_t reads = 0;
+    size_t pageReads = 0;
+
+    void map(duint base)
+    {
+        auto & page = pages[base];
+        page.resize(PageSize);
+        for(duint i = 0; i < PageSize; i++)
+            page[i] = (unsigned char)((base >> 12) * 31 + i);
+    }
+
+    unsigned char byte(duint address)
+    {
+        return pages[address & ~(PageSize - 1)][address & (PageSize - 1)];
+    }
+
+    // Reads until the first unreadable page, like ReadProcessMemory
+    duint read(duint address, unsigned char* buffer, duint size)
+    {
+        reads++;
+        if(size == PageSize)
+            pageReads++;
+        duint done = 0;
+        while(done < size)
+        {
+            auto found = pages.find((address + done) & ~(PageSize - 1));
+            if(found == pages.end())
+                break;
+            buffer[done] = found->second[(address + done) & (PageSize - 1)];
+            done++;
+        }
+        return done;
+    }
+};
+
+static unsigned short expected(FakeMemory & memory, duint address)
+{
+    return (unsigned short)(memory.byte(address) | (memory.byte(address + 1) << 8));
+}
+
+static void testGroups()
+{
+    std::vector<duint> addresses = { 0x1000, 0x1004, 0x1FFF, 0x3000, 0x3010, 0x7FF0 };
+    std::vector<std::pair<duint, std::pair<size_t, size_t>>> groups;
+    BpForEachPage(addresses, PageSize, [&](duint base, size_t first, size_t last)
+    {
+        groups.push_back(std::make_pair(base, std::make_pair(first, last)));
+    });
+    CHECK(groups.size() == 3);
+    CHECK(groups[0].first == 0x1000 && groups[0].second.first == 0 && groups[0].second.second == 3);
+    CHECK(groups[1].first == 0x3000 && groups[1].second.first == 3 && groups[1].second.second == 5);
+    CHECK(groups[2].first == 0x7000 && groups[2].second.first == 5 && groups[2].second.second == 6);
+
+    size_t calls = 0;
+    BpForEachPage(std::vector<duint>(), PageSize, [&](duint, size_t, size_t)
+    {
+        calls++;
+    });
+    CHECK(calls == 0);
+}
+
+static void testReadOncePerPage()
+{
+    FakeMemory memory;
+    memory.map(0x10000);
+    memory.map(0x11000);
+    memory.map(0x20000);
+
+    std::vector<duint> addresses;
+    for(duint address = 0x10000; address < 0x10FF0; address += 0x10)
+        addresses.push_back(address);
+    addresses.push_back(0x20100);
+
+    std::vector<unsigned short> oldBytes;
+    std::vector<bool> valid;
+    BpReadPageBytes(addresses, PageSize, oldBytes, valid, [&](duint address, unsigned char* buffer, duint size)
+    {
+        return memory.read(address, buffer, size);
+    });
+
+    CHECK(memory.reads == 2);
+    bool allValid = true, allEqual = true;
+    for(size_t i = 0; i < addresses.size(); i++)
+    {
+        allValid = allValid && valid[i];
+        allEqual = allEqual && oldBytes[i] == expected(memory, addresses[i]);
+    }
+    CHECK(allValid);
+    CHECK(allEqual);
+}
+
+static void testPageBoundaries()
+{
+    FakeMemory memory;
+    memory.map(0x10000);
+    memory.map(0x11000);
+    memory.map(0x30000);
+
+    // 0x10FFF crosses into a readable page, 0x30FFF into an unmapped one (the last byte of a region), 0x50000 is not mapped at all
+    std::vector<duint> addresses = { 0x10FFF, 0x30FFF, 0x50000 };
+    std::vector<unsigned short> oldBytes;
+    std::vector<bool> valid;
+    BpReadPageBytes(addresses, PageSize, oldBytes, valid, [&](duint address, unsigned char* buffer, duint size)
+    {
+        return memory.read(address, buffer, size);
+    });
+
+    CHECK(valid[0] && oldBytes[0] == expected(memory, 0x10FFF));
+    CHECK(valid[1] && oldBytes[1] == memory.byte(0x30FFF));
+    CHECK(!valid[2]);
+}
+
+static void testPartialPage()
+{
+    FakeMemory memory;
+    memory.map(0x40000);
+
+    // A read of the page that stops short must not be used, every address falls back to its own read
+    std::vector<duint> addresses = { 0x40010, 0x40020 };
+    std::vector<unsigned short> oldBytes;
+    std::vector<bool> valid;
+    BpReadPageBytes(addresses, PageSize, oldBytes, valid, [&](duint address, unsigned char* buffer, duint size)
+    {
+        memset(buffer, 0xCC, size_t(size));
+        if(size == PageSize)
+            return duint(0x18); // partially readable: only the first address is covered
+        return memory.read(address, buffer, size);
+    });
+
+    CHECK(valid[0] && oldBytes[0] == expected(memory, 0x40010));
+    CHECK(valid[1] && oldBytes[1] == expected(memory, 0x40020));
+}
+
+int main()
+{
+    testGroups();
+    testReadOncePerPage();
+    testPageBoundaries();
+    testPartialPage();
+    return unitresult("breakpointpage");
+}
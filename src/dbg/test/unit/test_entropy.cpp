@@ -0,0 +1,114 @@
+#include "unittest.h"
+#include "entropyreference.h"
+
+static bool close(double a, double b)
+{
+    return fabs(a - b) < 1e-9;
+}
+
+static bool closeAll(const std::vector<double> & a, const std::vector<double> & b)
+{
+    if(a.size() != b.size())
+        return false;
+    for(size_t i = 0; i < a.size(); i++)
+        if(!close(a[i], b[i]))
+            return false;
+    return true;
+}
+
+// Adding and removing bytes gives the entropy of the bytes in the window
+static void testWindow()
+{
+    auto data = entropyData(20000, 1);
+    const int blockSize = 256;
+    EntropyWindow window(blockSize);
+    CHECK(window.Value() == 0.0);
+    bool same = true;
+    for(int i = 0; i < (int)data.size(); i++)
+    {
+        if(i >= blockSize)
+            window.Remove(data[i - blockSize]);
+        window.Add(data[i]);
+        if(i >= blockSize - 1 && i % 97 == 0)
+            same = same && close(window.Value(), Entropy::MeasureData(data.data() + i + 1 - blockSize, blockSize));
+    }
+    CHECK(same);
+
+    unsigned char zeros[64] = {};
+    unsigned char all[256];
+    for(int i = 0; i < 256; i++)
+        all[i] = (unsigned char)i;
+    CHECK(Entropy::MeasureData(zeros, sizeof(zeros)) == 0.0);
+    CHECK(close(Entropy::MeasureData(all, sizeof(all)), 1.0));
+}
+
+// The sliding points match the block copies of the old implementation
+static void testPoints()
+{
+    auto data = entropyData(300000, 2);
+    const int blockSizes[] = { 2, 128, 1024, 4096 };
+    const int pointCounts[] = { 1, 7, 128, 1000 };
+    bool same = true;
+    for(int blockSize : blockSizes)
+    {
+        for(int pointCount : pointCounts)
+        {
+            std::vector<double> points, expected;
+            Entropy::MeasurePoints(data.data(), (int)data.size(), blockSize, points, pointCount);
+            measurePointsCopy(data.data(), (int)data.size(), blockSize, expected, pointCount);
+            same = same && !points.empty() && closeAll(points, expected);
+        }
+    }
+    CHECK(same);
+
+    // Odd block sizes use exactly blockSize bytes, centered on the point
+    std::vector<double> points;
+    Entropy::MeasurePoints(data.data(), 5000, 255, points, 10);
+    CHECK(points.size() == 10);
+    CHECK(close(points[0], Entropy::MeasureData(data.data(), 255)));
+    CHECK(close(points[9], Entropy::MeasureData(data.data() + 4500 - 127, 255)));
+
+    // Too little data
+    Entropy::MeasurePoints(data.data(), 100, 256, points, 10);
+    CHECK(points.size() == 10 && points[0] == -1);
+    Entropy::MeasurePoints(data.data(), 5, 2, points, 10);
+    CHECK(points.empty());
+}
+
+// The streaming mode gives the same points for any read size
+static void testStream()
+{
+    auto data = entropyData(3 * 1024 * 1024 + 123, 3);
+    std::vector<double> expected;
+    Entropy::MeasurePoints(data.data(), (int)data.size(), 1024, expected, 500);
+    const long long readSizes[] = { 1, 4095, 1024 * 1024 };
+    for(long long readSize : readSizes)
+    {
+        long long position = 0;
+        std::vector<double> points;
+        bool complete = Entropy::MeasureStream([&](unsigned char* buffer, long long size)
+        {
+            long long count = std::min(std::min(size, readSize), (long long)data.size() - position);
+            memcpy(buffer, data.data() + position, (size_t)count);
+            position += count;
+            return count;
+        }, (long long)data.size(), 1024, points, 500);
+        CHECK(complete && closeAll(points, expected));
+    }
+
+    // A failed read stops the measurement
+    std::vector<double> points;
+    long long reads = 0;
+    CHECK(!Entropy::MeasureStream([&](unsigned char*, long long size)
+    {
+        return ++reads < 2 ? size : 0;
+    }, (long long)data.size(), 1024, points, 500));
+}
+
+int main()
+{
+    testWindow();
+    testPoints();
+    testStream();
+    return unitresult("entropy");
+}
@@ -0,0 +1,135 @@
+#include "unittest.h"
+#include "jsonstream.h"
+
+static const char* TestFile = "test_jsonstream.json";
+
+// Writes every kind of value JsonWriter supports and checks JsonReader hands back the same entries
+static void roundTrip(bool compress, bool indent)
+{
+    JsonWriter writer;
+    CHECK(writer.Open(TestFile, compress, indent));
+    writer.ObjectBegin();
+    writer.ArrayBegin("comments");
+    for(int i = 0; i < 20000; i++)
+    {
+        writer.ObjectBegin();
+        writer.WriteString("module", "kernel\"32\\.dll\n\x01");
+        writer.WriteHex("address", 0x1000 + i);
+        writer.WriteString("text", "h\xc3\xa9llo");
+        writer.ObjectEnd();
+    }
+    writer.ArrayEnd();
+    writer.ArrayBegin("empty");
+    writer.ArrayEnd();
+    writer.ArrayBegin("breakpoints");
+    writer.ObjectBegin();
+    writer.WriteBoolean("enabled", true);
+    writer.WriteInteger("type", -3);
+    writer.ArrayBegin("watch");
+    writer.ObjectBegin();
+    writer.WriteHex("offset", 5);
+    writer.ObjectEnd();
+    writer.ArrayEnd();
+    writer.ObjectEnd();
+    writer.ArrayEnd();
+    writer.ObjectBegin("commandLine");
+    writer.WriteString("cmdLine", "a b");
+    writer.ObjectEnd();
+    writer.WriteString("notes", "x\ty");
+    writer.ObjectEnd();
+    CHECK(writer.RootSize() == 5);
+    CHECK(writer.Close());
+
+    JsonReader reader;
+    CHECK(reader.Open(TestFile));
+    CHECK(reader.Compressed() == compress);
+    int comments = 0;
+    duint addressSum = 0;
+    bool breakpoint = false, commandLine = false, notes = false, unknown = false;
+    CHECK(reader.Parse([&](const String & Section, const JsonEntry & Entry)
+    {
+        if(Section == "comments")
+        {
+            comments++;
+            addressSum += Entry.GetHex("address");
+            CHECK(strcmp(Entry.GetString("module"), "kernel\"32\\.dll\n\x01") == 0);
+            CHECK(strcmp(Entry.GetString("text"), "h\xc3\xa9llo") == 0);
+        }
+        else if(Section == "breakpoints")
+        {
+            CHECK(Entry.GetBoolean("enabled"));
+            CHECK(Entry.GetInteger("type") == -3);
+            auto watch = Entry.GetArray("watch");
+            CHECK(watch && watch->size() == 1 && (*watch)[0].GetHex("offset") == 5);
+            breakpoint = true;
+        }
+        else if(Section == "commandLine")
+            commandLine = strcmp(Entry.GetString("cmdLine"), "a b") == 0;
+        else if(Section == "notes")
+            notes = strcmp(Entry.Value(), "x\ty") == 0;
+        else
+            unknown = true;
+    }));
+    reader.Close();
+    CHECK(comments == 20000);
+    CHECK(addressSum == 20000ull * 0x1000 + 20000ull * 19999 / 2);
+    CHECK(breakpoint && commandLine && notes && !unknown);
+}
+
+static void writeFile(const char* text)
+{
+    FILE* file = fopen(TestFile, "wb");
+    fputs(text, file);
+    fclose(file);
+}
+
+// Plain JSON that was not written by JsonWriter: whitespace, escapes, surrogate pairs, null and nested objects
+static void plainJson()
+{
+    writeFile(" { \"a\" : [ {\"k\":\"\\u00e9\\ud83d\\ude00\", \"n\": null, \"o\": {\"x\":1}} ] , \"b\":true}");
+    JsonReader reader;
+    CHECK(reader.Open(TestFile));
+    CHECK(!reader.Compressed());
+    int entries = 0;
+    CHECK(reader.Parse([&](const String & Section, const JsonEntry & Entry)
+    {
+        entries++;
+        if(Section == "a")
+            CHECK(strcmp(Entry.GetString("k"), "\xc3\xa9\xf0\x9f\x98\x80") == 0);
+    }));
+    reader.Close();
+    CHECK(entries == 2);
+}
+
+// DbLoad validates the file before clearing the caches, so damaged files have to be rejected
+static void damagedJson()
+{
+    const char* damaged[] =
+    {
+        "{\"comments\":[{\"address\":\"0x1000\"},",
+        "{\"comments\":[{\"address\" \"0x1000\"}]}",
+        "{\"notes\":\"unterminated}",
+        "{\"a\":[1,2,]}",
+        "[1,2]",
+        "",
+    };
+    for(auto text : damaged)
+    {
+        writeFile(text);
+        JsonReader reader;
+        CHECK(reader.Open(TestFile));
+        CHECK(!reader.Parse([](const String &, const JsonEntry &) {}));
+        reader.Close();
+    }
+}
+
+int main()
+{
+    for(int compress = 0; compress < 2; compress++)
+        for(int indent = 0; indent < 2; indent++)
+            roundTrip(compress != 0, indent != 0);
+    plainJson();
+    damagedJson();
+    remove(TestFile);
+    return unitresult("test_jsonstream");
+}
@@ -0,0 +1,230 @@
+#include "unittest.h"
+#include "memdumplayout.h"
+#include <cstdint>
+#include <map>
+
+typedef uint64_t duint;
+typedef MemDumpRange<duint> Range;
+
+static const duint PageSize = 0x1000;
+
+struct Region
+{
+    duint addr;
+    duint size;
+};
+
+// Debuggee memory made of readable and unreadable pages
+struct FakeMemory
+{
+    std::map<duint, bool> readable;
+    size_t reads = 0;
+
+    void map(duint base, duint size)
+    {
+        for(duint page = base; page < base + size; page += PageSize)
+            readable[page] = true;
+    }
+
+    static unsigned char byte(duint address)
+    {
+        return (unsigned char)(address * 7 + (address >> 12));
+    }
+
+    // Reads until the first unreadable page, like ReadProcessMemory
+    duint read(duint address, unsigned char* buffer, duint size)
+    {
+        reads++;
+        duint done = 0;
+        while(done < size && readable.count((address + done) & ~(PageSize - 1)))
+        {
+            buffer[done] = byte(address + done);
+            done++;
+        }
+        return done;
+    }
+
+    void readChunk(duint address, unsigned char* buffer, duint size, unsigned long long offset, std::vector<Range> & unreadable)
+    {
+        MemDumpReadChunk<duint>(address, buffer, size, PageSize, offset, unreadable, [this](duint Address, unsigned char* Buffer, duint Size)
+        {
+            return read(Address, Buffer, Size);
+        });
+    }
+};
+
+static bool sameRange(const Range & range, duint addr, duint size, unsigned long long offset)
+{
+    return range.addr == addr && range.size == size && range.offset == offset;
+}
+
+// A plain dump writes the regions one after the other, in the given order
+static void testPlainLayout()
+{
+    std::vector<Region> regions = { { 0x30000, 0x2000 }, { 0x10000, 0x1000 }, { 0x10000, 0x800 } };
+    std::vector<Range> ranges;
+    CHECK(MemDumpLayout<duint>(regions, false, ranges) == 0x3800);
+    CHECK(ranges.size() == 3);
+    CHECK(sameRange(ranges[0], 0x30000, 0x2000, 0));
+    CHECK(sameRange(ranges[1], 0x10000, 0x1000, 0x2000));
+    CHECK(sameRange(ranges[2], 0x10000, 0x800, 0x3000));
+
+    CHECK(MemDumpLayout<duint>(std::vector<Region>(), false, ranges) == 0 && ranges.empty());
+}
+
+// A sparse dump keeps the distance between the regions, overlapping regions share their bytes
+static void testSparseLayout()
+{
+    std::vector<Region> regions = { { 0x30000, 0x2000 }, { 0x10000, 0x1000 }, { 0x10800, 0x1000 }, { 0x20000, 0x100 } };
+    std::vector<Range> ranges;
+    CHECK(MemDumpLayout<duint>(regions, true, ranges) == 0x22000);
+    CHECK(sameRange(ranges[0], 0x30000, 0x2000, 0x20000));
+    CHECK(sameRange(ranges[1], 0x10000, 0x1000, 0));
+    CHECK(sameRange(ranges[2], 0x10800, 0x1000, 0x800));
+    CHECK(sameRange(ranges[3], 0x20000, 0x100, 0x10000));
+
+    // The file ends with the region that ends last, not the one that starts last
+    regions = { { 0x10000, 0x10000 }, { 0x11000, 0x1000 } };
+    CHECK(MemDumpLayout<duint>(regions, true, ranges) == 0x10000);
+}
+
+static std::vector<Region> chunks(duint addr, duint size, duint chunkSize)
+{
+    std::vector<Region> result;
+    MemDumpForEachChunk<duint>(addr, size, chunkSize, PageSize, [&](duint Address, duint Size)
+    {
+        result.push_back({ Address, Size });
+        return true;
+    });
+    return result;
+}
+
+// The chunks cover the region, are bounded and start on a page boundary after the first one
+static void testChunks()
+{
+    const duint chunkSize = 4 * PageSize;
+    auto result = chunks(0x10000, 10 * PageSize, chunkSize);
+    CHECK(result.size() == 3);
+    CHECK(result[0].addr == 0x10000 && result[0].size == chunkSize);
+    CHECK(result[2].addr == 0x18000 && result[2].size == 2 * PageSize);
+
+    result = chunks(0x10123, 9 * PageSize, chunkSize);
+    duint next = 0x10123;
+    bool bounded = true;
+    bool aligned = true;
+    for(size_t i = 0; i < result.size(); i++)
+    {
+        bounded = bounded && result[i].addr == next && result[i].size && result[i].size <= chunkSize;
+        aligned = aligned && (i == 0 || !(result[i].addr & (PageSize - 1)));
+        next += result[i].size;
+    }
+    CHECK(bounded && aligned);
+    CHECK(next == 0x10123 + 9 * PageSize);
+    CHECK(result[0].size == chunkSize - 0x123);
+
+    CHECK(chunks(0x10000, 0, chunkSize).empty());
+    CHECK(chunks(0x10FFF, 1, chunkSize).size() == 1);
+
+    // A failed write stops at its chunk
+    size_t calls = 0;
+    CHECK(!MemDumpForEachChunk<duint>(0x10000, 10 * PageSize, chunkSize, PageSize, [&](duint, duint)
+    {
+        return ++calls < 2;
+    }));
+    CHECK(calls == 2);
+}
+
+// A readable chunk is a plain copy with a single read
+static void testReadableChunk()
+{
+    FakeMemory memory;
+    memory.map(0x10000, 4 * PageSize);
+    std::vector<unsigned char> buffer(3 * PageSize);
+    std::vector<Range> unreadable;
+    memory.readChunk(0x10800, buffer.data(), buffer.size(), 0, unreadable);
+    CHECK(unreadable.empty());
+    CHECK(memory.reads == 1);
+    CHECK(buffer[0] == FakeMemory::byte(0x10800) && buffer.back() == FakeMemory::byte(0x10800 + buffer.size() - 1));
+}
+
+// Unreadable pages are zeroed, consecutive ones form a single range
+static void testUnreadablePages()
+{
+    FakeMemory memory;
+    memory.map(0x10000, PageSize);
+    memory.map(0x13000, PageSize);
+    std::vector<unsigned char> buffer(4 * PageSize, 0xCC);
+    std::vector<Range> unreadable;
+    memory.readChunk(0x10000, buffer.data(), buffer.size(), 0x5000, unreadable);
+    CHECK(unreadable.size() == 1 && sameRange(unreadable[0], 0x11000, 2 * PageSize, 0x6000));
+    CHECK(buffer[PageSize - 1] == FakeMemory::byte(0x10FFF));
+    CHECK(buffer[PageSize] == 0 && buffer[3 * PageSize - 1] == 0);
+    CHECK(buffer[3 * PageSize] == FakeMemory::byte(0x13000));
+    CHECK(memory.reads == 5); // the chunk, then each page
+}
+
+// A chunk that starts and ends inside a page reads only its part of the pages
+static void testPartialPages()
+{
+    FakeMemory memory;
+    memory.map(0x10000, PageSize);
+    std::vector<unsigned char> buffer(0x1000, 0xCC);
+    std::vector<Range> unreadable;
+    memory.readChunk(0x10800, buffer.data(), buffer.size(), 0x800, unreadable);
+    CHECK(unreadable.size() == 1 && sameRange(unreadable[0], 0x11000, 0x800, 0x1000));
+    CHECK(buffer[0x7FF] == FakeMemory::byte(0x10FFF) && buffer[0x800] == 0 && buffer[0xFFF] == 0);
+}
+
+// Unreadable ranges continue across chunks of a region
+static void testMergeAcrossChunks()
+{
+    FakeMemory memory;
+    memory.map(0x10000, PageSize);
+    const duint chunkSize = 2 * PageSize;
+    std::vector<unsigned char> buffer(chunkSize);
+    std::vector<Range> unreadable;
+    MemDumpForEachChunk<duint>(0x10000, 6 * PageSize, chunkSize, PageSize, [&](duint Address, duint Size)
+    {
+        memory.readChunk(Address, buffer.data(), Size, Address - 0x10000, unreadable);
+        return true;
+    });
+    CHECK(unreadable.size() == 1 && sameRange(unreadable[0], 0x11000, 5 * PageSize, 0x1000));
+}
+
+// Ranges of different regions are only merged when they also continue each other in the file
+static void testMergeAcrossRegions()
+{
+    FakeMemory memory;
+    memory.map(0x10000, PageSize);
+    memory.map(0x50000, PageSize);
+    std::vector<Region> regions = { { 0x10000, 0x2000 }, { 0x12000, 0x1000 }, { 0x50000, 0x1000 }, { 0x13000, 0x1000 } };
+    std::vector<Range> ranges;
+    MemDumpLayout<duint>(regions, false, ranges);
+    std::vector<unsigned char> buffer(0x2000);
+    std::vector<Range> unreadable;
+    for(const auto & range : ranges)
+        memory.readChunk(range.addr, buffer.data(), range.size, range.offset, unreadable);
+    CHECK(unreadable.size() == 2);
+    CHECK(sameRange(unreadable[0], 0x11000, 0x2000, 0x1000));
+    CHECK(sameRange(unreadable[1], 0x13000, 0x1000, 0x4000));
+
+    // In a sparse dump the file mirrors the memory, so the ranges merge again
+    MemDumpLayout<duint>(regions, true, ranges);
+    unreadable.clear();
+    for(const auto & range : ranges)
+        memory.readChunk(range.addr, buffer.data(), range.size, range.offset, unreadable);
+    CHECK(unreadable.size() == 1 && sameRange(unreadable[0], 0x11000, 0x3000, 0x1000));
+}
+
+int main()
+{
+    testPlainLayout();
+    testSparseLayout();
+    testChunks();
+    testReadableChunk();
+    testUnreadablePages();
+    testPartialPages();
+    testMergeAcrossChunks();
+    testMergeAcrossRegions();
+    return unitresult("memdump");
+}
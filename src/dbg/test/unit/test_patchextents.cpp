@@ -0,0 +1,172 @@
+#include "unittest.h"
+#include "patchextents.h"
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+typedef uint64_t duint;
+typedef std::map<duint, PatchExtent> Extents;
+typedef std::vector<std::pair<duint, duint>> Ranges;
+
+static const duint Base = 0x400000;
+
+// Module bytes, the patches are applied to memory like PatchSetRange does
+struct FakeModule
+{
+    std::vector<unsigned char> original;
+    std::vector<unsigned char> memory;
+    Extents extents;
+
+    FakeModule()
+        : original(0x100), memory(0x100)
+    {
+        for(size_t i = 0; i < original.size(); i++)
+            original[i] = memory[i] = (unsigned char)(i * 3 + 1);
+    }
+
+    void patch(duint rva, const std::string & bytes)
+    {
+        PatchSetExtent<duint>(extents, rva, memory.data() + rva, (const unsigned char*)bytes.data(), bytes.size());
+        memcpy(memory.data() + rva, bytes.data(), bytes.size());
+    }
+
+    void restore(duint rva, duint size)
+    {
+        PatchSetExtent<duint>(extents, rva, memory.data() + rva, original.data() + rva, size);
+        memcpy(memory.data() + rva, original.data() + rva, size);
+    }
+
+    void remove(duint start, duint end, bool restore)
+    {
+        PatchDelExtents<duint>(extents, Base, Base + start, Base + end, [&](duint Address, const unsigned char* OldBytes, duint Size)
+        {
+            if(restore)
+                memcpy(memory.data() + (Address - Base), OldBytes, Size);
+        });
+    }
+
+    // The ranges PatchEnumRange lists
+    Ranges ranges() const
+    {
+        Ranges result;
+        for(auto & extent : extents)
+            result.push_back(std::make_pair(Base + extent.first, duint(extent.second.newbytes.size())));
+        return result;
+    }
+
+    // Every extent holds the original bytes and the bytes in memory
+    bool consistent() const
+    {
+        for(auto & extent : extents)
+        {
+            const PatchExtent & bytes = extent.second;
+            if(bytes.oldbytes.size() != bytes.newbytes.size() || bytes.newbytes.empty())
+                return false;
+            for(size_t i = 0; i < bytes.newbytes.size(); i++)
+            {
+                if(bytes.oldbytes[i] != original[extent.first + i] || bytes.newbytes[i] != memory[extent.first + i] || bytes.oldbytes[i] == bytes.newbytes[i])
+                    return false;
+            }
+        }
+        return true;
+    }
+};
+
+static bool sameRanges(const FakeModule & module, const Ranges & expected)
+{
+    return module.ranges() == expected && module.consistent();
+}
+
+static void testSingle()
+{
+    FakeModule module;
+    module.patch(0x10, "\x90\x90\x90");
+    CHECK(sameRanges(module, { { Base + 0x10, 3 } }));
+    CHECK(PatchFindExtent<duint>(module.extents, 0x12) == module.extents.begin());
+    CHECK(PatchFindExtent<duint>(module.extents, 0x13) == module.extents.end());
+    CHECK(PatchFindExtent<duint>(module.extents, 0x0F) == module.extents.end());
+}
+
+// Overlapping patches merge and keep the original bytes of the first patch
+static void testOverlapping()
+{
+    FakeModule module;
+    module.patch(0x10, "\x90\x90\x90\x90");
+    module.patch(0x12, "\xCC\xCC\xCC\xCC");
+    CHECK(sameRanges(module, { { Base + 0x10, 6 } }));
+    CHECK(module.extents.begin()->second.oldbytes[2] == module.original[0x12]);
+
+    // A patch covering several extents merges them all
+    module.patch(0x20, "\xEB");
+    module.patch(0x30, "\xEB");
+    CHECK(module.extents.size() == 3);
+    module.patch(0x14, std::string(0x20, '\xC3'));
+    CHECK(sameRanges(module, { { Base + 0x10, 0x24 } }));
+}
+
+// Touching patches become one extent, a gap keeps them apart
+static void testAdjacent()
+{
+    FakeModule module;
+    module.patch(0x10, "\x90\x90");
+    module.patch(0x12, "\x90\x90");
+    CHECK(sameRanges(module, { { Base + 0x10, 4 } }));
+    module.patch(0x0E, "\x90\x90");
+    CHECK(sameRanges(module, { { Base + 0x0E, 6 } }));
+    module.patch(0x15, "\x90");
+    CHECK(sameRanges(module, { { Base + 0x0E, 6 }, { Base + 0x15, 1 } }));
+    module.patch(0x14, "\x90");
+    CHECK(sameRanges(module, { { Base + 0x0E, 8 } }));
+}
+
+// Writing the original bytes back removes them from the extent
+static void testPartialRestore()
+{
+    FakeModule module;
+    module.patch(0x10, std::string(8, '\x90'));
+    module.restore(0x12, 2);
+    CHECK(sameRanges(module, { { Base + 0x10, 2 }, { Base + 0x14, 4 } }));
+    module.restore(0x10, 1);
+    CHECK(sameRanges(module, { { Base + 0x11, 1 }, { Base + 0x14, 4 } }));
+    module.restore(0x10, 0x10);
+    CHECK(module.extents.empty());
+    CHECK(module.memory == module.original);
+
+    // A patch with the bytes that are already there is not stored
+    module.patch(0x20, std::string((const char*)module.original.data() + 0x20, 4));
+    CHECK(module.extents.empty());
+}
+
+// Deleting part of an extent keeps the head and the tail
+static void testDeleteRange()
+{
+    FakeModule module;
+    module.patch(0x10, std::string(0x10, '\x90'));
+    module.patch(0x30, std::string(0x10, '\x90'));
+    module.remove(0x14, 0x18, true);
+    CHECK(sameRanges(module, { { Base + 0x10, 4 }, { Base + 0x18, 8 }, { Base + 0x30, 0x10 } }));
+
+    // A range across extents trims both, without restoring the memory stays patched
+    module.remove(0x1C, 0x34, false);
+    CHECK(module.ranges() == Ranges({ { Base + 0x10, 4 }, { Base + 0x18, 4 }, { Base + 0x34, 0x0C } }));
+    CHECK(module.memory[0x1C] == 0x90 && module.memory[0x30] == 0x90);
+
+    module.remove(0, 0x100, true);
+    CHECK(module.extents.empty());
+    CHECK(module.memory[0x10] == module.original[0x10] && module.memory[0x3F] == module.original[0x3F]);
+
+    // An empty range deletes nothing
+    module.patch(0x10, "\x90");
+    module.remove(0x10, 0x10, true);
+    CHECK(module.extents.size() == 1);
+}
+
+int main()
+{
+    testSingle();
+    testOverlapping();
+    testAdjacent();
+    testPartialRestore();
+    testDeleteRange();
+    return unitresult("patchextents");
+}
@@ -0,0 +1,123 @@
+#include "unittest.h"
+#include "settings.h"
+
+// Fake bridge ini, BridgeSettingSet notifies the callbacks like src/bridge/bridgemain.cpp
+static std::map<std::pair<std::string, std::string>, duint> ini;
+static std::vector<CBSETTINGCHANGED> callbacks;
+static int iniReads = 0;
+
+bool BridgeSettingGetUint(const char* section, const char* key, duint* value)
+{
+    iniReads++;
+    auto found = ini.find(std::make_pair(std::string(section), std::string(key)));
+    if(found == ini.end())
+        return false;
+    *value = found->second;
+    return true;
+}
+
+bool BridgeSettingAddCallback(CBSETTINGCHANGED cbChanged)
+{
+    callbacks.push_back(cbChanged);
+    return true;
+}
+
+static void settingSet(const char* section, const char* key, duint value)
+{
+    ini[std::make_pair(std::string(section), std::string(key))] = value;
+    for(auto callback : callbacks)
+        callback(section, key);
+}
+
+// BridgeSettingRead replaces the whole ini
+static void settingRead(const std::map<std::pair<std::string, std::string>, duint> & values)
+{
+    ini = values;
+    for(auto callback : callbacks)
+        callback(nullptr, nullptr);
+}
+
+static void testInit()
+{
+    ini[std::make_pair(std::string("Events"), std::string("DllLoad"))] = 1;
+    SettingInit();
+    CHECK(callbacks.size() == 1);
+    CHECK(iniReads == SettingLast);
+    CHECK(SettingGetBool(SettingEventsDllLoad));
+    CHECK(!SettingGetBool(SettingEventsSystemBreakpoint)); // missing keys use the default
+
+    // A second SettingInit keeps the handles and the callback
+    SettingInit();
+    CHECK(callbacks.size() == 1 && iniReads == SettingLast);
+}
+
+static void testRegister()
+{
+    ini[std::make_pair(std::string("Gui"), std::string("Width"))] = 800;
+    SETTINGHANDLE width = SettingRegister("Gui", "Width", 640);
+    SETTINGHANDLE height = SettingRegister("Gui", "Height", 480);
+    CHECK(width == SettingLast && height == SettingLast + 1);
+    CHECK(SettingGetUint(width) == 800 && SettingGetUint(height) == 480);
+
+    // The same key resolves to the same handle, predefined keys included
+    CHECK(SettingRegister("Gui", "Width") == width);
+    CHECK(SettingRegister("Events", "DllLoad") == SettingEventsDllLoad);
+    CHECK(SettingRegister("Events", nullptr) == -1 && SettingRegister(nullptr, "Width") == -1);
+
+    // Invalid handles read as zero
+    CHECK(SettingGetUint(-1) == 0 && SettingGetUint(MAX_SETTINGS) == 0);
+}
+
+// A change reloads only the entries of that key
+static void testChange()
+{
+    SETTINGHANDLE width = SettingRegister("Gui", "Width");
+    int reads = iniReads;
+    settingSet("Gui", "Width", 1024);
+    CHECK(iniReads == reads + 1);
+    CHECK(SettingGetUint(width) == 1024);
+
+    reads = iniReads;
+    settingSet("Events", "SystemBreakpoint", 1);
+    CHECK(iniReads == reads + 1);
+    CHECK(SettingGetBool(SettingEventsSystemBreakpoint));
+    CHECK(SettingGetUint(width) == 1024);
+
+    // Unknown keys do not touch the ini
+    reads = iniReads;
+    settingSet("Gui", "Unknown", 1);
+    CHECK(iniReads == reads);
+
+    // Reading the ini again reloads everything, removed keys are back to their default
+    std::map<std::pair<std::string, std::string>, duint> values;
+    values[std::make_pair(std::string("Events"), std::string("DllUnload"))] = 1;
+    settingRead(values);
+    CHECK(SettingGetBool(SettingEventsDllUnload));
+    CHECK(!SettingGetBool(SettingEventsSystemBreakpoint) && !SettingGetBool(SettingEventsDllLoad));
+    CHECK(SettingGetUint(width) == 640);
+}
+
+static void testFull()
+{
+    SETTINGHANDLE last = -1;
+    for(int i = 0; i < MAX_SETTINGS; i++)
+    {
+        SETTINGHANDLE handle = SettingRegister("Fill", std::to_string(i).c_str(), i);
+        if(handle == -1)
+            break;
+        last = handle;
+    }
+    CHECK(last == MAX_SETTINGS - 1);
+    CHECK(SettingGetUint(last) == duint(MAX_SETTINGS - 1 - (SettingLast + 2)));
+    CHECK(SettingRegister("Fill", "one more") == -1);
+    CHECK(SettingRegister("Gui", "Width") == SettingLast);
+}
+
+int main()
+{
+    testInit();
+    testRegister();
+    testChange();
+    testFull();
+    return unitresult("settings");
+}
@@ -0,0 +1,438 @@
+#include "unittest.h"
+#include "unwindtable.h"
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Builds small x64 PE files with .pdata/.xdata on disk and unwinds frames at every interesting offset of their functions.
+// Any further PE files given on the command line are loaded and every function is unwound from the start of its code and its tail.
+
+static const char* TestFile = "test_stackunwind.dll";
+static const uint64_t ImageBase = 0x140000000ull;
+static const uint64_t StackTop = 0x10000; // rsp of the caller before the call
+static const uint64_t ReturnAddress = 0x7FF600001234ull;
+
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI };
+
+static void put16(std::vector<unsigned char> & data, size_t offset, uint16_t value)
+{
+    memcpy(data.data() + offset, &value, sizeof(value));
+}
+
+static void put32(std::vector<unsigned char> & data, size_t offset, uint32_t value)
+{
+    memcpy(data.data() + offset, &value, sizeof(value));
+}
+
+static void putBytes(std::vector<unsigned char> & data, size_t offset, std::initializer_list<unsigned char> bytes)
+{
+    memcpy(data.data() + offset, bytes.begin(), bytes.size());
+}
+
+struct Section
+{
+    const char* Name;
+    uint32_t Rva;
+    uint32_t RawPointer;
+    uint32_t Size;
+};
+
+static const Section Sections[] =
+{
+    { ".text", 0x1000, 0x400, 0x200 },
+    { ".rdata", 0x2000, 0x600, 0x200 },
+    { ".pdata", 0x3000, 0x800, 0x200 },
+};
+
+// Writes the file layout of IMAGE_DOS_HEADER, IMAGE_NT_HEADERS64 and the section table
+static std::vector<unsigned char> peFile(uint32_t exceptionRva, uint32_t exceptionSize)
+{
+    std::vector<unsigned char> file(0xA00);
+    put16(file, 0, 0x5A4D);
+    put32(file, 0x3C, 0x80);
+    put32(file, 0x80, 0x00004550);
+    put16(file, 0x84, 0x8664);
+    put16(file, 0x86, 3);
+    put16(file, 0x94, 0xF0);
+    put16(file, 0x98, 0x20B);
+    put32(file, 0x98 + 56, 0x4000); // SizeOfImage
+    put32(file, 0x98 + 108, 16);
+    put32(file, 0x98 + 112 + 3 * 8, exceptionRva);
+    put32(file, 0x98 + 112 + 3 * 8 + 4, exceptionSize);
+    size_t header = 0x98 + 0xF0;
+    for(const auto & section : Sections)
+    {
+        memcpy(file.data() + header, section.Name, strlen(section.Name));
+        put32(file, header + 8, section.Size);
+        put32(file, header + 12, section.Rva);
+        put32(file, header + 16, section.Size);
+        put32(file, header + 20, section.RawPointer);
+        header += 40;
+    }
+    return file;
+}
+
+static size_t fileOffset(uint32_t rva)
+{
+    for(const auto & section : Sections)
+        if(rva >= section.Rva && rva < section.Rva + section.Size)
+            return section.RawPointer + (rva - section.Rva);
+    return 0;
+}
+
+static void putCode(std::vector<unsigned char> & file, uint32_t rva, std::initializer_list<unsigned char> bytes)
+{
+    putBytes(file, fileOffset(rva), bytes);
+}
+
+static void putFunction(std::vector<unsigned char> & file, int index, uint32_t begin, uint32_t end, uint32_t unwindData)
+{
+    size_t offset = fileOffset(0x3000) + index * 12;
+    put32(file, offset, begin);
+    put32(file, offset + 4, end);
+    put32(file, offset + 8, unwindData);
+}
+
+static const int FunctionCount = 6;
+
+// The synthetic module, see the comments for the state of the stack at each instruction
+static std::vector<unsigned char> syntheticModule()
+{
+    std::vector<unsigned char> file = peFile(0x3000, FunctionCount * 12);
+
+    // F1: push rbx; sub rsp,20h; nop; add rsp,20h; pop rbx; ret
+    putCode(file, 0x1000, { 0x53, 0x48, 0x83, 0xEC, 0x20, 0x90, 0x48, 0x83, 0xC4, 0x20, 0x5B, 0xC3 });
+    putCode(file, 0x2000, { 0x01, 0x05, 0x02, 0x00, 0x05, 0x32, 0x01, 0x30 });
+
+    // F2: push rbp; sub rsp,40h; lea rbp,[rsp+20h]; nop; lea rsp,[rbp+20h]; pop rbp; ret
+    putCode(file, 0x1010, { 0x55, 0x48, 0x83, 0xEC, 0x40, 0x48, 0x8D, 0x6C, 0x24, 0x20, 0x90, 0x48, 0x8D, 0x65, 0x20, 0x5D, 0xC3 });
+    putCode(file, 0x2010, { 0x01, 0x0A, 0x03, 0x25, 0x0A, 0x03, 0x05, 0x72, 0x01, 0x50, 0x00, 0x00 });
+
+    // F3: sub rsp,28h; nop; add rsp,28h; jmp F1 (tail call)
+    putCode(file, 0x1030, { 0x48, 0x83, 0xEC, 0x28, 0x90, 0x48, 0x83, 0xC4, 0x28, 0xE9 });
+    put32(file, fileOffset(0x103A), uint32_t(0x1000 - 0x103E));
+    putCode(file, 0x2020, { 0x01, 0x04, 0x01, 0x00, 0x04, 0x42, 0x00, 0x00 });
+
+    // F4: push rsi; nops, then a second range chained to the first: nop; nop; jmp $-2 (inside the range)
+    putCode(file, 0x1040, { 0x56, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0x90, 0xEB, 0xFC });
+    putCode(file, 0x2030, { 0x01, 0x01, 0x01, 0x00, 0x01, 0x60, 0x00, 0x00 });
+    putCode(file, 0x2040, { 0x21, 0x00, 0x00, 0x00 });
+    put32(file, fileOffset(0x2044), 0x1040);
+    put32(file, fileOffset(0x2048), 0x1048);
+    put32(file, fileOffset(0x204C), 0x2030);
+
+    // F5: sub rsp,100h; mov [rsp+10h],rbx; nop; mov rbx,[rsp+10h]; add rsp,100h; ret
+    putCode(file, 0x1060, { 0x48, 0x81, 0xEC, 0x00, 0x01, 0x00, 0x00, 0x48, 0x89, 0x5C, 0x24, 0x10, 0x90,
+                            0x48, 0x8B, 0x5C, 0x24, 0x10, 0x48, 0x81, 0xC4, 0x00, 0x01, 0x00, 0x00, 0xC3 });
+    putCode(file, 0x2050, { 0x01, 0x0C, 0x04, 0x00, 0x0C, 0x34, 0x02, 0x00, 0x07, 0x01, 0x20, 0x00 });
+
+    // Not sorted on purpose, 0x1050-0x105F is leaf code without an entry
+    putFunction(file, 0, 0x1060, 0x107A, 0x2050);
+    putFunction(file, 1, 0x1000, 0x100C, 0x2000);
+    putFunction(file, 2, 0x1010, 0x1021, 0x2010);
+    putFunction(file, 3, 0x1030, 0x103E, 0x2020);
+    putFunction(file, 4, 0x1040, 0x1048, 0x2030);
+    putFunction(file, 5, 0x1048, 0x1050, 0x2040);
+    return file;
+}
+
+static bool writeFile(const char* path, const std::vector<unsigned char> & data)
+{
+    FILE* file = fopen(path, "wb");
+    if(!file)
+        return false;
+    bool result = fwrite(data.data(), 1, data.size(), file) == data.size();
+    fclose(file);
+    return result;
+}
+
+static bool readFile(const char* path, std::vector<unsigned char> & data)
+{
+    FILE* file = fopen(path, "rb");
+    if(!file)
+        return false;
+    fseek(file, 0, SEEK_END);
+    data.resize(size_t(ftell(file)));
+    fseek(file, 0, SEEK_SET);
+    bool result = fread(data.data(), 1, data.size(), file) == data.size();
+    fclose(file);
+    return result;
+}
+
+// Lays the sections out at their RVAs, like the loader does, so code can be read by address
+static std::vector<unsigned char> mapImage(const std::vector<unsigned char> & file)
+{
+    std::vector<unsigned char> image;
+    if(file.size() < 0x40)
+        return image;
+    uint32_t nt;
+    memcpy(&nt, file.data() + 0x3C, sizeof(nt));
+    if(size_t(nt) + 24 > file.size())
+        return image;
+    uint16_t sectionCount, optionalSize;
+    memcpy(&sectionCount, file.data() + nt + 6, sizeof(sectionCount));
+    memcpy(&optionalSize, file.data() + nt + 20, sizeof(optionalSize));
+    size_t header = nt + 24 + optionalSize;
+    for(uint16_t i = 0; i < sectionCount && header + 40 <= file.size(); i++, header += 40)
+    {
+        uint32_t virtualSize, rva, rawSize, rawPointer;
+        memcpy(&virtualSize, file.data() + header + 8, 4);
+        memcpy(&rva, file.data() + header + 12, 4);
+        memcpy(&rawSize, file.data() + header + 16, 4);
+        memcpy(&rawPointer, file.data() + header + 20, 4);
+        if(rawPointer >= file.size())
+            continue;
+        rawSize = uint32_t(std::min(size_t(rawSize), file.size() - rawPointer));
+        size_t end = size_t(rva) + std::max(virtualSize, rawSize);
+        if(end > 0x10000000) //not a sane image
+            continue;
+        if(image.size() < end)
+            image.resize(end);
+        memcpy(image.data() + rva, file.data() + rawPointer, std::min(rawSize, uint32_t(end - rva)));
+    }
+    return image;
+}
+
+struct Frame
+{
+    std::vector<unsigned char> Image;
+    uint64_t StackBase; // address of Stack[0]
+    std::vector<uint64_t> Stack;
+    UNWIND_CONTEXT Context;
+
+    UNWINDREADPROC Read()
+    {
+        return [this](uint64_t Address, uint64_t* Value)
+        {
+            if(Address < StackBase || (Address - StackBase) % 8 || (Address - StackBase) / 8 >= Stack.size())
+                return false;
+            *Value = Stack[size_t((Address - StackBase) / 8)];
+            return true;
+        };
+    }
+
+    UNWINDCODEPROC ReadCode()
+    {
+        return [this](uint64_t Address, unsigned char* Buffer, size_t Size)
+        {
+            if(Address < ImageBase || Address - ImageBase >= Image.size())
+                return size_t(0);
+            size_t offset = size_t(Address - ImageBase);
+            size_t read = std::min(Size, Image.size() - offset);
+            memcpy(Buffer, Image.data() + offset, read);
+            return read;
+        };
+    }
+};
+
+// Sets up rip and rsp, the stack holds Values from rsp upwards, the return address is above them
+static Frame frameAt(const std::vector<unsigned char> & image, uint32_t rva, std::initializer_list<uint64_t> values, uint64_t extra = 0)
+{
+    Frame frame;
+    frame.Image = image;
+    memset(&frame.Context, 0, sizeof(frame.Context));
+    frame.Context.Rip = ImageBase + rva;
+    uint64_t rsp = StackTop - 8 - values.size() * 8 - extra;
+    frame.Context.Regs[RSP] = rsp;
+    frame.StackBase = rsp;
+    frame.Stack.assign(size_t((StackTop + 8 - rsp) / 8), 0xCCCCCCCCCCCCCCCCull);
+    size_t i = size_t(extra / 8);
+    for(uint64_t value : values)
+        frame.Stack[i++] = value;
+    frame.Stack[i] = ReturnAddress;
+    return frame;
+}
+
+static bool unwound(const UnwindTable & table, Frame & frame)
+{
+    return table.VirtualUnwind(ImageBase, frame.Context, frame.Read(), frame.ReadCode()) &&
+           frame.Context.Rip == ReturnAddress &&
+           frame.Context.Regs[RSP] == StackTop;
+}
+
+static void syntheticUnwind()
+{
+    std::vector<unsigned char> file = syntheticModule();
+    CHECK(writeFile(TestFile, file));
+    std::vector<unsigned char> loaded;
+    CHECK(readFile(TestFile, loaded));
+    UnwindTable table;
+    CHECK(table.Load(loaded.data(), loaded.size()));
+    CHECK(table.Size() == FunctionCount);
+    std::vector<unsigned char> image = mapImage(loaded);
+
+    CHECK(table.Find(0x1000) && table.Find(0x1000)->EndAddress == 0x100C);
+    CHECK(table.Find(0x100B) && table.Find(0x100B)->BeginAddress == 0x1000);
+    CHECK(!table.Find(0x100C));
+    CHECK(!table.Find(0xFFF));
+    CHECK(!table.Find(0x1050));
+    CHECK(table.Find(0x1079) && table.Find(0x1079)->BeginAddress == 0x1060);
+
+    const uint64_t savedRbx = 0x1111, savedRbp = 0x2222, savedRsi = 0x3333;
+
+    // F1, the prolog, the body and every instruction of the epilog
+    Frame frame = frameAt(image, 0x1000, {});
+    CHECK(unwound(table, frame));
+    frame = frameAt(image, 0x1001, { savedRbx });
+    CHECK(unwound(table, frame) && frame.Context.Regs[RBX] == savedRbx);
+    frame = frameAt(image, 0x1005, { savedRbx }, 0x20);
+    CHECK(unwound(table, frame) && frame.Context.Regs[RBX] == savedRbx);
+    frame = frameAt(image, 0x1006, { savedRbx }, 0x20);
+    CHECK(unwound(table, frame) && frame.Context.Regs[RBX] == savedRbx);
+    frame = frameAt(image, 0x100A, { savedRbx });
+    CHECK(unwound(table, frame) && frame.Context.Regs[RBX] == savedRbx);
+    frame = frameAt(image, 0x100B, {});
+    frame.Context.Regs[RBX] = savedRbx;
+    CHECK(unwound(table, frame) && frame.Context.Regs[RBX] == savedRbx);
+
+    // F2, rbp based: the body unwinds through rbp even when rsp moved, the epilog through lea rsp
+    const uint64_t framePointer = StackTop - 48;
+    frame = frameAt(image, 0x101A, { savedRbp }, 0x40);
+    frame.Context.Regs[RBP] = framePointer;
+    CHECK(unwound(table, frame) && frame.Context.Regs[RBP] == savedRbp);
+    frame = frameAt(image, 0x101A, { savedRbp }, 0x40 + 0x80);
+    frame.Context.Regs[RBP] = framePointer;
+    CHECK(unwound(table, frame) && frame.Context.Regs[RBP] == savedRbp);
+    frame = frameAt(image, 0x101B, { savedRbp }, 0x40);
+    frame.Context.Regs[RBP] = framePointer;
+    CHECK(unwound(table, frame) && frame.Context.Regs[RBP] == savedRbp);
+    frame = frameAt(image, 0x101F, { savedRbp });
+    frame.Context.Regs[RBP] = framePointer;
+    CHECK(unwound(table, frame) && frame.Context.Regs[RBP] == savedRbp);
+
+    // F3, an epilog that ends in a tail call
+    frame = frameAt(image, 0x1034, {}, 0x28);
+    CHECK(unwound(table, frame));
+    frame = frameAt(image, 0x1035, {}, 0x28);
+    CHECK(unwound(table, frame));
+    frame = frameAt(image, 0x1039, {});
+    CHECK(unwound(table, frame));
+
+    // F4, the chained range applies the prolog of the primary range, its jmp stays inside and is no epilog
+    frame = frameAt(image, 0x1041, { savedRsi });
+    CHECK(unwound(table, frame) && frame.Context.Regs[RSI] == savedRsi);
+    frame = frameAt(image, 0x104A, { savedRsi });
+    CHECK(unwound(table, frame) && frame.Context.Regs[RSI] == savedRsi);
+
+    // Leaf code without an entry
+    frame = frameAt(image, 0x1050, {});
+    CHECK(unwound(table, frame));
+
+    // F5, large allocation and a saved register; a body instruction that looks like an epilog start is not one
+    frame = frameAt(image, 0x106C, {}, 0x100);
+    frame.Stack[2] = savedRbx;
+    CHECK(unwound(table, frame) && frame.Context.Regs[RBX] == savedRbx);
+    frame = frameAt(image, 0x106D, {}, 0x100);
+    frame.Stack[2] = savedRbx;
+    CHECK(unwound(table, frame) && frame.Context.Regs[RBX] == savedRbx);
+    frame = frameAt(image, 0x1072, {}, 0x100);
+    frame.Context.Regs[RBX] = savedRbx;
+    CHECK(unwound(table, frame) && frame.Context.Regs[RBX] == savedRbx);
+    frame = frameAt(image, 0x1079, {});
+    CHECK(unwound(table, frame));
+
+    // Without the code the epilog cannot be recognized, the body still unwinds
+    frame = frameAt(image, 0x1005, { savedRbx }, 0x20);
+    frame.Image.clear();
+    CHECK(unwound(table, frame) && frame.Context.Regs[RBX] == savedRbx);
+}
+
+// Damaged files are rejected or lose the damaged entries, but never read out of bounds
+static void damagedModules()
+{
+    std::vector<unsigned char> valid = syntheticModule();
+    UnwindTable table;
+    for(size_t size = 0; size <= valid.size(); size += 0x10)
+    {
+        std::vector<unsigned char> truncated(valid.begin(), valid.begin() + size);
+        table.Load(truncated.data(), truncated.size());
+    }
+    CHECK(!table.Load(valid.data(), 0x800));
+
+    std::vector<unsigned char> file = valid;
+    put32(file, 0x3C, 0xFFFFFFF0);
+    CHECK(!table.Load(file.data(), file.size()));
+    file = valid;
+    put16(file, 0x98, 0x10B);
+    CHECK(!table.Load(file.data(), file.size()));
+    file = valid;
+    put32(file, 0x98 + 112 + 3 * 8, 0x9000);
+    CHECK(!table.Load(file.data(), file.size()));
+    file = valid;
+    put16(file, 0x86, 0xFFFF);
+    CHECK(table.Load(file.data(), file.size()));
+
+    // An entry with unwind data outside of the file is dropped
+    file = valid;
+    putFunction(file, 1, 0x1000, 0x100C, 0x8000);
+    CHECK(table.Load(file.data(), file.size()) && table.Size() == FunctionCount - 1 && !table.Find(0x1000));
+
+    // A chain that points to itself ends
+    file = valid;
+    put32(file, fileOffset(0x204C), 0x2040);
+    CHECK(table.Load(file.data(), file.size()));
+    Frame frame = frameAt(mapImage(file), 0x104A, {});
+    table.VirtualUnwind(ImageBase, frame.Context, frame.Read(), frame.ReadCode());
+}
+
+// Unwinds every function of a real module from the first and the last bytes of its code with a filled stack
+static bool unwindModule(const char* path)
+{
+    std::vector<unsigned char> file;
+    if(!readFile(path, file))
+    {
+        printf("%s: could not be read\n", path);
+        return false;
+    }
+    UnwindTable table;
+    if(!table.Load(file.data(), file.size()))
+    {
+        printf("%s: no x64 unwind information\n", path);
+        return false;
+    }
+    std::vector<unsigned char> image = mapImage(file);
+    Frame frame;
+    frame.Image = image;
+    frame.StackBase = StackTop - 0x10000;
+    frame.Stack.assign(0x10000 / 8 + 1, ReturnAddress);
+    size_t functions = 0, unwinds = 0, failures = 0;
+    const UNWIND_FUNCTION* previous = nullptr;
+    for(uint32_t rva = 0; rva < image.size(); rva++)
+    {
+        const UNWIND_FUNCTION* function = table.Find(rva);
+        if(!function || function == previous)
+            continue;
+        previous = function;
+        functions++;
+        uint32_t size = function->EndAddress - function->BeginAddress;
+        for(uint32_t offset = 0; offset < size; offset++)
+        {
+            if(offset >= 64 && offset + 32 < size)
+                continue;
+            memset(&frame.Context, 0, sizeof(frame.Context));
+            frame.Context.Rip = ImageBase + function->BeginAddress + offset;
+            frame.Context.Regs[RSP] = frame.StackBase;
+            for(int reg = 0; reg < 16; reg++)
+                if(reg != RSP)
+                    frame.Context.Regs[reg] = frame.StackBase + 0x800;
+            unwinds++;
+            if(!table.VirtualUnwind(ImageBase, frame.Context, frame.Read(), frame.ReadCode()) || frame.Context.Regs[RSP] <= frame.StackBase)
+            {
+                failures++;
+                printf("%s: unwinding at rva %X failed\n", path, function->BeginAddress + offset);
+            }
+        }
+    }
+    printf("%s: %zu functions, %zu frames unwound, %zu failed\n", path, functions, unwinds, failures);
+    return functions == table.Size() && !failures;
+}
+
+int main(int argc, char* argv[])
+{
+    syntheticUnwind();
+    damagedModules();
+    remove(TestFile);
+    for(int i = 1; i < argc; i++)
+        CHECK(unwindModule(argv[i]));
+    return unitresult("test_stackunwind");
+}
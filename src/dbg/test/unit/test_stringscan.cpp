@@ -0,0 +1,101 @@
+#include "unittest.h"
+#include "stringscalar.h"
+#include <cctype>
+#include <clocale>
+#include <cstring>
+#include <string>
+
+// The classification matches isprint() || isspace() in the "C" locale, for every byte at every block position
+static void testClassification()
+{
+    setlocale(LC_ALL, "C");
+    bool scalar = true;
+    bool simd = true;
+    for(int ch = 0; ch < 256; ch++)
+    {
+        scalar = scalar && isstringchar((unsigned char)ch) == (isprint(ch) || isspace(ch));
+        for(int position = 0; position < 16; position++)
+        {
+            unsigned char block[16];
+            memset(block, ch == 'A' ? 0 : 'A', sizeof(block));
+            block[position] = (unsigned char)ch;
+            unsigned int expected = 0;
+            for(int i = 0; i < 16; i++)
+                if(isstringchar(block[i]))
+                    expected |= 1 << i;
+            simd = simd && stringcharmask(block) == expected;
+        }
+    }
+    CHECK(scalar);
+    CHECK(simd);
+}
+
+static StringRanges ascii(const std::string & text)
+{
+    StringRanges strings;
+    scanAscii((const unsigned char*)text.data(), text.size(), strings);
+    return strings;
+}
+
+static StringRanges range(size_t start, size_t end)
+{
+    return StringRanges(1, std::make_pair(start, end));
+}
+
+// Strings that start, end or are terminated at the block boundaries and in the tail
+static void testAsciiBoundaries()
+{
+    const std::string nul(1, '\0');
+    CHECK(ascii("ab" + nul) == range(0, 2));
+    CHECK(ascii("a" + nul).empty()); // too short
+    CHECK(ascii("abc").empty()); // not terminated
+    CHECK(ascii(std::string(15, '\x90') + "ab" + nul) == range(15, 17));
+    CHECK(ascii(std::string(16, 'x') + nul) == range(0, 16));
+    CHECK(ascii(std::string(40, 'x') + nul) == range(0, 40));
+    CHECK(ascii(std::string(32, 'x') + nul + std::string(15, '\x90')) == range(0, 32));
+    CHECK(ascii("ab\x90xy" + nul).size() == 1 && ascii("ab\x90xy" + nul)[0] == std::make_pair(size_t(3), size_t(5)));
+    CHECK(ascii(std::string(17, '\x90') + "\t\r\n" + nul) == range(17, 20));
+}
+
+// The SSE2 scan finds the same strings as the scalar scan
+static void testAsciiScalar()
+{
+    bool same = true;
+    size_t total = 0;
+    for(unsigned int seed = 1; seed <= 200; seed++)
+    {
+        auto data = moduleData(1000 + seed * 7, seed);
+        StringRanges simd, scalar;
+        scanAscii(data.data(), data.size(), simd);
+        scanAsciiScalar(data.data(), data.size(), scalar);
+        same = same && simd == scalar;
+        total += scalar.size();
+    }
+    CHECK(same);
+    CHECK(total > 1000);
+}
+
+static void testUnicode()
+{
+    const unsigned char data[] = { 0x90, 'a', 0, 'b', 0, 'c', 0, 0, 0, 'x', 0, 0, 0 };
+    StringRanges even, odd;
+    StringScanUnicode(data, sizeof(data), size_t(0), [&](size_t Start, size_t End)
+    {
+        even.push_back(std::make_pair(Start, End));
+    });
+    StringScanUnicode(data, sizeof(data), size_t(1), [&](size_t Start, size_t End)
+    {
+        odd.push_back(std::make_pair(Start, End));
+    });
+    CHECK(even.empty());
+    CHECK(odd == range(1, 7)); // "abc", the single "x" is too short
+}
+
+int main()
+{
+    testClassification();
+    testAsciiBoundaries();
+    testAsciiScalar();
+    testUnicode();
+    return unitresult("stringscan");
+}
@@ -0,0 +1,108 @@
+#include "unittest.h"
+#include "symbolqueue.h"
+#include <cstdint>
+
+typedef uint64_t duint;
+typedef SymbolLoadQueue<duint> Queue;
+
+static duint next(Queue & queue)
+{
+    Queue::Request request;
+    if(!queue.Next(request))
+        return 0;
+    return request.Base;
+}
+
+// Modules are loaded in the order they were added
+static void testOrder()
+{
+    Queue queue;
+    queue.Add(0x10000, 0x1000, "a.dll");
+    queue.Add(0x20000, 0x1000, "b.dll");
+    queue.Add(0x30000, 0x1000, "c.dll");
+    CHECK(queue.Size() == 3);
+    CHECK(next(queue) == 0x10000);
+    CHECK(next(queue) == 0x20000);
+    CHECK(next(queue) == 0x30000);
+    CHECK(next(queue) == 0);
+}
+
+// The module that was asked for last is loaded next
+static void testPrioritize()
+{
+    Queue queue;
+    queue.Add(0x10000, 0x1000, "a.dll");
+    queue.Add(0x20000, 0x1000, "b.dll");
+    queue.Add(0x30000, 0x1000, "c.dll");
+    CHECK(queue.Prioritize(0x20800));
+    CHECK(queue.Prioritize(0x30000));
+    CHECK(!queue.Prioritize(0x40000));
+    CHECK(next(queue) == 0x30000);
+    CHECK(next(queue) == 0x20000);
+    CHECK(next(queue) == 0x10000);
+}
+
+// Addresses inside a queued module or the module being loaded are pending
+static void testPending()
+{
+    Queue queue;
+    CHECK(!queue.IsPending(0x10000));
+    queue.Add(0x10000, 0x2000, "a.dll");
+    queue.Add(0x20000, 0x1000, "b.dll");
+    CHECK(queue.IsPending(0x11FFF));
+    CHECK(!queue.IsPending(0x12000));
+    CHECK(next(queue) == 0x10000);
+    CHECK(queue.IsPending(0x10000)); // being loaded
+    int done, total;
+    queue.Finish(done, total);
+    CHECK(!queue.IsPending(0x10000));
+    CHECK(queue.IsPending(0x20000));
+}
+
+// Unloaded modules leave the queue and the progress
+static void testRemove()
+{
+    Queue queue;
+    queue.Add(0x10000, 0x1000, "a.dll");
+    queue.Add(0x20000, 0x1000, "b.dll");
+    CHECK(queue.Remove(0x10000));
+    CHECK(!queue.Remove(0x10000));
+    CHECK(!queue.IsPending(0x10000));
+    CHECK(next(queue) == 0x20000);
+    int done, total;
+    queue.Finish(done, total);
+    CHECK(done == 1 && total == 1);
+}
+
+static void testProgressAndClear()
+{
+    Queue queue;
+    queue.Add(0x10000, 0x1000, "a.dll");
+    queue.Add(0x20000, 0x1000, "b.dll");
+    int done, total;
+    Queue::Request request;
+    CHECK(queue.Next(request) && request.Name == "a.dll" && request.Size == 0x1000);
+    queue.Finish(done, total);
+    CHECK(done == 1 && total == 2);
+    queue.Add(0x30000, 0x1000, "c.dll");
+    CHECK(next(queue) == 0x20000);
+    queue.Finish(done, total);
+    CHECK(done == 2 && total == 3);
+
+    queue.Clear();
+    CHECK(queue.Size() == 0 && !queue.IsPending(0x30000));
+    queue.Add(0x40000, 0x1000, "d.dll");
+    CHECK(next(queue) == 0x40000);
+    queue.Finish(done, total);
+    CHECK(done == 1 && total == 1);
+}
+
+int main()
+{
+    testOrder();
+    testPrioritize();
+    testPending();
+    testRemove();
+    testProgressAndClear();
+    return unitresult("symbolqueue");
+}
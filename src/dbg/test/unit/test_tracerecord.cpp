@@ -0,0 +1,184 @@
+#include "unittest.h"
+#include "tracesynthetic.h"
+
+static const char* TestFile = "test_tracerecord.trace";
+
+static bool readAll(std::vector<char> & data)
+{
+    FILE* file = fopen(TestFile, "rb");
+    if(!file)
+        return false;
+    fseek(file, 0, SEEK_END);
+    data.resize(size_t(ftell(file)));
+    fseek(file, 0, SEEK_SET);
+    bool result = fread(data.data(), 1, data.size(), file) == data.size();
+    fclose(file);
+    return result;
+}
+
+static void writeAll(const std::vector<char> & data)
+{
+    FILE* file = fopen(TestFile, "wb");
+    fwrite(data.data(), 1, data.size(), file);
+    fclose(file);
+}
+
+// Every event has to come back from the file, read in order and at random
+static void roundTrip(ULONGLONG count)
+{
+    TraceRecorder recorder;
+    for(ULONGLONG i = 0; i < count; i++)
+        recorder.Record(syntheticEvent(i));
+    CHECK(recorder.FirstEvent() == 0);
+    CHECK(recorder.EventCount() == count);
+    CHECK(recorder.Save(TestFile));
+
+    TraceReader reader;
+    CHECK(reader.Open(TestFile));
+    CHECK(reader.Header().FirstEvent == 0);
+    CHECK(reader.Header().EventCount == count);
+    CHECK(reader.Header().PointerSize == sizeof(duint));
+    TRACEEVENT event;
+    int mismatches = 0;
+    for(ULONGLONG i = 0; i < count; i++)
+        if(!reader.Read(i, event) || !sameEvent(event, syntheticEvent(i)))
+            mismatches++;
+    CHECK(mismatches == 0);
+    mismatches = 0;
+    for(ULONGLONG i = count; i-- > 0;)
+    {
+        ULONGLONG index = (i * 7919) % count;
+        if(!reader.Read(index, event) || !sameEvent(event, syntheticEvent(index)))
+            mismatches++;
+    }
+    CHECK(mismatches == 0);
+    CHECK(!reader.Read(count, event));
+}
+
+// The oldest blocks are dropped once the buffer is full, the rest keeps its event numbers
+static void ringBuffer()
+{
+    const ULONGLONG count = 200000;
+    TraceRecorder recorder;
+    recorder.SetMaxSize(2 * TRACE_BLOCK_SIZE);
+    for(ULONGLONG i = 0; i < count; i++)
+        recorder.Record(syntheticEvent(i));
+    recorder.Flush();
+    ULONGLONG first = recorder.FirstEvent();
+    CHECK(first > 0);
+    CHECK(first + recorder.EventCount() == count);
+    CHECK(recorder.MemoryUsage() <= 3 * TRACE_BLOCK_SIZE);
+    CHECK(recorder.Save(TestFile));
+
+    TraceReader reader;
+    CHECK(reader.Open(TestFile));
+    CHECK(reader.Header().FirstEvent == first);
+    TRACEEVENT event;
+    CHECK(!reader.Read(first - 1, event));
+    CHECK(reader.Read(first, event) && sameEvent(event, syntheticEvent(first)));
+    CHECK(reader.Read(count - 1, event) && sameEvent(event, syntheticEvent(count - 1)));
+    CHECK(!reader.Read(count, event));
+
+    // Clear starts over at event 0
+    recorder.Clear();
+    CHECK(recorder.EventCount() == 0);
+    recorder.Record(syntheticEvent(5));
+    CHECK(recorder.FirstEvent() == 0 && recorder.EventCount() == 1);
+    CHECK(recorder.Save(TestFile));
+    CHECK(reader.Open(TestFile));
+    CHECK(reader.Read(0, event) && sameEvent(event, syntheticEvent(5)));
+}
+
+static void emptyTrace()
+{
+    TraceRecorder recorder;
+    CHECK(recorder.Save(TestFile));
+    TraceReader reader;
+    CHECK(reader.Open(TestFile));
+    CHECK(reader.Header().EventCount == 0 && reader.Header().BlockCount == 0);
+    TRACEEVENT event;
+    CHECK(!reader.Read(0, event));
+}
+
+// Damaged headers and indexes are rejected by Open, damaged blocks by Read
+static void damagedFiles()
+{
+    TraceRecorder recorder;
+    for(ULONGLONG i = 0; i < 20000; i++)
+        recorder.Record(syntheticEvent(i));
+    CHECK(recorder.Save(TestFile));
+    std::vector<char> valid;
+    CHECK(readAll(valid));
+    TRACEFILEHEADER header;
+    memcpy(&header, valid.data(), sizeof(header));
+    CHECK(header.BlockCount >= 2);
+    const size_t indexOffset = size_t(header.IndexOffset);
+
+    auto patchHeader = [&](void (*patch)(TRACEFILEHEADER &))
+    {
+        std::vector<char> data = valid;
+        TRACEFILEHEADER damaged;
+        memcpy(&damaged, data.data(), sizeof(damaged));
+        patch(damaged);
+        memcpy(data.data(), &damaged, sizeof(damaged));
+        return data;
+    };
+    auto patchIndex = [&](size_t block, void (*patch)(TRACEFILEINDEX &))
+    {
+        std::vector<char> data = valid;
+        char* entry = data.data() + indexOffset + block * sizeof(TRACEFILEINDEX);
+        TRACEFILEINDEX damaged;
+        memcpy(&damaged, entry, sizeof(damaged));
+        patch(damaged);
+        memcpy(entry, &damaged, sizeof(damaged));
+        return data;
+    };
+
+    std::vector<std::vector<char>> damaged;
+    damaged.push_back(std::vector<char>(valid.begin(), valid.begin() + sizeof(TRACEFILEHEADER) - 1));
+    damaged.push_back(std::vector<char>(valid.begin(), valid.end() - 1));
+    damaged.push_back(patchHeader([](TRACEFILEHEADER & h) { h.Magic[0] ^= 1; }));
+    damaged.push_back(patchHeader([](TRACEFILEHEADER & h) { h.Version++; }));
+    damaged.push_back(patchHeader([](TRACEFILEHEADER & h) { h.BlockCount++; }));
+    damaged.push_back(patchHeader([](TRACEFILEHEADER & h) { h.BlockCount = 0xFFFFFFFF; }));
+    damaged.push_back(patchHeader([](TRACEFILEHEADER & h) { h.IndexOffset = 0; }));
+    damaged.push_back(patchHeader([](TRACEFILEHEADER & h) { h.IndexOffset = ~0ull; }));
+    damaged.push_back(patchHeader([](TRACEFILEHEADER & h) { h.EventCount++; }));
+    damaged.push_back(patchIndex(0, [](TRACEFILEINDEX & e) { e.RawSize = TRACE_BLOCK_SIZE + 1; }));
+    damaged.push_back(patchIndex(0, [](TRACEFILEINDEX & e) { e.CompressedSize = 0xFFFFFFFF; }));
+    damaged.push_back(patchIndex(0, [](TRACEFILEINDEX & e) { e.CompressedSize = 0; }));
+    damaged.push_back(patchIndex(0, [](TRACEFILEINDEX & e) { e.EventCount = 0xFFFFFFFF; }));
+    damaged.push_back(patchIndex(0, [](TRACEFILEINDEX & e) { e.EventCount = 0; }));
+    damaged.push_back(patchIndex(1, [](TRACEFILEINDEX & e) { e.Offset += 1; }));
+    damaged.push_back(patchIndex(1, [](TRACEFILEINDEX & e) { e.Offset = ~0ull; }));
+    damaged.push_back(patchIndex(1, [](TRACEFILEINDEX & e) { e.FirstEvent -= 1; }));
+    for(const auto & data : damaged)
+    {
+        writeAll(data);
+        TraceReader reader;
+        CHECK(!reader.Open(TestFile));
+    }
+
+    // A block that does not decode fails the read, but not the rest of the file
+    std::vector<char> data = valid;
+    TRACEFILEINDEX first;
+    memcpy(&first, data.data() + indexOffset, sizeof(first));
+    memset(data.data() + first.Offset, 0xFF, first.CompressedSize);
+    writeAll(data);
+    TraceReader reader;
+    CHECK(reader.Open(TestFile));
+    TRACEEVENT event;
+    CHECK(!reader.Read(0, event));
+    CHECK(reader.Read(first.EventCount, event) && sameEvent(event, syntheticEvent(first.EventCount)));
+}
+
+int main()
+{
+    roundTrip(1);
+    roundTrip(100000);
+    ringBuffer();
+    emptyTrace();
+    damagedFiles();
+    remove(TestFile);
+    return unitresult("test_tracerecord");
+}
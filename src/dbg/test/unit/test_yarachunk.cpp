@@ -0,0 +1,93 @@
+#include "unittest.h"
+#include "yarachunk.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+typedef uint64_t duint;
+
+struct Chunk
+{
+    duint offset;
+    duint size;
+    duint limit;
+};
+
+static std::vector<Chunk> chunks(duint regionSize, duint chunkSize, duint overlap)
+{
+    std::vector<Chunk> result;
+    YaraForEachChunk<duint>(regionSize, chunkSize, overlap, [&](duint Offset, duint Size, duint Limit)
+    {
+        result.push_back({ Offset, Size, Limit });
+    });
+    return result;
+}
+
+// Consecutive chunks overlap, only the last one reports everything
+static void testLayout()
+{
+    auto result = chunks(0x1000, 0x400, 0x100);
+    CHECK(result.size() == 5);
+    CHECK(result[0].offset == 0 && result[0].size == 0x400 && result[0].limit == 0x300);
+    CHECK(result[1].offset == 0x300 && result[1].size == 0x400);
+    CHECK(result[3].offset == 0x900 && result[3].size == 0x400 && result[3].limit == 0x300);
+    CHECK(result[4].offset == 0xC00 && result[4].size == 0x400);
+    CHECK(result.back().offset + result.back().size == 0x1000 && result.back().limit == ~duint(0));
+
+    // Regions up to one chunk are a single chunk
+    result = chunks(0x400, 0x400, 0x100);
+    CHECK(result.size() == 1 && result[0].size == 0x400 && result[0].limit == ~duint(0));
+    result = chunks(0x10, 0x400, 0x100);
+    CHECK(result.size() == 1 && result[0].size == 0x10);
+    CHECK(chunks(0, 0x400, 0x100).empty());
+
+    // The chunks cover the region without gaps and the reported parts do not overlap
+    result = chunks(0x12345, 0x1000, 0x80);
+    duint reported = 0;
+    bool contiguous = true;
+    for(size_t i = 0; i < result.size(); i++)
+    {
+        contiguous = contiguous && result[i].offset == reported && result[i].size <= 0x1000;
+        reported += std::min(result[i].size, result[i].limit);
+    }
+    CHECK(contiguous && reported == 0x12345);
+}
+
+// Every occurrence of a pattern up to the overlap is reported exactly once, like the matches of yaraScanCallback
+static void testMatches()
+{
+    const duint overlap = 0x40;
+    const duint chunkSize = 0x200;
+    const char pattern[] = "x64dbg-yara-pattern";
+    const duint patternSize = sizeof(pattern) - 1;
+
+    std::vector<unsigned char> region(0x1000, 0);
+    std::vector<duint> expected;
+    // Occurrences at the start, inside the overlaps, across chunk ends and at the end of the region
+    const duint positions[] = { 0, 0x100, 0x1B0, 0x1C5, 0x1F0, 0x37F - patternSize + 1, 0x3C0, 0x77F, 0x1000 - patternSize };
+    for(duint position : positions)
+    {
+        memcpy(region.data() + position, pattern, patternSize);
+        expected.push_back(position);
+    }
+
+    std::vector<duint> found;
+    YaraForEachChunk<duint>(region.size(), chunkSize, overlap, [&](duint Offset, duint Size, duint Limit)
+    {
+        for(duint i = 0; i + patternSize <= Size; i++)
+        {
+            if(!memcmp(region.data() + Offset + i, pattern, patternSize) && i < Limit)
+                found.push_back(Offset + i);
+        }
+    });
+    std::sort(found.begin(), found.end());
+    CHECK(found == expected);
+}
+
+int main()
+{
+    testLayout();
+    testMatches();
+    return unitresult("yarachunk");
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "tracestream.h"
+
+// Synthetic instruction stream for the trace encoder: small address and register steps like real code,
+// a thread switch every 1000 events and up to four memory operands on the stack. Event i only depends on i.
+static TRACEEVENT syntheticEvent(ULONGLONG i)
+{
+    TRACEEVENT event;
+    memset(&event, 0, sizeof(event));
+    event.Address = 0x140001000ull + (i * 7) % 0x3000;
+    event.ThreadId = 0x100 + DWORD(i / 1000 % 3) * 4;
+    for(int j = 0; j < TRACE_REGISTER_COUNT - 1; j++)
+    {
+        duint step = (j & 1) ? duint(-8) : 16;
+        event.Registers[j] = 0x7FF000000000ull * j + (i >> (j % 4)) * step;
+    }
+    event.Registers[TRACE_REGISTER_COUNT - 1] = 0x202 | ((i & 1) << 6);
+    event.MemoryCount = (unsigned char)(i % (TRACE_MAX_MEMORY + 1));
+    for(unsigned char k = 0; k < event.MemoryCount; k++)
+    {
+        TRACEMEMORY & memory = event.Memory[k];
+        memory.Address = event.Registers[4] - 8 * k;
+        memory.Size = (unsigned char)(1 << (k % 4));
+        memory.OldValue = (i * 0x1234567ull) >> (k * 8);
+        memory.Written = (i + k) % 2 == 0;
+        if(memory.Written)
+            memory.NewValue = memory.OldValue ^ 0xFF;
+    }
+    return event;
+}
+
+static bool sameEvent(const TRACEEVENT & a, const TRACEEVENT & b)
+{
+    if(a.Address != b.Address || a.ThreadId != b.ThreadId || a.MemoryCount != b.MemoryCount)
+        return false;
+    if(memcmp(a.Registers, b.Registers, sizeof(a.Registers)))
+        return false;
+    for(unsigned char k = 0; k < a.MemoryCount; k++)
+    {
+        const TRACEMEMORY & x = a.Memory[k];
+        const TRACEMEMORY & y = b.Memory[k];
+        if(x.Address != y.Address || x.Size != y.Size || x.OldValue != y.OldValue || x.Written != y.Written || (x.Written && x.NewValue != y.NewValue))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdio>
+#include <chrono>
+
+// Minimal checks for the tests of the platform independent parts of the debugger, see Makefile
+static int unitChecks = 0;
+static int unitFailures = 0;
+
+#define CHECK(expr) do { unitChecks++; if(!(expr)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); unitFailures++; } } while(0)
+
+static int unitresult(const char* name)
+{
+    if(unitFailures)
+        printf("%s: %d of %d check(s) failed\n", name, unitFailures, unitChecks);
+    else
+        printf("%s: %d check(s) passed\n", name, unitChecks);
+    return unitFailures ? 1 : 0;
+}
+
+/**
+\brief Runs Proc Iterations times and prints the time per iteration.
+*/
+template<typename Proc>
+static double unitbench(const char* name, size_t iterations, Proc proc)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    for(size_t i = 0; i < iterations; i++)
+        proc();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+    double perIteration = elapsed.count() / double(iterations);
+    printf("%-40s %12.1f ns/iteration (%zu iterations)\n", name, perIteration, iterations);
+    return perIteration;
+}
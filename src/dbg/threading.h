@@ -52,6 +52,16 @@ enum SectionLock
     LockPluginCallbackList,
     LockPluginCommandList,
     LockPluginMenuList,
+    LockStackComments,
+    LockUnwindTables,
+    LockCommands,
+    LockExpressions,
+    LockTraceRecord,
+    LockGuiUpdate,
+    LockSymbolCache,
+    LockSymbolLoader,
+    LockSettings,
+    LockAutoAnalysis,
 
     // Number of elements in this enumeration. Must always be the last
     // index.
@@ -0,0 +1,214 @@
+/**
+ @file tracerecord.cpp
+
+ @brief Implements the run-trace recorder.
+ */
+
+#include "tracerecord.h"
+#include "memory.h"
+#include "threading.h"
+#include <capstone_wrapper.h>
+
+static TraceRecorder traceRecorder;
+static TRACEEVENT tracePending;
+static bool tracePendingValid = false;
+
+static bool traceregister(const TITAN_ENGINE_CONTEXT_t & context, unsigned int reg, duint next, duint & value)
+{
+    switch(reg)
+    {
+#ifdef _WIN64
+    case X86_REG_RAX:
+        value = context.cax;
+        return true;
+    case X86_REG_RCX:
+        value = context.ccx;
+        return true;
+    case X86_REG_RDX:
+        value = context.cdx;
+        return true;
+    case X86_REG_RBX:
+        value = context.cbx;
+        return true;
+    case X86_REG_RSP:
+        value = context.csp;
+        return true;
+    case X86_REG_RBP:
+        value = context.cbp;
+        return true;
+    case X86_REG_RSI:
+        value = context.csi;
+        return true;
+    case X86_REG_RDI:
+        value = context.cdi;
+        return true;
+    case X86_REG_R8:
+        value = context.r8;
+        return true;
+    case X86_REG_R9:
+        value = context.r9;
+        return true;
+    case X86_REG_R10:
+        value = context.r10;
+        return true;
+    case X86_REG_R11:
+        value = context.r11;
+        return true;
+    case X86_REG_R12:
+        value = context.r12;
+        return true;
+    case X86_REG_R13:
+        value = context.r13;
+        return true;
+    case X86_REG_R14:
+        value = context.r14;
+        return true;
+    case X86_REG_R15:
+        value = context.r15;
+        return true;
+    case X86_REG_RIP:
+        value = next;
+        return true;
+#endif //_WIN64
+    case X86_REG_EAX:
+        value = DWORD(context.cax);
+        return true;
+    case X86_REG_ECX:
+        value = DWORD(context.ccx);
+        return true;
+    case X86_REG_EDX:
+        value = DWORD(context.cdx);
+        return true;
+    case X86_REG_EBX:
+        value = DWORD(context.cbx);
+        return true;
+    case X86_REG_ESP:
+        value = DWORD(context.csp);
+        return true;
+    case X86_REG_EBP:
+        value = DWORD(context.cbp);
+        return true;
+    case X86_REG_ESI:
+        value = DWORD(context.csi);
+        return true;
+    case X86_REG_EDI:
+        value = DWORD(context.cdi);
+        return true;
+    case X86_REG_EIP:
+        value = DWORD(next);
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+\brief Captures the state of a thread before it executes its next instruction. The event is completed and recorded by TraceRecordEnd().
+\param hThread Handle of the thread.
+\param ThreadId Identifier of the thread.
+*/
+void TraceRecordBegin(HANDLE hThread, DWORD ThreadId)
+{
+    tracePendingValid = false;
+    TITAN_ENGINE_CONTEXT_t context;
+    if(!GetFullContextDataEx(hThread, &context))
+        return;
+    TRACEEVENT & event = tracePending;
+    memset(&event, 0, sizeof(event));
+    event.Address = context.cip;
+    event.ThreadId = ThreadId;
+    const duint registers[TRACE_REGISTER_COUNT] =
+    {
+        context.cax, context.ccx, context.cdx, context.cbx, context.csp, context.cbp, context.csi, context.cdi,
+#ifdef _WIN64
+        context.r8, context.r9, context.r10, context.r11, context.r12, context.r13, context.r14, context.r15,
+#endif //_WIN64
+        context.eflags
+    };
+    memcpy(event.Registers, registers, sizeof(registers));
+
+    //resolve the memory operands, fs/gs relative operands are skipped because the segment base is not in the context
+    unsigned char data[MAX_DISASM_BUFFER];
+    Capstone cp;
+    if(MemRead(event.Address, data, sizeof(data)) && cp.Disassemble(event.Address, data) && cp.GetId() != X86_INS_LEA && !cp.IsNop())
+    {
+        duint next = event.Address + cp.Size();
+        for(int i = 0; i < cp.OpCount() && event.MemoryCount < TRACE_MAX_MEMORY; i++)
+        {
+            const cs_x86_op & op = cp[i];
+            if(op.type != X86_OP_MEM || !op.size || op.mem.segment == X86_REG_FS || op.mem.segment == X86_REG_GS)
+                continue;
+            duint base = 0;
+            duint index = 0;
+            if(op.mem.base != X86_REG_INVALID && !traceregister(context, op.mem.base, next, base))
+                continue;
+            if(op.mem.index != X86_REG_INVALID && !traceregister(context, op.mem.index, next, index))
+                continue;
+            TRACEMEMORY & memory = event.Memory[event.MemoryCount];
+            memory.Address = base + index * op.mem.scale + duint(op.mem.disp);
+            memory.Size = (unsigned char)min(op.size, sizeof(duint));
+            if(MemRead(memory.Address, &memory.OldValue, memory.Size))
+                event.MemoryCount++;
+        }
+    }
+    tracePendingValid = true;
+}
+
+/**
+\brief Completes the event captured by TraceRecordBegin() after the instruction executed and adds it to the trace buffer.
+*/
+void TraceRecordEnd()
+{
+    if(!tracePendingValid)
+        return;
+    tracePendingValid = false;
+    for(unsigned char i = 0; i < tracePending.MemoryCount; i++)
+    {
+        TRACEMEMORY & memory = tracePending.Memory[i];
+        duint value = 0;
+        if(MemRead(memory.Address, &value, memory.Size) && value != memory.OldValue)
+        {
+            memory.NewValue = value;
+            memory.Written = true;
+        }
+    }
+    EXCLUSIVE_ACQUIRE(LockTraceRecord);
+    traceRecorder.Record(tracePending);
+}
+
+void TraceRecordFlush()
+{
+    EXCLUSIVE_ACQUIRE(LockTraceRecord);
+    traceRecorder.Flush();
+}
+
+void TraceRecordClear()
+{
+    EXCLUSIVE_ACQUIRE(LockTraceRecord);
+    tracePendingValid = false;
+    traceRecorder.Clear();
+}
+
+bool TraceRecordSave(const char* FileName)
+{
+    EXCLUSIVE_ACQUIRE(LockTraceRecord);
+    return traceRecorder.Save(FileName);
+}
+
+void TraceRecordSetMaxSize(size_t MaxSize)
+{
+    EXCLUSIVE_ACQUIRE(LockTraceRecord);
+    traceRecorder.SetMaxSize(MaxSize);
+}
+
+ULONGLONG TraceRecordEventCount()
+{
+    SHARED_ACQUIRE(LockTraceRecord);
+    return traceRecorder.EventCount();
+}
+
+size_t TraceRecordMemoryUsage()
+{
+    SHARED_ACQUIRE(LockTraceRecord);
+    return traceRecorder.MemoryUsage();
+}
@@ -0,0 +1,16 @@
+#ifndef _TRACERECORD_H
+#define _TRACERECORD_H
+
+#include "_global.h"
+#include "tracestream.h"
+
+void TraceRecordBegin(HANDLE hThread, DWORD ThreadId);
+void TraceRecordEnd();
+void TraceRecordFlush();
+void TraceRecordClear();
+bool TraceRecordSave(const char* FileName);
+void TraceRecordSetMaxSize(size_t MaxSize);
+ULONGLONG TraceRecordEventCount();
+size_t TraceRecordMemoryUsage();
+
+#endif //_TRACERECORD_H
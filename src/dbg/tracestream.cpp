@@ -0,0 +1,429 @@
+/**
+ @file tracestream.cpp
+
+ @brief Implements the run-trace encoder and the trace file format.
+ */
+
+#include "tracestream.h"
+#include "lz4\lz4.h"
+
+#define TRACE_FILE_MAGIC "TRACEREC"
+#define TRACE_FILE_VERSION 1
+#define TRACE_MAX_RECORD_SIZE (32 + TRACE_REGISTER_COUNT * 10 + TRACE_MAX_MEMORY * 32)
+
+static bool writeall(HANDLE File, const void* Data, size_t Size)
+{
+    DWORD written = 0;
+    return !!WriteFile(File, Data, DWORD(Size), &written, nullptr) && written == DWORD(Size);
+}
+
+static bool readall(HANDLE File, void* Data, size_t Size)
+{
+    DWORD read = 0;
+    return !!ReadFile(File, Data, DWORD(Size), &read, nullptr) && read == DWORD(Size);
+}
+
+static void writevarint(std::vector<unsigned char> & out, ULONGLONG value)
+{
+    while(value >= 0x80)
+    {
+        out.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((unsigned char)value);
+}
+
+static void writedelta(std::vector<unsigned char> & out, duint value, duint previous)
+{
+    //zigzag encoding, small positive and negative differences both end up as short varints
+    dsint delta = dsint(value - previous);
+    duint zigzag = (duint(delta) << 1) ^ duint(delta >> (sizeof(dsint) * 8 - 1));
+    writevarint(out, zigzag);
+}
+
+static bool readvarint(const unsigned char* & data, const unsigned char* end, ULONGLONG & value)
+{
+    value = 0;
+    for(int shift = 0; shift < 64; shift += 7)
+    {
+        if(data >= end)
+            return false;
+        unsigned char byte = *data++;
+        value |= ULONGLONG(byte & 0x7F) << shift;
+        if(!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static bool readdelta(const unsigned char* & data, const unsigned char* end, duint previous, duint & value)
+{
+    ULONGLONG encoded;
+    if(!readvarint(data, end, encoded))
+        return false;
+    duint zigzag = duint(encoded);
+    dsint delta = dsint(zigzag >> 1) ^ -dsint(zigzag & 1);
+    value = previous + duint(delta);
+    return true;
+}
+
+TraceRecorder::TraceRecorder()
+{
+    m_CompressedSize = 0;
+    m_MaxSize = TRACE_DEFAULT_BUFFER_SIZE;
+    m_NextEvent = 0;
+    m_RawCount = 0;
+    ResetEncoder();
+}
+
+void TraceRecorder::ResetEncoder()
+{
+    //every block starts from a zero state, so blocks can be decoded on their own
+    memset(&m_Previous, 0, sizeof(m_Previous));
+    m_PreviousMemory = 0;
+}
+
+void TraceRecorder::Record(const TRACEEVENT & Event)
+{
+    if(m_Raw.size() + TRACE_MAX_RECORD_SIZE > TRACE_BLOCK_SIZE)
+        Flush();
+    if(!m_RawCount)
+    {
+        ResetEncoder();
+        m_Raw.reserve(TRACE_BLOCK_SIZE);
+    }
+
+    unsigned char memoryCount = min(Event.MemoryCount, (unsigned char)TRACE_MAX_MEMORY);
+    bool threadChanged = Event.ThreadId != m_Previous.ThreadId;
+    writevarint(m_Raw, (memoryCount << 1) | (threadChanged ? 1 : 0));
+    if(threadChanged)
+        writevarint(m_Raw, Event.ThreadId);
+    writedelta(m_Raw, Event.Address, m_Previous.Address);
+
+    //only the registers that changed since the previous event are stored
+    DWORD mask = 0;
+    for(int i = 0; i < TRACE_REGISTER_COUNT; i++)
+        if(Event.Registers[i] != m_Previous.Registers[i])
+            mask |= 1 << i;
+    writevarint(m_Raw, mask);
+    for(int i = 0; i < TRACE_REGISTER_COUNT; i++)
+        if(mask & (1 << i))
+            writedelta(m_Raw, Event.Registers[i], m_Previous.Registers[i]);
+
+    for(unsigned char i = 0; i < memoryCount; i++)
+    {
+        const TRACEMEMORY & memory = Event.Memory[i];
+        m_Raw.push_back((memory.Size & 0xF) | (memory.Written ? 0x10 : 0));
+        writedelta(m_Raw, memory.Address, m_PreviousMemory);
+        writevarint(m_Raw, memory.OldValue);
+        if(memory.Written)
+            writevarint(m_Raw, memory.NewValue);
+        m_PreviousMemory = memory.Address;
+    }
+
+    m_Previous = Event;
+    m_RawCount++;
+    m_NextEvent++;
+}
+
+void TraceRecorder::Flush()
+{
+    if(!m_RawCount)
+        return;
+    TraceBlock block;
+    block.FirstEvent = m_NextEvent - m_RawCount;
+    block.EventCount = m_RawCount;
+    block.RawSize = DWORD(m_Raw.size());
+    block.Data.resize(LZ4_compressBound(int(m_Raw.size())));
+    int compressedSize = LZ4_compress((const char*)m_Raw.data(), block.Data.data(), int(m_Raw.size()));
+    if(compressedSize > 0 && compressedSize < int(m_Raw.size()))
+        block.Data.resize(compressedSize);
+    else //store blocks that do not compress as they are
+        block.Data.assign(m_Raw.begin(), m_Raw.end());
+    block.Data.shrink_to_fit();
+    m_CompressedSize += block.Data.size();
+    m_Blocks.push_back(std::move(block));
+    m_Raw.clear();
+    m_RawCount = 0;
+
+    //drop the oldest blocks, but always keep the most recent one
+    while(m_CompressedSize > m_MaxSize && m_Blocks.size() > 1)
+    {
+        m_CompressedSize -= m_Blocks.front().Data.size();
+        m_Blocks.pop_front();
+    }
+}
+
+void TraceRecorder::Clear()
+{
+    m_Blocks.clear();
+    m_CompressedSize = 0;
+    m_NextEvent = 0;
+    m_Raw.clear();
+    m_RawCount = 0;
+    ResetEncoder();
+}
+
+bool TraceRecorder::Save(const char* FileName)
+{
+    Flush();
+    HANDLE hFile = CreateFileW(StringUtils::Utf8ToUtf16(FileName).c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    //header, compressed blocks and the block index at the end
+    TRACEFILEHEADER header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.Magic, TRACE_FILE_MAGIC, sizeof(header.Magic));
+    header.Version = TRACE_FILE_VERSION;
+    header.PointerSize = sizeof(duint);
+    header.FirstEvent = FirstEvent();
+    header.EventCount = EventCount();
+    header.BlockCount = DWORD(m_Blocks.size());
+    header.IndexOffset = sizeof(header) + m_CompressedSize;
+
+    std::vector<TRACEFILEINDEX> index;
+    index.reserve(m_Blocks.size());
+    ULONGLONG offset = sizeof(header);
+    for(const auto & block : m_Blocks)
+    {
+        TRACEFILEINDEX entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.FirstEvent = block.FirstEvent;
+        entry.Offset = offset;
+        entry.EventCount = block.EventCount;
+        entry.RawSize = block.RawSize;
+        entry.CompressedSize = DWORD(block.Data.size());
+        index.push_back(entry);
+        offset += block.Data.size();
+    }
+
+    bool result = writeall(hFile, &header, sizeof(header));
+    for(const auto & block : m_Blocks)
+        result = result && writeall(hFile, block.Data.data(), block.Data.size());
+    if(index.size())
+        result = result && writeall(hFile, index.data(), index.size() * sizeof(TRACEFILEINDEX));
+    CloseHandle(hFile);
+    return result;
+}
+
+void TraceRecorder::SetMaxSize(size_t MaxSize)
+{
+    m_MaxSize = MaxSize;
+}
+
+ULONGLONG TraceRecorder::FirstEvent() const
+{
+    if(m_Blocks.empty())
+        return m_NextEvent - m_RawCount;
+    return m_Blocks.front().FirstEvent;
+}
+
+ULONGLONG TraceRecorder::EventCount() const
+{
+    return m_NextEvent - FirstEvent();
+}
+
+size_t TraceRecorder::MemoryUsage() const
+{
+    return m_CompressedSize + m_Raw.capacity();
+}
+
+TraceReader::TraceReader()
+    : m_File(INVALID_HANDLE_VALUE)
+{
+    memset(&m_Header, 0, sizeof(m_Header));
+    m_CachedBlock = -1;
+}
+
+TraceReader::~TraceReader()
+{
+    Close();
+}
+
+/**
+\brief Opens a trace file. The header and the block index are checked against the file size, so a damaged file is rejected here instead of when its events are read.
+\param FileName UTF-8 path of the file.
+\return true if the file is a valid trace file.
+*/
+bool TraceReader::Open(const char* FileName)
+{
+    Close();
+    m_File = CreateFileW(StringUtils::Utf8ToUtf16(FileName).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(m_File == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(m_File, &fileSize) || !readall(m_File, &m_Header, sizeof(m_Header)))
+    {
+        Close();
+        return false;
+    }
+    //the index is the last part of the file, behind the blocks
+    ULONGLONG size = ULONGLONG(fileSize.QuadPart);
+    if(memcmp(m_Header.Magic, TRACE_FILE_MAGIC, sizeof(m_Header.Magic)) ||
+            m_Header.Version != TRACE_FILE_VERSION ||
+            m_Header.PointerSize != sizeof(duint) ||
+            m_Header.IndexOffset < sizeof(m_Header) ||
+            m_Header.IndexOffset > size ||
+            m_Header.BlockCount != (size - m_Header.IndexOffset) / sizeof(TRACEFILEINDEX))
+    {
+        Close();
+        return false;
+    }
+    LARGE_INTEGER offset;
+    offset.QuadPart = m_Header.IndexOffset;
+    m_Index.resize(m_Header.BlockCount);
+    if(!SetFilePointerEx(m_File, offset, nullptr, FILE_BEGIN) || !readall(m_File, m_Index.data(), m_Index.size() * sizeof(TRACEFILEINDEX)))
+    {
+        Close();
+        return false;
+    }
+    //the blocks follow each other without gaps and hold consecutive events
+    ULONGLONG nextOffset = sizeof(m_Header);
+    ULONGLONG nextEvent = m_Header.FirstEvent;
+    for(const auto & entry : m_Index)
+    {
+        if(entry.Offset != nextOffset ||
+                entry.FirstEvent != nextEvent ||
+                !entry.EventCount ||
+                entry.RawSize > TRACE_BLOCK_SIZE ||
+                entry.EventCount > entry.RawSize ||
+                !entry.CompressedSize ||
+                entry.CompressedSize > entry.RawSize ||
+                entry.CompressedSize > m_Header.IndexOffset - entry.Offset)
+        {
+            Close();
+            return false;
+        }
+        nextOffset += entry.CompressedSize;
+        nextEvent += entry.EventCount;
+    }
+    if(nextOffset != m_Header.IndexOffset || nextEvent - m_Header.FirstEvent != m_Header.EventCount)
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void TraceReader::Close()
+{
+    if(m_File != INVALID_HANDLE_VALUE)
+        CloseHandle(m_File);
+    m_File = INVALID_HANDLE_VALUE;
+    memset(&m_Header, 0, sizeof(m_Header));
+    m_Index.clear();
+    m_Events.clear();
+    m_CachedBlock = -1;
+}
+
+bool TraceReader::Read(ULONGLONG Index, TRACEEVENT & Event)
+{
+    //find the last block that starts at or before the event
+    auto found = std::upper_bound(m_Index.begin(), m_Index.end(), Index, [](ULONGLONG index, const TRACEFILEINDEX & entry)
+    {
+        return index < entry.FirstEvent;
+    });
+    if(found == m_Index.begin())
+        return false;
+    --found;
+    if(Index >= found->FirstEvent + found->EventCount)
+        return false;
+    size_t block = found - m_Index.begin();
+    if(block != m_CachedBlock && !LoadBlock(block))
+        return false;
+    Event = m_Events[size_t(Index - found->FirstEvent)];
+    return true;
+}
+
+const TRACEFILEHEADER & TraceReader::Header() const
+{
+    return m_Header;
+}
+
+bool TraceReader::LoadBlock(size_t Block)
+{
+    m_CachedBlock = -1;
+    m_Events.clear();
+    const TRACEFILEINDEX & entry = m_Index[Block];
+    LARGE_INTEGER offset;
+    offset.QuadPart = entry.Offset;
+    if(!SetFilePointerEx(m_File, offset, nullptr, FILE_BEGIN))
+        return false;
+    std::vector<unsigned char> raw(entry.RawSize);
+    if(entry.CompressedSize == entry.RawSize)
+    {
+        if(!readall(m_File, raw.data(), raw.size()))
+            return false;
+    }
+    else
+    {
+        std::vector<char> compressed(entry.CompressedSize);
+        if(!readall(m_File, compressed.data(), compressed.size()))
+            return false;
+        if(LZ4_decompress_safe(compressed.data(), (char*)raw.data(), int(compressed.size()), int(raw.size())) != int(raw.size()))
+            return false;
+    }
+
+    //replay the delta encoding of TraceRecorder::Record
+    const unsigned char* data = raw.data();
+    const unsigned char* end = data + raw.size();
+    TRACEEVENT previous;
+    memset(&previous, 0, sizeof(previous));
+    duint previousMemory = 0;
+    m_Events.reserve(entry.EventCount);
+    for(DWORD i = 0; i < entry.EventCount; i++)
+    {
+        TRACEEVENT event = previous;
+        ULONGLONG header;
+        if(!readvarint(data, end, header))
+            return false;
+        event.MemoryCount = (unsigned char)(header >> 1);
+        if(event.MemoryCount > TRACE_MAX_MEMORY)
+            return false;
+        if(header & 1)
+        {
+            ULONGLONG threadId;
+            if(!readvarint(data, end, threadId))
+                return false;
+            event.ThreadId = DWORD(threadId);
+        }
+        if(!readdelta(data, end, previous.Address, event.Address))
+            return false;
+        ULONGLONG mask;
+        if(!readvarint(data, end, mask))
+            return false;
+        for(int j = 0; j < TRACE_REGISTER_COUNT; j++)
+            if(mask & (1ull << j) && !readdelta(data, end, previous.Registers[j], event.Registers[j]))
+                return false;
+        memset(event.Memory, 0, sizeof(event.Memory));
+        for(unsigned char j = 0; j < event.MemoryCount; j++)
+        {
+            TRACEMEMORY & memory = event.Memory[j];
+            if(data >= end)
+                return false;
+            unsigned char flags = *data++;
+            memory.Size = flags & 0xF;
+            if(memory.Size > sizeof(duint))
+                return false;
+            memory.Written = !!(flags & 0x10);
+            ULONGLONG value;
+            if(!readdelta(data, end, previousMemory, memory.Address) || !readvarint(data, end, value))
+                return false;
+            memory.OldValue = duint(value);
+            if(memory.Written)
+            {
+                if(!readvarint(data, end, value))
+                    return false;
+                memory.NewValue = duint(value);
+            }
+            previousMemory = memory.Address;
+        }
+        m_Events.push_back(event);
+        previous = event;
+    }
+    if(data != end)
+        return false;
+    m_CachedBlock = Block;
+    return true;
+}
@@ -0,0 +1,118 @@
+#ifndef _TRACESTREAM_H
+#define _TRACESTREAM_H
+
+#include "_global.h"
+#include <deque>
+
+#ifdef _WIN64
+#define TRACE_REGISTER_COUNT 17 // cax-cdi, r8-r15, eflags
+#else
+#define TRACE_REGISTER_COUNT 9 // cax-cdi, eflags
+#endif //_WIN64
+#define TRACE_MAX_MEMORY 4
+#define TRACE_BLOCK_SIZE (64 * 1024)
+#define TRACE_DEFAULT_BUFFER_SIZE (64 * 1024 * 1024)
+
+struct TRACEMEMORY
+{
+    duint Address;
+    duint OldValue; // value before the instruction executed
+    duint NewValue; // value after the instruction executed (only valid when Written is set)
+    unsigned char Size;
+    bool Written;
+};
+
+struct TRACEEVENT
+{
+    duint Address;
+    DWORD ThreadId;
+    duint Registers[TRACE_REGISTER_COUNT]; // state before the instruction executed, in TITAN_ENGINE_CONTEXT_t order
+    unsigned char MemoryCount;
+    TRACEMEMORY Memory[TRACE_MAX_MEMORY];
+};
+
+#pragma pack(push, 1)
+struct TRACEFILEHEADER
+{
+    char Magic[8];
+    DWORD Version;
+    DWORD PointerSize;
+    ULONGLONG FirstEvent;
+    ULONGLONG EventCount;
+    ULONGLONG IndexOffset;
+    DWORD BlockCount;
+    DWORD Reserved;
+};
+
+struct TRACEFILEINDEX
+{
+    ULONGLONG FirstEvent;
+    ULONGLONG Offset;
+    DWORD EventCount;
+    DWORD RawSize;
+    DWORD CompressedSize; // Equal to RawSize when the block is stored uncompressed
+    DWORD Reserved;
+};
+#pragma pack(pop)
+
+/**
+\brief Delta encodes trace events into blocks that are LZ4 compressed once they are full. The oldest blocks are dropped when the compressed size exceeds the buffer size, so the memory use is bounded.
+*/
+class TraceRecorder
+{
+public:
+    TraceRecorder();
+    void Record(const TRACEEVENT & Event);
+    void Flush();
+    void Clear();
+    bool Save(const char* FileName);
+    void SetMaxSize(size_t MaxSize);
+    ULONGLONG FirstEvent() const;
+    ULONGLONG EventCount() const;
+    size_t MemoryUsage() const;
+
+private:
+    struct TraceBlock
+    {
+        ULONGLONG FirstEvent;
+        DWORD EventCount;
+        DWORD RawSize;
+        std::vector<char> Data;
+    };
+
+    void ResetEncoder();
+
+    std::deque<TraceBlock> m_Blocks;
+    size_t m_CompressedSize;
+    size_t m_MaxSize;
+    ULONGLONG m_NextEvent;
+    std::vector<unsigned char> m_Raw;
+    DWORD m_RawCount;
+    TRACEEVENT m_Previous;
+    duint m_PreviousMemory;
+};
+
+/**
+\brief Random access to a trace file written by TraceRecorder::Save. Only the block containing the requested event is decompressed.
+*/
+class TraceReader
+{
+public:
+    TraceReader();
+    ~TraceReader();
+    bool Open(const char* FileName);
+    void Close();
+    bool Read(ULONGLONG Index, TRACEEVENT & Event);
+    const TRACEFILEHEADER & Header() const;
+
+private:
+    bool LoadBlock(size_t Block);
+
+    HANDLE m_File;
+    TRACEFILEHEADER m_Header;
+    std::vector<TRACEFILEINDEX> m_Index;
+    size_t m_CachedBlock;
+    std::vector<TRACEEVENT> m_Events;
+};
+
+#endif //_TRACESTREAM_H
@@ -0,0 +1,465 @@
+/**
+ @file unwindtable.cpp
+
+ @brief Implements the parser and the virtual unwinder for x64 unwind information.
+ */
+
+#include "unwindtable.h"
+#include <string.h>
+#include <algorithm>
+#include <unordered_map>
+
+enum
+{
+    UWOP_PUSH_NONVOL = 0,
+    UWOP_ALLOC_LARGE,
+    UWOP_ALLOC_SMALL,
+    UWOP_SET_FPREG,
+    UWOP_SAVE_NONVOL,
+    UWOP_SAVE_NONVOL_FAR,
+    UWOP_EPILOG,
+    UWOP_SPARE_CODE,
+    UWOP_SAVE_XMM128,
+    UWOP_SAVE_XMM128_FAR,
+    UWOP_PUSH_MACHFRAME
+};
+
+#define UNWIND_FLAG_CHAININFO 0x4
+#define UNWIND_MAX_CHAIN 32
+#define UNWIND_MAX_EPILOG 32
+#define UNWIND_REG_RSP 4
+
+// PE layout, see IMAGE_DOS_HEADER, IMAGE_NT_HEADERS64 and IMAGE_SECTION_HEADER
+#define PE_DOS_SIGNATURE 0x5A4D
+#define PE_DOS_LFANEW 0x3C
+#define PE_NT_SIGNATURE 0x00004550
+#define PE_FILE_SECTIONS 6
+#define PE_FILE_OPTIONAL_SIZE 20
+#define PE_OPTIONAL 24
+#define PE_OPTIONAL_MAGIC64 0x20B
+#define PE_OPTIONAL_DIRECTORY_COUNT 108
+#define PE_OPTIONAL_DIRECTORIES 112
+#define PE_DIRECTORY_EXCEPTION 3
+#define PE_SECTION_SIZE 40
+#define PE_SECTION_VIRTUAL_SIZE 8
+#define PE_SECTION_VIRTUAL_ADDRESS 12
+#define PE_SECTION_RAW_SIZE 16
+#define PE_SECTION_RAW_POINTER 20
+
+static uint16_t read16(const unsigned char* Data)
+{
+    uint16_t value;
+    memcpy(&value, Data, sizeof(value));
+    return value;
+}
+
+static uint32_t read32(const unsigned char* Data)
+{
+    uint32_t value;
+    memcpy(&value, Data, sizeof(value));
+    return value;
+}
+
+static bool rvatooffset(const unsigned char* FileData, size_t FileSize, size_t NtHeaders, uint32_t Rva, size_t* Offset)
+{
+    uint16_t sectionCount = read16(FileData + NtHeaders + PE_FILE_SECTIONS);
+    size_t section = NtHeaders + PE_OPTIONAL + read16(FileData + NtHeaders + PE_FILE_OPTIONAL_SIZE);
+    for(uint16_t i = 0; i < sectionCount; i++, section += PE_SECTION_SIZE)
+    {
+        if(section + PE_SECTION_SIZE > FileSize)
+            return false;
+        uint32_t virtualAddress = read32(FileData + section + PE_SECTION_VIRTUAL_ADDRESS);
+        uint32_t rawSize = read32(FileData + section + PE_SECTION_RAW_SIZE);
+        uint32_t size = std::max(read32(FileData + section + PE_SECTION_VIRTUAL_SIZE), rawSize);
+        if(Rva >= virtualAddress && Rva - virtualAddress < size)
+        {
+            uint32_t delta = Rva - virtualAddress;
+            if(delta >= rawSize) //not backed by the file
+                return false;
+            *Offset = size_t(read32(FileData + section + PE_SECTION_RAW_POINTER)) + delta;
+            return *Offset < FileSize;
+        }
+    }
+    return false;
+}
+
+static int unwindopslots(unsigned char UnwindOp, unsigned char OpInfo)
+{
+    switch(UnwindOp)
+    {
+    case UWOP_ALLOC_LARGE:
+        return OpInfo ? 3 : 2;
+    case UWOP_SAVE_NONVOL:
+    case UWOP_EPILOG:
+    case UWOP_SAVE_XMM128:
+        return 2;
+    case UWOP_SAVE_NONVOL_FAR:
+    case UWOP_SPARE_CODE:
+    case UWOP_SAVE_XMM128_FAR:
+        return 3;
+    default:
+        return 1;
+    }
+}
+
+/**
+\brief Checks whether the code at Rip is a standard epilog: an optional add rsp or lea rsp, pops and a ret or a jmp out of the function.
+\return true if the code is an epilog.
+*/
+static bool unwindinepilog(const unsigned char* Code, size_t Size, uint64_t Rip, uint64_t ImageBase, const UNWIND_FUNCTION & Function)
+{
+    size_t pc = 0;
+    if(Size >= 4 && (Code[0] & 0xF8) == 0x48)
+    {
+        switch(Code[1])
+        {
+        case 0x81: //add rsp, imm32
+            if(Code[0] != 0x48 || Code[2] != 0xC4)
+                return false;
+            pc = 7;
+            break;
+        case 0x83: //add rsp, imm8
+            if(Code[0] != 0x48 || Code[2] != 0xC4)
+                return false;
+            pc = 4;
+            break;
+        case 0x8D: //lea rsp, [reg + disp]
+            if((Code[0] & 0x06) || ((Code[2] >> 3) & 7) != UNWIND_REG_RSP || (Code[2] & 7) == 4) //no REX.R/X and no SIB
+                return false;
+            if((Code[2] >> 6) == 1)
+                pc = 4;
+            else if((Code[2] >> 6) == 2)
+                pc = 7;
+            else
+                return false;
+            break;
+        }
+    }
+    while(pc < Size)
+    {
+        bool rex = (Code[pc] & 0xF0) == 0x40;
+        if(rex && ++pc >= Size)
+            return false;
+        unsigned char op = Code[pc];
+        if(op >= 0x58 && op <= 0x5F) //pop reg, the prolog never pushes rsp
+        {
+            if(op == 0x58 + UNWIND_REG_RSP && !(rex && (Code[pc - 1] & 1)))
+                return false;
+            pc++;
+            continue;
+        }
+        uint64_t target;
+        switch(op)
+        {
+        case 0xC2: //ret imm16
+            return pc + 3 <= Size;
+        case 0xC3: //ret
+            return true;
+        case 0xF3: //rep ret
+            return pc + 1 < Size && Code[pc + 1] == 0xC3;
+        case 0xE9: //jmp rel32, a tail call if it leaves the function
+            if(pc + 5 > Size)
+                return false;
+            target = Rip + pc + 5 + int32_t(read32(Code + pc + 1));
+            break;
+        case 0xEB: //jmp rel8
+            if(pc + 2 > Size)
+                return false;
+            target = Rip + pc + 2 + int8_t(Code[pc + 1]);
+            break;
+        case 0xFF: //jmp qword ptr [rip + disp32], a tail call through the import table
+            return pc + 1 < Size && Code[pc + 1] == 0x25;
+        default:
+            return false;
+        }
+        return target < ImageBase + Function.BeginAddress || target >= ImageBase + Function.EndAddress;
+    }
+    return false;
+}
+
+/**
+\brief Unwinds by emulating the rest of an epilog that was recognized by unwindinepilog. The unwind codes cannot be used there, part of the prolog has been undone already.
+*/
+static bool unwindepilog(const unsigned char* Code, UNWIND_CONTEXT & Context, const UNWINDREADPROC & Read)
+{
+    uint64_t & rsp = Context.Regs[UNWIND_REG_RSP];
+    size_t pc = 0;
+    if((Code[0] & 0xF8) == 0x48)
+    {
+        switch(Code[1])
+        {
+        case 0x81:
+            rsp += int32_t(read32(Code + 3));
+            pc = 7;
+            break;
+        case 0x83:
+            rsp += int8_t(Code[3]);
+            pc = 4;
+            break;
+        case 0x8D:
+        {
+            uint64_t base = Context.Regs[(Code[2] & 7) | ((Code[0] & 1) << 3)];
+            if((Code[2] >> 6) == 1)
+            {
+                rsp = base + int8_t(Code[3]);
+                pc = 4;
+            }
+            else
+            {
+                rsp = base + int32_t(read32(Code + 3));
+                pc = 7;
+            }
+        }
+        break;
+        }
+    }
+    while(true)
+    {
+        unsigned char rex = 0;
+        if((Code[pc] & 0xF0) == 0x40)
+            rex = Code[pc++];
+        if(Code[pc] < 0x58 || Code[pc] > 0x5F)
+            break;
+        if(!Read(rsp, &Context.Regs[(Code[pc] - 0x58) | ((rex & 1) << 3)]))
+            return false;
+        rsp += sizeof(uint64_t);
+        pc++;
+    }
+    //ret or tail call: the return address is on top of the stack
+    if(!Read(rsp, &Context.Rip))
+        return false;
+    rsp += sizeof(uint64_t);
+    if(Code[pc] == 0xC2) //ret imm16 also releases the arguments
+        rsp += read16(Code + pc + 1);
+    return true;
+}
+
+bool UnwindTable::Load(const unsigned char* FileData, size_t FileSize)
+{
+    m_Functions.clear();
+    m_UnwindData.clear();
+
+    // Locate the exception directory
+    if(FileSize < PE_DOS_LFANEW + sizeof(uint32_t) || read16(FileData) != PE_DOS_SIGNATURE)
+        return false;
+    size_t ntHeaders = read32(FileData + PE_DOS_LFANEW);
+    if(ntHeaders > FileSize || FileSize - ntHeaders < PE_OPTIONAL + PE_OPTIONAL_DIRECTORIES)
+        return false;
+    if(read32(FileData + ntHeaders) != PE_NT_SIGNATURE || read16(FileData + ntHeaders + PE_OPTIONAL) != PE_OPTIONAL_MAGIC64)
+        return false;
+    if(read32(FileData + ntHeaders + PE_OPTIONAL + PE_OPTIONAL_DIRECTORY_COUNT) <= PE_DIRECTORY_EXCEPTION)
+        return false;
+    size_t directory = ntHeaders + PE_OPTIONAL + PE_OPTIONAL_DIRECTORIES + PE_DIRECTORY_EXCEPTION * 2 * sizeof(uint32_t);
+    if(directory + 2 * sizeof(uint32_t) > FileSize)
+        return false;
+    uint32_t directoryRva = read32(FileData + directory);
+    uint32_t directorySize = read32(FileData + directory + sizeof(uint32_t));
+    size_t tableOffset;
+    if(!directoryRva || !rvatooffset(FileData, FileSize, ntHeaders, directoryRva, &tableOffset))
+        return false;
+    size_t count = std::min(size_t(directorySize), FileSize - tableOffset) / sizeof(UNWIND_FUNCTION);
+    const unsigned char* table = FileData + tableOffset;
+
+    // Copy every (chained) UNWIND_INFO into one blob, sharing identical entries
+    std::unordered_map<uint32_t, uint32_t> copied;
+    std::function<bool(uint32_t, uint32_t*, int)> copyUnwindInfo = [&](uint32_t Rva, uint32_t* Result, int Depth)
+    {
+        if(Depth > UNWIND_MAX_CHAIN)
+            return false;
+        auto found = copied.find(Rva);
+        if(found != copied.end())
+        {
+            *Result = found->second;
+            return true;
+        }
+        size_t offset;
+        if(Rva & 1) //indirect entry: points to another RUNTIME_FUNCTION
+        {
+            if(!rvatooffset(FileData, FileSize, ntHeaders, Rva & ~1, &offset) || offset + sizeof(UNWIND_FUNCTION) > FileSize)
+                return false;
+            return copyUnwindInfo(read32(FileData + offset + offsetof(UNWIND_FUNCTION, UnwindData)), Result, Depth + 1);
+        }
+        if(!rvatooffset(FileData, FileSize, ntHeaders, Rva, &offset) || offset + 4 > FileSize)
+            return false;
+        const unsigned char* info = FileData + offset;
+        size_t size = 4 + ((info[2] + 1) & ~1) * sizeof(uint16_t);
+        bool chained = ((info[0] >> 3) & UNWIND_FLAG_CHAININFO) != 0;
+        if(chained)
+            size += sizeof(UNWIND_FUNCTION);
+        if(offset + size > FileSize)
+            return false;
+        uint32_t blobOffset = uint32_t(m_UnwindData.size());
+        m_UnwindData.insert(m_UnwindData.end(), info, info + size);
+        copied[Rva] = blobOffset;
+        if(chained)
+        {
+            // Rewrite the chained entry to point into the blob as well
+            uint32_t chainOffset;
+            if(!copyUnwindInfo(read32(info + size - sizeof(uint32_t)), &chainOffset, Depth + 1))
+                return false;
+            memcpy(m_UnwindData.data() + blobOffset + size - sizeof(uint32_t), &chainOffset, sizeof(uint32_t));
+        }
+        *Result = blobOffset;
+        return true;
+    };
+
+    m_Functions.reserve(count);
+    for(size_t i = 0; i < count; i++)
+    {
+        UNWIND_FUNCTION function;
+        memcpy(&function, table + i * sizeof(UNWIND_FUNCTION), sizeof(function));
+        if(!function.BeginAddress || function.EndAddress <= function.BeginAddress)
+            continue;
+        if(!copyUnwindInfo(function.UnwindData, &function.UnwindData, 0))
+            continue;
+        m_Functions.push_back(function);
+    }
+
+    // The table should already be sorted, but do not rely on the linker
+    std::sort(m_Functions.begin(), m_Functions.end(), [](const UNWIND_FUNCTION & a, const UNWIND_FUNCTION & b)
+    {
+        return a.BeginAddress < b.BeginAddress;
+    });
+    return !m_Functions.empty();
+}
+
+const UNWIND_FUNCTION* UnwindTable::Find(uint32_t Rva) const
+{
+    auto found = std::upper_bound(m_Functions.begin(), m_Functions.end(), Rva, [](uint32_t rva, const UNWIND_FUNCTION & function)
+    {
+        return rva < function.BeginAddress;
+    });
+    if(found == m_Functions.begin())
+        return nullptr;
+    --found;
+    if(Rva >= found->EndAddress)
+        return nullptr;
+    return &*found;
+}
+
+/**
+\brief Unwinds one frame, like RtlVirtualUnwind.
+\param ImageBase Base of the module the table was loaded from.
+\param [in,out] Context The registers of the frame, they are replaced by the registers of the caller.
+\param Read Reads a stack value.
+\param ReadCode Reads the code at Rip, to tell whether it is in an epilog.
+\return true if the frame was unwound.
+*/
+bool UnwindTable::VirtualUnwind(uint64_t ImageBase, UNWIND_CONTEXT & Context, const UNWINDREADPROC & Read, const UNWINDCODEPROC & ReadCode) const
+{
+    uint64_t & rsp = Context.Regs[UNWIND_REG_RSP];
+    const UNWIND_FUNCTION* function = Context.Rip >= ImageBase ? Find(uint32_t(Context.Rip - ImageBase)) : nullptr;
+    if(!function) //leaf function: the return address is on top of the stack
+    {
+        if(!Read(rsp, &Context.Rip))
+            return false;
+        rsp += sizeof(uint64_t);
+        return true;
+    }
+
+    uint32_t prologOffset = uint32_t(Context.Rip - ImageBase) - function->BeginAddress;
+    uint32_t unwindOffset = function->UnwindData;
+    if(size_t(unwindOffset) + 4 > m_UnwindData.size())
+        return false;
+
+    // Past the prolog the code can be in an epilog, which has undone part of the prolog already
+    if(prologOffset >= m_UnwindData[unwindOffset + 1])
+    {
+        unsigned char code[UNWIND_MAX_EPILOG];
+        size_t codeSize = ReadCode(Context.Rip, code, sizeof(code));
+        if(unwindinepilog(code, std::min(codeSize, sizeof(code)), Context.Rip, ImageBase, *function))
+            return unwindepilog(code, Context, Read);
+    }
+
+    for(int depth = 0; depth < UNWIND_MAX_CHAIN; depth++)
+    {
+        if(size_t(unwindOffset) + 4 > m_UnwindData.size())
+            return false;
+        const unsigned char* info = m_UnwindData.data() + unwindOffset;
+        unsigned char flags = info[0] >> 3;
+        unsigned char codeCount = info[2];
+        unsigned char frameRegister = info[3] & 0xF;
+        unsigned char frameOffset = info[3] >> 4;
+        const unsigned char* codes = info + 4;
+
+        for(int i = 0; i < codeCount;)
+        {
+            unsigned char codeOffset = codes[i * 2];
+            unsigned char unwindOp = codes[i * 2 + 1] & 0xF;
+            unsigned char opInfo = codes[i * 2 + 1] >> 4;
+            int slots = unwindopslots(unwindOp, opInfo);
+            if(i + slots > codeCount)
+                return false;
+
+            // Chained entries describe code that always executed
+            if(depth == 0 && codeOffset > prologOffset)
+            {
+                i += slots;
+                continue;
+            }
+
+            const unsigned char* slot = codes + i * 2;
+            switch(unwindOp)
+            {
+            case UWOP_PUSH_NONVOL:
+                if(!Read(rsp, &Context.Regs[opInfo]))
+                    return false;
+                rsp += sizeof(uint64_t);
+                break;
+
+            case UWOP_ALLOC_LARGE:
+                if(opInfo)
+                    rsp += read32(slot + 2);
+                else
+                    rsp += read16(slot + 2) * 8;
+                break;
+
+            case UWOP_ALLOC_SMALL:
+                rsp += opInfo * 8 + 8;
+                break;
+
+            case UWOP_SET_FPREG:
+                rsp = Context.Regs[frameRegister] - frameOffset * 16;
+                break;
+
+            case UWOP_SAVE_NONVOL:
+                if(!Read(rsp + read16(slot + 2) * 8, &Context.Regs[opInfo]))
+                    return false;
+                break;
+
+            case UWOP_SAVE_NONVOL_FAR:
+                if(!Read(rsp + read32(slot + 2), &Context.Regs[opInfo]))
+                    return false;
+                break;
+
+            case UWOP_PUSH_MACHFRAME:
+            {
+                // The processor pushed a trap frame: [error code], RIP, CS, EFLAGS, old RSP
+                uint64_t frame = rsp + (opInfo ? sizeof(uint64_t) : 0);
+                if(!Read(frame, &Context.Rip) || !Read(frame + 3 * sizeof(uint64_t), &rsp))
+                    return false;
+                return true;
+            }
+
+            default: //XMM saves do not affect the integer context
+                break;
+            }
+            i += slots;
+        }
+
+        if(!(flags & UNWIND_FLAG_CHAININFO))
+            break;
+        unwindOffset = read32(codes + ((codeCount + 1) & ~1) * sizeof(uint16_t) + 2 * sizeof(uint32_t));
+    }
+
+    // Pop the return address
+    if(!Read(rsp, &Context.Rip))
+        return false;
+    rsp += sizeof(uint64_t);
+    return true;
+}
+
+size_t UnwindTable::Size() const
+{
+    return m_Functions.size();
+}
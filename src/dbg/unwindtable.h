@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <functional>
+
+struct UNWIND_FUNCTION
+{
+    uint32_t BeginAddress;
+    uint32_t EndAddress;
+    uint32_t UnwindData; // Offset in UnwindTable::m_UnwindData
+};
+
+struct UNWIND_CONTEXT
+{
+    uint64_t Rip;
+    uint64_t Regs[16]; // Indexed by the x64 unwind register numbers (RAX=0, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8-R15)
+};
+
+typedef std::function<bool(uint64_t Address, uint64_t* Value)> UNWINDREADPROC;
+typedef std::function<size_t(uint64_t Address, unsigned char* Buffer, size_t Size)> UNWINDCODEPROC; // Returns the number of bytes read
+
+/**
+\brief Sorted lookup table built from the .pdata/.xdata unwind information of an x64 PE file.
+The parser only touches the raw file bytes and does not use the Windows headers, so it does not depend on a running debuggee.
+*/
+class UnwindTable
+{
+public:
+    bool Load(const unsigned char* FileData, size_t FileSize);
+    const UNWIND_FUNCTION* Find(uint32_t Rva) const;
+    bool VirtualUnwind(uint64_t ImageBase, UNWIND_CONTEXT & Context, const UNWINDREADPROC & Read, const UNWINDCODEPROC & ReadCode) const;
+    size_t Size() const;
+
+private:
+    std::vector<UNWIND_FUNCTION> m_Functions;
+    std::vector<unsigned char> m_UnwindData;
+};
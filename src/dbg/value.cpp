@@ -14,9 +14,15 @@
 #include "label.h"
 #include "expressionparser.h"
 #include "function.h"
+#include "threading.h"
+#include <memory>
 
 static bool dosignedcalc = false;
 
+#define MAX_EXPRESSION_CACHE 4096
+
+static std::unordered_map<String, std::shared_ptr<ExpressionParser>> expressionCache;
+
 /**
 \brief Returns whether we do signed or unsigned calculations.
 \return true if we do signed calculations, false for unsigned calculationss.
@@ -75,6 +81,133 @@ static bool isflag(const char* string)
     return false;
 }
 
+/**
+\brief A register name with the TitanEngine register it is read from and the bits it covers.
+*/
+struct REGISTERENTRY
+{
+    const char* name;
+    DWORD titan;
+    unsigned char shift;
+    duint mask;
+    int size;
+};
+
+static const REGISTERENTRY registerTable[] =
+{
+    { "eax", UE_EAX, 0, ~duint(0), 4 },
+    { "ebx", UE_EBX, 0, ~duint(0), 4 },
+    { "ecx", UE_ECX, 0, ~duint(0), 4 },
+    { "edx", UE_EDX, 0, ~duint(0), 4 },
+    { "edi", UE_EDI, 0, ~duint(0), 4 },
+    { "esi", UE_ESI, 0, ~duint(0), 4 },
+    { "ebp", UE_EBP, 0, ~duint(0), 4 },
+    { "esp", UE_ESP, 0, ~duint(0), 4 },
+    { "eip", UE_EIP, 0, ~duint(0), 4 },
+    { "eflags", UE_EFLAGS, 0, ~duint(0), 4 },
+    { "gs", UE_SEG_GS, 0, ~duint(0), 4 },
+    { "fs", UE_SEG_FS, 0, ~duint(0), 4 },
+    { "es", UE_SEG_ES, 0, ~duint(0), 4 },
+    { "ds", UE_SEG_DS, 0, ~duint(0), 4 },
+    { "cs", UE_SEG_CS, 0, ~duint(0), 4 },
+    { "ss", UE_SEG_SS, 0, ~duint(0), 4 },
+    { "ax", UE_EAX, 0, 0xFFFF, 2 },
+    { "bx", UE_EBX, 0, 0xFFFF, 2 },
+    { "cx", UE_ECX, 0, 0xFFFF, 2 },
+    { "dx", UE_EDX, 0, 0xFFFF, 2 },
+    { "si", UE_ESI, 0, 0xFFFF, 2 },
+    { "di", UE_EDI, 0, 0xFFFF, 2 },
+    { "bp", UE_EBP, 0, 0xFFFF, 2 },
+    { "sp", UE_ESP, 0, 0xFFFF, 2 },
+    { "ip", UE_EIP, 0, 0xFFFF, 2 },
+    { "ah", UE_EAX, 8, 0xFF, 1 },
+    { "al", UE_EAX, 0, 0xFF, 1 },
+    { "bh", UE_EBX, 8, 0xFF, 1 },
+    { "bl", UE_EBX, 0, 0xFF, 1 },
+    { "ch", UE_ECX, 8, 0xFF, 1 },
+    { "cl", UE_ECX, 0, 0xFF, 1 },
+    { "dh", UE_EDX, 8, 0xFF, 1 },
+    { "dl", UE_EDX, 0, 0xFF, 1 },
+    { "sih", UE_ESI, 8, 0xFF, 1 },
+    { "sil", UE_ESI, 0, 0xFF, 1 },
+    { "dih", UE_EDI, 8, 0xFF, 1 },
+    { "dil", UE_EDI, 0, 0xFF, 1 },
+    { "bph", UE_EBP, 8, 0xFF, 1 },
+    { "bpl", UE_EBP, 0, 0xFF, 1 },
+    { "sph", UE_ESP, 8, 0xFF, 1 },
+    { "spl", UE_ESP, 0, 0xFF, 1 },
+    { "iph", UE_EIP, 8, 0xFF, 1 },
+    { "ipl", UE_EIP, 0, 0xFF, 1 },
+    { "dr0", UE_DR0, 0, ~duint(0), sizeof(duint) },
+    { "dr1", UE_DR1, 0, ~duint(0), sizeof(duint) },
+    { "dr2", UE_DR2, 0, ~duint(0), sizeof(duint) },
+    { "dr3", UE_DR3, 0, ~duint(0), sizeof(duint) },
+    { "dr6", UE_DR6, 0, ~duint(0), sizeof(duint) },
+    { "dr4", UE_DR6, 0, ~duint(0), sizeof(duint) },
+    { "dr7", UE_DR7, 0, ~duint(0), sizeof(duint) },
+    { "dr5", UE_DR7, 0, ~duint(0), sizeof(duint) },
+    { "cip", UE_CIP, 0, ~duint(0), sizeof(duint) },
+    { "csp", UE_CSP, 0, ~duint(0), sizeof(duint) },
+    { "cflags", UE_CFLAGS, 0, ~duint(0), sizeof(duint) },
+#ifdef _WIN64
+    { "rax", UE_RAX, 0, ~duint(0), 8 },
+    { "rbx", UE_RBX, 0, ~duint(0), 8 },
+    { "rcx", UE_RCX, 0, ~duint(0), 8 },
+    { "rdx", UE_RDX, 0, ~duint(0), 8 },
+    { "rdi", UE_RDI, 0, ~duint(0), 8 },
+    { "rsi", UE_RSI, 0, ~duint(0), 8 },
+    { "rbp", UE_RBP, 0, ~duint(0), 8 },
+    { "rsp", UE_RSP, 0, ~duint(0), 8 },
+    { "rip", UE_RIP, 0, ~duint(0), 8 },
+    { "rflags", UE_RFLAGS, 0, ~duint(0), 8 },
+    { "r8", UE_R8, 0, ~duint(0), 8 },
+    { "r9", UE_R9, 0, ~duint(0), 8 },
+    { "r10", UE_R10, 0, ~duint(0), 8 },
+    { "r11", UE_R11, 0, ~duint(0), 8 },
+    { "r12", UE_R12, 0, ~duint(0), 8 },
+    { "r13", UE_R13, 0, ~duint(0), 8 },
+    { "r14", UE_R14, 0, ~duint(0), 8 },
+    { "r15", UE_R15, 0, ~duint(0), 8 },
+    { "r8d", UE_R8, 0, 0xFFFFFFFF, 4 },
+    { "r9d", UE_R9, 0, 0xFFFFFFFF, 4 },
+    { "r10d", UE_R10, 0, 0xFFFFFFFF, 4 },
+    { "r11d", UE_R11, 0, 0xFFFFFFFF, 4 },
+    { "r12d", UE_R12, 0, 0xFFFFFFFF, 4 },
+    { "r13d", UE_R13, 0, 0xFFFFFFFF, 4 },
+    { "r14d", UE_R14, 0, 0xFFFFFFFF, 4 },
+    { "r15d", UE_R15, 0, 0xFFFFFFFF, 4 },
+    { "r8w", UE_R8, 0, 0xFFFF, 2 },
+    { "r9w", UE_R9, 0, 0xFFFF, 2 },
+    { "r10w", UE_R10, 0, 0xFFFF, 2 },
+    { "r11w", UE_R11, 0, 0xFFFF, 2 },
+    { "r12w", UE_R12, 0, 0xFFFF, 2 },
+    { "r13w", UE_R13, 0, 0xFFFF, 2 },
+    { "r14w", UE_R14, 0, 0xFFFF, 2 },
+    { "r15w", UE_R15, 0, 0xFFFF, 2 },
+    { "r8b", UE_R8, 0, 0xFF, 1 },
+    { "r9b", UE_R9, 0, 0xFF, 1 },
+    { "r10b", UE_R10, 0, 0xFF, 1 },
+    { "r11b", UE_R11, 0, 0xFF, 1 },
+    { "r12b", UE_R12, 0, 0xFF, 1 },
+    { "r13b", UE_R13, 0, 0xFF, 1 },
+    { "r14b", UE_R14, 0, 0xFF, 1 },
+    { "r15b", UE_R15, 0, 0xFF, 1 },
+#endif //_WIN64
+};
+
+/**
+\brief Gets the index of a register in registerTable.
+\param string The register name.
+\return The index, -1 if the string is not a register.
+*/
+static int registerindex(const char* string)
+{
+    for(int i = 0; i < int(_countof(registerTable)); i++)
+        if(scmp(string, registerTable[i].name))
+            return i;
+    return -1;
+}
+
 /**
 \brief Check if a string is a register.
 \param string The string to check.
@@ -82,204 +215,7 @@ static bool isflag(const char* string)
 */
 static bool isregister(const char* string)
 {
-    if(scmp(string, "eax"))
-        return true;
-    if(scmp(string, "ebx"))
-        return true;
-    if(scmp(string, "ecx"))
-        return true;
-    if(scmp(string, "edx"))
-        return true;
-    if(scmp(string, "edi"))
-        return true;
-    if(scmp(string, "esi"))
-        return true;
-    if(scmp(string, "ebp"))
-        return true;
-    if(scmp(string, "esp"))
-        return true;
-    if(scmp(string, "eip"))
-        return true;
-    if(scmp(string, "eflags"))
-        return true;
-
-    if(scmp(string, "ax"))
-        return true;
-    if(scmp(string, "bx"))
-        return true;
-    if(scmp(string, "cx"))
-        return true;
-    if(scmp(string, "dx"))
-        return true;
-    if(scmp(string, "si"))
-        return true;
-    if(scmp(string, "di"))
-        return true;
-    if(scmp(string, "bp"))
-        return true;
-    if(scmp(string, "sp"))
-        return true;
-    if(scmp(string, "ip"))
-        return true;
-
-    if(scmp(string, "ah"))
-        return true;
-    if(scmp(string, "al"))
-        return true;
-    if(scmp(string, "bh"))
-        return true;
-    if(scmp(string, "bl"))
-        return true;
-    if(scmp(string, "ch"))
-        return true;
-    if(scmp(string, "cl"))
-        return true;
-    if(scmp(string, "dh"))
-        return true;
-    if(scmp(string, "dl"))
-        return true;
-    if(scmp(string, "sih"))
-        return true;
-    if(scmp(string, "sil"))
-        return true;
-    if(scmp(string, "dih"))
-        return true;
-    if(scmp(string, "dil"))
-        return true;
-    if(scmp(string, "bph"))
-        return true;
-    if(scmp(string, "bpl"))
-        return true;
-    if(scmp(string, "sph"))
-        return true;
-    if(scmp(string, "spl"))
-        return true;
-    if(scmp(string, "iph"))
-        return true;
-    if(scmp(string, "ipl"))
-        return true;
-
-    if(scmp(string, "dr0"))
-        return true;
-    if(scmp(string, "dr1"))
-        return true;
-    if(scmp(string, "dr2"))
-        return true;
-    if(scmp(string, "dr3"))
-        return true;
-    if(scmp(string, "dr6") || scmp(string, "dr4"))
-        return true;
-    if(scmp(string, "dr7") || scmp(string, "dr5"))
-        return true;
-
-    if(scmp(string, "cip"))
-        return true;
-    if(scmp(string, "csp"))
-        return true;
-    if(scmp(string, "cflags"))
-        return true;
-
-    if(scmp(string, "gs"))
-        return true;
-    if(scmp(string, "fs"))
-        return true;
-    if(scmp(string, "es"))
-        return true;
-    if(scmp(string, "ds"))
-        return true;
-    if(scmp(string, "cs"))
-        return true;
-    if(scmp(string, "ss"))
-        return true;
-
-#ifndef _WIN64
-    return false;
-#endif // _WIN64
-    if(scmp(string, "rax"))
-        return true;
-    if(scmp(string, "rbx"))
-        return true;
-    if(scmp(string, "rcx"))
-        return true;
-    if(scmp(string, "rdx"))
-        return true;
-    if(scmp(string, "rdi"))
-        return true;
-    if(scmp(string, "rsi"))
-        return true;
-    if(scmp(string, "rbp"))
-        return true;
-    if(scmp(string, "rsp"))
-        return true;
-    if(scmp(string, "rip"))
-        return true;
-    if(scmp(string, "rflags"))
-        return true;
-    if(scmp(string, "r8"))
-        return true;
-    if(scmp(string, "r9"))
-        return true;
-    if(scmp(string, "r10"))
-        return true;
-    if(scmp(string, "r11"))
-        return true;
-    if(scmp(string, "r12"))
-        return true;
-    if(scmp(string, "r13"))
-        return true;
-    if(scmp(string, "r14"))
-        return true;
-    if(scmp(string, "r15"))
-        return true;
-    if(scmp(string, "r8d"))
-        return true;
-    if(scmp(string, "r9d"))
-        return true;
-    if(scmp(string, "r10d"))
-        return true;
-    if(scmp(string, "r11d"))
-        return true;
-    if(scmp(string, "r12d"))
-        return true;
-    if(scmp(string, "r13d"))
-        return true;
-    if(scmp(string, "r14d"))
-        return true;
-    if(scmp(string, "r15d"))
-        return true;
-    if(scmp(string, "r8w"))
-        return true;
-    if(scmp(string, "r9w"))
-        return true;
-    if(scmp(string, "r10w"))
-        return true;
-    if(scmp(string, "r11w"))
-        return true;
-    if(scmp(string, "r12w"))
-        return true;
-    if(scmp(string, "r13w"))
-        return true;
-    if(scmp(string, "r14w"))
-        return true;
-    if(scmp(string, "r15w"))
-        return true;
-    if(scmp(string, "r8b"))
-        return true;
-    if(scmp(string, "r9b"))
-        return true;
-    if(scmp(string, "r10b"))
-        return true;
-    if(scmp(string, "r11b"))
-        return true;
-    if(scmp(string, "r12b"))
-        return true;
-    if(scmp(string, "r13b"))
-        return true;
-    if(scmp(string, "r14b"))
-        return true;
-    if(scmp(string, "r15b"))
-        return true;
-    return false;
+    return registerindex(string) != -1;
 }
 
 #define MXCSRFLAG_IE 0x1
@@ -551,504 +487,122 @@ bool valflagfromstring(duint eflags, const char* string)
     if(scmp(string, "ac"))
         return (bool)((int)(eflags & 0x40000) != 0);
     if(scmp(string, "vif"))
-        return (bool)((int)(eflags & 0x80000) != 0);
-    if(scmp(string, "vip"))
-        return (bool)((int)(eflags & 0x100000) != 0);
-    if(scmp(string, "id"))
-        return (bool)((int)(eflags & 0x200000) != 0);
-    return false;
-}
-
-/**
-\brief Sets a flag value.
-\param string The name of the flag.
-\param set The value of the flag.
-\return true if the flag was successfully set, false otherwise.
-*/
-bool setflag(const char* string, bool set)
-{
-    duint eflags = GetContextDataEx(hActiveThread, UE_CFLAGS);
-    duint xorval = 0;
-    duint flag = 0;
-    if(scmp(string, "cf"))
-        flag = 0x1;
-    else if(scmp(string, "pf"))
-        flag = 0x4;
-    else if(scmp(string, "af"))
-        flag = 0x10;
-    else if(scmp(string, "zf"))
-        flag = 0x40;
-    else if(scmp(string, "sf"))
-        flag = 0x80;
-    else if(scmp(string, "tf"))
-        flag = 0x100;
-    else if(scmp(string, "if"))
-        flag = 0x200;
-    else if(scmp(string, "df"))
-        flag = 0x400;
-    else if(scmp(string, "of"))
-        flag = 0x800;
-    else if(scmp(string, "rf"))
-        flag = 0x10000;
-    else if(scmp(string, "vm"))
-        flag = 0x20000;
-    else if(scmp(string, "ac"))
-        flag = 0x40000;
-    else if(scmp(string, "vif"))
-        flag = 0x80000;
-    else if(scmp(string, "vip"))
-        flag = 0x100000;
-    else if(scmp(string, "id"))
-        flag = 0x200000;
-    if(eflags & flag && !set)
-        xorval = flag;
-    else if(set)
-        xorval = flag;
-    return SetContextDataEx(hActiveThread, UE_CFLAGS, eflags ^ xorval);
-}
-
-/**
-\brief Gets a register from a string.
-\param [out] size This function can store the register size in bytes in this parameter. Can be null, in that case it will be ignored.
-\param string The name of the register to get.
-\return The register value.
-*/
-static duint getregister(int* size, const char* string)
-{
-    if(size)
-        *size = 4;
-    if(scmp(string, "eax"))
-    {
-        return GetContextDataEx(hActiveThread, UE_EAX);
-    }
-    if(scmp(string, "ebx"))
-    {
-        return GetContextDataEx(hActiveThread, UE_EBX);
-    }
-    if(scmp(string, "ecx"))
-    {
-        return GetContextDataEx(hActiveThread, UE_ECX);
-    }
-    if(scmp(string, "edx"))
-    {
-        return GetContextDataEx(hActiveThread, UE_EDX);
-    }
-    if(scmp(string, "edi"))
-    {
-        return GetContextDataEx(hActiveThread, UE_EDI);
-    }
-    if(scmp(string, "esi"))
-    {
-        return GetContextDataEx(hActiveThread, UE_ESI);
-    }
-    if(scmp(string, "ebp"))
-    {
-        return GetContextDataEx(hActiveThread, UE_EBP);
-    }
-    if(scmp(string, "esp"))
-    {
-        return GetContextDataEx(hActiveThread, UE_ESP);
-    }
-    if(scmp(string, "eip"))
-    {
-        return GetContextDataEx(hActiveThread, UE_EIP);
-    }
-    if(scmp(string, "eflags"))
-    {
-        return GetContextDataEx(hActiveThread, UE_EFLAGS);
-    }
-
-    if(scmp(string, "gs"))
-    {
-        return GetContextDataEx(hActiveThread, UE_SEG_GS);
-    }
-    if(scmp(string, "fs"))
-    {
-        return GetContextDataEx(hActiveThread, UE_SEG_FS);
-    }
-    if(scmp(string, "es"))
-    {
-        return GetContextDataEx(hActiveThread, UE_SEG_ES);
-    }
-    if(scmp(string, "ds"))
-    {
-        return GetContextDataEx(hActiveThread, UE_SEG_DS);
-    }
-    if(scmp(string, "cs"))
-    {
-        return GetContextDataEx(hActiveThread, UE_SEG_CS);
-    }
-    if(scmp(string, "ss"))
-    {
-        return GetContextDataEx(hActiveThread, UE_SEG_SS);
-    }
-
-    if(size)
-        *size = 2;
-    if(scmp(string, "ax"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_EAX);
-        return val & 0xFFFF;
-    }
-    if(scmp(string, "bx"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_EBX);
-        return val & 0xFFFF;
-    }
-    if(scmp(string, "cx"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_ECX);
-        return val & 0xFFFF;
-    }
-    if(scmp(string, "dx"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_EDX);
-        return val & 0xFFFF;
-    }
-    if(scmp(string, "si"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_ESI);
-        return val & 0xFFFF;
-    }
-    if(scmp(string, "di"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_EDI);
-        return val & 0xFFFF;
-    }
-    if(scmp(string, "bp"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_EBP);
-        return val & 0xFFFF;
-    }
-    if(scmp(string, "sp"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_ESP);
-        return val & 0xFFFF;
-    }
-    if(scmp(string, "ip"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_EIP);
-        return val & 0xFFFF;
-    }
-
-    if(size)
-        *size = 1;
-    if(scmp(string, "ah"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_EAX);
-        return (val >> 8) & 0xFF;
-    }
-    if(scmp(string, "al"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_EAX);
-        return val & 0xFF;
-    }
-    if(scmp(string, "bh"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_EBX);
-        return (val >> 8) & 0xFF;
-    }
-    if(scmp(string, "bl"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_EBX);
-        return val & 0xFF;
-    }
-    if(scmp(string, "ch"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_ECX);
-        return (val >> 8) & 0xFF;
-    }
-    if(scmp(string, "cl"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_ECX);
-        return val & 0xFF;
-    }
-    if(scmp(string, "dh"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_EDX);
-        return (val >> 8) & 0xFF;
-    }
-    if(scmp(string, "dl"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_EDX);
-        return val & 0xFF;
-    }
-    if(scmp(string, "sih"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_ESI);
-        return (val >> 8) & 0xFF;
-    }
-    if(scmp(string, "sil"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_ESI);
-        return val & 0xFF;
-    }
-    if(scmp(string, "dih"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_EDI);
-        return (val >> 8) & 0xFF;
-    }
-    if(scmp(string, "dil"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_EDI);
-        return val & 0xFF;
-    }
-    if(scmp(string, "bph"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_EBP);
-        return (val >> 8) & 0xFF;
-    }
-    if(scmp(string, "bpl"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_EBP);
-        return val & 0xFF;
-    }
-    if(scmp(string, "sph"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_ESP);
-        return (val >> 8) & 0xFF;
-    }
-    if(scmp(string, "spl"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_ESP);
-        return val & 0xFF;
-    }
-    if(scmp(string, "iph"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_EIP);
-        return (val >> 8) & 0xFF;
-    }
-    if(scmp(string, "ipl"))
-    {
-        duint val = GetContextDataEx(hActiveThread, UE_EIP);
-        return val & 0xFF;
-    }
-
-    if(size)
-        *size = sizeof(duint);
-    if(scmp(string, "dr0"))
-    {
-        return GetContextDataEx(hActiveThread, UE_DR0);
-    }
-    if(scmp(string, "dr1"))
-    {
-        return GetContextDataEx(hActiveThread, UE_DR1);
-    }
-    if(scmp(string, "dr2"))
-    {
-        return GetContextDataEx(hActiveThread, UE_DR2);
-    }
-    if(scmp(string, "dr3"))
-    {
-        return GetContextDataEx(hActiveThread, UE_DR3);
-    }
-    if(scmp(string, "dr6") || scmp(string, "dr4"))
-    {
-        return GetContextDataEx(hActiveThread, UE_DR6);
-    }
-    if(scmp(string, "dr7") || scmp(string, "dr5"))
-    {
-        return GetContextDataEx(hActiveThread, UE_DR7);
-    }
+        return (bool)((int)(eflags & 0x80000) != 0);
+    if(scmp(string, "vip"))
+        return (bool)((int)(eflags & 0x100000) != 0);
+    if(scmp(string, "id"))
+        return (bool)((int)(eflags & 0x200000) != 0);
+    return false;
+}
 
-    if(scmp(string, "cip"))
-    {
-        return GetContextDataEx(hActiveThread, UE_CIP);
-    }
-    if(scmp(string, "csp"))
-    {
-        return GetContextDataEx(hActiveThread, UE_CSP);
-    }
-    if(scmp(string, "cflags"))
-    {
-        return GetContextDataEx(hActiveThread, UE_CFLAGS);
-    }
+/**
+\brief Sets a flag value.
+\param string The name of the flag.
+\param set The value of the flag.
+\return true if the flag was successfully set, false otherwise.
+*/
+bool setflag(const char* string, bool set)
+{
+    duint eflags = GetContextDataEx(hActiveThread, UE_CFLAGS);
+    duint xorval = 0;
+    duint flag = 0;
+    if(scmp(string, "cf"))
+        flag = 0x1;
+    else if(scmp(string, "pf"))
+        flag = 0x4;
+    else if(scmp(string, "af"))
+        flag = 0x10;
+    else if(scmp(string, "zf"))
+        flag = 0x40;
+    else if(scmp(string, "sf"))
+        flag = 0x80;
+    else if(scmp(string, "tf"))
+        flag = 0x100;
+    else if(scmp(string, "if"))
+        flag = 0x200;
+    else if(scmp(string, "df"))
+        flag = 0x400;
+    else if(scmp(string, "of"))
+        flag = 0x800;
+    else if(scmp(string, "rf"))
+        flag = 0x10000;
+    else if(scmp(string, "vm"))
+        flag = 0x20000;
+    else if(scmp(string, "ac"))
+        flag = 0x40000;
+    else if(scmp(string, "vif"))
+        flag = 0x80000;
+    else if(scmp(string, "vip"))
+        flag = 0x100000;
+    else if(scmp(string, "id"))
+        flag = 0x200000;
+    if(eflags & flag && !set)
+        xorval = flag;
+    else if(set)
+        xorval = flag;
+    return SetContextDataEx(hActiveThread, UE_CFLAGS, eflags ^ xorval);
+}
 
-#ifdef _WIN64
-    if(size)
-        *size = 8;
-    if(scmp(string, "rax"))
-    {
-        return GetContextDataEx(hActiveThread, UE_RAX);
-    }
-    if(scmp(string, "rbx"))
-    {
-        return GetContextDataEx(hActiveThread, UE_RBX);
-    }
-    if(scmp(string, "rcx"))
-    {
-        return GetContextDataEx(hActiveThread, UE_RCX);
-    }
-    if(scmp(string, "rdx"))
-    {
-        return GetContextDataEx(hActiveThread, UE_RDX);
-    }
-    if(scmp(string, "rdi"))
-    {
-        return GetContextDataEx(hActiveThread, UE_RDI);
-    }
-    if(scmp(string, "rsi"))
-    {
-        return GetContextDataEx(hActiveThread, UE_RSI);
-    }
-    if(scmp(string, "rbp"))
-    {
-        return GetContextDataEx(hActiveThread, UE_RBP);
-    }
-    if(scmp(string, "rsp"))
-    {
-        return GetContextDataEx(hActiveThread, UE_RSP);
-    }
-    if(scmp(string, "rip"))
-    {
-        return GetContextDataEx(hActiveThread, UE_RIP);
-    }
-    if(scmp(string, "rflags"))
-    {
-        return GetContextDataEx(hActiveThread, UE_RFLAGS);
-    }
-    if(scmp(string, "r8"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R8);
-    }
-    if(scmp(string, "r9"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R9);
-    }
-    if(scmp(string, "r10"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R10);
-    }
-    if(scmp(string, "r11"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R11);
-    }
-    if(scmp(string, "r12"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R12);
-    }
-    if(scmp(string, "r13"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R13);
-    }
-    if(scmp(string, "r14"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R14);
-    }
-    if(scmp(string, "r15"))
+/**
+\brief Gets a register from a string.
+\param [out] size This function can store the register size in bytes in this parameter. Can be null, in that case it will be ignored.
+\param string The name of the register to get.
+\return The register value.
+*/
+static duint getregister(int* size, const char* string)
+{
+    int index = registerindex(string);
+    if(index == -1)
     {
-        return GetContextDataEx(hActiveThread, UE_R15);
+        if(size)
+            *size = 0;
+        return 0;
     }
-
+    const auto & entry = registerTable[index];
     if(size)
-        *size = 4;
-    if(scmp(string, "r8d"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R8) & 0xFFFFFFFF;
-    }
-    if(scmp(string, "r9d"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R9) & 0xFFFFFFFF;
-    }
-    if(scmp(string, "r10d"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R10) & 0xFFFFFFFF;
-    }
-    if(scmp(string, "r11d"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R11) & 0xFFFFFFFF;
-    }
-    if(scmp(string, "r12d"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R12) & 0xFFFFFFFF;
-    }
-    if(scmp(string, "r13d"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R13) & 0xFFFFFFFF;
-    }
-    if(scmp(string, "r14d"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R14) & 0xFFFFFFFF;
-    }
-    if(scmp(string, "r15d"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R15) & 0xFFFFFFFF;
-    }
+        *size = entry.size;
+    return (GetContextDataEx(hActiveThread, entry.titan) >> entry.shift) & entry.mask;
+}
 
-    if(size)
-        *size = 2;
-    if(scmp(string, "r8w"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R8) & 0xFFFF;
-    }
-    if(scmp(string, "r9w"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R9) & 0xFFFF;
-    }
-    if(scmp(string, "r10w"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R10) & 0xFFFF;
-    }
-    if(scmp(string, "r11w"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R11) & 0xFFFF;
-    }
-    if(scmp(string, "r12w"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R12) & 0xFFFF;
-    }
-    if(scmp(string, "r13w"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R13) & 0xFFFF;
-    }
-    if(scmp(string, "r14w"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R14) & 0xFFFF;
-    }
-    if(scmp(string, "r15w"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R15) & 0xFFFF;
-    }
+/**
+\brief Resolves a register name once, so an expression that is evaluated many times does not look it up again.
+\param string The register name.
+\param [out] index The register, for valregisterget().
+\return true if the string is a register, false otherwise.
+*/
+bool valregisterfromstring(const char* string, int* index)
+{
+    *index = registerindex(string);
+    return *index != -1;
+}
 
-    if(size)
-        *size = 1;
-    if(scmp(string, "r8b"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R8) & 0xFF;
-    }
-    if(scmp(string, "r9b"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R9) & 0xFF;
-    }
-    if(scmp(string, "r10b"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R10) & 0xFF;
-    }
-    if(scmp(string, "r11b"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R11) & 0xFF;
-    }
-    if(scmp(string, "r12b"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R12) & 0xFF;
-    }
-    if(scmp(string, "r13b"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R13) & 0xFF;
-    }
-    if(scmp(string, "r14b"))
-    {
-        return GetContextDataEx(hActiveThread, UE_R14) & 0xFF;
-    }
-    if(scmp(string, "r15b"))
+/**
+\brief Gets the value of a register resolved with valregisterfromstring(). The results are the same as valfromstring_noexpr() with the register name.
+\param index The register.
+\param [out] value The register value.
+\param silent true to not output anything to the console.
+\param [out] value_size The register size. Can be null.
+\param [out] isvar Always set to true. Can be null.
+\return true.
+*/
+bool valregisterget(int index, duint* value, bool silent, int* value_size, bool* isvar)
+{
+    if(isvar)
+        *isvar = true;
+    if(!DbgIsDebugging())
     {
-        return GetContextDataEx(hActiveThread, UE_R15) & 0xFF;
+        if(!silent)
+            dputs("not debugging!");
+        *value = 0;
+        if(value_size)
+            *value_size = 0;
+        return true;
     }
-#endif //_WIN64
-
-    if(size)
-        *size = 0;
-    return 0;
+    const auto & entry = registerTable[index];
+    if(value_size)
+        *value_size = entry.size;
+    *value = (GetContextDataEx(hActiveThread, entry.titan) >> entry.shift) & entry.mask;
+    return true;
 }
 
 /**
@@ -1564,23 +1118,7 @@ bool valfromstring_noexpr(const char* string, duint* value, bool silent, bool ba
         return true;
     }
     else if(isregister(string))  //register
-    {
-        if(!DbgIsDebugging())
-        {
-            if(!silent)
-                dputs("not debugging!");
-            *value = 0;
-            if(value_size)
-                *value_size = 0;
-            if(isvar)
-                *isvar = true;
-            return true;
-        }
-        *value = getregister(value_size, string);
-        if(isvar)
-            *isvar = true;
-        return true;
-    }
+        return valregisterget(registerindex(string), value, silent, value_size, isvar);
     else if(*string == '!' && isflag(string + 1))  //flag
     {
         if(!DbgIsDebugging())
@@ -1652,6 +1190,27 @@ bool valfromstring_noexpr(const char* string, duint* value, bool silent, bool ba
     return false; //nothing was OK
 }
 
+/**
+\brief Gets the compiled form of an expression, compiling and caching it on first use.
+\param string The expression.
+\return The compiled expression. The parser does not depend on debuggee state, so it stays valid for the whole session.
+*/
+static std::shared_ptr<ExpressionParser> valexpressionget(const char* string)
+{
+    SHARED_ACQUIRE(LockExpressions);
+    auto found = expressionCache.find(string);
+    if(found != expressionCache.end())
+        return found->second;
+    SHARED_RELEASE();
+
+    //compile outside of the lock, operands are only resolved in ExpressionParser::calculate
+    auto parser = std::make_shared<ExpressionParser>(string);
+    EXCLUSIVE_ACQUIRE(LockExpressions);
+    if(expressionCache.size() >= MAX_EXPRESSION_CACHE)
+        expressionCache.clear();
+    return expressionCache.emplace(string, parser).first->second;
+}
+
 /**
 \brief Gets a value from a string. This function can parse expressions, memory locations, registers, flags, API names, labels, symbols and variables.
 \param string The string to parse.
@@ -1672,14 +1231,39 @@ bool valfromstring(const char* string, duint* value, bool silent, bool baseonly,
         *value = 0;
         return true;
     }
-    ExpressionParser parser(string);
+    auto parser = valexpressionget(string);
     duint result;
-    if(!parser.calculate(result, valuesignedcalc(), silent, baseonly, value_size, isvar, hexonly))
+    if(!parser->calculate(result, valuesignedcalc(), silent, baseonly, value_size, isvar, hexonly))
         return false;
     *value = result;
     return true;
 }
 
+/**
+\brief Resolves a string to a number if it is a number literal. Strings that would be parsed as a register are never constant.
+\param string The string to check.
+\param [out] value The value of the number literal. This value cannot be null.
+\return true if the string is a decimal or hexadecimal number literal, false otherwise.
+*/
+bool valconstfromstring(const char* string, duint* value)
+{
+    if(!*string || isregister(string))
+        return false;
+    if(isdecnumber(string))
+    {
+        *value = 0;
+        sscanf(string + 1, "%" fext "u", value);
+        return true;
+    }
+    if(ishexnumber(string))
+    {
+        *value = 0;
+        sscanf(string + (*string == 'x' ? 1 : 0), "%" fext "x", value);
+        return true;
+    }
+    return false;
+}
+
 /**
 \brief Checks if a string is long enough.
 \param str The string to check.
@@ -9,6 +9,9 @@ void valuesetsignedcalc(bool a);
 bool valapifromstring(const char* name, duint* value, int* value_size, bool printall, bool silent, bool* hexonly);
 bool valfromstring_noexpr(const char* string, duint* value, bool silent = true, bool baseonly = false, int* value_size = 0, bool* isvar = 0, bool* hexonly = 0);
 bool valfromstring(const char* string, duint* value, bool silent = true, bool baseonly = false, int* value_size = 0, bool* isvar = 0, bool* hexonly = 0);
+bool valconstfromstring(const char* string, duint* value);
+bool valregisterfromstring(const char* string, int* index);
+bool valregisterget(int index, duint* value, bool silent, int* value_size, bool* isvar);
 bool valflagfromstring(duint eflags, const char* string);
 bool valtostring(const char* string, duint value, bool silent);
 bool valmxcsrflagfromstring(duint mxcsrflags, const char* string);
@@ -21,6 +21,8 @@
 #include "_scriptapi_gui.h"
 #include "filehelper.h"
 #include "database.h"
+#include "settings.h"
+#include "allocator.h"
 
 static MESSAGE_STACK* gMsgStack = 0;
 static HANDLE hCommandLoopThread = 0;
@@ -95,11 +97,18 @@ static void registercommands()
     dbgcmdnew("loadlib", cbDebugLoadLib, true); //Load DLL
     dbgcmdnew("skip", cbDebugSkip, true); //skip one instruction
     dbgcmdnew("setfreezestack", cbDebugSetfreezestack, false); //freeze the stack from auto updates
+    dbgcmdnew("TraceIntoConditional\1ticnd", cbDebugTraceIntoConditional, true); //recorded trace into, arg1:stop condition,[arg2:max steps]
+    dbgcmdnew("TraceOverConditional\1tocnd", cbDebugTraceOverConditional, true); //recorded trace over, arg1:stop condition,[arg2:max steps]
+    dbgcmdnew("tracesave", cbDebugTraceSave, false); //save the trace buffer, arg1:file
+    dbgcmdnew("traceclear", cbDebugTraceClear, false); //clear the trace buffer
+    dbgcmdnew("tracelog", cbDebugTraceLog, false); //print a trace file, arg1:file,[arg2:first event],[arg3:count]
 
     //breakpoints
     dbgcmdnew("bplist", cbDebugBplist, true); //breakpoint list
     dbgcmdnew("SetBPXOptions\1bptype", cbDebugSetBPXOptions, false); //breakpoint type
     dbgcmdnew("SetBPX\1bp\1bpx", cbDebugSetBPX, true); //breakpoint
+    dbgcmdnew("SetExportBPX\1bpexports", cbDebugSetExportBPX, true); //breakpoint on all exports of a module
+    dbgcmdnew("SetReferenceBPX\1bpref", cbDebugSetReferenceBPX, true); //breakpoint on all references
     dbgcmdnew("DeleteBPX\1bpc\1bc", cbDebugDeleteBPX, true); //breakpoint delete
     dbgcmdnew("EnableBPX\1bpe\1be", cbDebugEnableBPX, true); //breakpoint enable
     dbgcmdnew("DisableBPX\1bpd\1bd", cbDebugDisableBPX, true); //breakpoint disable
@@ -111,6 +120,9 @@ static void registercommands()
     dbgcmdnew("DeleteMemoryBPX\1membpc\1bpmc", cbDebugDeleteMemoryBreakpoint, true); //delete memory breakpoint
     dbgcmdnew("EnableMemoryBreakpoint\1membpe\1bpme", cbDebugEnableMemoryBreakpoint, true); //enable memory breakpoint
     dbgcmdnew("DisableMemoryBreakpoint\1membpd\1bpmd", cbDebugDisableMemoryBreakpoint, true); //enable memory breakpoint
+    dbgcmdnew("SetBreakpointCondition\1bpcond", cbDebugSetBreakpointCondition, true); //break condition, arg1:breakpoint,[arg2:expression]
+    dbgcmdnew("SetBreakpointLog\1bplog", cbDebugSetBreakpointLog, true); //log and continue, arg1:breakpoint,[arg2:text]
+    dbgcmdnew("ResetBreakpointHitCount\1bphitreset", cbDebugResetBreakpointHitCount, true); //reset hit counter, arg1:breakpoint
 
     //variables
     dbgcmdnew("varnew\1var", cbInstrVar, false); //make a variable arg1:name,[arg2:value]
@@ -129,6 +141,7 @@ static void registercommands()
     dbgcmdnew("refinit", cbInstrRefinit, false);
     dbgcmdnew("refadd", cbInstrRefadd, false);
     dbgcmdnew("asm", cbInstrAssemble, true); //assemble instruction
+    dbgcmdnew("asmblock", cbInstrAssembleBlock, true); //assemble multiple instructions with labels
     dbgcmdnew("sleep", cbInstrSleep, false); //Sleep
 
     //user database
@@ -188,6 +201,7 @@ static void registercommands()
     //data
     dbgcmdnew("reffind\1findref\1ref", cbInstrRefFind, true); //find references to a value
     dbgcmdnew("refstr\1strref", cbInstrRefStr, true); //find string references
+    dbgcmdnew("modstrings\1strings", cbInstrModStrings, true); //list the strings in a module
     dbgcmdnew("find", cbInstrFind, true); //find a pattern
     dbgcmdnew("findall", cbInstrFindAll, true); //find all patterns
     dbgcmdnew("modcallfind", cbInstrModCallFind, true); //find intermodular calls
@@ -195,6 +209,7 @@ static void registercommands()
     dbgcmdnew("reffindrange\1findrefrange\1refrange", cbInstrRefFindRange, true);
     dbgcmdnew("yara", cbInstrYara, true); //yara test command
     dbgcmdnew("yaramod", cbInstrYaramod, true); //yara rule on module
+    dbgcmdnew("yaraall", cbInstrYaraAll, true); //yara rule on all memory
     dbgcmdnew("analyse\1analyze\1anal", cbInstrAnalyse, true); //secret analysis command
 
     //undocumented
@@ -214,6 +229,10 @@ static void registercommands()
     dbgcmdnew("findallmem\1findmemall", cbInstrFindMemAll, true); //memory map pattern find
     dbgcmdnew("setmaxfindresult\1findsetmaxresult", cbInstrSetMaxFindResult, false); //set the maximum number of occurences found
     dbgcmdnew("savedata", cbInstrSavedata, true); //save data to disk
+    dbgcmdnew("saveregions", cbInstrSaveRegions, true); //save multiple regions to a sparse file
+    dbgcmdnew("pluginstats", cbInstrPluginStats, false); //plugin callback timing
+    dbgcmdnew("symcachestats", cbInstrSymCacheStats, false); //symbol name cache hit rate
+    dbgcmdnew("allocstats", cbInstrAllocStats, false); //allocation statistics per tag
 }
 
 static bool cbCommandProvider(char* cmd, int maxlen)
@@ -257,6 +276,8 @@ extern "C" DLL_EXPORT const char* _dbg_dbginit()
 
     dputs("Initializing wait objects...");
     waitinitialize();
+    dputs("Initializing settings...");
+    SettingInit();
     dputs("Initializing debugger...");
     dbginit();
     dputs("Initializing debugger functions...");
@@ -386,11 +407,15 @@ extern "C" DLL_EXPORT void _dbg_dbgexitsignal()
     dputs("Cleaning up allocated data...");
     cmdfree();
     varfree();
+    yararulescacheclear();
     yr_finalize();
     Capstone::GlobalFinalize();
     dputs("Checking for mem leaks...");
     if(memleaks())
+    {
         dprintf("%d memory leak(s) found!\n", memleaks());
+        AllocStatsPrint(true);
+    }
     else
         DeleteFileA(alloctrace);
     dputs("Cleaning up wait objects...");
@@ -0,0 +1,19 @@
+#pragma once
+
+/**
+\brief Calls Proc(Offset, Size, Limit) for the chunks of a region of RegionSize bytes. Consecutive chunks overlap by Overlap bytes, so a match of up to Overlap bytes that crosses a chunk boundary is found completely in one of them. A chunk only reports the matches that start before its Limit, the ones after it are found again by the next chunk. This header does not depend on the Windows types, so it can be tested on its own.
+\param ChunkSize The size of a chunk, larger than Overlap.
+*/
+template<typename Address, typename ChunkProc>
+void YaraForEachChunk(Address RegionSize, Address ChunkSize, Address Overlap, ChunkProc Proc)
+{
+    for(Address offset = 0; offset < RegionSize;)
+    {
+        Address chunkSize = RegionSize - offset < ChunkSize ? RegionSize - offset : ChunkSize;
+        bool last = offset + chunkSize >= RegionSize;
+        Proc(offset, chunkSize, last ? ~Address(0) : chunkSize - Overlap);
+        if(last)
+            break;
+        offset += chunkSize - Overlap;
+    }
+}
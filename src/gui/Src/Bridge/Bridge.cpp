@@ -214,7 +214,17 @@ void* Bridge::processMessage(GUIMSG type, void* param1, void* param2)
     break;
 
     case GUI_REF_GETCELLCONTENT:
-        return (void*)referenceManager->currentReferenceView()->mList->getCellContent((int)param1, (int)param2).toUtf8().constData();
+        //the text stays valid until the next call
+        mCellContent = referenceManager->currentReferenceView()->mList->getCellContent((int)param1, (int)param2).toUtf8();
+        return (void*)mCellContent.constData();
+
+    case GUI_REF_GETCELLCONTENTCOPY:
+    {
+        QByteArray content = referenceManager->currentReferenceView()->mList->getCellContent((int)param1, (int)param2).toUtf8();
+        char* result = (char*)BridgeAlloc(content.length() + 1);
+        memcpy(result, content.constData(), content.length());
+        return result;
+    }
 
     case GUI_REF_RELOADDATA:
         emit referenceReloadData();
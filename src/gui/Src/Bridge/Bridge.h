@@ -122,6 +122,7 @@ private:
     dsint bridgeResult;
     volatile bool hasBridgeResult;
     volatile bool dbgStopped;
+    QByteArray mCellContent;
 };
 
 #endif // BRIDGE_H
@@ -5,8 +5,10 @@
 #include "YaraRuleSelectionDialog.h"
 #include "EntropyDialog.h"
 #include "HexEditDialog.h"
+#include "QEntropyView/Entropy.h"
+#include "QEntropyView/EntropyThread.h"
 
-MemoryMapView::MemoryMapView(StdTable* parent) : StdTable(parent)
+MemoryMapView::MemoryMapView(StdTable* parent) : StdTable(parent), mEntropyThread(nullptr)
 {
     enableMultiSelection(false);
 
@@ -18,6 +20,7 @@ MemoryMapView::MemoryMapView(StdTable* parent) : StdTable(parent)
     addColumnAt(8 + charwidth * 5, "Type", false, "Allocation Type"); //allocation type
     addColumnAt(8 + charwidth * 11, "Protection", false, "Current Protection"); //current protection
     addColumnAt(8 + charwidth * 8, "Initial", false, "Allocation Protection"); //allocation protection
+    addColumnAt(8 + charwidth * 7, "Entropy", false, "Entropy"); //entropy (computed in the background)
     addColumnAt(100, "", false);
 
     connect(Bridge::getBridge(), SIGNAL(updateMemory()), this, SLOT(refreshMap()));
@@ -27,6 +30,11 @@ MemoryMapView::MemoryMapView(StdTable* parent) : StdTable(parent)
     setupContextMenu();
 }
 
+MemoryMapView::~MemoryMapView()
+{
+    delete mEntropyThread;
+}
+
 void MemoryMapView::setupContextMenu()
 {
     //Follow in Dump
@@ -229,6 +237,7 @@ void MemoryMapView::refreshMap()
 {
     MEMMAP wMemMapStruct;
     int wI;
+    std::vector<EntropyRegion> regions;
 
     memset(&wMemMapStruct, 0, sizeof(MEMMAP));
 
@@ -296,16 +305,112 @@ void MemoryMapView::refreshMap()
         wS = getProtectionString(wMbi.AllocationProtect);
         setCellContent(wI, 5, wS);
 
+        // entropy
+        auto found = mEntropyCache.find(std::make_pair((duint)wMbi.BaseAddress, (duint)wMbi.RegionSize));
+        if(found != mEntropyCache.end())
+            setCellContent(wI, 6, QString::number(found->second.value, 'f', 3));
+        else if(wMbi.State == MEM_COMMIT && !(wMbi.Protect & (PAGE_NOACCESS | PAGE_GUARD)))
+        {
+            EntropyRegion region;
+            region.addr = (duint)wMbi.BaseAddress;
+            region.size = (duint)wMbi.RegionSize;
+            region.writable = (wMbi.Protect & (PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY)) != 0;
+            regions.push_back(region);
+        }
     }
     if(wMemMapStruct.page != 0)
         BridgeFree(wMemMapStruct.page);
     reloadData(); //refresh memory map
+
+    mEntropyRegions.swap(regions);
+    startEntropyThread();
+}
+
+void MemoryMapView::startEntropyThread()
+{
+    //the regions are read in bounded chunks, every result is reported as soon as it is known
+    stopEntropyThread();
+    if(mEntropyRegions.empty())
+        return;
+    std::vector<EntropyRegion> regions = mEntropyRegions;
+    mEntropyThread = new EntropyThread([regions](EntropyThread * thread)
+    {
+        std::vector<unsigned char> buffer(1024 * 1024);
+        for(int i = 0; i < (int)regions.size(); i++)
+        {
+            unsigned long long occurrences[256] = {};
+            unsigned long long total = 0;
+            for(duint offset = 0; offset < regions[i].size; offset += buffer.size())
+            {
+                if(thread->isStopped())
+                    return;
+                duint size = qMin(regions[i].size - offset, (duint)buffer.size());
+                if(!DbgMemRead(regions[i].addr + offset, buffer.data(), size))
+                    continue;
+                for(duint j = 0; j < size; j++)
+                    occurrences[buffer[j]]++;
+                total += size;
+            }
+            if(total)
+                thread->emitValueReady(i, Entropy::MeasureHistogram(occurrences, total));
+        }
+    });
+    connect(mEntropyThread, SIGNAL(valueReady(int, double)), this, SLOT(entropyReadySlot(int, double)));
+    mEntropyThread->start(QThread::LowPriority);
+}
+
+void MemoryMapView::stopEntropyThread()
+{
+    if(!mEntropyThread)
+        return;
+    mEntropyThread->stop();
+    mEntropyThread->wait();
+    mEntropyThread->deleteLater(); //results that are still queued are ignored by entropyReadySlot
+    mEntropyThread = nullptr;
+}
+
+void MemoryMapView::entropyReadySlot(int index, double value)
+{
+    if(sender() != mEntropyThread || index >= (int)mEntropyRegions.size())
+        return;
+    const EntropyRegion & region = mEntropyRegions[index];
+    EntropyValue & cached = mEntropyCache[std::make_pair(region.addr, region.size)];
+    cached.value = value;
+    cached.writable = region.writable;
+
+    //the rows might be sorted, so look up the row of the region
+    QString addrText = QString("%1").arg(region.addr, sizeof(duint) * 2, 16, QChar('0')).toUpper();
+    for(int i = 0; i < getRowCount(); i++)
+    {
+        if(getCellContent(i, 0) == addrText)
+        {
+            setCellContent(i, 6, QString::number(value, 'f', 3));
+            updateViewport();
+            break;
+        }
+    }
 }
 
 void MemoryMapView::stateChangedSlot(DBGSTATE state)
 {
     if(state == paused)
+    {
+        //the contents of writable regions might have changed since the last pause
+        for(auto i = mEntropyCache.begin(); i != mEntropyCache.end();)
+        {
+            if(i->second.writable)
+                i = mEntropyCache.erase(i);
+            else
+                ++i;
+        }
         refreshMap();
+    }
+    else if(state == stopped)
+    {
+        stopEntropyThread();
+        mEntropyRegions.clear();
+        mEntropyCache.clear();
+    }
 }
 
 void MemoryMapView::followDumpSlot()
@@ -2,12 +2,16 @@
 #define MEMORYMAPVIEW_H
 
 #include "StdTable.h"
+#include <map>
+
+class EntropyThread;
 
 class MemoryMapView : public StdTable
 {
     Q_OBJECT
 public:
     explicit MemoryMapView(StdTable* parent = 0);
+    ~MemoryMapView();
     QString paintContent(QPainter* painter, dsint rowBase, int rowOffset, int col, int x, int y, int w, int h);
     void setupContextMenu();
 
@@ -35,9 +39,12 @@ public slots:
     void refreshMap();
     void entropy();
     void findPatternSlot();
+    void entropyReadySlot(int index, double value);
 
 private:
     QString getProtectionString(DWORD Protect);
+    void startEntropyThread();
+    void stopEntropyThread();
 
     QAction* mFollowDump;
     QAction* mFollowDisassembly;
@@ -59,6 +66,23 @@ private:
     QAction* mMemoryExecuteSingleshootToggle;
     QAction* mEntropy;
     QAction* mFindPattern;
+
+    struct EntropyRegion
+    {
+        duint addr;
+        duint size;
+        bool writable;
+    };
+
+    struct EntropyValue
+    {
+        double value;
+        bool writable; //writable regions can change while the debuggee runs
+    };
+
+    EntropyThread* mEntropyThread;
+    std::vector<EntropyRegion> mEntropyRegions;
+    std::map<std::pair<duint, duint>, EntropyValue> mEntropyCache;
 };
 
 #endif // MEMORYMAPVIEW_H
@@ -39,12 +39,10 @@ bool PatchDialog::isPartOfPreviousGroup(const PatchInfoList & patchList, int ind
 {
     if(!index)
         return true;
-    uint addr = patchList.at(index).patch.addr;
-    uint prevAddr = patchList.at(index - 1).patch.addr;
-    for(int i = 1; i < 10; i++) //10 bytes in between groups
-        if(addr - i == prevAddr)
-            return true;
-    return false;
+    duint addr = patchList.at(index).patch.addr;
+    const DBGPATCHRANGE & prev = patchList.at(index - 1).patch;
+    duint prevAddr = prev.addr + prev.size - 1; //last byte of the previous range
+    return addr > prevAddr && addr - prevAddr < 10; //10 bytes in between groups
 }
 
 bool PatchDialog::isGroupEnabled(const PatchInfoList & patchList, int group)
@@ -79,6 +77,13 @@ dsint PatchDialog::getGroupAddress(const PatchInfoList & patchList, int group)
     return -1;
 }
 
+void PatchDialog::writePatchBytes(const PatchPair & patch)
+{
+    //change the bytes to reflect the change for the user (cypherpunk reported this)
+    const QByteArray & bytes = patch.status.checked ? patch.newBytes : patch.oldBytes;
+    DbgMemWrite(patch.patch.addr, (const unsigned char*)bytes.constData(), bytes.size());
+}
+
 void PatchDialog::dbgStateChanged(DBGSTATE state)
 {
     if(state == stopped)
@@ -98,16 +103,16 @@ void PatchDialog::updatePatches()
     ui->listPatches->clear();
     mPatches.clear();
 
-    //get patches from DBG
+    //get the patched ranges from DBG
     size_t cbsize;
-    if(!DbgFunctions()->PatchEnum(0, &cbsize))
+    if(!DbgFunctions()->PatchEnumRange(0, &cbsize))
         return;
-    int numPatches = (int)cbsize / sizeof(DBGPATCHINFO);
+    int numPatches = (int)cbsize / sizeof(DBGPATCHRANGE);
     if(!numPatches)
         return;
-    DBGPATCHINFO* patches = new DBGPATCHINFO[numPatches];
-    memset(patches, 0, numPatches * sizeof(DBGPATCHINFO));
-    if(!DbgFunctions()->PatchEnum(patches, 0))
+    DBGPATCHRANGE* patches = new DBGPATCHRANGE[numPatches];
+    memset(patches, 0, numPatches * sizeof(DBGPATCHRANGE));
+    if(!DbgFunctions()->PatchEnumRange(patches, 0))
     {
         delete [] patches;
         mIsWorking = false;
@@ -120,18 +125,22 @@ void PatchDialog::updatePatches()
     defaultStatus.checked = true;
     for(int i = 0; i < numPatches; i++)
     {
-        if(!patches[i].addr)
+        if(!patches[i].addr || !patches[i].size)
             continue;
         if(!*patches[i].mod)
             continue;
+        QByteArray oldBytes((int)patches[i].size, '\0');
+        QByteArray newBytes((int)patches[i].size, '\0');
+        if(!DbgFunctions()->PatchGetRange(patches[i].addr, patches[i].size, (unsigned char*)oldBytes.data(), (unsigned char*)newBytes.data()))
+            continue;
         QString mod = patches[i].mod;
         PatchMap::iterator found = mPatches.find(mod);
         if(found != mPatches.end()) //found
-            mPatches[mod].append(PatchPair(patches[i], defaultStatus));
+            mPatches[mod].append(PatchPair(patches[i], oldBytes, newBytes, defaultStatus));
         else //not found
         {
             PatchInfoList patchList;
-            patchList.append(PatchPair(patches[i], defaultStatus));
+            patchList.append(PatchPair(patches[i], oldBytes, newBytes, defaultStatus));
             mPatches.insert(mod, patchList);
         }
     }
@@ -148,9 +157,9 @@ void PatchDialog::updatePatches()
             if(!isPartOfPreviousGroup(curPatchList, j))
                 group++;
             curPatchList[j].status.group = group;
-            unsigned char byte;
-            if(DbgMemRead(curPatchList[j].patch.addr, &byte, sizeof(byte)))
-                curPatchList[j].status.checked = byte == curPatchList[j].patch.newbyte;
+            QByteArray bytes(curPatchList[j].newBytes.size(), '\0');
+            if(DbgMemRead(curPatchList[j].patch.addr, (unsigned char*)bytes.data(), bytes.size()))
+                curPatchList[j].status.checked = bytes == curPatchList[j].newBytes;
         }
         ui->listModules->addItem(i.key());
     }
@@ -180,9 +189,7 @@ void PatchDialog::groupToggle()
             continue;
         ui->listPatches->item(i)->setCheckState(checkState);
         curPatchList[i].status.checked = enabled;
-        //change the byte to reflect the change for the user (cypherpunk reported this)
-        unsigned char writebyte = curPatchList[i].status.checked ? curPatchList[i].patch.newbyte : curPatchList[i].patch.oldbyte;
-        DbgMemWrite(curPatchList[i].patch.addr, &writebyte, sizeof(writebyte));
+        writePatchBytes(curPatchList[i]);
     }
     GuiUpdateAllViews();
     mIsWorking = false;
@@ -260,9 +267,18 @@ void PatchDialog::on_listModules_itemSelectionChanged()
     ui->listPatches->clear();
     for(int i = 0; i < patchList.size(); i++)
     {
-        const DBGPATCHINFO curPatch = patchList.at(i).patch;
-        QString addrText = QString("%1").arg(curPatch.addr, sizeof(dsint) * 2, 16, QChar('0')).toUpper();
-        QListWidgetItem* item = new QListWidgetItem(QString().sprintf("%d", patchList.at(i).status.group).rightJustified(4, ' ', true) + "|" + addrText + QString().sprintf(":%.2X->%.2X", curPatch.oldbyte, curPatch.newbyte), ui->listPatches);
+        const PatchPair & curPatch = patchList.at(i);
+        QString addrText = QString("%1").arg(curPatch.patch.addr, sizeof(dsint) * 2, 16, QChar('0')).toUpper();
+        //long ranges only show their first bytes
+        const int maxBytes = 8;
+        QString oldText = QString(curPatch.oldBytes.left(maxBytes).toHex()).toUpper();
+        QString newText = QString(curPatch.newBytes.left(maxBytes).toHex()).toUpper();
+        if(curPatch.newBytes.size() > maxBytes)
+        {
+            oldText += "...";
+            newText += QString().sprintf("... (%d bytes)", curPatch.newBytes.size());
+        }
+        QListWidgetItem* item = new QListWidgetItem(QString().sprintf("%d", curPatch.status.group).rightJustified(4, ' ', true) + "|" + addrText + ":" + oldText + "->" + newText, ui->listPatches);
         item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
         Qt::CheckState state = patchList.at(i).status.checked ? Qt::Checked : Qt::Unchecked;
         item->setCheckState(state);
@@ -284,9 +300,7 @@ void PatchDialog::on_listPatches_itemChanged(QListWidgetItem* item) //checkbox c
     if(patch.status.checked == checked) //check state did not change
         return;
     patch.status.checked = checked;
-    //change the byte to reflect the change for the user (cypherpunk reported this)
-    unsigned char writebyte = patch.status.checked ? patch.patch.newbyte : patch.patch.oldbyte;
-    DbgMemWrite(patch.patch.addr, &writebyte, sizeof(writebyte));
+    writePatchBytes(patch);
     //check state changed
     if((QApplication::keyboardModifiers() & Qt::ControlModifier) != Qt::ControlModifier)
     {
@@ -298,9 +312,7 @@ void PatchDialog::on_listPatches_itemChanged(QListWidgetItem* item) //checkbox c
                 //change the patch state
                 curPatchList[i].status.checked = checked;
                 ui->listPatches->item(i)->setCheckState(item->checkState());
-                //change the byte to reflect the change for the user (cypherpunk reported this)
-                unsigned char writebyte = curPatchList[i].status.checked ? curPatchList[i].patch.newbyte : curPatchList[i].patch.oldbyte;
-                DbgMemWrite(curPatchList[i].patch.addr, &writebyte, sizeof(writebyte));
+                writePatchBytes(curPatchList[i]);
             }
         mIsWorking = false;
     }
@@ -328,8 +340,7 @@ void PatchDialog::on_btnSelectAll_clicked()
     {
         ui->listPatches->item(i)->setCheckState(Qt::Checked);
         curPatchList[i].status.checked = true;
-        //change the byte to reflect the change for the user (cypherpunk reported this)
-        DbgMemWrite(curPatchList[i].patch.addr, &curPatchList[i].patch.newbyte, sizeof(unsigned char));
+        writePatchBytes(curPatchList[i]);
     }
     GuiUpdateAllViews();
     mIsWorking = false;
@@ -349,8 +360,7 @@ void PatchDialog::on_btnDeselectAll_clicked()
     {
         ui->listPatches->item(i)->setCheckState(Qt::Unchecked);
         curPatchList[i].status.checked = false;
-        //change the byte to reflect the change for the user (cypherpunk reported this)
-        DbgMemWrite(curPatchList[i].patch.addr, &curPatchList[i].patch.oldbyte, sizeof(unsigned char));
+        writePatchBytes(curPatchList[i]);
     }
     GuiUpdateAllViews();
     mIsWorking = false;
@@ -367,16 +377,15 @@ void PatchDialog::on_btnRestoreSelected_clicked()
         return;
     mIsWorking = true;
     PatchInfoList & curPatchList = found.value();
-    int removed = 0;
+    //restoring a range refreshes the patches (and mPatches), so collect the ranges first
+    QList<DBGPATCHRANGE> restoreList;
     int total = curPatchList.size();
     for(int i = 0; i < total; i++)
-    {
         if(curPatchList.at(i).status.checked)
-        {
-            DbgFunctions()->PatchRestore(curPatchList.at(i).patch.addr);
-            removed++;
-        }
-    }
+            restoreList.push_back(curPatchList.at(i).patch);
+    int removed = restoreList.size();
+    for(int i = 0; i < restoreList.size(); i++)
+        DbgFunctions()->PatchRestoreRange(restoreList.at(i).addr, restoreList.at(i).addr + restoreList.at(i).size - 1);
     mIsWorking = false;
     updatePatches();
     if(removed != total)
@@ -439,10 +448,14 @@ void PatchDialog::on_btnPatchFile_clicked()
     PatchInfoList & curPatchList = found.value();
 
     //get patches to save
-    QList<DBGPATCHINFO> patchList;
+    QList<DBGPATCHRANGE> patchList;
+    int patchBytes = 0;
     for(int i = 0; i < curPatchList.size(); i++)
         if(curPatchList.at(i).status.checked)
+        {
             patchList.push_back(curPatchList.at(i).patch);
+            patchBytes += (int)curPatchList.at(i).patch.size;
+        }
     if(!curPatchList.size() || !patchList.size())
     {
         QMessageBox msg(QMessageBox::Information, "Information", "Nothing to patch!");
@@ -476,11 +489,11 @@ void PatchDialog::on_btnPatchFile_clicked()
     filename = QDir::toNativeSeparators(filename); //convert to native path format (with backlashes)
 
     //call patchSave function
-    DBGPATCHINFO* dbgPatchList = new DBGPATCHINFO[patchList.size()];
+    DBGPATCHRANGE* dbgPatchList = new DBGPATCHRANGE[patchList.size()];
     for(int i = 0; i < patchList.size(); i++)
         dbgPatchList[i] = patchList.at(i);
     char error[MAX_ERROR_SIZE] = "";
-    int patched = DbgFunctions()->PatchFile(dbgPatchList, patchList.size(), filename.toUtf8().constData(), error);
+    int patched = DbgFunctions()->PatchFileRange(dbgPatchList, patchList.size(), filename.toUtf8().constData(), error);
     delete [] dbgPatchList;
     if(patched == -1)
     {
@@ -490,7 +503,7 @@ void PatchDialog::on_btnPatchFile_clicked()
         msg.exec();
         return;
     }
-    QMessageBox msg(QMessageBox::Information, "Information", QString().sprintf("%d/%d patch(es) applied!", patched, patchList.size()));
+    QMessageBox msg(QMessageBox::Information, "Information", QString().sprintf("%d/%d patched byte(s) applied!", patched, patchBytes));
     msg.setWindowIcon(QIcon(":/icons/images/information.png"));
     msg.setParent(this, Qt::Dialog);
     msg.setWindowFlags(msg.windowFlags() & (~Qt::WindowContextHelpButtonHint));
@@ -653,16 +666,21 @@ void PatchDialog::on_btnExport_clicked()
             continue;
         for(int j = 0; j < curPatchList.size(); j++)
         {
-            if(!curPatchList.at(j).status.checked) //skip unchecked patches
+            const PatchPair & curPatch = curPatchList.at(j);
+            if(!curPatch.status.checked) //skip unchecked patches
                 continue;
             if(!bModPlaced)
             {
                 lines.push_back(">" + i.key());
                 bModPlaced = true;
             }
-            QString addrText = QString("%1").arg(curPatchList.at(j).patch.addr - modbase, sizeof(dsint) * 2, 16, QChar('0')).toUpper();
-            lines.push_back(addrText + QString().sprintf(":%.2X->%.2X", curPatchList.at(j).patch.oldbyte, curPatchList.at(j).patch.newbyte));
-            patches++;
+            //the file format has one line per byte
+            for(int k = 0; k < curPatch.newBytes.size(); k++)
+            {
+                QString addrText = QString("%1").arg(curPatch.patch.addr + k - modbase, sizeof(dsint) * 2, 16, QChar('0')).toUpper();
+                lines.push_back(addrText + QString().sprintf(":%.2X->%.2X", (unsigned char)curPatch.oldBytes.at(k), (unsigned char)curPatch.newBytes.at(k)));
+                patches++;
+            }
         }
     }
 
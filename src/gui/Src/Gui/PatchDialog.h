@@ -23,12 +23,16 @@ class PatchDialog : public QDialog
 
     struct PatchPair
     {
-        DBGPATCHINFO patch;
+        DBGPATCHRANGE patch;
+        QByteArray oldBytes;
+        QByteArray newBytes;
         STATUSINFO status;
 
-        PatchPair(const DBGPATCHINFO & patch, const STATUSINFO & status)
+        PatchPair(const DBGPATCHRANGE & patch, const QByteArray & oldBytes, const QByteArray & newBytes, const STATUSINFO & status)
         {
             this->patch = patch;
+            this->oldBytes = oldBytes;
+            this->newBytes = newBytes;
             this->status = status;
         }
     };
@@ -57,6 +61,7 @@ private:
     bool hasPreviousGroup(const PatchInfoList & patchList, int group);
     bool hasNextGroup(const PatchInfoList & patchList, int group);
     dsint getGroupAddress(const PatchInfoList & patchList, int group);
+    static void writePatchBytes(const PatchPair & patch);
 
 private slots:
     void dbgStateChanged(DBGSTATE state);
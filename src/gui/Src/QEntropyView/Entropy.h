@@ -2,16 +2,75 @@
 #define ENTROPY_H
 
 #include <cmath>
+#include <cstring>
 #include <vector>
+#include <thread>
+#include <functional>
+#include <algorithm>
+
+// Reads up to size bytes into buffer, returns the number of bytes read (<= 0 stops the measurement)
+typedef std::function<long long(unsigned char* buffer, long long size)> ENTROPYREADPROC;
+
+/**
+\brief Byte histogram of a sliding window. Every added or removed byte updates the entropy in O(1) with a precomputed c*log(c) table.
+*/
+class EntropyWindow
+{
+public:
+    explicit EntropyWindow(int blockSize)
+        : mTable(blockSize + 1)
+    {
+        for(int c = 1; c <= blockSize; c++)
+            mTable[c] = c * log((double)c);
+        Clear();
+    }
+
+    void Clear()
+    {
+        memset(mOccurrences, 0, sizeof(mOccurrences));
+        mSum = 0.0;
+        mCount = 0;
+    }
+
+    void Add(unsigned char byte)
+    {
+        int & occurrences = mOccurrences[byte];
+        mSum += mTable[occurrences + 1] - mTable[occurrences];
+        occurrences++;
+        mCount++;
+    }
+
+    void Remove(unsigned char byte)
+    {
+        int & occurrences = mOccurrences[byte];
+        mSum += mTable[occurrences - 1] - mTable[occurrences];
+        occurrences--;
+        mCount--;
+    }
+
+    double Value() const
+    {
+        // H = log(n) - sum(c * log(c)) / n, normalized to [0, 1]
+        if(!mCount)
+            return 0.0;
+        double entropy = (log((double)mCount) - mSum / mCount) / log(256.0);
+        return entropy < 0.0 ? 0.0 : entropy;
+    }
+
+private:
+    std::vector<double> mTable;
+    int mOccurrences[256];
+    double mSum;
+    int mCount;
+};
 
 class Entropy
 {
 public:
-    static double MeasureData(const unsigned char* data, int dataSize)
+    static double MeasureHistogram(const unsigned long long occurrences[256], unsigned long long dataSize)
     {
-        int occurrences[256] = {};
-        for(int i = 0; i < dataSize; i++)
-            occurrences[data[i]]++;
+        if(!dataSize)
+            return 0.0;
         double entropy = 0.0;
         double logBase = log(256);
         for(int i = 0; i < 256; i++)
@@ -24,43 +83,138 @@ public:
         return -entropy;
     }
 
-    static double MeasureByte(const unsigned char* data, int dataSize, int index, unsigned char* block, int blockSize)
+    static double MeasureData(const unsigned char* data, int dataSize)
     {
+        unsigned long long occurrences[256] = {};
+        for(int i = 0; i < dataSize; i++)
+            occurrences[data[i]]++;
+        return MeasureHistogram(occurrences, dataSize);
+    }
+
+    static void MeasurePoints(const unsigned char* data, int dataSize, int blockSize, std::vector<double> & points, int pointCount)
+    {
+        points.clear();
+        std::vector<long long> starts;
+        if(!pointStarts(dataSize, blockSize, pointCount, starts))
+            return;
+        points.resize(starts.size(), -1);
+        if(dataSize < blockSize)
+            return;
+
+        // Every thread slides its own window over a contiguous range of points
+        int threadCount = (int)std::thread::hardware_concurrency();
+        threadCount = std::max(1, std::min(threadCount, dataSize / (1024 * 1024) + 1));
+        threadCount = std::min(threadCount, (int)starts.size());
+        std::vector<std::thread> threads;
+        int perThread = ((int)starts.size() + threadCount - 1) / threadCount;
+        for(int t = 0; t < threadCount; t++)
+        {
+            int begin = t * perThread;
+            int end = std::min(begin + perThread, (int)starts.size());
+            if(begin >= end)
+                break;
+            auto measure = [data, blockSize, &starts, &points, begin, end]()
+            {
+                measureRange(data, blockSize, starts, points, begin, end);
+            };
+            if(t + 1 == threadCount)
+                measure();
+            else
+                threads.push_back(std::thread(measure));
+        }
+        for(auto & thread : threads)
+            thread.join();
+    }
+
+    static bool MeasureStream(const ENTROPYREADPROC & read, long long dataSize, int blockSize, std::vector<double> & points, int pointCount)
+    {
+        points.clear();
+        std::vector<long long> starts;
+        if(!pointStarts(dataSize, blockSize, pointCount, starts))
+            return true;
         if(dataSize < blockSize)
-            return -1;
-        int start = index - blockSize / 2;
-        int end = index + blockSize / 2;
-        if(start < 0)
         {
-            end += -start;
-            start = 0;
+            points.resize(starts.size(), -1);
+            return true;
         }
-        else if(end > dataSize)
+        points.reserve(starts.size());
+
+        // The last blockSize bytes are kept in a ring buffer, so they can be removed from the window again
+        EntropyWindow window(blockSize);
+        std::vector<unsigned char> ring(blockSize);
+        std::vector<unsigned char> buffer(1024 * 1024);
+        size_t next = 0;
+        long long position = 0;
+        while(position < dataSize && next < starts.size())
         {
-            start -= end - dataSize;
-            end = dataSize;
+            long long count = read(buffer.data(), std::min((long long)buffer.size(), dataSize - position));
+            if(count <= 0)
+                return false;
+            for(long long i = 0; i < count; i++, position++)
+            {
+                unsigned char & old = ring[position % blockSize];
+                if(position >= blockSize)
+                    window.Remove(old);
+                old = buffer[(size_t)i];
+                window.Add(old);
+                while(next < starts.size() && starts[next] + blockSize - 1 == position)
+                {
+                    points.push_back(window.Value());
+                    next++;
+                }
+            }
         }
-        for(int i = start; i < end; i++)
-            block[i - start] = data[i];
-        return MeasureData(block, blockSize);
+        return next == starts.size();
     }
 
-    static void MeasurePoints(const unsigned char* data, int dataSize, int blockSize, std::vector<double> & points, int pointCount)
+private:
+    // The window of every point is centered on it, but shifted to stay inside of the data
+    static bool pointStarts(long long dataSize, int blockSize, int pointCount, std::vector<long long> & starts)
     {
-        points.clear();
-        if(dataSize < pointCount)
-            return;
+        if(pointCount <= 0 || dataSize < pointCount)
+            return false;
         if(dataSize % pointCount != 0)
-            pointCount += dataSize % pointCount;
-
-        unsigned char* block = new unsigned char[blockSize];
-        int interval = dataSize / pointCount;
-        points.reserve(pointCount);
-        for(int i = 0; i < dataSize; i += interval)
-            points.push_back(MeasureByte(data, dataSize, i, block, blockSize));
-        delete[] block;
+            pointCount += (int)(dataSize % pointCount);
+        long long interval = dataSize / pointCount;
+        starts.reserve(pointCount);
+        for(long long i = 0; i < dataSize; i += interval)
+        {
+            long long start = i - blockSize / 2;
+            if(start + blockSize > dataSize)
+                start = dataSize - blockSize;
+            if(start < 0)
+                start = 0;
+            starts.push_back(start);
+        }
+        return true;
+    }
+
+    static void measureRange(const unsigned char* data, int blockSize, const std::vector<long long> & starts, std::vector<double> & points, int begin, int end)
+    {
+        EntropyWindow window(blockSize);
+        long long windowStart = -1;
+        for(int i = begin; i < end; i++)
+        {
+            long long start = starts[i];
+            if(windowStart < 0 || start >= windowStart + blockSize)
+            {
+                // No overlap with the previous window
+                window.Clear();
+                for(long long j = start; j < start + blockSize; j++)
+                    window.Add(data[j]);
+            }
+            else
+            {
+                for(long long j = windowStart; j < start; j++)
+                {
+                    window.Remove(data[j]);
+                    window.Add(data[j + blockSize]);
+                }
+            }
+            windowStart = start;
+            points[i] = window.Value();
+        }
     }
 };
 
 #endif // ENTROPY_H
-
@@ -0,0 +1,31 @@
+#include "EntropyThread.h"
+
+EntropyThread::EntropyThread(ENTROPYJOB job, QObject* parent) : QThread(parent), mJob(job), mStopThread(false)
+{
+}
+
+EntropyThread::~EntropyThread()
+{
+    stop();
+    wait();
+}
+
+void EntropyThread::stop()
+{
+    mStopThread = true;
+}
+
+bool EntropyThread::isStopped() const
+{
+    return mStopThread;
+}
+
+void EntropyThread::emitValueReady(int index, double value)
+{
+    emit valueReady(index, value);
+}
+
+void EntropyThread::run()
+{
+    mJob(this);
+}
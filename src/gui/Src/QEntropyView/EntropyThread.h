@@ -0,0 +1,30 @@
+#ifndef ENTROPYTHREAD_H
+#define ENTROPYTHREAD_H
+
+#include <QThread>
+#include <functional>
+
+class EntropyThread;
+typedef std::function<void(EntropyThread* thread)> ENTROPYJOB;
+
+class EntropyThread : public QThread
+{
+    Q_OBJECT
+public:
+    explicit EntropyThread(ENTROPYJOB job, QObject* parent = 0);
+    ~EntropyThread();
+    void stop();
+    bool isStopped() const;
+    void emitValueReady(int index, double value);
+
+signals:
+    void valueReady(int index, double value);
+
+private:
+    ENTROPYJOB mJob;
+    volatile bool mStopThread;
+
+    void run();
+};
+
+#endif // ENTROPYTHREAD_H
@@ -1,12 +1,18 @@
 #include "QEntropyView.h"
 #include <QFile>
 #include "Entropy.h"
+#include "EntropyThread.h"
 
-QEntropyView::QEntropyView(QWidget* parent) : QGraphicsView(parent)
+QEntropyView::QEntropyView(QWidget* parent) : QGraphicsView(parent), mThread(nullptr)
 {
     mScene = new QGraphicsScene(this);
 }
 
+QEntropyView::~QEntropyView()
+{
+    delete mThread;
+}
+
 void QEntropyView::InitializeGraph(int penSize)
 {
     //initialize scene
@@ -57,14 +63,45 @@ void QEntropyView::AddGraph(const std::vector<double> & points, QColor color)
 
 void QEntropyView::GraphFile(const QString & fileName, int blockSize, int pointCount, QColor color)
 {
-    QFile file(fileName);
-    if(!file.open(QIODevice::ReadOnly))
-        return;
-
-    QByteArray fileData = file.readAll();
-    file.close();
+    //the file is streamed on a background thread, the graph is added when it finished
+    if(mThread)
+    {
+        mThread->stop();
+        mThread->wait();
+        mThread->deleteLater(); //a queued finished signal is ignored by graphFinishedSlot
+    }
+    mPendingPoints.clear();
+    mPendingColor = color;
+    mThread = new EntropyThread([this, fileName, blockSize, pointCount](EntropyThread * thread)
+    {
+        QFile file(fileName);
+        if(!file.open(QIODevice::ReadOnly))
+            return;
+        qint64 dataSize = file.size();
+        int fileBlockSize = blockSize;
+        if(dataSize < fileBlockSize)
+            fileBlockSize = qMax(int(dataSize / 2), 1);
+        int filePointCount = int(qMin(qint64(pointCount), dataSize));
+        std::vector<double> points;
+        bool success = Entropy::MeasureStream([&file, thread](unsigned char * buffer, long long size) -> long long
+        {
+            if(thread->isStopped())
+                return -1;
+            return file.read((char*)buffer, size);
+        }, dataSize, fileBlockSize, points, filePointCount);
+        if(success)
+            mPendingPoints.swap(points);
+    });
+    connect(mThread, SIGNAL(finished()), this, SLOT(graphFinishedSlot()));
+    mThread->start();
+}
 
-    GraphMemory((unsigned char*)fileData.constData(), fileData.size(), blockSize, pointCount, color);
+void QEntropyView::graphFinishedSlot()
+{
+    if(sender() != mThread)
+        return;
+    AddGraph(mPendingPoints, mPendingColor);
+    mPendingPoints.clear();
 }
 
 void QEntropyView::GraphMemory(const unsigned char* data, int dataSize, int blockSize, int pointCount, QColor color)
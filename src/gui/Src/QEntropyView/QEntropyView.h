@@ -4,20 +4,29 @@
 #include <QGraphicsView>
 #include <QGraphicsScene>
 
+class EntropyThread;
+
 class QEntropyView : public QGraphicsView
 {
     Q_OBJECT
 public:
     explicit QEntropyView(QWidget* parent = 0);
+    ~QEntropyView();
     void InitializeGraph(int penSize = 1);
     void AddGraph(const std::vector<double> & points, QColor color = Qt::black);
     void GraphFile(const QString & fileName, int blockSize, int pointCount, QColor = Qt::black);
     void GraphMemory(const unsigned char* data, int dataSize, int blockSize, int pointCount, QColor = Qt::black);
 
+private slots:
+    void graphFinishedSlot();
+
 private:
     QGraphicsScene* mScene;
     QRectF mRect;
     int mPenSize;
+    EntropyThread* mThread;
+    std::vector<double> mPendingPoints;
+    QColor mPendingColor;
 };
 
 #endif // QENTROPYVIEW_H
@@ -136,6 +136,7 @@ SOURCES += \
     Src/Gui/TimeWastedCounter.cpp \
     Src/Utils/FlickerThread.cpp \
     Src/QEntropyView/QEntropyView.cpp \
+    Src/QEntropyView/EntropyThread.cpp \
     Src/Gui/EntropyDialog.cpp \
     Src/Gui/NotesManager.cpp \
     Src/Gui/NotepadView.cpp \
@@ -216,6 +217,7 @@ HEADERS += \
     Src/Utils/FlickerThread.h \
     Src/QEntropyView/Entropy.h \
     Src/QEntropyView/QEntropyView.h \
+    Src/QEntropyView/EntropyThread.h \
     Src/Gui/EntropyDialog.h \
     Src/Gui/NotesManager.h \
     Src/Gui/NotepadView.h \